@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CompressedReplayStreamer.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+#include "Modules/ModuleManager.h"
+
+namespace CompressedReplayStreamer
+{
+	static FString Compressor(TEXT("Oodle"));
+	static FAutoConsoleVariableRef CVarCompressor(
+		TEXT("ReplayStreaming.Compressor"),
+		Compressor,
+		TEXT("Compression format of new replay chunks: Oodle, Zlib, Gzip or LZ4. Playback reads whatever the file was written with."));
+
+	/** Uncompressed size, then the format's name index, then the payload */
+	static constexpr int32 HeaderSize = sizeof(int32) + sizeof(int32);
+
+	static const FName Formats[] = {NAME_Oodle, NAME_Zlib, NAME_Gzip, NAME_LZ4};
+}
+
+bool FCompressedReplayStreamer::CompressBuffer(const TArray<uint8>& InBuffer, TArray<uint8>& OutCompressed) const
+{
+	using namespace CompressedReplayStreamer;
+
+	int32 FormatIndex = 0;
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(Formats); ++Index)
+	{
+		if (Formats[Index] == FName(*Compressor))
+		{
+			FormatIndex = Index;
+		}
+	}
+	const FName Format = Formats[FormatIndex];
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(Format, InBuffer.Num());
+	OutCompressed.SetNumUninitialized(HeaderSize + CompressedSize);
+	if (!FCompression::CompressMemory(Format, OutCompressed.GetData() + HeaderSize, CompressedSize, InBuffer.GetData(), InBuffer.Num()))
+	{
+		return false;
+	}
+
+	const int32 UncompressedSize = InBuffer.Num();
+	FMemory::Memcpy(OutCompressed.GetData(), &UncompressedSize, sizeof(int32));
+	FMemory::Memcpy(OutCompressed.GetData() + sizeof(int32), &FormatIndex, sizeof(int32));
+	OutCompressed.SetNum(HeaderSize + CompressedSize, EAllowShrinking::No);
+	return true;
+}
+
+bool FCompressedReplayStreamer::DecompressBuffer(const TArray<uint8>& InCompressed, TArray<uint8>& OutBuffer) const
+{
+	using namespace CompressedReplayStreamer;
+
+	if (InCompressed.Num() < HeaderSize)
+	{
+		return false;
+	}
+
+	int32 UncompressedSize = 0;
+	int32 FormatIndex = 0;
+	FMemory::Memcpy(&UncompressedSize, InCompressed.GetData(), sizeof(int32));
+	FMemory::Memcpy(&FormatIndex, InCompressed.GetData() + sizeof(int32), sizeof(int32));
+	if (UncompressedSize < 0 || FormatIndex < 0 || FormatIndex >= UE_ARRAY_COUNT(Formats))
+	{
+		return false;
+	}
+
+	OutBuffer.SetNumUninitialized(UncompressedSize);
+	return FCompression::UncompressMemory(Formats[FormatIndex], OutBuffer.GetData(), UncompressedSize, InCompressed.GetData() + HeaderSize, InCompressed.Num() - HeaderSize);
+}
+
+TSharedPtr<INetworkReplayStreamer> FMultiplayerReplayStreamingModule::CreateReplayStreamer()
+{
+	//Ticked by the base factory like its own streamers
+	TSharedPtr<FCompressedReplayStreamer> Streamer = MakeShared<FCompressedReplayStreamer>();
+	LocalFileStreamers.Add(Streamer);
+	return Streamer;
+}
+
+IMPLEMENT_MODULE(FMultiplayerReplayStreamingModule, MultiplayerReplayStreaming)
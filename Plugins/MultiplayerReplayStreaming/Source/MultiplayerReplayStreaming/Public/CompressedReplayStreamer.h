@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LocalFileNetworkReplayStreaming.h"
+
+/**
+ * The engine's local file replay streamer (chunked .replay files under Saved/Demos, only the chunk being recorded
+ * is held in memory and file requests run off the game thread) with every stream chunk and checkpoint compressed.
+ * A 100 player match is mostly movement deltas and compresses well; playback reads the same files back.
+ * A chunk is stored as its uncompressed size and the compressor it was written with (ReplayStreaming.Compressor,
+ * Oodle by default), then the payload.
+ */
+class MULTIPLAYERREPLAYSTREAMING_API FCompressedReplayStreamer : public FLocalFileNetworkReplayStreamer
+{
+public:
+	virtual bool SupportsCompression() const override { return true; }
+	virtual bool CompressBuffer(const TArray<uint8>& InBuffer, TArray<uint8>& OutCompressed) const override;
+	virtual bool DecompressBuffer(const TArray<uint8>& InCompressed, TArray<uint8>& OutBuffer) const override;
+};
+
+/**
+ * The module is the streamer factory, record or play with "ReplayStreamerOverride=MultiplayerReplayStreaming" in
+ * the replay's options.
+ */
+class FMultiplayerReplayStreamingModule : public FLocalFileNetworkReplayStreamingFactory
+{
+public:
+	virtual TSharedPtr<INetworkReplayStreamer> CreateReplayStreamer() override;
+};
@@ -6,16 +6,32 @@
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Engine/GameInstance.h"
-#include "Engine/Engine.h"
+#include "HAL/PlatformTime.h"
+#include "MultiplayerOnlineServices.h"
+#include "MultiplayerTelemetry.h"
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerJoinFunnel.h"
 
 void UMenu::MenuSetup(int32 NumberOfPublicConnections, FString TypeOfMatch, FString LobbyPath)
 {
     PathToLobby = FString::Printf(TEXT("%s?listen"),*LobbyPath);
     NumPublicConnections = NumberOfPublicConnections;
-    MatchType = TypeOfMatch;
+    //Strings stop at the Blueprint boundary, everything past here compares the enum
+    if (!LexTryParseString(MatchType, *TypeOfMatch))
+    {
+        UE_LOG(LogMultiplayerSessions, Warning, TEXT("Unknown match type %s, using %s"), *TypeOfMatch, LexToString(MatchType));
+    }
     AddToViewport();
     SetVisibility(ESlateVisibility::Visible);
 
+    //Cold start to main menu, what deferring the online work is meant to shorten
+    static bool bLoggedStartup = false;
+    if (!bLoggedStartup)
+    {
+        bLoggedStartup = true;
+        UE_LOG(LogMultiplayerSessions, Display, TEXT("Main menu up %.2f s after process start"), FPlatformTime::Seconds() - GStartTime);
+    }
+
     UWorld* World = GetWorld();
     if (World)
     {
@@ -74,77 +90,76 @@ void UMenu::NativeDestruct()
 
 void UMenu::OnCreateSession(bool bWasSuccessful)
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMenu::OnCreateSession);
+    //Success and failure are both recorded by the subsystem
     if (bWasSuccessful)
     {
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, TEXT("Session created successfully!"));
-        }
         UWorld* World = GetWorld();
         if (World)
         {
+            TRACE_BOOKMARK(TEXT("ServerTravel %s"), *PathToLobby);
             World->ServerTravel(PathToLobby);
         }
     }
-    else
-    {
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, TEXT("Failed to create Session!"));
-        }
-    }
 }
 
 void UMenu::OnFindSession(const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful)
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMenu::OnFindSession);
     if (MultiplayerSessionSubsystem == nullptr || !bWasSuccessful)
     {
         return;
     }
     
-    for (auto Result : SessionResults)
+    const int32 ResultIndex = FindMatchingResult(SessionResults, MatchType);
+    if (ResultIndex != INDEX_NONE)
     {
-        FString SettingValue;
-        Result.Session.SessionSettings.Get(FName("MatchType"), SettingValue);
-        if (SettingValue.Equals(MatchType))
-        {
-            MultiplayerSessionSubsystem->JoinSession(Result);
-            return;
-        }
+        MultiplayerSessionSubsystem->JoinSession(SessionResults[ResultIndex]);
+        return;
     }
     
     // 如果没有找到匹配的会话
-    if (GEngine)
+    MULTIPLAYER_TELEMETRY(NoMatchingSession, NAME_None, SessionResults.Num());
+}
+
+int32 UMenu::FindMatchingResult(const TArray<FOnlineSessionSearchResult>& SessionResults, EMultiplayerMatchType MatchType)
+{
+    return SessionResults.IndexOfByPredicate([MatchType](const FOnlineSessionSearchResult& Result)
     {
-        GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Yellow, TEXT("No matching sessions found"));
-    }
+        return FMultiplayerSessionMode::Read(Result.Session.SessionSettings).MatchType == MatchType;
+    });
 }
 
 void UMenu::OnJoinSession(EOnJoinSessionCompleteResult::Type Result)
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMenu::OnJoinSession);
+    //Failures are recorded by the subsystem
     if (Result != EOnJoinSessionCompleteResult::Success)
     {
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, FString::Printf(TEXT("Join failed: %d"), (int32)Result));
-        }
         return;
     }
     
-    IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
-    if (Subsystem)
+    IOnlineSessionPtr SessionInterface = FMultiplayerOnlineServices::Get().GetSessionInterface();
+    if (SessionInterface.IsValid())
     {
-        IOnlineSessionPtr SessionInterface = Subsystem->GetSessionInterface();
-        if (SessionInterface.IsValid())
+        FString Address;
+        if (!SessionInterface->GetResolvedConnectString(NAME_GameSession, Address))
+        {
+            MULTIPLAYER_TELEMETRY(ConnectStringFailed, NAME_GameSession);
+            return;
+        }
+        MULTIPLAYER_TELEMETRY(ConnectStringResolved, NAME_GameSession);
+
+        //The host picks the id up from the login options and logs its side of the join
+        const FString JoinCorrelationId = MultiplayerSessionSubsystem ? MultiplayerSessionSubsystem->GetJoinCorrelationId() : FString();
+        Address = FMultiplayerJoinFunnel::AppendToURL(Address, JoinCorrelationId);
+
+        APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
+        if (PlayerController)
         {
-            FString Address;
-            SessionInterface->GetResolvedConnectString(NAME_GameSession, Address);
-
-            APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
-            if (PlayerController)
-            {
-                PlayerController->ClientTravel(Address, TRAVEL_Absolute);
-            }
+            TRACE_BOOKMARK(TEXT("ClientTravel GameSession"));
+            FMultiplayerJoinFunnel::LogPhase(JoinCorrelationId, EMultiplayerJoinPhase::ClientTravel);
+            PlayerController->ClientTravel(Address, TRAVEL_Absolute);
         }
     }
 }
@@ -161,6 +176,7 @@ void UMenu::OnStartSession(bool bWasSuccessful)
 
 void UMenu::HostButtonClicked()
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMenu::HostButtonClicked);
     if (MultiplayerSessionSubsystem)
     {
         MultiplayerSessionSubsystem->CreateSession(NumPublicConnections, MatchType);
@@ -169,8 +185,10 @@ void UMenu::HostButtonClicked()
 
 void UMenu::JoinButtonClicked()
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMenu::JoinButtonClicked);
     if (MultiplayerSessionSubsystem)
     {
+        MultiplayerSessionSubsystem->StartJoinFunnel();
         MultiplayerSessionSubsystem->FindSession(10000);
     }
 }
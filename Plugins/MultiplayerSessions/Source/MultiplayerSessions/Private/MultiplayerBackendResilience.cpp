@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerBackendResilience.h"
+
+const TCHAR* LexToString(EMultiplayerBackendOp Op)
+{
+	switch (Op)
+	{
+	case EMultiplayerBackendOp::CreateSession:	return TEXT("CreateSession");
+	case EMultiplayerBackendOp::FindSessions:	return TEXT("FindSessions");
+	case EMultiplayerBackendOp::JoinSession:	return TEXT("JoinSession");
+	case EMultiplayerBackendOp::UpdateSession:	return TEXT("UpdateSession");
+	default:									return TEXT("Unknown");
+	}
+}
+
+void FMultiplayerCircuitBreaker::Configure(int32 InFailureThreshold, double InOpenSeconds)
+{
+	FailureThreshold = FMath::Max(1, InFailureThreshold);
+	OpenSeconds = FMath::Max(0.0, InOpenSeconds);
+}
+
+bool FMultiplayerCircuitBreaker::AllowRequest(double Now)
+{
+	switch (State)
+	{
+	case EState::Open:
+		if (Now < OpenUntil)
+		{
+			return false;
+		}
+		State = EState::HalfOpen;
+		bProbeInFlight = true;
+		return true;
+	case EState::HalfOpen:
+		if (bProbeInFlight)
+		{
+			return false;
+		}
+		bProbeInFlight = true;
+		return true;
+	default:
+		return true;
+	}
+}
+
+bool FMultiplayerCircuitBreaker::RecordSuccess()
+{
+	const bool bWasOpen = State != EState::Closed;
+	State = EState::Closed;
+	ConsecutiveFailures = 0;
+	bProbeInFlight = false;
+	return bWasOpen;
+}
+
+bool FMultiplayerCircuitBreaker::RecordFailure(double Now)
+{
+	++ConsecutiveFailures;
+	bProbeInFlight = false;
+
+	//A failed probe reopens right away, otherwise it takes a run of failures
+	if (State == EState::HalfOpen || (State == EState::Closed && ConsecutiveFailures >= FailureThreshold))
+	{
+		State = EState::Open;
+		OpenUntil = Now + OpenSeconds;
+		++NumOpens;
+		return true;
+	}
+	return false;
+}
+
+void FMultiplayerCircuitBreaker::Reset()
+{
+	State = EState::Closed;
+	ConsecutiveFailures = 0;
+	OpenUntil = 0.0;
+	bProbeInFlight = false;
+}
+
+float MultiplayerBackendResilience::GetBackoffDelay(int32 Retry, float BaseDelay, float MaxDelay)
+{
+	//Half fixed, half jitter: never instant, and clients that failed together don't all come back together
+	const float Ceiling = FMath::Min(MaxDelay, BaseDelay * FMath::Pow(2.f, static_cast<float>(FMath::Clamp(Retry - 1, 0, 16))));
+	return Ceiling * 0.5f + FMath::FRandRange(0.f, Ceiling * 0.5f);
+}
@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerIdentitySubsystem.h"
+#include "MultiplayerOnlineServices.h"
+#include "MultiplayerTelemetry.h"
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+
+void UMultiplayerIdentitySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	IdentityInterface = FMultiplayerOnlineServices::Get().GetIdentityInterface();
+	BindIdentityInterface();
+	OnlineServicesReadyHandle = FMultiplayerOnlineServices::Get().OnOnlineServicesReady.AddUObject(this, &ThisClass::OnOnlineServicesReady);
+}
+
+void UMultiplayerIdentitySubsystem::Deinitialize()
+{
+	FMultiplayerOnlineServices::Get().OnOnlineServicesReady.Remove(OnlineServicesReadyHandle);
+	UnbindIdentityInterface();
+	IdentityInterface.Reset();
+	Invalidate();
+
+	Super::Deinitialize();
+}
+
+void UMultiplayerIdentitySubsystem::BindIdentityInterface()
+{
+	if (!IdentityInterface.IsValid())
+	{
+		return;
+	}
+
+	for (int32 LocalUserNum = 0; LocalUserNum < MAX_LOCAL_PLAYERS; ++LocalUserNum)
+	{
+		LoginStatusChangedDelegateHandles[LocalUserNum] = IdentityInterface->AddOnLoginStatusChangedDelegate_Handle(
+			LocalUserNum, FOnLoginStatusChangedDelegate::CreateUObject(this, &ThisClass::OnLoginStatusChanged));
+		LoginCompleteDelegateHandles[LocalUserNum] = IdentityInterface->AddOnLoginCompleteDelegate_Handle(
+			LocalUserNum, FOnLoginCompleteDelegate::CreateUObject(this, &ThisClass::OnLoginComplete));
+	}
+}
+
+void UMultiplayerIdentitySubsystem::UnbindIdentityInterface()
+{
+	if (!IdentityInterface.IsValid())
+	{
+		return;
+	}
+
+	for (int32 LocalUserNum = 0; LocalUserNum < MAX_LOCAL_PLAYERS; ++LocalUserNum)
+	{
+		IdentityInterface->ClearOnLoginStatusChangedDelegate_Handle(LocalUserNum, LoginStatusChangedDelegateHandles[LocalUserNum]);
+		IdentityInterface->ClearOnLoginCompleteDelegate_Handle(LocalUserNum, LoginCompleteDelegateHandles[LocalUserNum]);
+	}
+}
+
+void UMultiplayerIdentitySubsystem::OnOnlineServicesReady()
+{
+	UnbindIdentityInterface();
+	IdentityInterface = FMultiplayerOnlineServices::Get().GetIdentityInterface();
+	BindIdentityInterface();
+
+	//Ids resolved without the interface came from the local players, the online ones may differ
+	Invalidate();
+	for (const ULocalPlayer* LocalPlayer : GetGameInstance()->GetLocalPlayers())
+	{
+		if (LocalPlayer)
+		{
+			MultiplayerOnNetIdChanged.Broadcast(LocalPlayer->GetControllerId(), GetNetId(LocalPlayer->GetControllerId()));
+		}
+	}
+}
+
+FUniqueNetIdRepl UMultiplayerIdentitySubsystem::GetNetId(int32 LocalUserNum)
+{
+	if (LocalUserNum < 0 || LocalUserNum >= MAX_LOCAL_PLAYERS)
+	{
+		return FUniqueNetIdRepl();
+	}
+
+	FCachedNetId& Cached = CachedNetIds[LocalUserNum];
+	if (!Cached.bResolved)
+	{
+		Cached.NetId = ResolveNetId(LocalUserNum);
+		//Only cache once the identity interface exists, otherwise there is nobody to tell us to refresh
+		Cached.bResolved = IdentityInterface.IsValid();
+	}
+	return Cached.NetId;
+}
+
+FUniqueNetIdRepl UMultiplayerIdentitySubsystem::GetNetIdForLocalPlayer(const ULocalPlayer* LocalPlayer)
+{
+	if (LocalPlayer == nullptr)
+	{
+		LocalPlayer = GetGameInstance()->GetFirstGamePlayer();
+	}
+	return LocalPlayer ? GetNetId(LocalPlayer->GetControllerId()) : FUniqueNetIdRepl();
+}
+
+ELoginStatus::Type UMultiplayerIdentitySubsystem::GetLoginStatus(int32 LocalUserNum) const
+{
+	return IdentityInterface.IsValid() ? IdentityInterface->GetLoginStatus(LocalUserNum) : ELoginStatus::NotLoggedIn;
+}
+
+void UMultiplayerIdentitySubsystem::Invalidate(int32 LocalUserNum)
+{
+	if (LocalUserNum == INDEX_NONE)
+	{
+		for (FCachedNetId& Cached : CachedNetIds)
+		{
+			Cached = FCachedNetId();
+		}
+	}
+	else if (LocalUserNum >= 0 && LocalUserNum < MAX_LOCAL_PLAYERS)
+	{
+		CachedNetIds[LocalUserNum] = FCachedNetId();
+	}
+}
+
+FString UMultiplayerIdentitySubsystem::NetIdToString(const FUniqueNetIdRepl& NetId)
+{
+	if (!NetId.IsValid())
+	{
+		return TEXT("Invalid_NetId");
+	}
+
+	// 使用 GetUniqueNetId() 方法获取原始指针
+	if (const FUniqueNetId* RawNetId = NetId.GetUniqueNetId().Get())
+	{
+		return RawNetId->ToString();
+	}
+
+	return TEXT("Invalid_RawNetId");
+}
+
+FUniqueNetIdRepl UMultiplayerIdentitySubsystem::ResolveNetId(int32 LocalUserNum) const
+{
+	// 首先尝试从身份接口获取
+	if (IdentityInterface.IsValid())
+	{
+		TSharedPtr<const FUniqueNetId> NetIdPtr = IdentityInterface->GetUniquePlayerId(LocalUserNum);
+		if (NetIdPtr.IsValid())
+		{
+			FUniqueNetIdRepl NetIdRepl(NetIdPtr);
+			MULTIPLAYER_TELEMETRY(NetIdResolved, NAME_None, LocalUserNum, 0);
+			return NetIdRepl;
+		}
+	}
+
+	// 如果身份接口没有，尝试其他方法
+	const ULocalPlayer* LocalPlayer = FindLocalPlayer(LocalUserNum);
+	if (LocalPlayer)
+	{
+		FUniqueNetIdRepl PreferredNetId = LocalPlayer->GetPreferredUniqueNetId();
+		if (PreferredNetId.IsValid())
+		{
+			MULTIPLAYER_TELEMETRY(NetIdResolved, NAME_None, LocalUserNum, 1);
+			return PreferredNetId;
+		}
+
+		FUniqueNetIdRepl CachedNetId = LocalPlayer->GetCachedUniqueNetId();
+		if (CachedNetId.IsValid())
+		{
+			MULTIPLAYER_TELEMETRY(NetIdResolved, NAME_None, LocalUserNum, 2);
+			return CachedNetId;
+		}
+	}
+
+	MULTIPLAYER_TELEMETRY(NetIdMissing, NAME_None, LocalUserNum);
+	return FUniqueNetIdRepl();
+}
+
+const ULocalPlayer* UMultiplayerIdentitySubsystem::FindLocalPlayer(int32 LocalUserNum) const
+{
+	for (const ULocalPlayer* LocalPlayer : GetGameInstance()->GetLocalPlayers())
+	{
+		if (LocalPlayer && LocalPlayer->GetControllerId() == LocalUserNum)
+		{
+			return LocalPlayer;
+		}
+	}
+	return nullptr;
+}
+
+void UMultiplayerIdentitySubsystem::OnLoginStatusChanged(int32 LocalUserNum, ELoginStatus::Type OldStatus, ELoginStatus::Type NewStatus, const FUniqueNetId& NewId)
+{
+	Invalidate(LocalUserNum);
+	MultiplayerOnNetIdChanged.Broadcast(LocalUserNum, GetNetId(LocalUserNum));
+}
+
+void UMultiplayerIdentitySubsystem::OnLoginComplete(int32 LocalUserNum, bool bWasSuccessful, const FUniqueNetId& UserId, const FString& Error)
+{
+	Invalidate(LocalUserNum);
+	MultiplayerOnNetIdChanged.Broadcast(LocalUserNum, GetNetId(LocalUserNum));
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerJoinFunnel.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Guid.h"
+
+DEFINE_LOG_CATEGORY(LogMultiplayerJoinFunnel);
+
+const TCHAR* const FMultiplayerJoinFunnel::UrlOption = TEXT("JoinId");
+
+const TCHAR* LexToString(EMultiplayerJoinPhase Phase)
+{
+	switch (Phase)
+	{
+	case EMultiplayerJoinPhase::JoinClicked:			return TEXT("JoinClicked");
+	case EMultiplayerJoinPhase::SearchCompleted:		return TEXT("SearchCompleted");
+	case EMultiplayerJoinPhase::ReservationCompleted:	return TEXT("ReservationCompleted");
+	case EMultiplayerJoinPhase::JoinSessionCompleted:	return TEXT("JoinSessionCompleted");
+	case EMultiplayerJoinPhase::ClientTravel:			return TEXT("ClientTravel");
+	case EMultiplayerJoinPhase::ServerPreLogin:			return TEXT("ServerPreLogin");
+	case EMultiplayerJoinPhase::ServerPostLogin:		return TEXT("ServerPostLogin");
+	default:											return TEXT("Unknown");
+	}
+}
+
+bool LexTryParseString(EMultiplayerJoinPhase& OutPhase, const TCHAR* Buffer)
+{
+	for (uint8 Phase = 0; Phase < static_cast<uint8>(EMultiplayerJoinPhase::Count); ++Phase)
+	{
+		if (FCString::Stricmp(Buffer, LexToString(static_cast<EMultiplayerJoinPhase>(Phase))) == 0)
+		{
+			OutPhase = static_cast<EMultiplayerJoinPhase>(Phase);
+			return true;
+		}
+	}
+	return false;
+}
+
+FString FMultiplayerJoinFunnel::NewCorrelationId()
+{
+	//Base36 keeps it URL safe without escaping
+	return FGuid::NewGuid().ToString(EGuidFormats::Base36Encoded);
+}
+
+FString FMultiplayerJoinFunnel::AppendToURL(const FString& URL, const FString& CorrelationId)
+{
+	if (CorrelationId.IsEmpty())
+	{
+		return URL;
+	}
+	return FString::Printf(TEXT("%s?%s=%s"), *URL, UrlOption, *CorrelationId);
+}
+
+FString FMultiplayerJoinFunnel::ParseFromOptions(const FString& Options)
+{
+	return UGameplayStatics::ParseOption(Options, UrlOption);
+}
+
+void FMultiplayerJoinFunnel::LogPhase(const FString& CorrelationId, EMultiplayerJoinPhase Phase)
+{
+	if (CorrelationId.IsEmpty())
+	{
+		return;
+	}
+
+	UE_LOG(LogMultiplayerJoinFunnel, Log, TEXT("JoinFunnel: id=%s phase=%s pid=%u utc=%s mono=%.6f"),
+		*CorrelationId, LexToString(Phase), FPlatformProcess::GetCurrentProcessId(), *FDateTime::UtcNow().ToIso8601(), FPlatformTime::Seconds());
+}
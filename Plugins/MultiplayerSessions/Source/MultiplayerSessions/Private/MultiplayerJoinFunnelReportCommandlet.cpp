@@ -0,0 +1,209 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerJoinFunnelReportCommandlet.h"
+#include "MultiplayerJoinFunnel.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+
+namespace MultiplayerJoinFunnelReport
+{
+	struct FPhaseStamp
+	{
+		bool bSet{false};
+		uint32 ProcessId{0};
+		FDateTime Utc;
+		double Mono{0.0};
+	};
+
+	struct FJoinTimeline
+	{
+		FPhaseStamp Phases[static_cast<int32>(EMultiplayerJoinPhase::Count)];
+
+		const FPhaseStamp& Get(EMultiplayerJoinPhase Phase) const { return Phases[static_cast<int32>(Phase)]; }
+	};
+
+	struct FSegment
+	{
+		const TCHAR* Name;
+		EMultiplayerJoinPhase From;
+		EMultiplayerJoinPhase To;
+	};
+
+	static const FSegment Segments[] =
+	{
+		{TEXT("Search"),		EMultiplayerJoinPhase::JoinClicked,				EMultiplayerJoinPhase::SearchCompleted},
+		{TEXT("ReserveAndJoin"),EMultiplayerJoinPhase::SearchCompleted,			EMultiplayerJoinPhase::JoinSessionCompleted},
+		{TEXT("ResolveAddress"),EMultiplayerJoinPhase::JoinSessionCompleted,	EMultiplayerJoinPhase::ClientTravel},
+		{TEXT("Handshake"),		EMultiplayerJoinPhase::ClientTravel,			EMultiplayerJoinPhase::ServerPreLogin},
+		{TEXT("MapLoad"),		EMultiplayerJoinPhase::ServerPreLogin,			EMultiplayerJoinPhase::ServerPostLogin},
+		{TEXT("Total"),			EMultiplayerJoinPhase::JoinClicked,				EMultiplayerJoinPhase::ServerPostLogin},
+	};
+	static constexpr int32 NumSegments = UE_ARRAY_COUNT(Segments);
+
+	/** Negative when either end is missing */
+	static double GetSeconds(const FJoinTimeline& Timeline, const FSegment& Segment)
+	{
+		const FPhaseStamp& From = Timeline.Get(Segment.From);
+		const FPhaseStamp& To = Timeline.Get(Segment.To);
+		if (!From.bSet || !To.bSet)
+		{
+			return -1.0;
+		}
+
+		//Inside one process the monotonic clock is exact, across processes only wall clock lines up
+		if (From.ProcessId == To.ProcessId)
+		{
+			return To.Mono - From.Mono;
+		}
+		return (To.Utc - From.Utc).GetTotalSeconds();
+	}
+
+	static double GetPercentile(const TArray<double>& Sorted, double Percentile)
+	{
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+		return Sorted[Index];
+	}
+
+	static bool ParseLine(const FString& Line, FString& OutId, EMultiplayerJoinPhase& OutPhase, FPhaseStamp& OutStamp)
+	{
+		const int32 Start = Line.Find(TEXT("JoinFunnel: "), ESearchCase::CaseSensitive);
+		if (Start == INDEX_NONE)
+		{
+			return false;
+		}
+
+		const TCHAR* Fields = *Line + Start;
+		FString PhaseName;
+		FString Utc;
+		if (!FParse::Value(Fields, TEXT(" id="), OutId) ||
+			!FParse::Value(Fields, TEXT(" phase="), PhaseName) ||
+			!FParse::Value(Fields, TEXT(" pid="), OutStamp.ProcessId) ||
+			!FParse::Value(Fields, TEXT(" utc="), Utc) ||
+			!FParse::Value(Fields, TEXT(" mono="), OutStamp.Mono))
+		{
+			return false;
+		}
+
+		OutStamp.bSet = LexTryParseString(OutPhase, *PhaseName) && FDateTime::ParseIso8601(*Utc, OutStamp.Utc);
+		return OutStamp.bSet;
+	}
+}
+
+UMultiplayerJoinFunnelReportCommandlet::UMultiplayerJoinFunnelReportCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UMultiplayerJoinFunnelReportCommandlet::Main(const FString& Params)
+{
+	using namespace MultiplayerJoinFunnelReport;
+
+	FString LogsParam;
+	if (!FParse::Value(*Params, TEXT("Logs="), LogsParam, false))
+	{
+		UE_LOG(LogMultiplayerJoinFunnel, Error, TEXT("Usage: -run=MultiplayerJoinFunnelReport -Logs=\"Client.log;Server.log\" [-Csv=Joins.csv] [-Timelines]"));
+		return 1;
+	}
+
+	TArray<FString> LogFiles;
+	LogsParam.ParseIntoArray(LogFiles, TEXT(";"));
+
+	//Client and server lines of the same join land in the same timeline through the id
+	TMap<FString, FJoinTimeline> Timelines;
+	for (const FString& LogFile : LogFiles)
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *LogFile))
+		{
+			UE_LOG(LogMultiplayerJoinFunnel, Error, TEXT("Could not read %s"), *LogFile);
+			return 1;
+		}
+
+		for (const FString& Line : Lines)
+		{
+			FString Id;
+			EMultiplayerJoinPhase Phase = EMultiplayerJoinPhase::Count;
+			FPhaseStamp Stamp;
+			if (ParseLine(Line, Id, Phase, Stamp))
+			{
+				Timelines.FindOrAdd(Id).Phases[static_cast<int32>(Phase)] = Stamp;
+			}
+		}
+	}
+
+	UE_LOG(LogMultiplayerJoinFunnel, Display, TEXT("%d joins in %d logs"), Timelines.Num(), LogFiles.Num());
+
+	const bool bPrintTimelines = FParse::Param(*Params, TEXT("Timelines"));
+	FString Csv = TEXT("JoinId");
+	for (const FSegment& Segment : Segments)
+	{
+		Csv += FString::Printf(TEXT(",%s"), Segment.Name);
+	}
+	Csv += LINE_TERMINATOR;
+
+	TArray<double> Durations[NumSegments];
+	for (const TPair<FString, FJoinTimeline>& Pair : Timelines)
+	{
+		FString Row = Pair.Key;
+		for (int32 SegmentIndex = 0; SegmentIndex < NumSegments; ++SegmentIndex)
+		{
+			const double Seconds = GetSeconds(Pair.Value, Segments[SegmentIndex]);
+			if (Seconds >= 0.0)
+			{
+				Durations[SegmentIndex].Add(Seconds);
+				Row += FString::Printf(TEXT(",%.3f"), Seconds);
+			}
+			else
+			{
+				Row += TEXT(",");
+			}
+		}
+		Csv += Row + LINE_TERMINATOR;
+
+		if (bPrintTimelines)
+		{
+			UE_LOG(LogMultiplayerJoinFunnel, Display, TEXT("%s"), *Row);
+		}
+	}
+
+	UE_LOG(LogMultiplayerJoinFunnel, Display, TEXT("%-16s %6s %9s %9s %9s %9s"), TEXT("Step"), TEXT("Joins"), TEXT("p50"), TEXT("p90"), TEXT("p99"), TEXT("max"));
+	const TCHAR* Bottleneck = nullptr;
+	double BottleneckP50 = -1.0;
+	for (int32 SegmentIndex = 0; SegmentIndex < NumSegments; ++SegmentIndex)
+	{
+		TArray<double>& Sorted = Durations[SegmentIndex];
+		if (Sorted.Num() == 0)
+		{
+			UE_LOG(LogMultiplayerJoinFunnel, Display, TEXT("%-16s %6d"), Segments[SegmentIndex].Name, 0);
+			continue;
+		}
+		Sorted.Sort();
+
+		const double P50 = GetPercentile(Sorted, 0.5);
+		UE_LOG(LogMultiplayerJoinFunnel, Display, TEXT("%-16s %6d %8.3fs %8.3fs %8.3fs %8.3fs"), Segments[SegmentIndex].Name, Sorted.Num(),
+			P50, GetPercentile(Sorted, 0.9), GetPercentile(Sorted, 0.99), Sorted.Last());
+
+		//The last segment is the whole join, not a step
+		if (SegmentIndex < NumSegments - 1 && P50 > BottleneckP50)
+		{
+			BottleneckP50 = P50;
+			Bottleneck = Segments[SegmentIndex].Name;
+		}
+	}
+	if (Bottleneck)
+	{
+		UE_LOG(LogMultiplayerJoinFunnel, Display, TEXT("Slowest step by median: %s (%.3fs)"), Bottleneck, BottleneckP50);
+	}
+
+	FString CsvPath;
+	if (FParse::Value(*Params, TEXT("Csv="), CsvPath) && !FFileHelper::SaveStringToFile(Csv, *CsvPath))
+	{
+		UE_LOG(LogMultiplayerJoinFunnel, Error, TEXT("Could not write %s"), *CsvPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerOnlineServices.h"
+#include "MultiplayerSessions.h"
+#include "MultiplayerTelemetry.h"
+#include "OnlineSubsystemNames.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Online Services Init"), STAT_MultiplayerOnlineServicesInit, STATGROUP_MultiplayerSessions);
+
+FMultiplayerOnlineServices& FMultiplayerOnlineServices::Get()
+{
+	static FMultiplayerOnlineServices Instance;
+	return Instance;
+}
+
+void FMultiplayerOnlineServices::Initialize()
+{
+	check(IsInGameThread());
+	if (bInitialized)
+	{
+		return;
+	}
+
+	//A subsystem that isn't there yet may still come up, its module can load late. Look again now and then,
+	//not on every call
+	const double Now = FPlatformTime::Seconds();
+	if (Now < NextResolveTime)
+	{
+		return;
+	}
+	NextResolveTime = Now + ResolveRetrySeconds;
+
+#if MULTIPLAYER_TELEMETRY_ENABLED
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+#endif
+	Resolve();
+	bInitialized = OnlineSubsystem != nullptr;
+	if (!bInitialized)
+	{
+		if (!RetryTickerHandle.IsValid())
+		{
+			RetryTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this](float DeltaTime)
+			{
+				//The ticker already waits ResolveRetrySeconds
+				NextResolveTime = 0.0;
+				Initialize();
+				return !bInitialized;
+			}), ResolveRetrySeconds);
+		}
+		return;
+	}
+
+	//Found by a caller before the ticker came round
+	if (RetryTickerHandle.IsValid())
+	{
+		FTSTicker::RemoveTicker(RetryTickerHandle);
+		RetryTickerHandle.Reset();
+	}
+	MULTIPLAYER_TELEMETRY(OnlineServicesReady, SubsystemName, static_cast<int64>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0));
+	OnOnlineServicesReady.Broadcast();
+}
+
+IOnlineSubsystem* FMultiplayerOnlineServices::GetOnlineSubsystem()
+{
+	Initialize();
+	return OnlineSubsystem;
+}
+
+IOnlineSessionPtr FMultiplayerOnlineServices::GetSessionInterface()
+{
+	Initialize();
+	if (SessionInterfaceOverride.IsValid())
+	{
+		return SessionInterfaceOverride;
+	}
+	IOnlineSessionPtr Pinned = SessionInterface.Pin();
+	if (!Pinned.IsValid() && OnlineSubsystem)
+	{
+		Resolve();
+		Pinned = SessionInterface.Pin();
+	}
+	return Pinned;
+}
+
+IOnlineIdentityPtr FMultiplayerOnlineServices::GetIdentityInterface()
+{
+	Initialize();
+	IOnlineIdentityPtr Pinned = IdentityInterface.Pin();
+	if (!Pinned.IsValid() && OnlineSubsystem)
+	{
+		Resolve();
+		Pinned = IdentityInterface.Pin();
+	}
+	return Pinned;
+}
+
+FName FMultiplayerOnlineServices::GetSubsystemName()
+{
+	Initialize();
+	return SubsystemName;
+}
+
+void FMultiplayerOnlineServices::SetSessionInterfaceOverride(IOnlineSessionPtr InSessionInterface)
+{
+	check(IsInGameThread());
+	SessionInterfaceOverride = InSessionInterface;
+	OnSessionInterfaceChanged.Broadcast();
+}
+
+bool FMultiplayerOnlineServices::IsLANOnly()
+{
+	return GetSubsystemName() == NULL_SUBSYSTEM;
+}
+
+void FMultiplayerOnlineServices::Resolve()
+{
+	SCOPE_CYCLE_COUNTER(STAT_MultiplayerOnlineServicesInit);
+
+	OnlineSubsystem = IOnlineSubsystem::Get();
+	if (OnlineSubsystem == nullptr)
+	{
+		if (!bReportedMissing)
+		{
+			bReportedMissing = true;
+			MULTIPLAYER_TELEMETRY(OnlineSubsystemMissing);
+		}
+		SubsystemName = NAME_None;
+		return;
+	}
+
+	SubsystemName = OnlineSubsystem->GetSubsystemName();
+	SessionInterface = OnlineSubsystem->GetSessionInterface();
+	IdentityInterface = OnlineSubsystem->GetIdentityInterface();
+}
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerReservationBeaconClient.h"
+#include "MultiplayerReservationBeaconHost.h"
+#include "Engine/NetConnection.h"
+
+AMultiplayerReservationBeaconClient::AMultiplayerReservationBeaconClient()
+{
+}
+
+bool AMultiplayerReservationBeaconClient::RequestReservation(const FString& ConnectString, const FMultiplayerSlotReservation& Reservation)
+{
+	PendingReservation = Reservation;
+	bResponded = false;
+
+	FURL ConnectURL(nullptr, *ConnectString, TRAVEL_Absolute);
+	return InitClient(ConnectURL);
+}
+
+void AMultiplayerReservationBeaconClient::OnConnected()
+{
+	ServerRequestReservation(PendingReservation);
+}
+
+void AMultiplayerReservationBeaconClient::OnFailure()
+{
+	Super::OnFailure();
+	Respond(EMultiplayerReservationResult::ConnectionFailed);
+}
+
+bool AMultiplayerReservationBeaconClient::ServerRequestReservation_Validate(const FMultiplayerSlotReservation& Reservation)
+{
+	//Anything past the largest party is never legitimate, drop the connection
+	return Reservation.PartyMembers.Num() <= GetDefault<AMultiplayerReservationBeaconHost>()->GetMaxPartySize();
+}
+
+void AMultiplayerReservationBeaconClient::ServerRequestReservation_Implementation(const FMultiplayerSlotReservation& Reservation)
+{
+	AMultiplayerReservationBeaconHost* BeaconHost = Cast<AMultiplayerReservationBeaconHost>(GetBeaconOwner());
+	if (BeaconHost == nullptr)
+	{
+		ClientReservationResponse(EMultiplayerReservationResult::InvalidRequest);
+		return;
+	}
+
+	//The id this connection logged in with
+	const UNetConnection* Connection = GetNetConnection();
+	ClientReservationResponse(BeaconHost->ProcessReservationRequest(Reservation, Connection ? Connection->PlayerId : FUniqueNetIdRepl()));
+}
+
+void AMultiplayerReservationBeaconClient::ClientReservationResponse_Implementation(EMultiplayerReservationResult Result)
+{
+	Respond(Result);
+}
+
+void AMultiplayerReservationBeaconClient::Respond(EMultiplayerReservationResult Result)
+{
+	//OnFailure can follow a response when the host closes the connection, only report once
+	if (bResponded)
+	{
+		return;
+	}
+	bResponded = true;
+
+	OnReservationResponse.ExecuteIfBound(Result);
+}
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerReservationBeaconHost.h"
+#include "MultiplayerReservationBeaconClient.h"
+#include "MultiplayerTelemetry.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+
+AMultiplayerReservationBeaconHost::AMultiplayerReservationBeaconHost()
+{
+	ClientBeaconActorClass = AMultiplayerReservationBeaconClient::StaticClass();
+	BeaconTypeName = ClientBeaconActorClass->GetName();
+}
+
+void AMultiplayerReservationBeaconHost::BeginPlay()
+{
+	Super::BeginPlay();
+
+	GetWorldTimerManager().SetTimer(ExpireTimerHandle, this, &ThisClass::ExpireSlots, 1.f, true);
+}
+
+void AMultiplayerReservationBeaconHost::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(ExpireTimerHandle);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+EMultiplayerReservationResult AMultiplayerReservationBeaconHost::ProcessReservationRequest(const FMultiplayerSlotReservation& Reservation, const FUniqueNetIdRepl& ConnectionId)
+{
+	if (!Reservation.IsValid() || Reservation.PartyMembers.Num() > MaxPartySize)
+	{
+		return EMultiplayerReservationResult::InvalidRequest;
+	}
+
+	//The other members are the leader's split-screen players, only the leader's id is checked by the login
+	if (!ConnectionId.IsValid() || Reservation.PartyLeader != ConnectionId)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Reservation for %s rejected, the beacon connection is %s"),
+			*Reservation.PartyLeader.ToDebugString(), *ConnectionId.ToDebugString());
+		return EMultiplayerReservationResult::InvalidRequest;
+	}
+
+	//Members that already hold a slot of this party (a retry after a lost response) don't need a new one
+	ExpireSlots();
+	int32 NumNewSlots = 0;
+	for (const FUniqueNetIdRepl& Member : Reservation.PartyMembers)
+	{
+		if (!Member.IsValid())
+		{
+			return EMultiplayerReservationResult::InvalidRequest;
+		}
+		const FSlot* Existing = FindSlot(Member);
+		if (Existing == nullptr)
+		{
+			++NumNewSlots;
+		}
+		else if (Existing->Leader != Reservation.PartyLeader)
+		{
+			return EMultiplayerReservationResult::InvalidRequest;
+		}
+	}
+
+	if (Slots.Num() + NumNewSlots > MaxSlots)
+	{
+		return EMultiplayerReservationResult::SessionFull;
+	}
+
+	const double ExpireTime = GetWorld()->GetRealTimeSeconds() + ReservationTimeout;
+	for (const FUniqueNetIdRepl& Member : Reservation.PartyMembers)
+	{
+		if (FSlot* Existing = FindSlot(Member))
+		{
+			if (Existing->State == ESlotState::Reserved)
+			{
+				Existing->ExpireTime = ExpireTime;
+			}
+			continue;
+		}
+		Slots.Add({Member, ESlotState::Reserved, ExpireTime, Reservation.PartyLeader});
+	}
+
+	return EMultiplayerReservationResult::Accepted;
+}
+
+bool AMultiplayerReservationBeaconHost::ClaimSlot(const FUniqueNetIdRepl& PlayerId)
+{
+	const double ExpireTime = GetWorld()->GetRealTimeSeconds() + ConnectingTimeout;
+
+	if (FSlot* Existing = FindSlot(PlayerId))
+	{
+		if (Existing->State == ESlotState::Reserved)
+		{
+			Existing->State = ESlotState::Connecting;
+			Existing->ExpireTime = ExpireTime;
+		}
+		return true;
+	}
+
+	ExpireSlots();
+	if (Slots.Num() >= MaxSlots)
+	{
+		return false;
+	}
+
+	Slots.Add({PlayerId, ESlotState::Connecting, ExpireTime, PlayerId});
+	return true;
+}
+
+void AMultiplayerReservationBeaconHost::JoinSlot(const FUniqueNetIdRepl& PlayerId)
+{
+	if (FSlot* Existing = FindSlot(PlayerId))
+	{
+		Existing->State = ESlotState::Joined;
+		return;
+	}
+
+	//The listen server host never goes through PreLogin, so it has nothing to claim
+	Slots.Add({PlayerId, ESlotState::Joined, 0.0, PlayerId});
+}
+
+void AMultiplayerReservationBeaconHost::ReleaseSlot(const FUniqueNetIdRepl& PlayerId)
+{
+	Slots.RemoveAllSwap([&PlayerId](const FSlot& Slot)
+	{
+		return Slot.PlayerId == PlayerId;
+	});
+}
+
+AMultiplayerReservationBeaconHost::FSlot* AMultiplayerReservationBeaconHost::FindSlot(const FUniqueNetIdRepl& PlayerId)
+{
+	if (!PlayerId.IsValid())
+	{
+		return nullptr;
+	}
+	return Slots.FindByPredicate([&PlayerId](const FSlot& Slot)
+	{
+		return Slot.PlayerId == PlayerId;
+	});
+}
+
+void AMultiplayerReservationBeaconHost::ExpireSlots()
+{
+	const double Now = GetWorld()->GetRealTimeSeconds();
+	Slots.RemoveAllSwap([Now](const FSlot& Slot)
+	{
+		return Slot.State != ESlotState::Joined && Slot.ExpireTime < Now;
+	});
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionSchema.h"
+#include "OnlineSessionSettings.h"
+#include "UObject/Class.h"
+
+namespace MultiplayerSessionSchema
+{
+	const FName ModeKey(TEXT("MODE"));
+	const FName RegionKey(TEXT("RGN"));
+	const FName BuildIdKey(TEXT("BLD"));
+	const FName LoadKey(TEXT("LOAD"));
+}
+
+bool LexTryParseString(EMultiplayerMatchType& OutMatchType, const TCHAR* Buffer)
+{
+	const int64 Value = StaticEnum<EMultiplayerMatchType>()->GetValueByNameString(Buffer);
+	if (Value == INDEX_NONE || Value == static_cast<int64>(EMultiplayerMatchType::Invalid))
+	{
+		return false;
+	}
+	OutMatchType = static_cast<EMultiplayerMatchType>(Value);
+	return true;
+}
+
+const TCHAR* LexToString(EMultiplayerMatchType MatchType)
+{
+	switch (MatchType)
+	{
+	case EMultiplayerMatchType::FreeForAll:		return TEXT("FreeForAll");
+	case EMultiplayerMatchType::TeamDeathmatch:	return TEXT("TeamDeathmatch");
+	case EMultiplayerMatchType::Coop:			return TEXT("Coop");
+	default:									return TEXT("Invalid");
+	}
+}
+
+void FMultiplayerSessionMode::Write(FOnlineSessionSettings& Settings) const
+{
+	//Ping advertisement too, so LAN beacons can filter on it without a backend
+	Settings.Set(MultiplayerSessionSchema::ModeKey, Pack(), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+}
+
+FMultiplayerSessionMode FMultiplayerSessionMode::Read(const FOnlineSessionSettings& Settings)
+{
+	int32 Packed = 0;
+	if (!Settings.Get(MultiplayerSessionSchema::ModeKey, Packed))
+	{
+		return FMultiplayerSessionMode();
+	}
+	return Unpack(Packed);
+}
@@ -10,119 +10,642 @@
 #include "Engine/World.h"
 #include "GameFramework/PlayerState.h"  
 #include "Engine/LocalPlayer.h"
-#include "Interfaces/OnlineIdentityInterface.h"
+#include "MultiplayerReservationBeaconClient.h"
+#include "MultiplayerIdentitySubsystem.h"
+#include "MultiplayerOnlineServices.h"
+#include "MultiplayerTelemetry.h"
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerJoinFunnel.h"
+#include "TimerManager.h"
+#include "Misc/CommandLine.h"
+#include "GameFramework/GameModeBase.h"
+#include "HAL/PlatformTime.h"
+
+TRACE_DECLARE_INT_COUNTER(MultiplayerSessions_InFlightOps, TEXT("MultiplayerSessions/InFlightOps"));
+TRACE_DECLARE_INT_COUNTER(MultiplayerSessions_SearchResults, TEXT("MultiplayerSessions/SearchResults"));
+TRACE_DECLARE_INT_COUNTER(MultiplayerSessions_SearchCandidates, TEXT("MultiplayerSessions/SearchCandidates"));
+TRACE_DECLARE_INT_COUNTER(MultiplayerSessions_BackendRetries, TEXT("MultiplayerSessions/BackendRetries"));
+TRACE_DECLARE_INT_COUNTER(MultiplayerSessions_BackendTimeouts, TEXT("MultiplayerSessions/BackendTimeouts"));
+TRACE_DECLARE_INT_COUNTER(MultiplayerSessions_CircuitOpen, TEXT("MultiplayerSessions/CircuitOpen"));
 
 UMultiplayerSessionSubsystem::UMultiplayerSessionSubsystem():
 	CreateSessionCompleteDelegate(FOnCreateSessionCompleteDelegate::CreateUObject(this,&ThisClass::OnCreateSessionComplete)),
 	FindSessionCompleteDelegate(FOnFindSessionsCompleteDelegate::CreateUObject(this,&ThisClass::OnFindSessionComplete)),
 	JoinSessionCompleteDelegate(FOnJoinSessionCompleteDelegate::CreateUObject(this,&ThisClass::OnJoinSessionComplete)),
 	DestroySessionCompleteDelegate(FOnDestroySessionCompleteDelegate::CreateUObject(this,&ThisClass::OnDestroySessionComplete)),
-	StartSessionCompleteDelegate(FOnStartSessionCompleteDelegate::CreateUObject(this,&ThisClass::OnStartSessionComplete))
+	StartSessionCompleteDelegate(FOnStartSessionCompleteDelegate::CreateUObject(this,&ThisClass::OnStartSessionComplete)),
+	UpdateSessionCompleteDelegate(FOnUpdateSessionCompleteDelegate::CreateUObject(this,&ThisClass::OnUpdateSessionComplete))
+{
+}
+
+void UMultiplayerSessionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
-	IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
-	if (Subsystem)
+	Super::Initialize(Collection);
+
+	//The online subsystem is looked up here, once, rather than while the CDO is built at module load
+	SessionInterface = FMultiplayerOnlineServices::Get().GetSessionInterface();
+	BindSessionInterface();
+	SessionInterfaceChangedHandle = FMultiplayerOnlineServices::Get().OnSessionInterfaceChanged.AddUObject(this, &ThisClass::OnSessionInterfaceChanged);
+	//Null until then when the online subsystem comes up late
+	OnlineServicesReadyHandle = FMultiplayerOnlineServices::Get().OnOnlineServicesReady.AddUObject(this, &ThisClass::OnSessionInterfaceChanged);
+	BackendCircuit.Configure(CircuitFailureThreshold, CircuitOpenSeconds);
+}
+
+void UMultiplayerSessionSubsystem::BindSessionInterface()
+{
+	if (SessionInterface.IsValid())
 	{
-		SessionInterface = Subsystem->GetSessionInterface();
+		CreateSessionCompleteDelegateHandle = SessionInterface->AddOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate);
+		FindSessionsCompleteDelegateHandle = SessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionCompleteDelegate);
+		JoinSessionCompleteDelegateHandle = SessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
+		DestroySessionCompleteDelegateHandle = SessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
+		UpdateSessionCompleteDelegateHandle = SessionInterface->AddOnUpdateSessionCompleteDelegate_Handle(UpdateSessionCompleteDelegate);
 	}
 }
 
-void UMultiplayerSessionSubsystem::CreateSession(int32 NumPublicConnections, FString MatchType)
+void UMultiplayerSessionSubsystem::UnbindSessionInterface()
 {
+	if (SessionInterface.IsValid())
+	{
+		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+		SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+		SessionInterface->ClearOnUpdateSessionCompleteDelegate_Handle(UpdateSessionCompleteDelegateHandle);
+	}
+}
+
+void UMultiplayerSessionSubsystem::OnSessionInterfaceChanged()
+{
+	UnbindSessionInterface();
+	SessionInterface = FMultiplayerOnlineServices::Get().GetSessionInterface();
+	BindSessionInterface();
+
+	//Calls still out on the old interface can't call back anymore, and its failures say nothing about the new one
+	BackendCircuit.Reset();
+	TRACE_COUNTER_SET(MultiplayerSessions_CircuitOpen, 0);
+	AbandonBackendCalls();
+}
+
+void UMultiplayerSessionSubsystem::Deinitialize()
+{
+	FTSTicker::RemoveTicker(LoadTickerHandle);
+	LoadTickerHandle.Reset();
+	LoadTickTimer.Stop();
+	for (FMultiplayerBackendCall& Call : BackendCalls)
+	{
+		FTSTicker::RemoveTicker(Call.TimeoutHandle);
+		FTSTicker::RemoveTicker(Call.RetryHandle);
+		Call = FMultiplayerBackendCall();
+	}
+	CancelSlotReservation();
+	UnbindSessionInterface();
+	FMultiplayerOnlineServices::Get().OnSessionInterfaceChanged.Remove(SessionInterfaceChangedHandle);
+	FMultiplayerOnlineServices::Get().OnOnlineServicesReady.Remove(OnlineServicesReadyHandle);
+
+	Super::Deinitialize();
+}
+
+void UMultiplayerSessionSubsystem::CreateSession(int32 NumPublicConnections, EMultiplayerMatchType MatchType)
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::CreateSession);
 	if (!SessionInterface.IsValid())
 	{
 		return;
 	}
-	auto ExistingSession = SessionInterface->GetNamedSession(NAME_GameSession);
-	if (ExistingSession != nullptr)
+
+	//Its retries would go out with these settings instead, the one in flight reports for both
+	if (BackendCalls[static_cast<int32>(EMultiplayerBackendOp::CreateSession)].bInFlight)
 	{
-		SessionInterface->DestroySession(NAME_GameSession);
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("CreateSession is already in flight, not starting another"));
+		return;
 	}
 
-	//Store the delegate in a FDelegateHandle so can later remove it from the delegate list
-	CreateSessionCompleteDelegateHandle = SessionInterface->AddOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate);
-
+	LLM_SCOPE_BYTAG(MultiplayerSessions);
 	LastSessionSetting = MakeShareable(new FOnlineSessionSettings());
-	LastSessionSetting->bIsLANMatch = Online::GetSubsystem(GetWorld())->GetSubsystemName() == "NULL" ?true : false;
+	LastSessionSetting->bIsLANMatch = FMultiplayerOnlineServices::Get().IsLANOnly();
 	LastSessionSetting->NumPublicConnections = NumPublicConnections;
 	LastSessionSetting->bAllowJoinInProgress = true;
 	LastSessionSetting->bAllowJoinInProgress = true;
 	LastSessionSetting->bShouldAdvertise = true;
 	LastSessionSetting->bUsesPresence = true;
 	LastSessionSetting->bUseLobbiesIfAvailable = true;
-	LastSessionSetting->Set(FName("MatchType"),MatchType , EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
-	LastSessionSetting->BuildUniqueId = 1;
-	
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	FUniqueNetIdRepl NetIdPtr = *LocalPlayer->GetPreferredUniqueNetId();
-	if (NetIdPtr.IsValid())
+	FMultiplayerSessionMode Mode;
+	Mode.MatchType = MatchType;
+	Mode.Flags |= LastSessionSetting->bAllowJoinInProgress ? EMultiplayerSessionFlags::JoinInProgress : EMultiplayerSessionFlags::None;
+	Mode.Flags |= IsRunningDedicatedServer() ? EMultiplayerSessionFlags::DedicatedServer : EMultiplayerSessionFlags::None;
+	Mode.Flags |= LastSessionSetting->bIsLANMatch ? EMultiplayerSessionFlags::LANOnly : EMultiplayerSessionFlags::None;
+	Mode.Write(*LastSessionSetting);
+	LastSessionSetting->BuildUniqueId = GetBuildUniqueId();
+	LastSessionSetting->Set(MultiplayerSessionSchema::BuildIdKey, LastSessionSetting->BuildUniqueId, EOnlineDataAdvertisementType::ViaOnlineService);
+	if (!GetRegion().IsEmpty())
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Using NetId from Identity interface: %s"), *NetIdToString(NetIdPtr));
+		LastSessionSetting->Set(MultiplayerSessionSchema::RegionKey, GetRegion(), EOnlineDataAdvertisementType::ViaOnlineService);
 	}
-	if(!SessionInterface->CreateSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, *LastSessionSetting))
+
+	//A new request replaces a retry still waiting from the last one
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(EMultiplayerBackendOp::CreateSession)];
+	FTSTicker::RemoveTicker(Call.RetryHandle);
+	Call.RetryHandle.Reset();
+	Call.Retry = 0;
+
+	AttemptCreateSession();
+}
+
+void UMultiplayerSessionSubsystem::AttemptCreateSession()
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::AttemptCreateSession);
+	FUniqueNetIdRepl NetId = GetPlayerNetId();
+	if (!NetId.IsValid())
 	{
-		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+		MULTIPLAYER_TELEMETRY(NotLoggedIn, TEXT("CreateSession"));
+		MultiplayerOnCreateSessionComplete.Broadcast(false);
+		return;
+	}
 
-		//Broadcast our own custom delegate
+	if (!BeginBackendCall(EMultiplayerBackendOp::CreateSession))
+	{
 		MultiplayerOnCreateSessionComplete.Broadcast(false);
+		return;
+	}
+
+	MULTIPLAYER_TELEMETRY(SessionCreateRequested, NAME_GameSession, LastSessionSetting->NumPublicConnections);
+	TRACE_COUNTER_INCREMENT(MultiplayerSessions_InFlightOps);
+
+	//Creating over a session that is still being destroyed fails, so the create goes out once the old one is gone.
+	//The create's timeout covers both
+	if (SessionInterface->GetNamedSession(NAME_GameSession) != nullptr)
+	{
+		CreateAfterDestroyGeneration = BackendCalls[static_cast<int32>(EMultiplayerBackendOp::CreateSession)].Generation;
+		if (!SessionInterface->DestroySession(NAME_GameSession))
+		{
+			OnDestroySessionComplete(NAME_GameSession, false);
+		}
+		return;
+	}
+
+	SendCreateSession();
+}
+
+void UMultiplayerSessionSubsystem::SendCreateSession()
+{
+	FUniqueNetIdRepl NetId = GetPlayerNetId();
+	MarkBackendCallSent(EMultiplayerBackendOp::CreateSession);
+	if (!NetId.IsValid() || !SessionInterface->CreateSession(*NetId, NAME_GameSession, *LastSessionSetting))
+	{
+		//Some subsystems already called back with the failure before returning, then this does nothing
+		CompleteCreateSession(MarkBackendCallNotSent(EMultiplayerBackendOp::CreateSession), false);
 	}
-	
 }
 
 void UMultiplayerSessionSubsystem::FindSession(int32 MaxSearchResults)
 {
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::FindSession);
 	if (!SessionInterface.IsValid())
 	{
 		return;
 	}
 
-	FindSessionsCompleteDelegateHandle = SessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionCompleteDelegate);
+	//The rings of the search in flight are still going, its results are reported
+	if (BackendCalls[static_cast<int32>(EMultiplayerBackendOp::FindSessions)].bInFlight)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("FindSessions is already in flight, not starting another"));
+		return;
+	}
 
-	LastSessionSearch = MakeShareable(new FOnlineSessionSearch());
-	LastSessionSearch->MaxSearchResults = MaxSearchResults;
-	LastSessionSearch->bIsLanQuery = Online::GetSubsystem(GetWorld())->GetSubsystemName() == "NULL" ?true : false;
-	LastSessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
-	
+	//Nearest region first, the wider rings are only asked when the closer ones come up short.
+	//An empty region means "anywhere" and is what we get without any region configured.
+	SearchRegions.Reset();
+	if (!GetRegion().IsEmpty())
+	{
+		SearchRegions.Add(GetRegion());
+		for (const FString& NearbyRegion : NearbyRegions)
+		{
+			SearchRegions.AddUnique(NearbyRegion);
+		}
+	}
+	SearchRegions.Add(FString());
+
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(EMultiplayerBackendOp::FindSessions)];
+	FTSTicker::RemoveTicker(Call.RetryHandle);
+	Call.RetryHandle.Reset();
+	Call.Retry = 0;
+
+	SearchRegionIndex = 0;
+	SearchMaxResults = MaxSearchResults;
+	SearchCandidates.Reset();
+	SearchCandidateIds.Reset();
+	NumGoodSearchCandidates = 0;
+	TRACE_COUNTER_SET(MultiplayerSessions_SearchCandidates, 0);
+
+	StartRegionSearch();
+}
+
+void UMultiplayerSessionSubsystem::StartRegionSearch()
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::StartRegionSearch);
 	// 使用统一的网络ID获取方法
 	FUniqueNetIdRepl NetId = GetPlayerNetId();
 	if (!NetId.IsValid())
 	{
-		UE_LOG(LogTemp, Error, TEXT("Cannot join session: Invalid NetId"));
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, TEXT("Cannot join session: Player not logged in"));
-		}
+		MULTIPLAYER_TELEMETRY(NotLoggedIn, TEXT("FindSessions"));
+		FinishRegionSearch();
 		return;
 	}
 
-	if (const FUniqueNetId* RawNetId = NetId.GetUniqueNetId().Get())
+	LLM_SCOPE_BYTAG(MultiplayerSessions);
+	LastSessionSearch = MakeShareable(new FOnlineSessionSearch());
+	LastSessionSearch->MaxSearchResults = SearchMaxResults;
+	LastSessionSearch->bIsLanQuery = FMultiplayerOnlineServices::Get().IsLANOnly();
+	LastSessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+
+	//Filtered by the backend, sessions of other builds never reach us
+	LastSessionSearch->QuerySettings.Set(MultiplayerSessionSchema::BuildIdKey, GetBuildUniqueId(), EOnlineComparisonOp::Equals);
+	const FString& SearchRegion = SearchRegions[SearchRegionIndex];
+	if (!SearchRegion.IsEmpty())
+	{
+		LastSessionSearch->QuerySettings.Set(MultiplayerSessionSchema::RegionKey, SearchRegion, EOnlineComparisonOp::Equals);
+	}
+
+	//While the backend is down, report what the closer rings found rather than keep asking
+	if (!BeginBackendCall(EMultiplayerBackendOp::FindSessions))
 	{
-		FString NetIdStr = RawNetId->ToString();
-		UE_LOG(LogTemp, Warning, TEXT("NetId: %s"), *NetIdStr);
+		FinishRegionSearch();
+		return;
 	}
+
+	TRACE_COUNTER_INCREMENT(MultiplayerSessions_InFlightOps);
+	MarkBackendCallSent(EMultiplayerBackendOp::FindSessions);
 	if (!SessionInterface->FindSessions(*NetId, LastSessionSearch.ToSharedRef()))
 	{
-		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+		CompleteFindSessions(MarkBackendCallNotSent(EMultiplayerBackendOp::FindSessions), false);
+	}
+}
 
+void UMultiplayerSessionSubsystem::FinishRegionSearch()
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::FinishRegionSearch);
+	FMultiplayerJoinFunnel::LogPhase(JoinCorrelationId, EMultiplayerJoinPhase::SearchCompleted);
+	MULTIPLAYER_TELEMETRY(SessionSearchCompleted, NAME_None, SearchCandidates.Num() > 0, SearchCandidates.Num());
+	RankSearchCandidates();
+	if (SearchCandidates.Num() <= 0)
+	{
 		MultiplayerOnFindSessionComplete.Broadcast(TArray<FOnlineSessionSearchResult>(),false);
+		return;
 	}
 
+	MultiplayerOnFindSessionComplete.Broadcast(SearchCandidates,true);
+}
+
+FString UMultiplayerSessionSubsystem::GetRegion() const
+{
+	FString RegionOverride;
+	if (FParse::Value(FCommandLine::Get(), TEXT("Region="), RegionOverride))
+	{
+		return RegionOverride;
+	}
+	return Region;
 }
 
 void UMultiplayerSessionSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult)
 {
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::JoinSession);
 	if (!SessionInterface.IsValid())
 	{
 		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
 		return;
 	}
+
+	//One join at a time, the one under way reports. A second one would skip the reservation or replace its result
+	if (ReservationBeacon != nullptr || BackendCalls[static_cast<int32>(EMultiplayerBackendOp::JoinSession)].bInFlight)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("A join is already under way, not starting another"));
+		return;
+	}
+
+	//Ask the lobby for a slot first, it's much cheaper to be told "full" now than after loading the map
+	FString BeaconConnectString;
+	if (bReserveSlotBeforeJoin && SessionInterface->GetResolvedConnectString(SessionResult, NAME_BeaconPort, BeaconConnectString))
+	{
+		PendingJoinResult = SessionResult;
+		if (RequestSlotReservation(BeaconConnectString))
+		{
+			return;
+		}
+	}
+
+	JoinReservedSession(SessionResult);
+}
+
+void UMultiplayerSessionSubsystem::JoinReservedSession(const FOnlineSessionSearchResult& SessionResult)
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::JoinReservedSession);
 	FUniqueNetIdRepl NetId = GetPlayerNetId();
-	SessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
+	if (!NetId.IsValid())
+	{
+		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+		return;
+	}
 
-	if (SessionInterface->JoinSession(*NetId, NAME_GameSession,SessionResult))
+	//Joins aren't retried, the host may be gone by now and a fresh search is the better answer
+	if (!BeginBackendCall(EMultiplayerBackendOp::JoinSession))
 	{
-		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
 		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+		return;
+	}
+
+	MULTIPLAYER_TELEMETRY(SessionJoinRequested, NAME_GameSession);
+	TRACE_COUNTER_INCREMENT(MultiplayerSessions_InFlightOps);
+	MarkBackendCallSent(EMultiplayerBackendOp::JoinSession);
+	if (!SessionInterface->JoinSession(*NetId, NAME_GameSession,SessionResult))
+	{
+		CompleteJoinSession(MarkBackendCallNotSent(EMultiplayerBackendOp::JoinSession), EOnJoinSessionCompleteResult::UnknownError);
+	}
+}
+
+bool UMultiplayerSessionSubsystem::RequestSlotReservation(const FString& BeaconConnectString)
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::RequestSlotReservation);
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return false;
+	}
+
+	//Split-screen players travel together, so they are reserved as one party
+	FMultiplayerSlotReservation Reservation;
+	Reservation.PartyLeader = GetPlayerNetId();
+	UMultiplayerIdentitySubsystem* IdentitySubsystem = GetGameInstance()->GetSubsystem<UMultiplayerIdentitySubsystem>();
+	for (const ULocalPlayer* LocalPlayer : GetGameInstance()->GetLocalPlayers())
+	{
+		FUniqueNetIdRepl MemberId = LocalPlayer && IdentitySubsystem ? IdentitySubsystem->GetNetIdForLocalPlayer(LocalPlayer) : FUniqueNetIdRepl();
+		if (MemberId.IsValid())
+		{
+			Reservation.PartyMembers.Add(MemberId);
+		}
+	}
+	if (!Reservation.IsValid())
+	{
+		return false;
+	}
+
+	ReservationBeacon = World->SpawnActor<AMultiplayerReservationBeaconClient>(AMultiplayerReservationBeaconClient::StaticClass());
+	if (ReservationBeacon == nullptr)
+	{
+		return false;
+	}
+
+	ReservationBeacon->OnReservationResponse.BindUObject(this, &ThisClass::OnReservationResponse);
+	TRACE_COUNTER_INCREMENT(MultiplayerSessions_InFlightOps);
+	if (!ReservationBeacon->RequestReservation(BeaconConnectString, Reservation))
+	{
+		TRACE_COUNTER_DECREMENT(MultiplayerSessions_InFlightOps);
+		ReservationBeacon->DestroyBeacon();
+		ReservationBeacon = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void UMultiplayerSessionSubsystem::OnReservationResponse(EMultiplayerReservationResult Result)
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::OnReservationResponse);
+	TRACE_COUNTER_DECREMENT(MultiplayerSessions_InFlightOps);
+	FMultiplayerJoinFunnel::LogPhase(JoinCorrelationId, EMultiplayerJoinPhase::ReservationCompleted);
+
+	//We are inside the beacon's RPC here, tear it down on the next tick instead
+	if (ReservationBeacon)
+	{
+		ReservationBeacon->OnReservationResponse.Unbind();
+		TWeakObjectPtr<AMultiplayerReservationBeaconClient> WeakBeacon = ReservationBeacon;
+		GetWorld()->GetTimerManager().SetTimerForNextTick([WeakBeacon]()
+		{
+			if (WeakBeacon.IsValid())
+			{
+				WeakBeacon->DestroyBeacon();
+			}
+		});
+		ReservationBeacon = nullptr;
+	}
+
+	switch (Result)
+	{
+	case EMultiplayerReservationResult::Accepted:
+	//A host without a reservation beacon still guards its slots in PreLogin, so just try to join
+	case EMultiplayerReservationResult::ConnectionFailed:
+		JoinReservedSession(PendingJoinResult);
+		break;
+	case EMultiplayerReservationResult::SessionFull:
+		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::SessionIsFull);
+		break;
+	default:
+		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+		break;
+	}
+}
+
+bool UMultiplayerSessionSubsystem::CancelSlotReservation()
+{
+	if (ReservationBeacon == nullptr)
+	{
+		return false;
+	}
+
+	TRACE_COUNTER_DECREMENT(MultiplayerSessions_InFlightOps);
+	//Gone already when its world went first
+	if (IsValid(ReservationBeacon))
+	{
+		ReservationBeacon->OnReservationResponse.Unbind();
+		ReservationBeacon->DestroyBeacon();
 	}
+	ReservationBeacon = nullptr;
+	return true;
+}
+
+void UMultiplayerSessionSubsystem::AdvertiseBeaconPort(int32 BeaconPort)
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::AdvertiseBeaconPort);
+	if (!SessionInterface.IsValid())
+	{
+		return;
+	}
+
+	FOnlineSessionSettings* SessionSettings = SessionInterface->GetSessionSettings(NAME_GameSession);
+	if (SessionSettings == nullptr)
+	{
+		return;
+	}
+
+	SessionSettings->Set(SETTING_BEACONPORT, BeaconPort, EOnlineDataAdvertisementType::ViaOnlineService);
+	MarkSessionSettingsDirty();
+	FlushSessionSettings();
+	StartLoadReporting();
+}
+
+void UMultiplayerSessionSubsystem::StartLoadReporting()
+{
+	if (LoadTickerHandle.IsValid())
+	{
+		return;
+	}
+
+	bHasPublishedLoad = false;
+	TimeUntilLoadSample = 0.f;
+	LoadTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickLoadReporting));
+}
+
+bool UMultiplayerSessionSubsystem::TickLoadReporting(float DeltaTime)
+{
+	//Game thread work rather than frame time, a server idling until its next tick isn't busy. After a travel the
+	//new world is timed from its next tick on
+	UWorld* World = GetWorld();
+	if (LoadTickTimer.GetWorld() != World)
+	{
+		LoadTickTimer.Start(World);
+	}
+	if (LoadTickTimer.GetNumTicks() > 0)
+	{
+		const float TickMs = static_cast<float>(LoadTickTimer.GetLastTickMs());
+		TickMsEMA = TickMsEMA > 0.f ? FMath::Lerp(TickMsEMA, TickMs, 0.05f) : TickMs;
+	}
+
+	//Nothing is published before the first tick was timed, it would claim all the headroom
+	TimeUntilLoadSample -= DeltaTime;
+	if (TimeUntilLoadSample <= 0.f && LoadTickTimer.GetNumTicks() > 0)
+	{
+		TimeUntilLoadSample = LoadSampleInterval;
+
+		FNamedOnlineSession* Session = SessionInterface.IsValid() ? SessionInterface->GetNamedSession(NAME_GameSession) : nullptr;
+		if (Session == nullptr || !Session->bHosting)
+		{
+			//Nothing to report on until we host again
+			LoadTickerHandle.Reset();
+			LoadTickTimer.Stop();
+			return false;
+		}
+
+		const AGameModeBase* GameMode = World ? World->GetAuthGameMode() : nullptr;
+		FMultiplayerServerLoad Load;
+		Load.TickMs = TickMsEMA;
+		Load.HeadroomPercent = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(100.f * (1.f - TickMsEMA / TargetTickMs)), 0, 100));
+		Load.FreeSlots = static_cast<uint8>(FMath::Clamp(Session->SessionSettings.NumPublicConnections - (GameMode ? GameMode->GetNumPlayers() : 0), 0, 255));
+
+		if (!bHasPublishedLoad || !Load.IsNearlyEqual(PublishedLoad))
+		{
+			PublishedLoad = Load;
+			bHasPublishedLoad = true;
+			Session->SessionSettings.Set(MultiplayerSessionSchema::LoadKey, Load.Pack(), EOnlineDataAdvertisementType::ViaOnlineService);
+			MarkSessionSettingsDirty();
+		}
+	}
+
+	FlushSessionSettings();
+	return true;
+}
+
+void UMultiplayerSessionSubsystem::MarkSessionSettingsDirty()
+{
+	bSessionSettingsDirty = true;
+}
+
+void UMultiplayerSessionSubsystem::FlushSessionSettings()
+{
+	//Whatever changed since the last update rides along with the next one
+	if (!bSessionSettingsDirty || bSessionUpdateInFlight || FPlatformTime::Seconds() < NextSessionUpdateTime || !SessionInterface.IsValid())
+	{
+		return;
+	}
+
+	FOnlineSessionSettings* SessionSettings = SessionInterface->GetSessionSettings(NAME_GameSession);
+	if (SessionSettings == nullptr)
+	{
+		bSessionSettingsDirty = false;
+		return;
+	}
+
+	//Stays dirty while the circuit is open, the next flush after the interval tries again
+	NextSessionUpdateTime = FPlatformTime::Seconds() + MinSessionUpdateInterval;
+	if (!BeginBackendCall(EMultiplayerBackendOp::UpdateSession))
+	{
+		return;
+	}
+
+	bSessionSettingsDirty = false;
+	bSessionUpdateInFlight = true;
+	MarkBackendCallSent(EMultiplayerBackendOp::UpdateSession);
+	if (!SessionInterface->UpdateSession(NAME_GameSession, *SessionSettings))
+	{
+		CompleteUpdateSession(MarkBackendCallNotSent(EMultiplayerBackendOp::UpdateSession), false);
+	}
+}
+
+float UMultiplayerSessionSubsystem::ScoreSearchResult(const FOnlineSessionSearchResult& SearchResult) const
+{
+	const int32 PingMs = SearchResult.PingInMs >= 0 && SearchResult.PingInMs < MAX_QUERY_PING ? SearchResult.PingInMs : UnknownPingMs;
+
+	//Hosts without a load record yet count as half busy
+	float LoadFraction = 0.5f;
+	bool bFull = SearchResult.Session.NumOpenPublicConnections <= 0;
+	int32 PackedLoad = 0;
+	if (SearchResult.Session.SessionSettings.Get(MultiplayerSessionSchema::LoadKey, PackedLoad))
+	{
+		const FMultiplayerServerLoad Load = FMultiplayerServerLoad::Unpack(PackedLoad);
+		LoadFraction = 1.f - Load.HeadroomPercent / 100.f;
+		bFull = Load.FreeSlots == 0;
+	}
+
+	//A full host stays in the list but behind every host with room
+	return PingMs + LoadPenaltyMs * LoadFraction + (bFull ? 100000.f : 0.f);
+}
+
+void UMultiplayerSessionSubsystem::RankSearchCandidates()
+{
+	if (SearchCandidates.Num() < 2)
+	{
+		return;
+	}
+
+	TArray<TPair<float, int32>> Scores;
+	Scores.Reserve(SearchCandidates.Num());
+	for (int32 Index = 0; Index < SearchCandidates.Num(); ++Index)
+	{
+		Scores.Emplace(ScoreSearchResult(SearchCandidates[Index]), Index);
+	}
+	Scores.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B)
+	{
+		return A.Key < B.Key;
+	});
+
+	TArray<FOnlineSessionSearchResult> Ranked;
+	Ranked.Reserve(SearchCandidates.Num());
+	for (const TPair<float, int32>& Score : Scores)
+	{
+		Ranked.Add(MoveTemp(SearchCandidates[Score.Value]));
+	}
+
+	//The menu joins the first result that fits, so put a random one of the near-best hosts first
+	int32 NumNearBest = 1;
+	while (NumNearBest < Scores.Num() && Scores[NumNearBest].Key <= Scores[0].Key + SelectionSlackMs)
+	{
+		++NumNearBest;
+	}
+	if (NumNearBest > 1)
+	{
+		Ranked.Swap(0, FMath::RandRange(0, NumNearBest - 1));
+	}
+
+	SearchCandidates = MoveTemp(Ranked);
+}
+
+EOnlineSessionState::Type UMultiplayerSessionSubsystem::GetSessionState() const
+{
+	return SessionInterface.IsValid() ? SessionInterface->GetSessionState(NAME_GameSession) : EOnlineSessionState::NoSession;
+}
+
+int32 UMultiplayerSessionSubsystem::GetNumOpenPublicConnections() const
+{
+	const FNamedOnlineSession* Session = SessionInterface.IsValid() ? SessionInterface->GetNamedSession(NAME_GameSession) : nullptr;
+	return Session ? Session->NumOpenPublicConnections : 0;
 }
 
 void UMultiplayerSessionSubsystem::StartSession()
@@ -137,115 +660,433 @@ void UMultiplayerSessionSubsystem::DestroySession()
 
 void UMultiplayerSessionSubsystem::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
 {
-	if (SessionInterface)
+	if (SessionName == NAME_GameSession)
 	{
-		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+		CompleteCreateSession(TakeBackendAnswer(EMultiplayerBackendOp::CreateSession), bWasSuccessful);
+	}
+}
+
+void UMultiplayerSessionSubsystem::CompleteCreateSession(uint32 Generation, bool bWasSuccessful)
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::CompleteCreateSession);
+	if (!EndBackendCall(EMultiplayerBackendOp::CreateSession, Generation, bWasSuccessful))
+	{
+		return;
 	}
+	CreateAfterDestroyGeneration = 0;
+	TRACE_COUNTER_DECREMENT(MultiplayerSessions_InFlightOps);
 
+	if (bWasSuccessful)
+	{
+		MULTIPLAYER_TELEMETRY(SessionCreated, NAME_GameSession);
+		StartLoadReporting();
+	}
+	else
+	{
+		MULTIPLAYER_TELEMETRY(SessionCreateFailed, NAME_GameSession);
+		if (ScheduleBackendRetry(EMultiplayerBackendOp::CreateSession))
+		{
+			return;
+		}
+	}
 	MultiplayerOnCreateSessionComplete.Broadcast(bWasSuccessful);
 	
 }
 
 void UMultiplayerSessionSubsystem::OnFindSessionComplete(bool bWasSuccessful)
 {
-	if (SessionInterface)
+	//The search object tells the attempts apart: this answers one given up on, the current one isn't done yet
+	if (LastSessionSearch.IsValid() && LastSessionSearch->SearchState == EOnlineAsyncTaskState::InProgress)
 	{
-		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+		return;
 	}
+	CompleteFindSessions(TakeBackendAnswer(EMultiplayerBackendOp::FindSessions), bWasSuccessful);
+}
 
-	if (LastSessionSearch->SearchResults.Num() <= 0)
+void UMultiplayerSessionSubsystem::CompleteFindSessions(uint32 Generation, bool bWasSuccessful)
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::CompleteFindSessions);
+	if (!EndBackendCall(EMultiplayerBackendOp::FindSessions, Generation, bWasSuccessful))
 	{
-		MultiplayerOnFindSessionComplete.Broadcast(TArray<FOnlineSessionSearchResult>(),false);
 		return;
 	}
-	
-	MultiplayerOnFindSessionComplete.Broadcast(LastSessionSearch->SearchResults,bWasSuccessful);
-	
+
+	LLM_SCOPE_BYTAG(MultiplayerSessions);
+	TRACE_COUNTER_DECREMENT(MultiplayerSessions_InFlightOps);
+
+	//Same ring again after the backoff
+	if (!bWasSuccessful && ScheduleBackendRetry(EMultiplayerBackendOp::FindSessions))
+	{
+		return;
+	}
+	TRACE_COUNTER_SET(MultiplayerSessions_SearchResults, LastSessionSearch.IsValid() ? LastSessionSearch->SearchResults.Num() : 0);
+
+	if (bWasSuccessful && LastSessionSearch.IsValid())
+	{
+		const int32 BuildUniqueId = GetBuildUniqueId();
+		for (const FOnlineSessionSearchResult& Result : LastSessionSearch->SearchResults)
+		{
+			//Backends that can't filter on our keys still must not hand out sessions we can't join
+			if (Result.Session.SessionSettings.BuildUniqueId != BuildUniqueId)
+			{
+				continue;
+			}
+
+			//The unfiltered last ring returns sessions the region rings already found
+			bool bAlreadyFound = false;
+			SearchCandidateIds.Add(Result.GetSessionIdStr(), &bAlreadyFound);
+			if (bAlreadyFound)
+			{
+				continue;
+			}
+
+			SearchCandidates.Add(Result);
+			TRACE_COUNTER_SET(MultiplayerSessions_SearchCandidates, SearchCandidates.Num());
+			if (Result.Session.NumOpenPublicConnections > 0)
+			{
+				++NumGoodSearchCandidates;
+			}
+		}
+	}
+
+	//The session interface runs one search at a time, so the rings go one after another and stop early
+	++SearchRegionIndex;
+	if (NumGoodSearchCandidates < MinGoodSearchCandidates && SearchRegionIndex < SearchRegions.Num())
+	{
+		StartRegionSearch();
+		return;
+	}
+
+	FinishRegionSearch();
 }
 
 void UMultiplayerSessionSubsystem::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
 {
-	if (SessionInterface)
+	if (SessionName == NAME_GameSession)
 	{
-		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+		CompleteJoinSession(TakeBackendAnswer(EMultiplayerBackendOp::JoinSession), Result);
+	}
+}
+
+void UMultiplayerSessionSubsystem::CompleteJoinSession(uint32 Generation, EOnJoinSessionCompleteResult::Type Result)
+{
+	MULTIPLAYER_SESSIONS_TRACE_SCOPE(UMultiplayerSessionSubsystem::CompleteJoinSession);
+	//A full or vanished session is a healthy backend answering
+	const bool bBackendAnswered = Result != EOnJoinSessionCompleteResult::UnknownError && Result != EOnJoinSessionCompleteResult::CouldNotRetrieveAddress;
+	if (!EndBackendCall(EMultiplayerBackendOp::JoinSession, Generation, bBackendAnswered))
+	{
+		return;
 	}
+	TRACE_COUNTER_DECREMENT(MultiplayerSessions_InFlightOps);
+	FMultiplayerJoinFunnel::LogPhase(JoinCorrelationId, EMultiplayerJoinPhase::JoinSessionCompleted);
 
+	if (Result != EOnJoinSessionCompleteResult::Success)
+	{
+		MULTIPLAYER_TELEMETRY(SessionJoinFailed, NAME_GameSession, Result);
+	}
 	MultiplayerOnJoinSessionComplete.Broadcast(Result);
 }
 
 void UMultiplayerSessionSubsystem::OnDestroySessionComplete(FName SessionName, bool bWasSuccessful)
 {
+	if (SessionName != NAME_GameSession || CreateAfterDestroyGeneration == 0)
+	{
+		return;
+	}
+
+	//The create may have timed out while the old session was going away
+	const uint32 Generation = CreateAfterDestroyGeneration;
+	CreateAfterDestroyGeneration = 0;
+	const FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(EMultiplayerBackendOp::CreateSession)];
+	if (!Call.bInFlight || Call.Generation != Generation)
+	{
+		return;
+	}
+
+	if (bWasSuccessful)
+	{
+		SendCreateSession();
+	}
+	else
+	{
+		CompleteCreateSession(Generation, false);
+	}
 }
 
 void UMultiplayerSessionSubsystem::OnStartSessionComplete(FName SessionName, bool bWasSuccessful)
 {
 }
 
-FString UMultiplayerSessionSubsystem::NetIdToString(const FUniqueNetIdRepl& NetId) const
+void UMultiplayerSessionSubsystem::OnUpdateSessionComplete(FName SessionName, bool bWasSuccessful)
 {
-	if (!NetId.IsValid())
+	if (SessionName == NAME_GameSession)
 	{
-		return TEXT("Invalid_NetId");
+		CompleteUpdateSession(TakeBackendAnswer(EMultiplayerBackendOp::UpdateSession), bWasSuccessful);
 	}
-    
-	// 使用 GetUniqueNetId() 方法获取原始指针
-	if (const FUniqueNetId* RawNetId = NetId.GetUniqueNetId().Get())
+}
+
+void UMultiplayerSessionSubsystem::CompleteUpdateSession(uint32 Generation, bool bWasSuccessful)
+{
+	if (!EndBackendCall(EMultiplayerBackendOp::UpdateSession, Generation, bWasSuccessful))
 	{
-		return RawNetId->ToString();
+		return;
+	}
+	bSessionUpdateInFlight = false;
+
+	//Goes out again with the next flush, MinSessionUpdateInterval is the backoff here
+	if (!bWasSuccessful)
+	{
+		MarkSessionSettingsDirty();
 	}
-    
-	return TEXT("Invalid_RawNetId");
 }
 
-FUniqueNetIdRepl UMultiplayerSessionSubsystem::GetPlayerNetId() const
+bool UMultiplayerSessionSubsystem::BeginBackendCall(EMultiplayerBackendOp Op)
 {
-	IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
-	if (!OnlineSubsystem)
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(Op)];
+	FMultiplayerBackendOpStats& Stats = BackendStats[static_cast<int32>(Op)];
+	//Before the circuit, a half open probe must not be spent on a call that doesn't go out
+	if (IsBackendBusy(Op))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("No OnlineSubsystem found"));
-		return FUniqueNetIdRepl();
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("%s is still in flight or owed an answer, not starting another"), LexToString(Op));
+		return false;
+	}
+	if (!BackendCircuit.AllowRequest(FPlatformTime::Seconds()))
+	{
+		++Stats.Rejected;
+		MULTIPLAYER_TELEMETRY(CircuitRejected, NAME_None, static_cast<int64>(Op));
+		return false;
 	}
 
-	IOnlineIdentityPtr IdentityInterface = OnlineSubsystem->GetIdentityInterface();
-	if (!IdentityInterface.IsValid())
+	++Stats.Attempts;
+	//An answer it was still owed counts as lost by now
+	Call.AwaitingGeneration = 0;
+	Call.Generation = Call.Generation == MAX_uint32 ? 1 : Call.Generation + 1;
+	Call.bInFlight = true;
+	FTSTicker::RemoveTicker(Call.TimeoutHandle);
+	Call.TimeoutHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::OnBackendCallTimeout, Op, Call.Generation), GetBackendTimeout(Op));
+	return true;
+}
+
+void UMultiplayerSessionSubsystem::MarkBackendCallSent(EMultiplayerBackendOp Op)
+{
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(Op)];
+	Call.AwaitingGeneration = Call.Generation;
+	Call.AwaitUntil = MAX_dbl;
+}
+
+uint32 UMultiplayerSessionSubsystem::MarkBackendCallNotSent(EMultiplayerBackendOp Op)
+{
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(Op)];
+	if (Call.AwaitingGeneration == Call.Generation)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Identity interface not valid"));
-		return FUniqueNetIdRepl();
+		Call.AwaitingGeneration = 0;
 	}
+	return Call.Generation;
+}
+
+uint32 UMultiplayerSessionSubsystem::TakeBackendAnswer(EMultiplayerBackendOp Op)
+{
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(Op)];
+	const uint32 Generation = Call.AwaitingGeneration;
+	Call.AwaitingGeneration = 0;
+	return Generation;
+}
+
+bool UMultiplayerSessionSubsystem::IsBackendBusy(EMultiplayerBackendOp Op) const
+{
+	const FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(Op)];
+	return Call.bInFlight || (Call.AwaitingGeneration != 0 && FPlatformTime::Seconds() < Call.AwaitUntil);
+}
 
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	if (!LocalPlayer)
+bool UMultiplayerSessionSubsystem::EndBackendCall(EMultiplayerBackendOp Op, uint32 Generation, bool bWasSuccessful)
+{
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(Op)];
+	if (!Call.bInFlight || Generation == 0 || Generation != Call.Generation)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("No local player found"));
-		return FUniqueNetIdRepl();
+		return false;
 	}
 
-	int32 ControllerId = LocalPlayer->GetControllerId();
-    
-	// 首先尝试从身份接口获取
-	TSharedPtr<const FUniqueNetId> NetIdPtr = IdentityInterface->GetUniquePlayerId(ControllerId);
-	if (NetIdPtr.IsValid())
+	Call.bInFlight = false;
+	FTSTicker::RemoveTicker(Call.TimeoutHandle);
+	Call.TimeoutHandle.Reset();
+
+	if (bWasSuccessful)
+	{
+		Call.Retry = 0;
+		if (BackendCircuit.RecordSuccess())
+		{
+			MULTIPLAYER_TELEMETRY(CircuitClosed, NAME_None, static_cast<int64>(Op));
+			TRACE_COUNTER_SET(MultiplayerSessions_CircuitOpen, 0);
+		}
+	}
+	else
 	{
-		FUniqueNetIdRepl NetIdRepl(NetIdPtr);
-		UE_LOG(LogTemp, Warning, TEXT("Using NetId from Identity interface: %s"), *NetIdToString(NetIdRepl));
-		return NetIdRepl;
+		++BackendStats[static_cast<int32>(Op)].Failures;
+		if (BackendCircuit.RecordFailure(FPlatformTime::Seconds()))
+		{
+			MULTIPLAYER_TELEMETRY(CircuitOpened, NAME_None, static_cast<int64>(Op), FMath::RoundToInt(CircuitOpenSeconds));
+			TRACE_COUNTER_SET(MultiplayerSessions_CircuitOpen, 1);
+		}
 	}
+	return true;
+}
 
-	// 如果身份接口没有，尝试其他方法
-	FUniqueNetIdRepl PreferredNetId = LocalPlayer->GetPreferredUniqueNetId();
-	if (PreferredNetId.IsValid())
+bool UMultiplayerSessionSubsystem::ScheduleBackendRetry(EMultiplayerBackendOp Op)
+{
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(Op)];
+	if (Call.Retry >= MaxBackendRetries || BackendCircuit.GetState() == FMultiplayerCircuitBreaker::EState::Open)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Using PreferredUniqueNetId: %s"), *NetIdToString(PreferredNetId));
-		return PreferredNetId;
+		Call.Retry = 0;
+		return false;
 	}
 
-	FUniqueNetIdRepl CachedNetId = LocalPlayer->GetCachedUniqueNetId();
-	if (CachedNetId.IsValid())
+	++Call.Retry;
+	++BackendStats[static_cast<int32>(Op)].Retries;
+	const float Delay = MultiplayerBackendResilience::GetBackoffDelay(Call.Retry, RetryBaseDelay, RetryMaxDelay);
+	MULTIPLAYER_TELEMETRY(BackendRetry, NAME_None, static_cast<int64>(Op), Call.Retry);
+	TRACE_COUNTER_INCREMENT(MultiplayerSessions_BackendRetries);
+	Call.RetryHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::OnBackendRetry, Op), Delay);
+	return true;
+}
+
+bool UMultiplayerSessionSubsystem::OnBackendRetry(float DeltaTime, EMultiplayerBackendOp Op)
+{
+	//The attempt that timed out may still answer, and its answer would be taken for this one's. Wait for it
+	if (IsBackendBusy(Op))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Using CachedUniqueNetId: %s"), *NetIdToString(CachedNetId));
-		return CachedNetId;
+		return true;
+	}
+
+	BackendCalls[static_cast<int32>(Op)].RetryHandle.Reset();
+	switch (Op)
+	{
+	case EMultiplayerBackendOp::CreateSession:
+		AttemptCreateSession();
+		break;
+	case EMultiplayerBackendOp::FindSessions:
+		StartRegionSearch();
+		break;
+	default:
+		break;
+	}
+	return false;
+}
+
+void UMultiplayerSessionSubsystem::AbandonBackendCalls()
+{
+	bool bWasPending[static_cast<int32>(EMultiplayerBackendOp::Count)];
+	for (int32 Index = 0; Index < static_cast<int32>(EMultiplayerBackendOp::Count); ++Index)
+	{
+		FMultiplayerBackendCall& Call = BackendCalls[Index];
+		bWasPending[Index] = Call.bInFlight || Call.RetryHandle.IsValid();
+		if (Call.bInFlight && Index != static_cast<int32>(EMultiplayerBackendOp::UpdateSession))
+		{
+			TRACE_COUNTER_DECREMENT(MultiplayerSessions_InFlightOps);
+		}
+		FTSTicker::RemoveTicker(Call.TimeoutHandle);
+		FTSTicker::RemoveTicker(Call.RetryHandle);
+		//Generations keep counting, an answer that still turns up must not match a later attempt
+		const uint32 Generation = Call.Generation;
+		Call = FMultiplayerBackendCall();
+		Call.Generation = Generation;
+	}
+	CreateAfterDestroyGeneration = 0;
+	//The join it was for is abandoned with the rest, its answer must not start it after all
+	const bool bWasReserving = CancelSlotReservation();
+
+	//Everything is reset before anyone hears, so a caller may start over from its delegate
+	if (bWasPending[static_cast<int32>(EMultiplayerBackendOp::UpdateSession)])
+	{
+		bSessionUpdateInFlight = false;
+		MarkSessionSettingsDirty();
+	}
+	if (bWasPending[static_cast<int32>(EMultiplayerBackendOp::CreateSession)])
+	{
+		MultiplayerOnCreateSessionComplete.Broadcast(false);
+	}
+	if (bWasPending[static_cast<int32>(EMultiplayerBackendOp::FindSessions)])
+	{
+		FinishRegionSearch();
+	}
+	if (bWasPending[static_cast<int32>(EMultiplayerBackendOp::JoinSession)] || bWasReserving)
+	{
+		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+	}
+}
+
+bool UMultiplayerSessionSubsystem::OnBackendCallTimeout(float DeltaTime, EMultiplayerBackendOp Op, uint32 Generation)
+{
+	FMultiplayerBackendCall& Call = BackendCalls[static_cast<int32>(Op)];
+	if (!Call.bInFlight || Call.Generation != Generation)
+	{
+		return false;
+	}
+	Call.TimeoutHandle.Reset();
+	++BackendStats[static_cast<int32>(Op)].Timeouts;
+	MULTIPLAYER_TELEMETRY(BackendTimeout, NAME_None, static_cast<int64>(Op));
+	TRACE_COUNTER_INCREMENT(MultiplayerSessions_BackendTimeouts);
+
+	//Treated as the backend answering "failed". The late answer, if it comes, is dropped; the next attempt waits
+	//for it for another timeout's length at most
+	if (Call.AwaitingGeneration == Generation)
+	{
+		Call.AwaitUntil = FPlatformTime::Seconds() + GetBackendTimeout(Op);
+	}
+	switch (Op)
+	{
+	case EMultiplayerBackendOp::CreateSession:
+		CompleteCreateSession(Generation, false);
+		break;
+	case EMultiplayerBackendOp::FindSessions:
+		//A cancelled search never answers, and a late one is told apart by its search object anyway
+		if (SessionInterface && SessionInterface->CancelFindSessions())
+		{
+			MarkBackendCallNotSent(Op);
+		}
+		CompleteFindSessions(Generation, false);
+		break;
+	case EMultiplayerBackendOp::JoinSession:
+		CompleteJoinSession(Generation, EOnJoinSessionCompleteResult::UnknownError);
+		//A half joined session would make the next join fail
+		if (SessionInterface)
+		{
+			SessionInterface->DestroySession(NAME_GameSession);
+		}
+		break;
+	case EMultiplayerBackendOp::UpdateSession:
+		CompleteUpdateSession(Generation, false);
+		break;
+	default:
+		break;
+	}
+	return false;
+}
+
+float UMultiplayerSessionSubsystem::GetBackendTimeout(EMultiplayerBackendOp Op) const
+{
+	switch (Op)
+	{
+	case EMultiplayerBackendOp::CreateSession:	return CreateSessionTimeout;
+	case EMultiplayerBackendOp::FindSessions:	return FindSessionsTimeout;
+	case EMultiplayerBackendOp::JoinSession:	return JoinSessionTimeout;
+	default:									return UpdateSessionTimeout;
+	}
+}
+
+void UMultiplayerSessionSubsystem::StartJoinFunnel()
+{
+	JoinCorrelationId = FMultiplayerJoinFunnel::NewCorrelationId();
+	FMultiplayerJoinFunnel::LogPhase(JoinCorrelationId, EMultiplayerJoinPhase::JoinClicked);
+}
+
+FUniqueNetIdRepl UMultiplayerSessionSubsystem::GetPlayerNetId() const
+{
+	UMultiplayerIdentitySubsystem* IdentitySubsystem = GetGameInstance()->GetSubsystem<UMultiplayerIdentitySubsystem>();
+	if (IdentitySubsystem == nullptr)
+	{
+		return FUniqueNetIdRepl();
 	}
 
-	UE_LOG(LogTemp, Warning, TEXT("Could not get valid NetId from any source"));
-	return FUniqueNetIdRepl();
+	const UWorld* World = GetWorld();
+	return IdentitySubsystem->GetNetIdForLocalPlayer(World ? World->GetFirstLocalPlayerFromController() : nullptr);
 }
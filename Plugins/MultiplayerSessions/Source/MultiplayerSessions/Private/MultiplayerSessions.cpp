@@ -1,6 +1,10 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MultiplayerSessions.h"
+#include "MultiplayerSessionsTrace.h"
+
+UE_TRACE_CHANNEL_DEFINE(MultiplayerSessionsChannel);
+LLM_DEFINE_TAG(MultiplayerSessions);
 
 #define LOCTEXT_NAMESPACE "FMultiplayerSessionsModule"
 
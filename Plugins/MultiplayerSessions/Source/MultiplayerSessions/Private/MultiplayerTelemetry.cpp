@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerTelemetry.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Engine/Engine.h"
+#include "Interfaces/OnlineIdentityInterface.h"
+#include "MultiplayerBackendResilience.h"
+#include <atomic>
+
+DEFINE_LOG_CATEGORY(LogMultiplayerSessions);
+DEFINE_LOG_CATEGORY(LogMultiplayerLobby);
+
+#if MULTIPLAYER_TELEMETRY_ENABLED
+
+namespace MultiplayerTelemetry
+{
+	static constexpr uint64 Capacity = 1024;
+	static constexpr uint64 IndexMask = Capacity - 1;
+
+	struct FSlot
+	{
+		//Odd while a writer is filling the slot, 2 * (Index + 1) once it holds event Index
+		std::atomic<uint64> Sequence{0};
+		FMultiplayerTelemetryRecord Record;
+	};
+
+	static FSlot Slots[Capacity];
+	static std::atomic<uint64> WriteIndex{0};
+
+	static int32 EchoVerbosity = ELogVerbosity::Warning;
+	static FAutoConsoleVariableRef CVarEchoVerbosity(
+		TEXT("MultiplayerSessions.Telemetry.EchoVerbosity"),
+		EchoVerbosity,
+		TEXT("Events at least this severe (2 Error, 3 Warning, 4 Display, 5 Log, 6 Verbose) are formatted and logged as they happen.\n")
+		TEXT("Everything else is only kept in the ring until MultiplayerSessions.Telemetry.Dump."));
+
+	static bool bOnScreen = false;
+	static FAutoConsoleVariableRef CVarOnScreen(
+		TEXT("MultiplayerSessions.Telemetry.OnScreen"),
+		bOnScreen,
+		TEXT("Also print echoed events on screen."));
+
+	static ELogVerbosity::Type GetVerbosity(EMultiplayerTelemetryEvent Event)
+	{
+		switch (Event)
+		{
+		case EMultiplayerTelemetryEvent::OnlineSubsystemMissing:
+		case EMultiplayerTelemetryEvent::SessionInterfaceMissing:
+		case EMultiplayerTelemetryEvent::NotLoggedIn:
+		case EMultiplayerTelemetryEvent::SessionCreateFailed:
+		case EMultiplayerTelemetryEvent::SessionJoinFailed:
+		case EMultiplayerTelemetryEvent::ConnectStringFailed:
+		case EMultiplayerTelemetryEvent::CircuitOpened:
+			return ELogVerbosity::Error;
+		case EMultiplayerTelemetryEvent::NetIdMissing:
+		case EMultiplayerTelemetryEvent::NoMatchingSession:
+		case EMultiplayerTelemetryEvent::ReservationBeaconFailed:
+		case EMultiplayerTelemetryEvent::BackendTimeout:
+		case EMultiplayerTelemetryEvent::CircuitRejected:
+			return ELogVerbosity::Warning;
+		case EMultiplayerTelemetryEvent::SessionFound:
+			return ELogVerbosity::Verbose;
+		default:
+			return ELogVerbosity::Log;
+		}
+	}
+
+	static const FLogCategoryBase& GetCategory(EMultiplayerTelemetryEvent Event)
+	{
+		switch (Event)
+		{
+		case EMultiplayerTelemetryEvent::ReservationBeaconFailed:
+		case EMultiplayerTelemetryEvent::PlayerJoined:
+		case EMultiplayerTelemetryEvent::PlayerLeft:
+			return LogMultiplayerLobby;
+		default:
+			return LogMultiplayerSessions;
+		}
+	}
+
+	static void Echo(const FMultiplayerTelemetryRecord& Record, ELogVerbosity::Type Verbosity)
+	{
+		const FLogCategoryBase& Category = GetCategory(Record.Event);
+		if (Category.IsSuppressed(Verbosity))
+		{
+			return;
+		}
+
+		const FString Message = FMultiplayerTelemetry::Format(Record);
+		FMsg::Logf(__FILE__, __LINE__, Category.GetCategoryName(), Verbosity, TEXT("%s"), *Message);
+
+		if (bOnScreen && GEngine && IsInGameThread())
+		{
+			const FColor Color = Verbosity <= ELogVerbosity::Error ? FColor::Red : Verbosity <= ELogVerbosity::Warning ? FColor::Yellow : FColor::Cyan;
+			GEngine->AddOnScreenDebugMessage(-1, 10.f, Color, Message);
+		}
+	}
+
+	static FAutoConsoleCommandWithArgsAndOutputDevice DumpCommand(
+		TEXT("MultiplayerSessions.Telemetry.Dump"),
+		TEXT("Prints the most recent session/lobby telemetry events, oldest first. Optional argument: how many (default 64)."),
+		FConsoleCommandWithArgsAndOutputDeviceDelegate::CreateStatic([](const TArray<FString>& Args, FOutputDevice& Ar)
+		{
+			const int32 MaxRecords = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64;
+			FMultiplayerTelemetry::Dump(Ar, MaxRecords);
+		}));
+}
+
+void FMultiplayerTelemetry::Record(EMultiplayerTelemetryEvent Event, FName Name, int64 A, int64 B)
+{
+	using namespace MultiplayerTelemetry;
+
+	FMultiplayerTelemetryRecord NewRecord;
+	NewRecord.Cycles = FPlatformTime::Cycles64();
+	NewRecord.Frame = GFrameCounter;
+	NewRecord.Name = Name;
+	NewRecord.A = A;
+	NewRecord.B = B;
+	NewRecord.Event = Event;
+
+	//Per-slot sequence lock: writers never wait on each other or on a reader
+	const uint64 Index = WriteIndex.fetch_add(1, std::memory_order_relaxed);
+	FSlot& Slot = Slots[Index & IndexMask];
+	Slot.Sequence.store(Index * 2 + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Slot.Record = NewRecord;
+	Slot.Sequence.store(Index * 2 + 2, std::memory_order_release);
+
+	const ELogVerbosity::Type Verbosity = GetVerbosity(Event);
+	if (Verbosity <= EchoVerbosity)
+	{
+		Echo(NewRecord, Verbosity);
+	}
+}
+
+void FMultiplayerTelemetry::Dump(FOutputDevice& Ar, int32 MaxRecords)
+{
+	using namespace MultiplayerTelemetry;
+
+	const uint64 End = WriteIndex.load(std::memory_order_acquire);
+	const uint64 NumRecords = FMath::Min<uint64>(End, FMath::Clamp<uint64>(MaxRecords, 1, Capacity));
+	const uint64 NowCycles = FPlatformTime::Cycles64();
+
+	Ar.Logf(TEXT("Multiplayer telemetry: last %llu of %llu events"), NumRecords, End);
+	for (uint64 Index = End - NumRecords; Index < End; ++Index)
+	{
+		const FSlot& Slot = Slots[Index & IndexMask];
+		const uint64 Expected = Index * 2 + 2;
+		if (Slot.Sequence.load(std::memory_order_acquire) != Expected)
+		{
+			continue;
+		}
+		const FMultiplayerTelemetryRecord Record = Slot.Record;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (Slot.Sequence.load(std::memory_order_relaxed) != Expected)
+		{
+			//Overwritten while we were copying it
+			continue;
+		}
+
+		Ar.Logf(TEXT("  %9.3fs ago  frame %llu  %s"), FPlatformTime::ToSeconds64(NowCycles - Record.Cycles), Record.Frame, *Format(Record));
+	}
+}
+
+FString FMultiplayerTelemetry::Format(const FMultiplayerTelemetryRecord& Record)
+{
+	const FString Name = Record.Name.ToString();
+	switch (Record.Event)
+	{
+	case EMultiplayerTelemetryEvent::OnlineServicesReady:
+		return FString::Printf(TEXT("Online services (%s) ready in %.2f ms"), *Name, Record.A / 1000.0);
+	case EMultiplayerTelemetryEvent::OnlineSubsystemMissing:
+		return TEXT("OnlineSubsystem is null");
+	case EMultiplayerTelemetryEvent::SessionInterfaceMissing:
+		return TEXT("OnlineSessionInterface is not valid");
+	case EMultiplayerTelemetryEvent::NetIdResolved:
+	{
+		static const TCHAR* Sources[] = { TEXT("Identity interface"), TEXT("PreferredUniqueNetId"), TEXT("CachedUniqueNetId") };
+		return FString::Printf(TEXT("Local user %lld resolved NetId from %s"), Record.A, Sources[FMath::Clamp<int64>(Record.B, 0, UE_ARRAY_COUNT(Sources) - 1)]);
+	}
+	case EMultiplayerTelemetryEvent::NetIdMissing:
+		return FString::Printf(TEXT("Could not get valid NetId for local user %lld from any source"), Record.A);
+	case EMultiplayerTelemetryEvent::NotLoggedIn:
+		return FString::Printf(TEXT("%s: invalid NetId, player not logged in"), *Name);
+	case EMultiplayerTelemetryEvent::LoginStatus:
+		return FString::Printf(TEXT("Local user %lld login status: %s"), Record.A, ELoginStatus::ToString(static_cast<ELoginStatus::Type>(Record.B)));
+	case EMultiplayerTelemetryEvent::SessionCreateRequested:
+		return FString::Printf(TEXT("Creating session %s with %lld public connections"), *Name, Record.A);
+	case EMultiplayerTelemetryEvent::SessionCreated:
+		return FString::Printf(TEXT("Session created successfully: %s"), *Name);
+	case EMultiplayerTelemetryEvent::SessionCreateFailed:
+		return FString::Printf(TEXT("Failed to create session %s"), *Name);
+	case EMultiplayerTelemetryEvent::SessionSearchStarted:
+		return FString::Printf(TEXT("Searching sessions, max %lld results"), Record.A);
+	case EMultiplayerTelemetryEvent::SessionSearchCompleted:
+		return FString::Printf(TEXT("Find sessions completed. Successful: %lld, Results: %lld"), Record.A, Record.B);
+	case EMultiplayerTelemetryEvent::SessionFound:
+		return FString::Printf(TEXT("Search result %lld, match type %s"), Record.A, Record.B ? TEXT("matches") : TEXT("differs"));
+	case EMultiplayerTelemetryEvent::NoMatchingSession:
+		return FString::Printf(TEXT("No matching sessions found in %lld results"), Record.A);
+	case EMultiplayerTelemetryEvent::SessionJoinRequested:
+		return FString::Printf(TEXT("Joining session %s"), *Name);
+	case EMultiplayerTelemetryEvent::SessionJoinFailed:
+		return FString::Printf(TEXT("Join failed: %lld"), Record.A);
+	case EMultiplayerTelemetryEvent::ConnectStringResolved:
+		return FString::Printf(TEXT("Resolved connect string of %s"), *Name);
+	case EMultiplayerTelemetryEvent::ConnectStringFailed:
+		return FString::Printf(TEXT("Failed to get resolved connect string of %s"), *Name);
+	case EMultiplayerTelemetryEvent::ReservationBeaconFailed:
+		return TEXT("Reservation beacon failed to listen, slots are only checked at login");
+	case EMultiplayerTelemetryEvent::PlayerJoined:
+		return FString::Printf(TEXT("Player %lld has joined the session, players in game: %lld"), Record.A, Record.B);
+	case EMultiplayerTelemetryEvent::PlayerLeft:
+		return FString::Printf(TEXT("Player %lld has left the session, players in game: %lld"), Record.A, Record.B);
+	case EMultiplayerTelemetryEvent::BackendTimeout:
+		return FString::Printf(TEXT("%s timed out"), LexToString(static_cast<EMultiplayerBackendOp>(Record.A)));
+	case EMultiplayerTelemetryEvent::BackendRetry:
+		return FString::Printf(TEXT("%s failed, retry %lld"), LexToString(static_cast<EMultiplayerBackendOp>(Record.A)), Record.B);
+	case EMultiplayerTelemetryEvent::CircuitOpened:
+		return FString::Printf(TEXT("Online backend unhealthy after %s failed, failing calls for %llds"), LexToString(static_cast<EMultiplayerBackendOp>(Record.A)), Record.B);
+	case EMultiplayerTelemetryEvent::CircuitClosed:
+		return FString::Printf(TEXT("Online backend healthy again, %s succeeded"), LexToString(static_cast<EMultiplayerBackendOp>(Record.A)));
+	case EMultiplayerTelemetryEvent::CircuitRejected:
+		return FString::Printf(TEXT("%s not sent, online backend circuit is open"), LexToString(static_cast<EMultiplayerBackendOp>(Record.A)));
+	default:
+		return FString::Printf(TEXT("Unknown event %d"), static_cast<int32>(Record.Event));
+	}
+}
+
+#endif
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerWorldTickTimer.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+
+FMultiplayerWorldTickTimer::~FMultiplayerWorldTickTimer()
+{
+	Stop();
+}
+
+void FMultiplayerWorldTickTimer::Start(UWorld* InWorld)
+{
+	Stop();
+	if (InWorld == nullptr)
+	{
+		return;
+	}
+
+	World = InWorld;
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddLambda([this](UWorld* TickedWorld, ELevelTick TickType, float DeltaSeconds)
+	{
+		if (TickedWorld == World.Get())
+		{
+			TickStartCycles = FPlatformTime::Cycles64();
+		}
+	});
+	//Last thing the world's tick does, after the net driver sent everything
+	PostTickFlushHandle = InWorld->OnPostTickFlush().AddLambda([this]()
+	{
+		if (TickStartCycles != 0)
+		{
+			LastTickMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - TickStartCycles);
+			TickStartCycles = 0;
+			++NumTicks;
+		}
+	});
+}
+
+void FMultiplayerWorldTickTimer::Stop()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	TickStartHandle.Reset();
+	if (UWorld* TimedWorld = World.Get())
+	{
+		TimedWorld->OnPostTickFlush().Remove(PostTickFlushHandle);
+	}
+	PostTickFlushHandle.Reset();
+	World.Reset();
+	TickStartCycles = 0;
+	LastTickMs = 0.0;
+	NumTicks = 0;
+}
@@ -0,0 +1,250 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "Interfaces/OnlineIdentityInterface.h"
+#include "OnlineBeaconHost.h"
+#include "OnlineSubsystem.h"
+#include "MultiplayerReservationBeaconClient.h"
+#include "MultiplayerReservationBeaconHost.h"
+
+///
+///A lobby host and its clients over loopback, all beacons in one world that the test ticks itself. Every client
+///told Accepted must find its slot when it arrives, so no travel is wasted, and everyone past the last slot is told
+///SessionFull before travelling. A client asking for someone else's slot and a party over MaxPartySize are refused.
+///
+namespace MultiplayerReservationBeaconTest
+{
+	static constexpr int32 NumSlots = 4;
+	static constexpr int32 NumPlayers = 6;
+	static constexpr double TimeoutSeconds = 10.0;
+	static constexpr float TickSeconds = 1.f / 30.f;
+
+	struct FClient
+	{
+		TWeakObjectPtr<AMultiplayerReservationBeaconClient> Beacon;
+		/** What the login sends, the first local player's id in a game */
+		FUniqueNetIdRepl ConnectionId;
+		FMultiplayerSlotReservation Reservation;
+		TOptional<EMultiplayerReservationResult> Result;
+	};
+
+	struct FLoopback : public TSharedFromThis<FLoopback>
+	{
+		UWorld* World{nullptr};
+		TWeakObjectPtr<AOnlineBeaconHost> Listener;
+		TWeakObjectPtr<AMultiplayerReservationBeaconHost> Host;
+		TArray<FClient> Clients;
+		TArray<FUniqueNetIdRepl> PlayerIds;
+
+		bool Start(FAutomationTestBase& Test)
+		{
+			const IOnlineSubsystem* NullSubsystem = IOnlineSubsystem::Get(NULL_SUBSYSTEM);
+			const IOnlineIdentityPtr Identity = NullSubsystem ? NullSubsystem->GetIdentityInterface() : nullptr;
+			if (!Identity.IsValid())
+			{
+				Test.AddError(TEXT("Needs the NULL online subsystem for the players' ids"));
+				return false;
+			}
+			for (int32 Index = 0; Index < NumPlayers + 1; ++Index)
+			{
+				PlayerIds.Add(FUniqueNetIdRepl(Identity->CreateUniquePlayerId(FString::Printf(TEXT("LoopbackPlayer%d"), Index))));
+			}
+
+			World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("ReservationBeaconLoopback"));
+			FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+			WorldContext.SetCurrentWorld(World);
+			World->InitializeActorsForPlay(FURL());
+			World->BeginPlay();
+
+			AOnlineBeaconHost* ListenerActor = World->SpawnActor<AOnlineBeaconHost>(AOnlineBeaconHost::StaticClass());
+			if (ListenerActor == nullptr || !ListenerActor->InitHost())
+			{
+				Test.AddError(TEXT("The beacon host doesn't listen"));
+				return false;
+			}
+			AMultiplayerReservationBeaconHost* HostActor = World->SpawnActor<AMultiplayerReservationBeaconHost>(AMultiplayerReservationBeaconHost::StaticClass());
+			HostActor->SetMaxSlots(NumSlots);
+			ListenerActor->RegisterHost(HostActor);
+			ListenerActor->PauseBeaconRequests(false);
+			Listener = ListenerActor;
+			Host = HostActor;
+
+			//Honest players, more of them than there are slots
+			for (int32 Index = 0; Index < NumPlayers; ++Index)
+			{
+				FMultiplayerSlotReservation Reservation;
+				Reservation.PartyLeader = PlayerIds[Index];
+				Reservation.PartyMembers.Add(PlayerIds[Index]);
+				Connect(PlayerIds[Index], Reservation);
+			}
+
+			//Someone asking for the first player's slot
+			FMultiplayerSlotReservation Stolen;
+			Stolen.PartyLeader = PlayerIds[0];
+			Stolen.PartyMembers.Add(PlayerIds[0]);
+			Connect(PlayerIds[NumPlayers], Stolen);
+
+			//A party no split-screen client can have
+			FMultiplayerSlotReservation Oversized;
+			Oversized.PartyLeader = PlayerIds[NumPlayers];
+			for (int32 Index = 0; Index <= HostActor->GetMaxPartySize(); ++Index)
+			{
+				Oversized.PartyMembers.Add(Index == 0 ? PlayerIds[NumPlayers] : FUniqueNetIdRepl(Identity->CreateUniquePlayerId(FString::Printf(TEXT("LoopbackMember%d"), Index))));
+			}
+			Connect(PlayerIds[NumPlayers], Oversized);
+			return true;
+		}
+
+		void Connect(const FUniqueNetIdRepl& ConnectionId, const FMultiplayerSlotReservation& Reservation)
+		{
+			const int32 ClientIndex = Clients.AddDefaulted();
+			FClient& Client = Clients[ClientIndex];
+			Client.ConnectionId = ConnectionId;
+			Client.Reservation = Reservation;
+
+			AMultiplayerReservationBeaconClient* Beacon = World->SpawnActor<AMultiplayerReservationBeaconClient>(AMultiplayerReservationBeaconClient::StaticClass());
+			Client.Beacon = Beacon;
+			TWeakPtr<FLoopback> WeakThis = AsShared();
+			Beacon->OnReservationResponse.BindLambda([WeakThis, ClientIndex](EMultiplayerReservationResult Result)
+			{
+				if (TSharedPtr<FLoopback> This = WeakThis.Pin())
+				{
+					This->Clients[ClientIndex].Result = Result;
+				}
+			});
+			if (!Beacon->RequestReservation(FString::Printf(TEXT("127.0.0.1:%d"), Listener->GetListenPort()), Reservation))
+			{
+				Client.Result = EMultiplayerReservationResult::ConnectionFailed;
+				return;
+			}
+			//Sent to the host when the beacon joins, there is no local player to take it from here
+			if (UNetConnection* Connection = Beacon->GetNetConnection())
+			{
+				Connection->PlayerId = ConnectionId;
+			}
+		}
+
+		bool HaveAllResponded() const
+		{
+			return !Clients.ContainsByPredicate([](const FClient& Client) { return !Client.Result.IsSet(); });
+		}
+
+		void Check(FAutomationTestBase& Test)
+		{
+			AMultiplayerReservationBeaconHost* HostActor = Host.Get();
+			int32 NumAccepted = 0;
+			int32 NumFull = 0;
+			int32 NumWastedTravels = 0;
+			for (int32 Index = 0; Index < NumPlayers; ++Index)
+			{
+				const FClient& Client = Clients[Index];
+				if (!Client.Result.IsSet())
+				{
+					Test.AddError(FString::Printf(TEXT("Player %d got no answer"), Index));
+					continue;
+				}
+				if (Client.Result.GetValue() == EMultiplayerReservationResult::Accepted)
+				{
+					++NumAccepted;
+					//What PreLogin does when it arrives after the travel
+					NumWastedTravels += HostActor->ClaimSlot(Client.ConnectionId) ? 0 : 1;
+				}
+				NumFull += Client.Result.GetValue() == EMultiplayerReservationResult::SessionFull ? 1 : 0;
+			}
+			Test.TestEqual(TEXT("Accepted players"), NumAccepted, NumSlots);
+			Test.TestEqual(TEXT("Players told the lobby is full"), NumFull, NumPlayers - NumSlots);
+			Test.TestEqual(TEXT("Travels that don't find their slot"), NumWastedTravels, 0);
+			Test.TestFalse(TEXT("A player without a reservation gets in"), HostActor->ClaimSlot(PlayerIds[NumPlayers]));
+
+			const FClient& Stolen = Clients[NumPlayers];
+			Test.TestTrue(TEXT("Reserving someone else's slot is refused"),
+				Stolen.Result.IsSet() && Stolen.Result.GetValue() == EMultiplayerReservationResult::InvalidRequest);
+			//Dropped by the RPC's validation, which closes the connection
+			const FClient& Oversized = Clients[NumPlayers + 1];
+			Test.TestTrue(TEXT("An oversized party is refused"),
+				Oversized.Result.IsSet() && Oversized.Result.GetValue() != EMultiplayerReservationResult::Accepted);
+		}
+
+		void Stop()
+		{
+			for (const FClient& Client : Clients)
+			{
+				if (Client.Beacon.IsValid())
+				{
+					Client.Beacon->OnReservationResponse.Unbind();
+					Client.Beacon->DestroyBeacon();
+				}
+			}
+			if (Listener.IsValid())
+			{
+				Listener->DestroyBeacon();
+			}
+			if (Host.IsValid())
+			{
+				Host->Destroy();
+			}
+			if (World)
+			{
+				World->DestroyWorld(false);
+				GEngine->DestroyWorldContext(World);
+				World = nullptr;
+			}
+		}
+	};
+
+	class FTickLoopbackCommand : public IAutomationLatentCommand
+	{
+	public:
+		FTickLoopbackCommand(FAutomationTestBase& InTest, const TSharedRef<FLoopback>& InLoopback)
+			: Test(InTest)
+			, Loopback(InLoopback)
+		{
+		}
+
+		virtual bool Update() override
+		{
+			//The editor only ticks its own and the PIE worlds
+			Loopback->World->Tick(LEVELTICK_All, TickSeconds);
+			const bool bTimedOut = FPlatformTime::Seconds() - GetStartTime() > TimeoutSeconds;
+			if (!Loopback->HaveAllResponded() && !bTimedOut)
+			{
+				return false;
+			}
+
+			Loopback->Check(Test);
+			Loopback->Stop();
+			return true;
+		}
+
+	private:
+		FAutomationTestBase& Test;
+		TSharedRef<FLoopback> Loopback;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMultiplayerReservationBeaconLoopbackTest, "MultiplayerSessions.ReservationBeacon.Loopback",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FMultiplayerReservationBeaconLoopbackTest::RunTest(const FString& Parameters)
+{
+	using namespace MultiplayerReservationBeaconTest;
+
+	TSharedRef<FLoopback> Loopback = MakeShared<FLoopback>();
+	if (!Loopback->Start(*this))
+	{
+		Loopback->Stop();
+		return false;
+	}
+	ADD_LATENT_AUTOMATION_COMMAND(FTickLoopbackCommand(*this, Loopback));
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -20,7 +20,9 @@ class MULTIPLAYERSESSIONS_API UMenu : public UUserWidget
 public:
 	UFUNCTION(BlueprintCallable, Category = "MultiplayerSessions|Menu")
 	void MenuSetup(int32 NumberOfPublicConnections = 4,FString TypeOfMatch = FString(TEXT("FreeForAll")),FString PathToLobby = FString(TEXT("/Game/ThirdPerson/Maps/Lobby")));
-	
+
+	/** Index of the first result hosting MatchType, INDEX_NONE if there is none. Results come ranked best first */
+	static int32 FindMatchingResult(const TArray<FOnlineSessionSearchResult>& SessionResults, EMultiplayerMatchType MatchType);
 	
 protected:
 	
@@ -65,6 +67,6 @@ private:
 	class UMultiplayerSessionSubsystem* MultiplayerSessionSubsystem;
 
 	int32 NumPublicConnections{4};
-	FString MatchType{TEXT("FreeForAll")};
+	EMultiplayerMatchType MatchType{EMultiplayerMatchType::FreeForAll};
 	FString PathToLobby{TEXT("")};
 };
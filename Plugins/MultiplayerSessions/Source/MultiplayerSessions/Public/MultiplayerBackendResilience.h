@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+/** Online backend calls the session subsystem guards with a timeout, retries and the circuit breaker */
+enum class EMultiplayerBackendOp : uint8
+{
+	CreateSession,
+	FindSessions,
+	JoinSession,
+	UpdateSession,
+
+	Count
+};
+
+MULTIPLAYERSESSIONS_API const TCHAR* LexToString(EMultiplayerBackendOp Op);
+
+/** Totals since startup for one operation, always counted so servers can export them */
+struct FMultiplayerBackendOpStats
+{
+	uint32 Attempts{0};
+	uint32 Failures{0};
+	uint32 Timeouts{0};
+	uint32 Retries{0};
+	/** Failed right away because the circuit was open */
+	uint32 Rejected{0};
+};
+
+/** The one call of an operation currently in flight, if any */
+struct FMultiplayerBackendCall
+{
+	bool bInFlight{false};
+	/** Of the latest attempt, callbacks and timeouts of any other attempt are dropped. 0 is never used */
+	uint32 Generation{0};
+	/**
+	 * Attempt the backend still owes an answer, 0 when none. The session interface doesn't say which call an answer
+	 * is for, so only one attempt per operation is ever out at the backend: after a timeout the next attempt waits
+	 * until the late answer came and was dropped, or until AwaitUntil, when it counts as lost.
+	 */
+	uint32 AwaitingGeneration{0};
+	double AwaitUntil{0.0};
+	/** Retries done for the current request, reset once it succeeds or gives up */
+	int32 Retry{0};
+	FTSTicker::FDelegateHandle TimeoutHandle;
+	FTSTicker::FDelegateHandle RetryHandle;
+};
+
+/**
+ * Shared by every backend operation, since a degraded backend is degraded for all of them.
+ * Closed lets calls through. FailureThreshold failures in a row open it, and calls then fail without reaching the
+ * backend for OpenSeconds. After that a single probe call goes through (half open): success closes it, failure
+ * opens it again.
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerCircuitBreaker
+{
+public:
+	enum class EState : uint8
+	{
+		Closed,
+		Open,
+		HalfOpen
+	};
+
+	void Configure(int32 InFailureThreshold, double InOpenSeconds);
+
+	/** False while open, or while the half open probe is still out */
+	bool AllowRequest(double Now);
+
+	/** True when this closed the circuit again */
+	bool RecordSuccess();
+
+	/** True when this opened the circuit */
+	bool RecordFailure(double Now);
+
+	/** Closed with no failures counted, for a backend that has nothing to do with the one the failures came from */
+	void Reset();
+
+	EState GetState() const { return State; }
+	uint32 GetNumOpens() const { return NumOpens; }
+
+private:
+	EState State{EState::Closed};
+	int32 ConsecutiveFailures{0};
+	double OpenUntil{0.0};
+	bool bProbeInFlight{false};
+	uint32 NumOpens{0};
+
+	int32 FailureThreshold{4};
+	double OpenSeconds{30.0};
+};
+
+namespace MultiplayerBackendResilience
+{
+	/** Seconds to wait before retry number Retry (from 1): between half and all of BaseDelay * 2^(Retry-1), capped at MaxDelay */
+	MULTIPLAYERSESSIONS_API float GetBackoffDelay(int32 Retry, float BaseDelay, float MaxDelay);
+}
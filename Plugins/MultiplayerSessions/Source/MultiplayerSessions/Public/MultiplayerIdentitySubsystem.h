@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "GameFramework/OnlineReplStructs.h"
+#include "Interfaces/OnlineIdentityInterface.h"
+#include "MultiplayerIdentitySubsystem.generated.h"
+
+class ULocalPlayer;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnNetIdChanged, int32 /*LocalUserNum*/, const FUniqueNetIdRepl&);
+
+/**
+ * Single place to ask "who is this local player online".
+ * Each local user's NetId is resolved once and cached per controller id, so split-screen players
+ * get their own id. The cache is dropped when the identity interface reports a login change.
+ * Lookups on a warm cache are a plain array read on the game thread, no online interface calls and no locks.
+ */
+UCLASS()
+class MULTIPLAYERSESSIONS_API UMultiplayerIdentitySubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** NetId of the local user signed in on LocalUserNum (the controller id) */
+	FUniqueNetIdRepl GetNetId(int32 LocalUserNum);
+
+	/** NetId of LocalPlayer, falls back to the first local player when null */
+	FUniqueNetIdRepl GetNetIdForLocalPlayer(const ULocalPlayer* LocalPlayer);
+
+	ELoginStatus::Type GetLoginStatus(int32 LocalUserNum) const;
+
+	/** Drops the cached id of LocalUserNum, or of every local user with INDEX_NONE */
+	void Invalidate(int32 LocalUserNum = INDEX_NONE);
+
+	static FString NetIdToString(const FUniqueNetIdRepl& NetId);
+
+	/** Fired when a local user's login changed and their cached id was dropped */
+	FMultiplayerOnNetIdChanged MultiplayerOnNetIdChanged;
+
+private:
+	struct FCachedNetId
+	{
+		FUniqueNetIdRepl NetId;
+		bool bResolved{false};
+	};
+
+	void BindIdentityInterface();
+	void UnbindIdentityInterface();
+	/** The online subsystem came up after us, the interface was null until now */
+	void OnOnlineServicesReady();
+
+	FUniqueNetIdRepl ResolveNetId(int32 LocalUserNum) const;
+	const ULocalPlayer* FindLocalPlayer(int32 LocalUserNum) const;
+
+	void OnLoginStatusChanged(int32 LocalUserNum, ELoginStatus::Type OldStatus, ELoginStatus::Type NewStatus, const FUniqueNetId& NewId);
+	void OnLoginComplete(int32 LocalUserNum, bool bWasSuccessful, const FUniqueNetId& UserId, const FString& Error);
+
+	IOnlineIdentityPtr IdentityInterface;
+	FCachedNetId CachedNetIds[MAX_LOCAL_PLAYERS];
+	FDelegateHandle LoginStatusChangedDelegateHandles[MAX_LOCAL_PLAYERS];
+	FDelegateHandle LoginCompleteDelegateHandles[MAX_LOCAL_PLAYERS];
+	FDelegateHandle OnlineServicesReadyHandle;
+};
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Logging/LogMacros.h"
+
+MULTIPLAYERSESSIONS_API DECLARE_LOG_CATEGORY_EXTERN(LogMultiplayerJoinFunnel, Log, All);
+
+/** Steps of one join, in the order they happen. The Server* ones are logged by the host */
+enum class EMultiplayerJoinPhase : uint8
+{
+	JoinClicked,
+	SearchCompleted,
+	ReservationCompleted,
+	JoinSessionCompleted,
+	ClientTravel,
+	ServerPreLogin,
+	ServerPostLogin,
+
+	Count
+};
+
+MULTIPLAYERSESSIONS_API const TCHAR* LexToString(EMultiplayerJoinPhase Phase);
+MULTIPLAYERSESSIONS_API bool LexTryParseString(EMultiplayerJoinPhase& OutPhase, const TCHAR* Buffer);
+
+/**
+ * Correlation id of a join, created when the player clicks Join and carried to the host in the
+ * connect URL (?JoinId=). Each phase logs one line on whichever side it happens:
+ *
+ *   JoinFunnel: id=<id> phase=<phase> pid=<process> utc=<ISO 8601> mono=<seconds>
+ *
+ * mono is FPlatformTime::Seconds, used for durations inside one process. utc lines up client and
+ * server lines. -run=MultiplayerJoinFunnelReport merges the logs of both sides into per-join timelines.
+ */
+struct MULTIPLAYERSESSIONS_API FMultiplayerJoinFunnel
+{
+	/** URL option the id travels in */
+	static const TCHAR* const UrlOption;
+
+	static FString NewCorrelationId();
+
+	static FString AppendToURL(const FString& URL, const FString& CorrelationId);
+
+	/** Id from login options, empty when the player didn't come through the join funnel (e.g. the listen server host) */
+	static FString ParseFromOptions(const FString& Options);
+
+	/** Does nothing for an empty id */
+	static void LogPhase(const FString& CorrelationId, EMultiplayerJoinPhase Phase);
+};
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MultiplayerJoinFunnelReportCommandlet.generated.h"
+
+/**
+ * Merges client and server logs into one timeline per join (see FMultiplayerJoinFunnel) and reports
+ * percentiles of every funnel step, so it's clear whether search, handshake or map load is the slow part.
+ *
+ *   UnrealEditor-Cmd MPTesting_CPlusPlus.uproject -run=MultiplayerJoinFunnelReport -Logs="Client.log;Server.log" [-Csv=Joins.csv] [-Timelines]
+ */
+UCLASS()
+class MULTIPLAYERSESSIONS_API UMultiplayerJoinFunnelReportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMultiplayerJoinFunnelReportCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "OnlineSubsystem.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "Interfaces/OnlineIdentityInterface.h"
+
+/**
+ * Process-wide, lazily resolved handle to the online subsystem and the interfaces we use.
+ * Nothing touches the online subsystem until the first game instance starts (or someone asks),
+ * so CDO construction and module load stay free of online work. Interfaces are held weakly and
+ * re-resolved if the online subsystem was torn down in between. While there is no online subsystem at all
+ * it is looked for again every ResolveRetrySeconds, and OnOnlineServicesReady tells whoever got nulls before.
+ * Game thread only.
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerOnlineServices
+{
+public:
+	static FMultiplayerOnlineServices& Get();
+
+	/** Resolves the online subsystem on first call, later calls return straight away once it was found */
+	void Initialize();
+
+	IOnlineSubsystem* GetOnlineSubsystem();
+	IOnlineSessionPtr GetSessionInterface();
+	IOnlineIdentityPtr GetIdentityInterface();
+	FName GetSubsystemName();
+
+	/** The NULL subsystem only supports LAN sessions */
+	bool IsLANOnly();
+
+	/**
+	 * Routes every session call to this interface instead of the online subsystem's, e.g. a mock backend for perf
+	 * runs. Null restores the real one. Holders of the old interface hear about it through OnSessionInterfaceChanged.
+	 */
+	void SetSessionInterfaceOverride(IOnlineSessionPtr InSessionInterface);
+	FSimpleMulticastDelegate OnSessionInterfaceChanged;
+
+	/** Once, when the online subsystem is first found. Holders of its interfaces fetch and bind them again */
+	FSimpleMulticastDelegate OnOnlineServicesReady;
+
+private:
+	FMultiplayerOnlineServices() = default;
+
+	void Resolve();
+
+	static constexpr double ResolveRetrySeconds = 1.0;
+
+	/** Only once the online subsystem was found */
+	bool bInitialized{false};
+	double NextResolveTime{0.0};
+	bool bReportedMissing{false};
+	/** Keeps looking while there is no online subsystem, whether anyone asks or not */
+	FTSTicker::FDelegateHandle RetryTickerHandle;
+	IOnlineSubsystem* OnlineSubsystem{nullptr};
+	TWeakPtr<IOnlineSession, ESPMode::ThreadSafe> SessionInterface;
+	IOnlineSessionPtr SessionInterfaceOverride;
+	TWeakPtr<IOnlineIdentity, ESPMode::ThreadSafe> IdentityInterface;
+	FName SubsystemName;
+};
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineBeaconClient.h"
+#include "MultiplayerReservationTypes.h"
+#include "MultiplayerReservationBeaconClient.generated.h"
+
+DECLARE_DELEGATE_OneParam(FOnMultiplayerReservationResponse, EMultiplayerReservationResult);
+
+/**
+ * Client side of the slot reservation beacon.
+ * Connects to the lobby host before ClientTravel, asks for the slots of the whole party
+ * and reports the answer through OnReservationResponse.
+ */
+UCLASS(transient, notplaceable)
+class MULTIPLAYERSESSIONS_API AMultiplayerReservationBeaconClient : public AOnlineBeaconClient
+{
+	GENERATED_BODY()
+public:
+	AMultiplayerReservationBeaconClient();
+
+	/** Connect to the host beacon at ConnectString and send Reservation once connected */
+	bool RequestReservation(const FString& ConnectString, const FMultiplayerSlotReservation& Reservation);
+
+	FOnMultiplayerReservationResponse OnReservationResponse;
+
+	//~ Begin AOnlineBeaconClient Interface
+	virtual void OnConnected() override;
+	virtual void OnFailure() override;
+	//~ End AOnlineBeaconClient Interface
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerRequestReservation(const FMultiplayerSlotReservation& Reservation);
+
+	UFUNCTION(Client, Reliable)
+	void ClientReservationResponse(EMultiplayerReservationResult Result);
+
+private:
+	void Respond(EMultiplayerReservationResult Result);
+
+	FMultiplayerSlotReservation PendingReservation;
+	bool bResponded{false};
+};
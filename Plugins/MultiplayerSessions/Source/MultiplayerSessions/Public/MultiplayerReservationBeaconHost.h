@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineBeaconHostObject.h"
+#include "MultiplayerReservationTypes.h"
+#include "MultiplayerReservationBeaconHost.generated.h"
+
+/**
+ * Server side of the slot reservation beacon. Owns the slot book-keeping of the lobby:
+ * beacon reservations, players that are mid-handshake and players that are in the game.
+ * Reservations that are not used in time are released again.
+ */
+UCLASS(transient, notplaceable, config=Game)
+class MULTIPLAYERSESSIONS_API AMultiplayerReservationBeaconHost : public AOnlineBeaconHostObject
+{
+	GENERATED_BODY()
+public:
+	AMultiplayerReservationBeaconHost();
+
+	void SetMaxSlots(int32 InMaxSlots) { MaxSlots = InMaxSlots; }
+	int32 GetMaxSlots() const { return MaxSlots; }
+	int32 GetNumUsedSlots() const { return Slots.Num(); }
+	int32 GetMaxPartySize() const { return MaxPartySize; }
+
+	///
+	///Reserves a slot for every party member, or none of them. ConnectionId is the id the beacon connection logged
+	///in with, only that player can lead a party: a client can't reserve slots for ids it doesn't own, nor keep
+	///refreshing slots another party holds.
+	///
+	EMultiplayerReservationResult ProcessReservationRequest(const FMultiplayerSlotReservation& Reservation, const FUniqueNetIdRepl& ConnectionId);
+
+	///
+	///Called from the game mode. Claim turns a reservation into a connecting player, or takes a free
+	///slot for players that skipped the beacon (invites, the listen server host). Join marks the handshake done.
+	///
+	bool ClaimSlot(const FUniqueNetIdRepl& PlayerId);
+	void JoinSlot(const FUniqueNetIdRepl& PlayerId);
+	void ReleaseSlot(const FUniqueNetIdRepl& PlayerId);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	enum class ESlotState : uint8
+	{
+		Reserved,
+		Connecting,
+		Joined
+	};
+
+	struct FSlot
+	{
+		FUniqueNetIdRepl PlayerId;
+		ESlotState State;
+		double ExpireTime;
+		/** Who reserved it, the player themself for slots taken without the beacon */
+		FUniqueNetIdRepl Leader;
+	};
+
+	FSlot* FindSlot(const FUniqueNetIdRepl& PlayerId);
+	void ExpireSlots();
+
+	/** Seconds a beacon reservation is held before the player has to show up */
+	UPROPERTY(Config)
+	float ReservationTimeout{30.f};
+
+	/** Seconds a claimed slot is held while the client loads the map */
+	UPROPERTY(Config)
+	float ConnectingTimeout{60.f};
+
+	/** Largest party one request may reserve for, the local players of one split-screen client */
+	UPROPERTY(Config)
+	int32 MaxPartySize{4};
+
+	int32 MaxSlots{4};
+	TArray<FSlot> Slots;
+	FTimerHandle ExpireTimerHandle;
+};
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/OnlineReplStructs.h"
+#include "MultiplayerReservationTypes.generated.h"
+
+///
+/// Result of a slot reservation request sent over the reservation beacon
+///
+UENUM(BlueprintType)
+enum class EMultiplayerReservationResult : uint8
+{
+	Accepted,
+	SessionFull,
+	InvalidRequest,
+	ConnectionFailed
+};
+
+///
+/// A reservation request. A solo player is a party of one; every member reserves one slot
+/// and the whole party is accepted or rejected together.
+///
+USTRUCT()
+struct MULTIPLAYERSESSIONS_API FMultiplayerSlotReservation
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FUniqueNetIdRepl PartyLeader;
+
+	UPROPERTY()
+	TArray<FUniqueNetIdRepl> PartyMembers;
+
+	bool IsValid() const
+	{
+		return PartyLeader.IsValid() && PartyMembers.Num() > 0;
+	}
+};
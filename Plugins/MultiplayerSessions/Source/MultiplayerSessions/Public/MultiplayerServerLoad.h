@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * How busy a host is, advertised on its session as one packed integer so a refresh is a single key:
+ * game thread ms EMA in quarter milliseconds (bits 0-11), CPU headroom percent (bits 12-18), free slots (bits 19-26).
+ */
+struct FMultiplayerServerLoad
+{
+	float TickMs{0.f};
+	uint8 HeadroomPercent{100};
+	uint8 FreeSlots{0};
+
+	int32 Pack() const
+	{
+		const int32 TickQuarters = FMath::Clamp(FMath::RoundToInt(TickMs * 4.f), 0, 0xFFF);
+		return TickQuarters | (FMath::Min<int32>(HeadroomPercent, 100) << 12) | (static_cast<int32>(FreeSlots) << 19);
+	}
+
+	static FMultiplayerServerLoad Unpack(int32 Packed)
+	{
+		FMultiplayerServerLoad Load;
+		Load.TickMs = (Packed & 0xFFF) / 4.f;
+		Load.HeadroomPercent = static_cast<uint8>((Packed >> 12) & 0x7F);
+		Load.FreeSlots = static_cast<uint8>((Packed >> 19) & 0xFF);
+		return Load;
+	}
+
+	/** Small wobbles aren't worth a backend update */
+	bool IsNearlyEqual(const FMultiplayerServerLoad& Other) const
+	{
+		return FMath::Abs(TickMs - Other.TickMs) < 1.f && FMath::Abs(HeadroomPercent - Other.HeadroomPercent) < 5 && FreeSlots == Other.FreeSlots;
+	}
+};
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MultiplayerSessionSchema.generated.h"
+
+class FOnlineSessionSettings;
+
+/** What a session is being hosted for, advertised as a number rather than its name */
+UENUM(BlueprintType)
+enum class EMultiplayerMatchType : uint8
+{
+	FreeForAll,
+	TeamDeathmatch,
+	Coop,
+
+	Invalid UMETA(Hidden)
+};
+
+/** Yes/no facts about a host, packed next to the match type */
+enum class EMultiplayerSessionFlags : uint8
+{
+	None				= 0,
+	JoinInProgress		= 1 << 0,
+	DedicatedServer		= 1 << 1,
+	LANOnly				= 1 << 2,
+};
+ENUM_CLASS_FLAGS(EMultiplayerSessionFlags);
+
+/** Parses a match type by name, as the menu receives it from Blueprints */
+MULTIPLAYERSESSIONS_API bool LexTryParseString(EMultiplayerMatchType& OutMatchType, const TCHAR* Buffer);
+MULTIPLAYERSESSIONS_API const TCHAR* LexToString(EMultiplayerMatchType MatchType);
+
+/**
+ * Every attribute this plugin advertises on a session. Keys are built once and kept short since they are sent
+ * with every result, values are integers so filtering and sorting a large result list never compares strings.
+ */
+namespace MultiplayerSessionSchema
+{
+	///
+	///Attribute keys
+	///
+	/** Packed FMultiplayerSessionMode */
+	extern MULTIPLAYERSESSIONS_API const FName ModeKey;
+	/** FString, searched first so players land near their host */
+	extern MULTIPLAYERSESSIONS_API const FName RegionKey;
+	/** int32, searches only return hosts running the same build */
+	extern MULTIPLAYERSESSIONS_API const FName BuildIdKey;
+	/** Packed FMultiplayerServerLoad, refreshed by the host while it runs */
+	extern MULTIPLAYERSESSIONS_API const FName LoadKey;
+}
+
+/** Match type in bits 0-7 and EMultiplayerSessionFlags in bits 8-15 of a single attribute */
+struct FMultiplayerSessionMode
+{
+	EMultiplayerMatchType MatchType{EMultiplayerMatchType::Invalid};
+	EMultiplayerSessionFlags Flags{EMultiplayerSessionFlags::None};
+
+	int32 Pack() const
+	{
+		return static_cast<int32>(MatchType) | (static_cast<int32>(Flags) << 8);
+	}
+
+	static FMultiplayerSessionMode Unpack(int32 Packed)
+	{
+		FMultiplayerSessionMode Mode;
+		Mode.MatchType = static_cast<EMultiplayerMatchType>(Packed & 0xFF);
+		Mode.Flags = static_cast<EMultiplayerSessionFlags>((Packed >> 8) & 0xFF);
+		return Mode;
+	}
+
+	/** Writes the mode on a session the host is about to advertise */
+	MULTIPLAYERSESSIONS_API void Write(FOnlineSessionSettings& Settings) const;
+
+	/** Mode advertised on a search result, MatchType is Invalid if the host didn't advertise one */
+	static MULTIPLAYERSESSIONS_API FMultiplayerSessionMode Read(const FOnlineSessionSettings& Settings);
+};
@@ -5,8 +5,17 @@
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "OnlineSessionSettings.h"
+#include "MultiplayerReservationTypes.h"
+#include "MultiplayerServerLoad.h"
+#include "MultiplayerSessionSchema.h"
+#include "MultiplayerBackendResilience.h"
+#include "MultiplayerWorldTickTimer.h"
+#include "Containers/Ticker.h"
 #include "MultiplayerSessionSubsystem.generated.h"
 
+class AMultiplayerReservationBeaconClient;
+
 ///
 /// Declaring our own custom delegates for the Menu class to bind callbacks to 
 ///
@@ -18,24 +27,51 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnStartSessionComplete,
 /**
  * 
  */
-UCLASS()
+UCLASS(config=Game)
 class MULTIPLAYERSESSIONS_API UMultiplayerSessionSubsystem : public UGameInstanceSubsystem
 {
 	GENERATED_BODY()
 public:
 	UMultiplayerSessionSubsystem();
 
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
 	///
 	///To handle session functionality. The Menu class will call these
 	///
-	void CreateSession(int32 NumPublicConnections,FString MatchType);
+	void CreateSession(int32 NumPublicConnections,EMultiplayerMatchType MatchType);
 	void FindSession(int32 MaxSearchResults);
 	void JoinSession(const FOnlineSessionSearchResult& SessionResult);
 	void StartSession();
 	void DestroySession();
+
+	///
+	///Called by the lobby once its reservation beacon listens, so clients know where to reserve a slot
+	///
+	void AdvertiseBeaconPort(int32 BeaconPort);
+
+	///
+	///State of the hosted/joined game session, NoSession when there is none
+	///
+	EOnlineSessionState::Type GetSessionState() const;
+	int32 GetNumOpenPublicConnections() const;
+
 	UFUNCTION(BlueprintCallable, Category = "MultiplayerSessions|Menu")
 	FUniqueNetIdRepl GetPlayerNetId() const;
 
+	///
+	///Join funnel: a new correlation id per Join click, logged at each step and handed to the host in the connect URL
+	///
+	void StartJoinFunnel();
+	const FString& GetJoinCorrelationId() const { return JoinCorrelationId; }
+
+	///
+	///Backend health, for metrics
+	///
+	const FMultiplayerBackendOpStats& GetBackendStats(EMultiplayerBackendOp Op) const { return BackendStats[static_cast<int32>(Op)]; }
+	const FMultiplayerCircuitBreaker& GetBackendCircuit() const { return BackendCircuit; }
+
 
 	///
 	///Our own custom delegates foe the Menu class to bind callbacks to 
@@ -56,7 +92,79 @@ protected:
 	void OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result);
 	void OnDestroySessionComplete(FName SessionName, bool bWasSuccessful);
 	void OnStartSessionComplete(FName SessionName, bool bWasSuccessful);
-	FString NetIdToString(const FUniqueNetIdRepl& NetId) const;
+	void OnUpdateSessionComplete(FName SessionName, bool bWasSuccessful);
+
+	///
+	///The results of one attempt, from its backend answer, its timeout or its start call failing. Each drops the
+	///result unless Generation is the attempt still in flight
+	///
+	void CompleteCreateSession(uint32 Generation, bool bWasSuccessful);
+	void CompleteFindSessions(uint32 Generation, bool bWasSuccessful);
+	void CompleteJoinSession(uint32 Generation, EOnJoinSessionCompleteResult::Type Result);
+	void CompleteUpdateSession(uint32 Generation, bool bWasSuccessful);
+
+	///
+	///Every backend call goes Begin -> Sent -> (answer or timeout) -> End. A failed Create/Find is retried with backoff
+	///before the Menu hears about it, and while the circuit is open calls fail without reaching the backend.
+	///
+	void AttemptCreateSession();
+	void SendCreateSession();
+	/** False while the operation is in flight or still owed an answer, or while the circuit is open */
+	bool BeginBackendCall(EMultiplayerBackendOp Op);
+	/** Right before the call goes to the backend, its answer is awaited from then on */
+	void MarkBackendCallSent(EMultiplayerBackendOp Op);
+	/** The start call failed, the backend owes nothing. Returns the attempt's generation to complete it with */
+	uint32 MarkBackendCallNotSent(EMultiplayerBackendOp Op);
+	/** The attempt an answer from the backend belongs to, 0 when none was owed one */
+	uint32 TakeBackendAnswer(EMultiplayerBackendOp Op);
+	bool IsBackendBusy(EMultiplayerBackendOp Op) const;
+	/** False when Generation isn't the call in flight: it already ended, e.g. it timed out or was answered during its start call */
+	bool EndBackendCall(EMultiplayerBackendOp Op, uint32 Generation, bool bWasSuccessful);
+	bool ScheduleBackendRetry(EMultiplayerBackendOp Op);
+	bool OnBackendCallTimeout(float DeltaTime, EMultiplayerBackendOp Op, uint32 Generation);
+	bool OnBackendRetry(float DeltaTime, EMultiplayerBackendOp Op);
+	float GetBackendTimeout(EMultiplayerBackendOp Op) const;
+	/** Drops every call, retry and owed answer without touching the circuit, and fails the requests they were for */
+	void AbandonBackendCalls();
+
+	///
+	///Our callbacks stay bound for as long as we use an interface, so late answers are seen and dropped rather than
+	///taken for the next attempt's
+	///
+	void BindSessionInterface();
+	void UnbindSessionInterface();
+	void OnSessionInterfaceChanged();
+
+	///
+	///Slot reservation over the lobby beacon, done before we join and travel
+	///
+	bool RequestSlotReservation(const FString& BeaconConnectString);
+	void OnReservationResponse(EMultiplayerReservationResult Result);
+	/** Drops a reservation still waiting for its answer, true if there was one */
+	bool CancelSlotReservation();
+	void JoinReservedSession(const FOnlineSessionSearchResult& SessionResult);
+
+	///
+	///Region partitioned search, one region ring at a time, nearest first
+	///
+	void StartRegionSearch();
+	void FinishRegionSearch();
+	FString GetRegion() const;
+
+	///
+	///Host load record. Sampled every frame into an EMA, republished only when it moved, and all setting changes
+	///go out as one UpdateSession no more often than MinSessionUpdateInterval
+	///
+	void StartLoadReporting();
+	bool TickLoadReporting(float DeltaTime);
+	void MarkSessionSettingsDirty();
+	void FlushSessionSettings();
+
+	///
+	///Lower is better: ping plus a penalty for a busy or full host
+	///
+	float ScoreSearchResult(const FOnlineSessionSearchResult& SearchResult) const;
+	void RankSearchCandidates();
 
 private:
 	IOnlineSessionPtr SessionInterface;
@@ -77,5 +185,113 @@ private:
 	FDelegateHandle DestroySessionCompleteDelegateHandle;
 	FOnStartSessionCompleteDelegate StartSessionCompleteDelegate;
 	FDelegateHandle StartSessionCompleteDelegateHandle;
+	FOnUpdateSessionCompleteDelegate UpdateSessionCompleteDelegate;
+	FDelegateHandle UpdateSessionCompleteDelegateHandle;
+
+	UPROPERTY()
+	AMultiplayerReservationBeaconClient* ReservationBeacon;
+	FOnlineSessionSearchResult PendingJoinResult;
+
+	/** Reserve a slot over the lobby beacon before joining, so a full lobby is rejected before we travel */
+	UPROPERTY(Config)
+	bool bReserveSlotBeforeJoin{true};
+
+	/** Region this machine advertises its sessions in and searches first. -Region= on the command line overrides it */
+	UPROPERTY(Config)
+	FString Region;
+
+	/** Regions to widen the search to, nearest first, when the home region has too few sessions */
+	UPROPERTY(Config)
+	TArray<FString> NearbyRegions;
+
+	/** Stop widening the search once this many joinable sessions were found */
+	UPROPERTY(Config)
+	int32 MinGoodSearchCandidates{4};
+
+	TArray<FString> SearchRegions;
+	int32 SearchRegionIndex{0};
+	int32 SearchMaxResults{0};
+	int32 NumGoodSearchCandidates{0};
+	TArray<FOnlineSessionSearchResult> SearchCandidates;
+	TSet<FString> SearchCandidateIds;
+
+	FString JoinCorrelationId;
+
+	/** Game thread budget of a host, its headroom is measured against this */
+	UPROPERTY(Config)
+	float TargetTickMs{33.3f};
+
+	UPROPERTY(Config)
+	float LoadSampleInterval{5.f};
+
+	UPROPERTY(Config)
+	float MinSessionUpdateInterval{15.f};
+
+	/** Extra ms of ping a fully loaded host is worth when ranking search results */
+	UPROPERTY(Config)
+	float LoadPenaltyMs{100.f};
+
+	/** Ping assumed for results whose ping the backend doesn't know */
+	UPROPERTY(Config)
+	int32 UnknownPingMs{100};
+
+	/** Hosts scoring within this of the best are picked at random, so players spread instead of piling onto one */
+	UPROPERTY(Config)
+	float SelectionSlackMs{20.f};
+
+	FTSTicker::FDelegateHandle LoadTickerHandle;
+	/** What TickMsEMA averages, the game world's tick */
+	FMultiplayerWorldTickTimer LoadTickTimer;
+	float TickMsEMA{0.f};
+	float TimeUntilLoadSample{0.f};
+	FMultiplayerServerLoad PublishedLoad;
+	bool bHasPublishedLoad{false};
+	bool bSessionSettingsDirty{false};
+	bool bSessionUpdateInFlight{false};
+	double NextSessionUpdateTime{0.0};
+
+	///
+	///Seconds before a backend call whose callback never came counts as failed
+	///
+	UPROPERTY(Config)
+	float CreateSessionTimeout{20.f};
+
+	UPROPERTY(Config)
+	float FindSessionsTimeout{15.f};
+
+	UPROPERTY(Config)
+	float JoinSessionTimeout{20.f};
+
+	UPROPERTY(Config)
+	float UpdateSessionTimeout{15.f};
+
+	/** Retries of a failed CreateSession/FindSessions before the failure reaches the Menu */
+	UPROPERTY(Config)
+	int32 MaxBackendRetries{2};
+
+	/** First retry waits about this long, each following one twice as long up to RetryMaxDelay */
+	UPROPERTY(Config)
+	float RetryBaseDelay{1.f};
+
+	UPROPERTY(Config)
+	float RetryMaxDelay{8.f};
+
+	/** Backend failures in a row that open the circuit */
+	UPROPERTY(Config)
+	int32 CircuitFailureThreshold{4};
+
+	/** How long an open circuit fails calls before letting a probe through */
+	UPROPERTY(Config)
+	float CircuitOpenSeconds{30.f};
+
+	/** CreateSession attempt waiting for the old session to be destroyed first, 0 when none */
+	uint32 CreateAfterDestroyGeneration{0};
+
+	FMultiplayerCircuitBreaker BackendCircuit;
+	FMultiplayerBackendCall BackendCalls[static_cast<int32>(EMultiplayerBackendOp::Count)];
+	FMultiplayerBackendOpStats BackendStats[static_cast<int32>(EMultiplayerBackendOp::Count)];
+
+	FDelegateHandle SessionInterfaceChangedHandle;
+	FDelegateHandle OnlineServicesReadyHandle;
 	
 };
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "HAL/LowLevelMemTracker.h"
+
+///
+///Unreal Insights instrumentation of the session pipeline.
+///Capture with -trace=default,MultiplayerSessions (add Lobby for the lobby game mode) and, for the
+///memory tag, -llm. Everything here compiles to nothing when tracing/LLM is off.
+///
+UE_TRACE_CHANNEL_EXTERN(MultiplayerSessionsChannel, MULTIPLAYERSESSIONS_API);
+LLM_DECLARE_TAG_API(MultiplayerSessions, MULTIPLAYERSESSIONS_API);
+
+/** CPU scope on the MultiplayerSessions channel, Name is stringized (e.g. UMenu::OnJoinSession) */
+#define MULTIPLAYER_SESSIONS_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, MultiplayerSessionsChannel)
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Logging/LogMacros.h"
+
+///
+///Session/lobby telemetry. Call sites record a typed event with a couple of integer arguments,
+///nothing is formatted or allocated at that point. Events land in a fixed lock-free ring and are
+///only turned into text when someone asks (MultiplayerSessions.Telemetry.Dump), or right away when
+///they are at least as severe as MultiplayerSessions.Telemetry.EchoVerbosity.
+///Compiled out of Shipping and Server targets, the macro arguments are not even evaluated there.
+///
+#ifndef MULTIPLAYER_TELEMETRY_ENABLED
+#define MULTIPLAYER_TELEMETRY_ENABLED !(UE_BUILD_SHIPPING || UE_SERVER)
+#endif
+
+MULTIPLAYERSESSIONS_API DECLARE_LOG_CATEGORY_EXTERN(LogMultiplayerSessions, Log, All);
+MULTIPLAYERSESSIONS_API DECLARE_LOG_CATEGORY_EXTERN(LogMultiplayerLobby, Log, All);
+
+/** Every event has a fixed category, verbosity and message, see MultiplayerTelemetry.cpp */
+enum class EMultiplayerTelemetryEvent : uint8
+{
+	OnlineServicesReady,		//Name: subsystem, A: init time in microseconds
+	OnlineSubsystemMissing,
+	SessionInterfaceMissing,
+	NetIdResolved,				//A: local user, B: source (0 identity, 1 preferred, 2 cached)
+	NetIdMissing,				//A: local user
+	NotLoggedIn,				//Name: operation that needed a NetId
+	LoginStatus,				//A: local user, B: ELoginStatus
+	SessionCreateRequested,		//Name: session, A: public connections
+	SessionCreated,				//Name: session
+	SessionCreateFailed,		//Name: session
+	SessionSearchStarted,		//A: max results
+	SessionSearchCompleted,		//A: success, B: results
+	SessionFound,				//A: result index, B: match type matches
+	NoMatchingSession,			//A: results looked at
+	SessionJoinRequested,		//Name: session
+	SessionJoinFailed,			//A: EOnJoinSessionCompleteResult
+	ConnectStringResolved,		//Name: session
+	ConnectStringFailed,		//Name: session
+	ReservationBeaconFailed,
+	PlayerJoined,				//A: player id, B: players in game
+	PlayerLeft,					//A: player id, B: players in game
+	BackendTimeout,				//A: EMultiplayerBackendOp
+	BackendRetry,				//A: EMultiplayerBackendOp, B: retry number
+	CircuitOpened,				//A: EMultiplayerBackendOp that failed last, B: seconds open
+	CircuitClosed,				//A: EMultiplayerBackendOp that succeeded
+	CircuitRejected,			//A: EMultiplayerBackendOp
+
+	Count
+};
+
+#if MULTIPLAYER_TELEMETRY_ENABLED
+
+struct FMultiplayerTelemetryRecord
+{
+	uint64 Cycles = 0;
+	uint64 Frame = 0;
+	FName Name;
+	int64 A = 0;
+	int64 B = 0;
+	EMultiplayerTelemetryEvent Event = EMultiplayerTelemetryEvent::Count;
+};
+
+class MULTIPLAYERSESSIONS_API FMultiplayerTelemetry
+{
+public:
+	/** Safe from any thread. Overwrites the oldest event once the ring is full */
+	static void Record(EMultiplayerTelemetryEvent Event, FName Name = NAME_None, int64 A = 0, int64 B = 0);
+
+	/** Writes up to MaxRecords of the most recent events, oldest first */
+	static void Dump(FOutputDevice& Ar, int32 MaxRecords);
+
+	static FString Format(const FMultiplayerTelemetryRecord& Record);
+};
+
+#define MULTIPLAYER_TELEMETRY(Event, ...) FMultiplayerTelemetry::Record(EMultiplayerTelemetryEvent::Event, ##__VA_ARGS__)
+
+#else
+
+#define MULTIPLAYER_TELEMETRY(Event, ...) do {} while (0)
+
+#endif
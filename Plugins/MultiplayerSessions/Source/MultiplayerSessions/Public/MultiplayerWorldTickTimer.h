@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class UWorld;
+
+/**
+ * Game thread time of one world's ticks, from the start of its tick to the end of its net flush, so idling until
+ * the next server tick doesn't count. GGameThreadTime can't stand in for it on servers: it is only measured where
+ * a viewport draws and stays 0 on a dedicated server.
+ */
+class MULTIPLAYERSESSIONS_API FMultiplayerWorldTickTimer
+{
+public:
+	FMultiplayerWorldTickTimer() = default;
+	FMultiplayerWorldTickTimer(const FMultiplayerWorldTickTimer&) = delete;
+	FMultiplayerWorldTickTimer& operator=(const FMultiplayerWorldTickTimer&) = delete;
+	~FMultiplayerWorldTickTimer();
+
+	/** Times World's ticks from its next one on, instead of whatever it timed before */
+	void Start(UWorld* InWorld);
+	void Stop();
+
+	UWorld* GetWorld() const { return World.Get(); }
+
+	/** Of the last tick that finished, 0 before the first */
+	double GetLastTickMs() const { return LastTickMs; }
+	uint64 GetNumTicks() const { return NumTicks; }
+
+private:
+	TWeakObjectPtr<UWorld> World;
+	uint64 TickStartCycles{0};
+	double LastTickMs{0.0};
+	uint64 NumTicks{0};
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostTickFlushHandle;
+};
@@ -0,0 +1,634 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MockOnlineSession.h"
+#include "OnlineSubsystem.h"
+#include "OnlineSubsystemTypes.h"
+#include "HAL/PlatformTime.h"
+#include "MultiplayerSessionSchema.h"
+#include "MultiplayerServerLoad.h"
+#include "MultiplayerTelemetry.h"
+
+namespace MockOnlineSession
+{
+	static const FName SubsystemName(TEXT("MOCK"));
+
+	class FMockSessionInfo : public FOnlineSessionInfo
+	{
+	public:
+		explicit FMockSessionInfo(int32 InIndex)
+			: SessionId(FUniqueNetIdString::Create(FString::Printf(TEXT("Mock%d"), InIndex), SubsystemName))
+			, Index(InIndex)
+		{
+		}
+
+		virtual const uint8* GetBytes() const override { return reinterpret_cast<const uint8*>(&Index); }
+		virtual int32 GetSize() const override { return sizeof(Index); }
+		virtual bool IsValid() const override { return true; }
+		virtual FString ToString() const override { return SessionId->ToString(); }
+		virtual FString ToDebugString() const override { return FString::Printf(TEXT("MockSession %d"), Index); }
+		virtual const FUniqueNetId& GetSessionId() const override { return *SessionId; }
+
+	private:
+		FUniqueNetIdRef SessionId;
+		int32 Index;
+	};
+
+	/** Nothing listens there, a join that gets this far fails its travel */
+	static FString GetConnectString(const FOnlineSession& Session)
+	{
+		return FString::Printf(TEXT("%s.mock.invalid:7777"), Session.SessionInfo.IsValid() ? *Session.SessionInfo->ToString() : TEXT("unknown"));
+	}
+}
+
+FMockOnlineSession::FMockOnlineSession(const FMockOnlineSessionConfig& InConfig)
+	: Config(InConfig)
+	, Random(InConfig.Seed)
+{
+	BuildPopulation();
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FMockOnlineSession::Tick));
+}
+
+FMockOnlineSession::~FMockOnlineSession()
+{
+	FTSTicker::RemoveTicker(TickerHandle);
+}
+
+void FMockOnlineSession::BuildPopulation()
+{
+	using namespace MockOnlineSession;
+
+	const int32 NumSessions = FMath::Clamp(Config.NumSessions, 0, FMockOnlineSessionConfig::MaxSessions);
+	const int32 BuildUniqueId = Config.BuildUniqueId != 0 ? Config.BuildUniqueId : GetBuildUniqueId();
+
+	Population.SetNum(NumSessions);
+	for (int32 Index = 0; Index < NumSessions; ++Index)
+	{
+		FOnlineSession& Session = Population[Index];
+		Session.OwningUserId = FUniqueNetIdString::Create(FString::Printf(TEXT("MockHost%d"), Index), SubsystemName);
+		Session.SessionInfo = MakeShared<FMockSessionInfo>(Index);
+
+		FOnlineSessionSettings& Settings = Session.SessionSettings;
+		Settings.NumPublicConnections = Random.RandRange(2, 16);
+		Settings.bShouldAdvertise = true;
+		Settings.bUsesPresence = true;
+		Settings.bAllowJoinInProgress = true;
+		Settings.BuildUniqueId = BuildUniqueId;
+		Session.NumOpenPublicConnections = Random.RandRange(0, Settings.NumPublicConnections);
+
+		//Same attributes a real host of this plugin advertises
+		FMultiplayerSessionMode Mode;
+		Mode.MatchType = static_cast<EMultiplayerMatchType>(Random.RandHelper(static_cast<int32>(EMultiplayerMatchType::Invalid)));
+		Mode.Flags = EMultiplayerSessionFlags::JoinInProgress | (Random.FRand() < 0.5f ? EMultiplayerSessionFlags::DedicatedServer : EMultiplayerSessionFlags::None);
+		Mode.Write(Settings);
+		Settings.Set(MultiplayerSessionSchema::BuildIdKey, BuildUniqueId, EOnlineDataAdvertisementType::ViaOnlineService);
+		if (Config.Regions.Num() > 0)
+		{
+			Settings.Set(MultiplayerSessionSchema::RegionKey, Config.Regions[Random.RandHelper(Config.Regions.Num())], EOnlineDataAdvertisementType::ViaOnlineService);
+		}
+
+		FMultiplayerServerLoad Load;
+		Load.TickMs = Random.FRandRange(4.f, 40.f);
+		Load.HeadroomPercent = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(100.f * (1.f - Load.TickMs / 33.3f)), 0, 100));
+		Load.FreeSlots = static_cast<uint8>(Session.NumOpenPublicConnections);
+		Settings.Set(MultiplayerSessionSchema::LoadKey, Load.Pack(), EOnlineDataAdvertisementType::ViaOnlineService);
+	}
+}
+
+void FMockOnlineSession::Schedule(TFunction<void(bool)>&& Complete)
+{
+	if (Random.FRand() < Config.DropRate)
+	{
+		++Stats.NumDropped;
+		return;
+	}
+
+	FPendingCall& Call = PendingCalls.AddDefaulted_GetRef();
+	Call.bSucceeded = Random.FRand() >= Config.FailureRate;
+	Stats.NumFailed += Call.bSucceeded ? 0 : 1;
+
+	float LatencyMs = Config.LatencyMs + Random.FRandRange(0.f, Config.LatencyJitterMs);
+	if (Random.FRand() < Config.TailChance)
+	{
+		LatencyMs *= Config.TailMultiplier;
+	}
+	Call.DueTime = FPlatformTime::Seconds() + LatencyMs / 1000.0;
+	Call.Sequence = NextSequence++;
+	Call.Complete = MoveTemp(Complete);
+}
+
+bool FMockOnlineSession::Tick(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+
+	//Taken out first, a callback is free to make the next call
+	TArray<FPendingCall> DueCalls;
+	for (int32 Index = PendingCalls.Num() - 1; Index >= 0; --Index)
+	{
+		if (PendingCalls[Index].DueTime <= Now)
+		{
+			DueCalls.Add(MoveTemp(PendingCalls[Index]));
+			PendingCalls.RemoveAtSwap(Index);
+		}
+	}
+
+	if (Config.bReorderCallbacks)
+	{
+		for (int32 Index = DueCalls.Num() - 1; Index > 0; --Index)
+		{
+			DueCalls.Swap(Index, Random.RandRange(0, Index));
+		}
+	}
+	else
+	{
+		DueCalls.Sort([](const FPendingCall& A, const FPendingCall& B)
+		{
+			return A.DueTime < B.DueTime || (A.DueTime == B.DueTime && A.Sequence < B.Sequence);
+		});
+	}
+
+	for (FPendingCall& Call : DueCalls)
+	{
+		Call.Complete(Call.bSucceeded);
+	}
+	return true;
+}
+
+bool FMockOnlineSession::MatchesQuery(const FOnlineSession& Session, const FOnlineSearchSettings& QuerySettings) const
+{
+	//Keys a session doesn't advertise (presence and the like) don't filter, as on most backends
+	for (const TPair<FName, FOnlineSessionSearchParam>& Param : QuerySettings.SearchParams)
+	{
+		if (Param.Value.ComparisonOp != EOnlineComparisonOp::Equals)
+		{
+			continue;
+		}
+		const FOnlineSessionSetting* Setting = Session.SessionSettings.Settings.Find(Param.Key);
+		if (Setting && !(Setting->Data == Param.Value.Data))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FMockOnlineSession::FillSearchResults(FOnlineSessionSearch& Search)
+{
+	const int32 MaxResults = FMath::Max(0, Search.MaxSearchResults);
+	Search.SearchResults.Reset(FMath::Min(MaxResults, Population.Num()));
+	for (const FOnlineSession& Session : Population)
+	{
+		if (Search.SearchResults.Num() >= MaxResults)
+		{
+			break;
+		}
+		if (!MatchesQuery(Session, Search.QuerySettings))
+		{
+			continue;
+		}
+
+		FOnlineSessionSearchResult& Result = Search.SearchResults.AddDefaulted_GetRef();
+		Result.Session = Session;
+		Result.PingInMs = Random.RandRange(10, 250);
+	}
+}
+
+FUniqueNetIdPtr FMockOnlineSession::CreateSessionIdFromString(const FString& SessionIdStr)
+{
+	return FUniqueNetIdString::Create(SessionIdStr, MockOnlineSession::SubsystemName);
+}
+
+FNamedOnlineSession* FMockOnlineSession::GetNamedSession(FName SessionName)
+{
+	for (const TUniquePtr<FNamedOnlineSession>& Session : NamedSessions)
+	{
+		if (Session->SessionName == SessionName)
+		{
+			return Session.Get();
+		}
+	}
+	return nullptr;
+}
+
+void FMockOnlineSession::RemoveNamedSession(FName SessionName)
+{
+	NamedSessions.RemoveAll([SessionName](const TUniquePtr<FNamedOnlineSession>& Session)
+	{
+		return Session->SessionName == SessionName;
+	});
+}
+
+EOnlineSessionState::Type FMockOnlineSession::GetSessionState(FName SessionName) const
+{
+	for (const TUniquePtr<FNamedOnlineSession>& Session : NamedSessions)
+	{
+		if (Session->SessionName == SessionName)
+		{
+			return Session->SessionState;
+		}
+	}
+	return EOnlineSessionState::NoSession;
+}
+
+bool FMockOnlineSession::HasPresenceSession()
+{
+	return NamedSessions.ContainsByPredicate([](const TUniquePtr<FNamedOnlineSession>& Session)
+	{
+		return Session->SessionSettings.bUsesPresence;
+	});
+}
+
+FNamedOnlineSession* FMockOnlineSession::AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings)
+{
+	return NamedSessions.Add_GetRef(MakeUnique<FNamedOnlineSession>(SessionName, SessionSettings)).Get();
+}
+
+FNamedOnlineSession* FMockOnlineSession::AddNamedSession(FName SessionName, const FOnlineSession& Session)
+{
+	return NamedSessions.Add_GetRef(MakeUnique<FNamedOnlineSession>(SessionName, Session)).Get();
+}
+
+bool FMockOnlineSession::CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	//There is no identity behind the mock to turn a player index into an id
+	return false;
+}
+
+bool FMockOnlineSession::CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	if (GetNamedSession(SessionName) != nullptr)
+	{
+		return false;
+	}
+
+	FNamedOnlineSession* Session = AddNamedSession(SessionName, NewSessionSettings);
+	Session->bHosting = true;
+	Session->LocalOwnerId = HostingPlayerId.AsShared();
+	Session->OwningUserId = HostingPlayerId.AsShared();
+	Session->NumOpenPublicConnections = NewSessionSettings.NumPublicConnections;
+	Session->SessionInfo = MakeShared<MockOnlineSession::FMockSessionInfo>(INDEX_NONE);
+	Session->SessionState = EOnlineSessionState::Creating;
+
+	Schedule([this, SessionName, Session](bool bSucceeded)
+	{
+		//Destroyed, maybe created again, while this was out
+		if (GetNamedSession(SessionName) != Session)
+		{
+			return;
+		}
+		if (bSucceeded)
+		{
+			Session->SessionState = EOnlineSessionState::Pending;
+		}
+		else
+		{
+			RemoveNamedSession(SessionName);
+		}
+		TriggerOnCreateSessionCompleteDelegates(SessionName, bSucceeded);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::StartSession(FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	Session->SessionState = EOnlineSessionState::Starting;
+	Schedule([this, SessionName, Session](bool bSucceeded)
+	{
+		if (GetNamedSession(SessionName) != Session)
+		{
+			return;
+		}
+		Session->SessionState = bSucceeded ? EOnlineSessionState::InProgress : EOnlineSessionState::Pending;
+		TriggerOnStartSessionCompleteDelegates(SessionName, bSucceeded);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	Session->SessionSettings = UpdatedSessionSettings;
+	Schedule([this, SessionName](bool bSucceeded)
+	{
+		TriggerOnUpdateSessionCompleteDelegates(SessionName, bSucceeded);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::EndSession(FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	Session->SessionState = EOnlineSessionState::Ending;
+	Schedule([this, SessionName, Session](bool bSucceeded)
+	{
+		if (GetNamedSession(SessionName) != Session)
+		{
+			return;
+		}
+		Session->SessionState = EOnlineSessionState::Ended;
+		TriggerOnEndSessionCompleteDelegates(SessionName, bSucceeded);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::DestroySession(FName SessionName, const FOnDestroySessionCompleteDelegate& CompletionDelegate)
+{
+	if (GetNamedSession(SessionName) == nullptr)
+	{
+		return false;
+	}
+
+	//Gone right away so the name is free for the next create, only the callback waits
+	RemoveNamedSession(SessionName);
+	Schedule([this, SessionName, CompletionDelegate](bool bSucceeded)
+	{
+		CompletionDelegate.ExecuteIfBound(SessionName, bSucceeded);
+		TriggerOnDestroySessionCompleteDelegates(SessionName, bSucceeded);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::IsPlayerInSession(FName SessionName, const FUniqueNetId& UniqueId)
+{
+	const FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	return Session && Session->RegisteredPlayers.ContainsByPredicate([&UniqueId](const FUniqueNetIdRef& PlayerId)
+	{
+		return *PlayerId == UniqueId;
+	});
+}
+
+bool FMockOnlineSession::StartMatchmaking(const TArray<FUniqueNetIdRef>& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	return false;
+}
+
+bool FMockOnlineSession::CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName)
+{
+	return false;
+}
+
+bool FMockOnlineSession::CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	//One search at a time, like the real subsystems
+	if (CurrentSearch.IsValid())
+	{
+		return false;
+	}
+
+	CurrentSearch = SearchSettings;
+	SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+	SearchSettings->SearchResults.Reset();
+
+	Schedule([this, SearchSettings](bool bSucceeded)
+	{
+		//Cancelled, a timed out caller moved on already
+		if (CurrentSearch.Get() != &SearchSettings.Get())
+		{
+			return;
+		}
+		CurrentSearch.Reset();
+
+		if (bSucceeded)
+		{
+			const uint64 FillStartCycles = FPlatformTime::Cycles64();
+			FillSearchResults(SearchSettings.Get());
+			Stats.LastFillMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - FillStartCycles);
+		}
+		SearchSettings->SearchState = bSucceeded ? EOnlineAsyncTaskState::Done : EOnlineAsyncTaskState::Failed;
+		Stats.LastNumResults = SearchSettings->SearchResults.Num();
+
+		Stats.LastCallbackStartCycles = FPlatformTime::Cycles64();
+		TriggerOnFindSessionsCompleteDelegates(bSucceeded);
+		Stats.LastCallbackMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - Stats.LastCallbackStartCycles);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate)
+{
+	return false;
+}
+
+bool FMockOnlineSession::CancelFindSessions()
+{
+	if (!CurrentSearch.IsValid())
+	{
+		return false;
+	}
+
+	CurrentSearch->SearchState = EOnlineAsyncTaskState::Failed;
+	CurrentSearch.Reset();
+	Schedule([this](bool bSucceeded)
+	{
+		TriggerOnCancelFindSessionsCompleteDelegates(bSucceeded);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::PingSearchResults(const FOnlineSessionSearchResult& SearchResult)
+{
+	return false;
+}
+
+bool FMockOnlineSession::JoinSession(int32 LocalUserNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	return false;
+}
+
+bool FMockOnlineSession::JoinSession(const FUniqueNetId& LocalUserId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	if (GetNamedSession(SessionName) != nullptr)
+	{
+		return false;
+	}
+
+	FNamedOnlineSession* Session = AddNamedSession(SessionName, DesiredSession.Session);
+	Session->bHosting = false;
+	Session->LocalOwnerId = LocalUserId.AsShared();
+	Session->SessionState = EOnlineSessionState::Pending;
+
+	Schedule([this, SessionName, Session](bool bSucceeded)
+	{
+		if (GetNamedSession(SessionName) != Session)
+		{
+			return;
+		}
+		if (!bSucceeded)
+		{
+			RemoveNamedSession(SessionName);
+		}
+		TriggerOnJoinSessionCompleteDelegates(SessionName, bSucceeded ? EOnJoinSessionCompleteResult::Success : EOnJoinSessionCompleteResult::UnknownError);
+	});
+	return true;
+}
+
+bool FMockOnlineSession::FindFriendSession(int32 LocalUserNum, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& FriendList)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriend(const FUniqueNetId& LocalUserId, FName SessionName, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriends(int32 LocalUserNum, FName SessionName, const TArray<FUniqueNetIdRef>& Friends)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriends(const FUniqueNetId& LocalUserId, FName SessionName, const TArray<FUniqueNetIdRef>& Friends)
+{
+	return false;
+}
+
+bool FMockOnlineSession::GetResolvedConnectString(FName SessionName, FString& ConnectInfo, FName PortType)
+{
+	const FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr || PortType != NAME_GamePort)
+	{
+		return false;
+	}
+	ConnectInfo = MockOnlineSession::GetConnectString(*Session);
+	return true;
+}
+
+bool FMockOnlineSession::GetResolvedConnectString(const FOnlineSessionSearchResult& SearchResult, FName PortType, FString& ConnectInfo)
+{
+	//Mock hosts run no reservation beacon, so joins skip straight to the session join
+	if (!SearchResult.IsValid() || PortType != NAME_GamePort)
+	{
+		return false;
+	}
+	ConnectInfo = MockOnlineSession::GetConnectString(SearchResult.Session);
+	return true;
+}
+
+FOnlineSessionSettings* FMockOnlineSession::GetSessionSettings(FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	return Session ? &Session->SessionSettings : nullptr;
+}
+
+FString FMockOnlineSession::GetVoiceChatRoomName(FName SessionName)
+{
+	return FString();
+}
+
+bool FMockOnlineSession::RegisterPlayer(FName SessionName, const FUniqueNetId& PlayerId, bool bWasInvited)
+{
+	TArray<FUniqueNetIdRef> Players;
+	Players.Add(PlayerId.AsShared());
+	return RegisterPlayers(SessionName, Players, bWasInvited);
+}
+
+bool FMockOnlineSession::RegisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players, bool bWasInvited)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session)
+	{
+		for (const FUniqueNetIdRef& PlayerId : Players)
+		{
+			if (!IsPlayerInSession(SessionName, *PlayerId))
+			{
+				Session->RegisteredPlayers.Add(PlayerId);
+			}
+		}
+	}
+	TriggerOnRegisterPlayersCompleteDelegates(SessionName, Players, Session != nullptr);
+	return Session != nullptr;
+}
+
+bool FMockOnlineSession::UnregisterPlayer(FName SessionName, const FUniqueNetId& PlayerId)
+{
+	TArray<FUniqueNetIdRef> Players;
+	Players.Add(PlayerId.AsShared());
+	return UnregisterPlayers(SessionName, Players);
+}
+
+bool FMockOnlineSession::UnregisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session)
+	{
+		for (const FUniqueNetIdRef& PlayerId : Players)
+		{
+			Session->RegisteredPlayers.RemoveAll([&PlayerId](const FUniqueNetIdRef& Registered)
+			{
+				return *Registered == *PlayerId;
+			});
+		}
+	}
+	TriggerOnUnregisterPlayersCompleteDelegates(SessionName, Players, Session != nullptr);
+	return Session != nullptr;
+}
+
+void FMockOnlineSession::RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate)
+{
+	Delegate.ExecuteIfBound(PlayerId, EOnJoinSessionCompleteResult::Success);
+}
+
+void FMockOnlineSession::UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate)
+{
+	Delegate.ExecuteIfBound(PlayerId, true);
+}
+
+void FMockOnlineSession::RemovePlayerFromSession(int32 LocalUserNum, FName SessionName, const FUniqueNetId& TargetPlayerId)
+{
+}
+
+int32 FMockOnlineSession::GetNumSessions()
+{
+	return NamedSessions.Num();
+}
+
+void FMockOnlineSession::DumpSessionState()
+{
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("Mock backend: %d advertised, %d named, %d calls pending, %d dropped, %d failed"),
+		Population.Num(), NamedSessions.Num(), PendingCalls.Num(), Stats.NumDropped, Stats.NumFailed);
+	for (const TUniquePtr<FNamedOnlineSession>& Session : NamedSessions)
+	{
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("  %s: %s"), *Session->SessionName.ToString(), EOnlineSessionState::ToString(Session->SessionState));
+	}
+}
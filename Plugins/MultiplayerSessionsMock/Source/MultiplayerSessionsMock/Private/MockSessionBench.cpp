@@ -0,0 +1,215 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MockOnlineSession.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Parse.h"
+#include "Menu.h"
+#include "MultiplayerOnlineServices.h"
+#include "MultiplayerSessionSubsystem.h"
+#include "MultiplayerTelemetry.h"
+
+///
+///Runs the real UMultiplayerSessionSubsystem search path against FMockOnlineSession and reports what handling
+///the results cost on the game thread and in memory:
+///  MultiplayerSessions.Mock.Bench [Sessions=10000] [MaxResults=10000] [Runs=5] [Latency=50] [Jitter=50]
+///                                 [Fail=0] [Drop=0] [Reorder=0] [Regions=eu-west,us-east] [Seed=1]
+///Searches run one after another, the summary goes to LogMultiplayerSessions once the last one is back.
+///The MultiplayerSessions.Mock.Backend automation test drives the same mock and checks the circuit and interface swaps.
+///
+namespace MockSessionBench
+{
+	struct FRun
+	{
+		double WallMs{0.0};
+		double FillMs{0.0};
+		/** Subsystem handling of the last search callback, up to the moment the Menu would get the results */
+		double HandleMs{0.0};
+		/** The Menu's pick of a matching result */
+		double MatchMs{0.0};
+		int32 NumResults{0};
+		int64 ResultBytes{0};
+		int64 UsedPhysicalDelta{0};
+		bool bSucceeded{false};
+	};
+
+	class FBench : public TSharedFromThis<FBench>
+	{
+	public:
+		FBench(UMultiplayerSessionSubsystem* InSubsystem, const FMockOnlineSessionConfig& MockConfig, int32 InMaxResults, int32 InNumRuns)
+			: Subsystem(InSubsystem)
+			, MaxResults(InMaxResults)
+			, NumRuns(InNumRuns)
+		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			Mock = MakeShared<FMockOnlineSession, ESPMode::ThreadSafe>(MockConfig);
+			PopulationMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+		}
+
+		void Start()
+		{
+			FMultiplayerOnlineServices::Get().SetSessionInterfaceOverride(Mock);
+			FindCompleteHandle = Subsystem->MultiplayerOnFindSessionComplete.AddSP(this, &FBench::OnFindSessionComplete);
+			StartRun();
+		}
+
+	private:
+		void StartRun()
+		{
+			if (!Subsystem.IsValid())
+			{
+				Finish();
+				return;
+			}
+
+			RunStartCycles = FPlatformTime::Cycles64();
+			RunStartUsedPhysical = static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical);
+			Subsystem->FindSession(MaxResults);
+		}
+
+		void OnFindSessionComplete(const TArray<FOnlineSessionSearchResult>& Results, bool bWasSuccessful)
+		{
+			const uint64 EnterCycles = FPlatformTime::Cycles64();
+			FRun& Run = Runs.AddDefaulted_GetRef();
+			Run.bSucceeded = bWasSuccessful;
+			Run.NumResults = Results.Num();
+			Run.WallMs = FPlatformTime::ToMilliseconds64(EnterCycles - RunStartCycles);
+			Run.FillMs = Mock->GetStats().LastFillMs;
+			Run.HandleMs = Mock->GetStats().LastCallbackStartCycles > RunStartCycles ? FPlatformTime::ToMilliseconds64(EnterCycles - Mock->GetStats().LastCallbackStartCycles) : 0.0;
+			Run.UsedPhysicalDelta = static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - RunStartUsedPhysical;
+
+			const uint64 MatchStartCycles = FPlatformTime::Cycles64();
+			UMenu::FindMatchingResult(Results, EMultiplayerMatchType::Coop);
+			Run.MatchMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - MatchStartCycles);
+
+			Run.ResultBytes = Results.GetAllocatedSize();
+			for (const FOnlineSessionSearchResult& Result : Results)
+			{
+				Run.ResultBytes += Result.Session.SessionSettings.Settings.GetAllocatedSize();
+			}
+
+			//Still inside the subsystem's callback, the next search goes out from a clean stack
+			TSharedRef<FBench> Self = AsShared();
+			FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Self](float)
+			{
+				if (Self->Runs.Num() < Self->NumRuns)
+				{
+					Self->StartRun();
+				}
+				else
+				{
+					Self->Finish();
+				}
+				return false;
+			}));
+		}
+
+		void Finish();
+
+		static double GetMedian(TArray<double> Values)
+		{
+			if (Values.Num() == 0)
+			{
+				return 0.0;
+			}
+			Values.Sort();
+			return Values[Values.Num() / 2];
+		}
+
+		TWeakObjectPtr<UMultiplayerSessionSubsystem> Subsystem;
+		TSharedPtr<FMockOnlineSession, ESPMode::ThreadSafe> Mock;
+		FDelegateHandle FindCompleteHandle;
+		int32 MaxResults{0};
+		int32 NumRuns{0};
+		double PopulationMs{0.0};
+		uint64 RunStartCycles{0};
+		int64 RunStartUsedPhysical{0};
+		TArray<FRun> Runs;
+	};
+
+	static TSharedPtr<FBench> ActiveBench;
+
+	void FBench::Finish()
+	{
+		if (Subsystem.IsValid())
+		{
+			Subsystem->MultiplayerOnFindSessionComplete.Remove(FindCompleteHandle);
+		}
+		FMultiplayerOnlineServices::Get().SetSessionInterfaceOverride(nullptr);
+
+		const FMockOnlineSessionConfig& Config = Mock->GetConfig();
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("Mock search bench: %d sessions (built in %.1f ms), MaxResults=%d, %d runs, latency %.0f+%.0f ms, fail %.2f, drop %.2f, reorder %d"),
+			FMath::Min(Config.NumSessions, FMockOnlineSessionConfig::MaxSessions), PopulationMs, MaxResults, Runs.Num(),
+			Config.LatencyMs, Config.LatencyJitterMs, Config.FailureRate, Config.DropRate, Config.bReorderCallbacks ? 1 : 0);
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("%4s %3s %8s %10s %10s %10s %10s %12s %12s"),
+			TEXT("Run"), TEXT("Ok"), TEXT("Results"), TEXT("Wall ms"), TEXT("Fill ms"), TEXT("Handle ms"), TEXT("Match ms"), TEXT("Result KB"), TEXT("Used KB"));
+
+		TArray<double> HandleMs;
+		TArray<double> MatchMs;
+		for (int32 Index = 0; Index < Runs.Num(); ++Index)
+		{
+			const FRun& Run = Runs[Index];
+			UE_LOG(LogMultiplayerSessions, Display, TEXT("%4d %3d %8d %10.1f %10.2f %10.2f %10.3f %12lld %12lld"),
+				Index, Run.bSucceeded ? 1 : 0, Run.NumResults, Run.WallMs, Run.FillMs, Run.HandleMs, Run.MatchMs, Run.ResultBytes / 1024, Run.UsedPhysicalDelta / 1024);
+			HandleMs.Add(Run.HandleMs);
+			MatchMs.Add(Run.MatchMs);
+		}
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("Median handle %.2f ms, median match %.3f ms, %d calls dropped, %d failed"),
+			GetMedian(HandleMs), GetMedian(MatchMs), Mock->GetStats().NumDropped, Mock->GetStats().NumFailed);
+
+		//Runs from one of our own tickers, which keeps us alive until it returns
+		ActiveBench.Reset();
+	}
+
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (ActiveBench.IsValid())
+		{
+			Ar.Log(TEXT("A mock search bench is already running"));
+			return;
+		}
+
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		UMultiplayerSessionSubsystem* Subsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionSubsystem>() : nullptr;
+		if (Subsystem == nullptr)
+		{
+			Ar.Log(TEXT("No MultiplayerSessionSubsystem in this world"));
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		FMockOnlineSessionConfig Config;
+		Config.NumSessions = 10000;
+		int32 MaxResults = 10000;
+		int32 NumRuns = 5;
+		int32 bReorder = 0;
+		FString Regions;
+		FParse::Value(*Params, TEXT("Sessions="), Config.NumSessions);
+		FParse::Value(*Params, TEXT("MaxResults="), MaxResults);
+		FParse::Value(*Params, TEXT("Runs="), NumRuns);
+		FParse::Value(*Params, TEXT("Latency="), Config.LatencyMs);
+		FParse::Value(*Params, TEXT("Jitter="), Config.LatencyJitterMs);
+		FParse::Value(*Params, TEXT("Fail="), Config.FailureRate);
+		FParse::Value(*Params, TEXT("Drop="), Config.DropRate);
+		FParse::Value(*Params, TEXT("Reorder="), bReorder);
+		FParse::Value(*Params, TEXT("Seed="), Config.Seed);
+		if (FParse::Value(*Params, TEXT("Regions="), Regions, false))
+		{
+			Regions.ParseIntoArray(Config.Regions, TEXT(","));
+		}
+		Config.bReorderCallbacks = bReorder != 0;
+
+		Ar.Logf(TEXT("Building %d mock sessions, results are logged when %d searches are back"), Config.NumSessions, NumRuns);
+		ActiveBench = MakeShared<FBench>(Subsystem, Config, MaxResults, FMath::Max(1, NumRuns));
+		ActiveBench->Start();
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("MultiplayerSessions.Mock.Bench"),
+		TEXT("Times session search handling against a mock backend. Sessions= MaxResults= Runs= Latency= Jitter= Fail= Drop= Reorder= Regions= Seed="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
@@ -0,0 +1,233 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "MockOnlineSession.h"
+#include "MultiplayerOnlineServices.h"
+#include "MultiplayerSessionSubsystem.h"
+
+///
+///The session subsystem against FMockOnlineSession, what MultiplayerSessions.Mock.Bench runs, checked instead of timed:
+///  1. A backend failing every search opens the circuit.
+///  2. Swapping the interface closes it again, the failures were the old backend's.
+///  3. A healthy backend answers searches with results.
+///  4. A search the backend never answers is failed the moment the interface is swapped, not after its timeout,
+///     and the next search goes out right away.
+///Needs a game with a logged in local player, PIE or a -game client, the subsystem searches on that player's behalf.
+///
+namespace MockSessionBackendTest
+{
+	static constexpr double PhaseTimeoutSeconds = 60.0;
+	static constexpr int32 NumSessions = 200;
+
+	enum class EPhase : uint8
+	{
+		OpenCircuit,
+		Healthy,
+		Abandon,
+		Done
+	};
+
+	struct FBackendCheck : public TSharedFromThis<FBackendCheck>
+	{
+		TWeakObjectPtr<UMultiplayerSessionSubsystem> Subsystem;
+		FDelegateHandle FindCompleteHandle;
+		/** Done while no mock is installed */
+		EPhase Phase{EPhase::Done};
+		double PhaseStartTime{0.0};
+		bool bSearching{false};
+		int32 NumResults{0};
+		bool bSucceeded{false};
+
+		static UMultiplayerSessionSubsystem* FindSubsystem()
+		{
+			for (const FWorldContext& Context : GEngine->GetWorldContexts())
+			{
+				if (Context.World() && Context.World()->IsGameWorld() && Context.OwningGameInstance)
+				{
+					if (UMultiplayerSessionSubsystem* Found = Context.OwningGameInstance->GetSubsystem<UMultiplayerSessionSubsystem>())
+					{
+						return Found;
+					}
+				}
+			}
+			return nullptr;
+		}
+
+		bool Start(FAutomationTestBase& Test)
+		{
+			UMultiplayerSessionSubsystem* Found = FindSubsystem();
+			if (Found == nullptr || !Found->GetPlayerNetId().IsValid())
+			{
+				Test.AddError(TEXT("Needs a running game with a logged in local player, run it in PIE or on a -game client"));
+				return false;
+			}
+			Subsystem = Found;
+			FindCompleteHandle = Found->MultiplayerOnFindSessionComplete.AddSP(this, &FBackendCheck::OnFindSessionComplete);
+
+			FMockOnlineSessionConfig Failing;
+			Failing.NumSessions = NumSessions;
+			Failing.LatencyJitterMs = 0.f;
+			Failing.TailChance = 0.f;
+			Failing.FailureRate = 1.f;
+			StartPhase(EPhase::OpenCircuit, &Failing);
+			return true;
+		}
+
+		void StartPhase(EPhase NewPhase, const FMockOnlineSessionConfig* MockConfig)
+		{
+			Phase = NewPhase;
+			PhaseStartTime = FPlatformTime::Seconds();
+			FMultiplayerOnlineServices::Get().SetSessionInterfaceOverride(MockConfig ? MakeShared<FMockOnlineSession, ESPMode::ThreadSafe>(*MockConfig) : nullptr);
+		}
+
+		void Search()
+		{
+			bSearching = true;
+			NumResults = 0;
+			bSucceeded = false;
+			Subsystem->FindSession(NumSessions);
+		}
+
+		void OnFindSessionComplete(const TArray<FOnlineSessionSearchResult>& Results, bool bWasSuccessful)
+		{
+			bSearching = false;
+			NumResults = Results.Num();
+			bSucceeded = bWasSuccessful;
+		}
+
+		/** True once done */
+		bool Update(FAutomationTestBase& Test)
+		{
+			if (!Subsystem.IsValid())
+			{
+				Test.AddError(TEXT("The game went away"));
+				return true;
+			}
+			if (FPlatformTime::Seconds() - PhaseStartTime > PhaseTimeoutSeconds)
+			{
+				Test.AddError(FString::Printf(TEXT("Phase %d took over %.0f s"), static_cast<int32>(Phase), PhaseTimeoutSeconds));
+				return true;
+			}
+			if (bSearching)
+			{
+				return false;
+			}
+
+			switch (Phase)
+			{
+			case EPhase::OpenCircuit:
+				//Each search goes through its retries, a few of them are enough failures in a row
+				if (Subsystem->GetBackendCircuit().GetState() != FMultiplayerCircuitBreaker::EState::Open)
+				{
+					Test.TestFalse(TEXT("A failing backend's search succeeds"), bSucceeded && NumResults > 0);
+					Search();
+					return false;
+				}
+				{
+					FMockOnlineSessionConfig Healthy;
+					Healthy.NumSessions = NumSessions;
+					Healthy.TailChance = 0.f;
+					StartPhase(EPhase::Healthy, &Healthy);
+				}
+				Test.TestTrue(TEXT("The circuit closes when the interface is swapped"),
+					Subsystem->GetBackendCircuit().GetState() == FMultiplayerCircuitBreaker::EState::Closed);
+				Search();
+				return false;
+
+			case EPhase::Healthy:
+				Test.TestTrue(TEXT("A healthy backend's search succeeds"), bSucceeded);
+				Test.TestTrue(TEXT("A healthy backend's search finds sessions"), NumResults > 0);
+				{
+					FMockOnlineSessionConfig Silent;
+					Silent.NumSessions = NumSessions;
+					Silent.DropRate = 1.f;
+					StartPhase(EPhase::Abandon, &Silent);
+				}
+				Search();
+				{
+					//Swapped with the search still out on the silent one
+					FMockOnlineSessionConfig Healthy;
+					Healthy.NumSessions = NumSessions;
+					Healthy.TailChance = 0.f;
+					StartPhase(EPhase::Abandon, &Healthy);
+				}
+				Test.TestFalse(TEXT("A search left on the old interface is failed when it's swapped"), bSearching || bSucceeded);
+				//Would be refused as still in flight if the abandoned one weren't dropped
+				Search();
+				return false;
+
+			case EPhase::Abandon:
+				Test.TestTrue(TEXT("A search right after the swap succeeds"), bSucceeded && NumResults > 0);
+				StartPhase(EPhase::Done, nullptr);
+				return true;
+
+			default:
+				return true;
+			}
+		}
+
+		void Stop()
+		{
+			if (Subsystem.IsValid())
+			{
+				Subsystem->MultiplayerOnFindSessionComplete.Remove(FindCompleteHandle);
+			}
+			if (Phase != EPhase::Done)
+			{
+				Phase = EPhase::Done;
+				FMultiplayerOnlineServices::Get().SetSessionInterfaceOverride(nullptr);
+			}
+		}
+	};
+
+	class FUpdateBackendCheckCommand : public IAutomationLatentCommand
+	{
+	public:
+		FUpdateBackendCheckCommand(FAutomationTestBase& InTest, const TSharedRef<FBackendCheck>& InCheck)
+			: Test(InTest)
+			, Check(InCheck)
+		{
+		}
+
+		virtual bool Update() override
+		{
+			if (!Check->Update(Test))
+			{
+				return false;
+			}
+			Check->Stop();
+			return true;
+		}
+
+	private:
+		FAutomationTestBase& Test;
+		TSharedRef<FBackendCheck> Check;
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMockSessionBackendTest, "MultiplayerSessions.Mock.Backend",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+bool FMockSessionBackendTest::RunTest(const FString& Parameters)
+{
+	using namespace MockSessionBackendTest;
+
+	TSharedRef<FBackendCheck> Check = MakeShared<FBackendCheck>();
+	if (!Check->Start(*this))
+	{
+		Check->Stop();
+		return false;
+	}
+	ADD_LATENT_AUTOMATION_COMMAND(FUpdateBackendCheckCommand(*this, Check));
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
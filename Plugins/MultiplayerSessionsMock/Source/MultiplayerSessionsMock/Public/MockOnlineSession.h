@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "OnlineSessionSettings.h"
+#include "Containers/Ticker.h"
+#include "Math/RandomStream.h"
+
+/** Shape of the fake backend, see FMockOnlineSession */
+struct FMockOnlineSessionConfig
+{
+	/** Advertised sessions, capped at MaxSessions */
+	int32 NumSessions{1000};
+	static constexpr int32 MaxSessions = 100000;
+
+	/** Advertised sessions are spread over these, an empty list leaves them without a region */
+	TArray<FString> Regions;
+
+	/** Build id the sessions advertise, 0 uses this build's so nothing gets filtered out */
+	int32 BuildUniqueId{0};
+
+	///
+	///Time until a call calls back: LatencyMs plus up to LatencyJitterMs, and TailChance of calls take TailMultiplier times that
+	///
+	float LatencyMs{50.f};
+	float LatencyJitterMs{50.f};
+	float TailChance{0.01f};
+	float TailMultiplier{20.f};
+
+	/** Chance a call calls back with a failure */
+	float FailureRate{0.f};
+
+	/** Chance a call never calls back at all */
+	float DropRate{0.f};
+
+	/** Calls that come due in the same tick call back in random order instead of the order they were made */
+	bool bReorderCallbacks{false};
+
+	int32 Seed{1};
+};
+
+/** What the last FindSessions cost on the backend side and in the callbacks, so the two can be told apart */
+struct FMockOnlineSessionStats
+{
+	int32 LastNumResults{0};
+	double LastFillMs{0.0};
+	/** When the last FindSessions callback started, listeners can time the handlers ahead of them from it */
+	uint64 LastCallbackStartCycles{0};
+	double LastCallbackMs{0.0};
+	int32 NumDropped{0};
+	int32 NumFailed{0};
+};
+
+/**
+ * In-process IOnlineSession standing in for a real backend, installed with
+ * FMultiplayerOnlineServices::SetSessionInterfaceOverride. Holds a generated population of advertised sessions
+ * (up to 100k) and answers searches from it, filtered on the query's Equals settings like a backend would.
+ * Every call calls back later from the core ticker with the configured latency, failures and drops.
+ * Only what the MultiplayerSessions plugin uses does anything, the rest reports failure. Game thread only.
+ */
+class MULTIPLAYERSESSIONSMOCK_API FMockOnlineSession : public IOnlineSession
+{
+public:
+	explicit FMockOnlineSession(const FMockOnlineSessionConfig& InConfig);
+	virtual ~FMockOnlineSession();
+
+	const FMockOnlineSessionConfig& GetConfig() const { return Config; }
+	const FMockOnlineSessionStats& GetStats() const { return Stats; }
+	int32 GetNumPendingCalls() const { return PendingCalls.Num(); }
+
+	//~ Begin IOnlineSession Interface
+	virtual FUniqueNetIdPtr CreateSessionIdFromString(const FString& SessionIdStr) override;
+	virtual FNamedOnlineSession* GetNamedSession(FName SessionName) override;
+	virtual void RemoveNamedSession(FName SessionName) override;
+	virtual EOnlineSessionState::Type GetSessionState(FName SessionName) const override;
+	virtual bool HasPresenceSession() override;
+	virtual bool CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings) override;
+	virtual bool CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings) override;
+	virtual bool StartSession(FName SessionName) override;
+	virtual bool UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData = true) override;
+	virtual bool EndSession(FName SessionName) override;
+	virtual bool DestroySession(FName SessionName, const FOnDestroySessionCompleteDelegate& CompletionDelegate = FOnDestroySessionCompleteDelegate()) override;
+	virtual bool IsPlayerInSession(FName SessionName, const FUniqueNetId& UniqueId) override;
+	virtual bool StartMatchmaking(const TArray<FUniqueNetIdRef>& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName) override;
+	virtual bool CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName) override;
+	virtual bool FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate) override;
+	virtual bool CancelFindSessions() override;
+	virtual bool PingSearchResults(const FOnlineSessionSearchResult& SearchResult) override;
+	virtual bool JoinSession(int32 LocalUserNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession) override;
+	virtual bool JoinSession(const FUniqueNetId& LocalUserId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession) override;
+	virtual bool FindFriendSession(int32 LocalUserNum, const FUniqueNetId& Friend) override;
+	virtual bool FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend) override;
+	virtual bool FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& FriendList) override;
+	virtual bool SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend) override;
+	virtual bool SendSessionInviteToFriend(const FUniqueNetId& LocalUserId, FName SessionName, const FUniqueNetId& Friend) override;
+	virtual bool SendSessionInviteToFriends(int32 LocalUserNum, FName SessionName, const TArray<FUniqueNetIdRef>& Friends) override;
+	virtual bool SendSessionInviteToFriends(const FUniqueNetId& LocalUserId, FName SessionName, const TArray<FUniqueNetIdRef>& Friends) override;
+	virtual bool GetResolvedConnectString(FName SessionName, FString& ConnectInfo, FName PortType = NAME_GamePort) override;
+	virtual bool GetResolvedConnectString(const FOnlineSessionSearchResult& SearchResult, FName PortType, FString& ConnectInfo) override;
+	virtual FOnlineSessionSettings* GetSessionSettings(FName SessionName) override;
+	virtual FString GetVoiceChatRoomName(FName SessionName) override;
+	virtual bool RegisterPlayer(FName SessionName, const FUniqueNetId& PlayerId, bool bWasInvited) override;
+	virtual bool RegisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players, bool bWasInvited = false) override;
+	virtual bool UnregisterPlayer(FName SessionName, const FUniqueNetId& PlayerId) override;
+	virtual bool UnregisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players) override;
+	virtual void RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate) override;
+	virtual void UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate) override;
+	virtual void RemovePlayerFromSession(int32 LocalUserNum, FName SessionName, const FUniqueNetId& TargetPlayerId) override;
+	virtual int32 GetNumSessions() override;
+	virtual void DumpSessionState() override;
+	//~ End IOnlineSession Interface
+
+protected:
+	virtual FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings) override;
+	virtual FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSession& Session) override;
+
+private:
+	struct FPendingCall
+	{
+		double DueTime{0.0};
+		uint64 Sequence{0};
+		bool bSucceeded{true};
+		TFunction<void(bool)> Complete;
+	};
+
+	void BuildPopulation();
+
+	/** Calls Complete later, or never, as the config says */
+	void Schedule(TFunction<void(bool)>&& Complete);
+	bool Tick(float DeltaTime);
+
+	bool MatchesQuery(const FOnlineSession& Session, const FOnlineSearchSettings& QuerySettings) const;
+	void FillSearchResults(FOnlineSessionSearch& Search);
+
+	FMockOnlineSessionConfig Config;
+	FMockOnlineSessionStats Stats;
+	FRandomStream Random;
+
+	TArray<FOnlineSession> Population;
+	TArray<TUniquePtr<FNamedOnlineSession>> NamedSessions;
+	TSharedPtr<FOnlineSessionSearch> CurrentSearch;
+
+	TArray<FPendingCall> PendingCalls;
+	uint64 NextSequence{0};
+	FTSTicker::FDelegateHandle TickerHandle;
+};
@@ -0,0 +1,277 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActorPoolSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Parse.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectGlobals.h"
+#include "MultiplayerWorldTickTimer.h"
+#include "MPTesting_CPlusPlus.h"
+
+///
+///Sustained full-auto spawning of a cosmetic class, first spawned and destroyed every time (ActorPool.Enabled 0),
+///then through the pool:
+///  ActorPool.Bench [Class=/Script/Engine.StaticMeshActor] [Shooters=100] [Rate=15] [Seconds=5] [Lifetime=2]
+///Rate is spawns per second per shooter (900 rpm is 15), each spawn lives Lifetime seconds. Between the two runs
+///nothing spawns until the first run's objects are gone. The pool's cap is raised for the run so every spawn stays
+///alive its whole lifetime in both; a pooled run that still had to steal, or kept a different number of objects
+///alive, measured another workload and is reported as invalid. The summary goes to LogCombat at the end.
+///
+namespace ActorPoolBench
+{
+	/** Live objects of the two runs may differ by this much, spawns land on frames and expire on frames */
+	static constexpr float LiveTolerance = 0.05f;
+
+	struct FPhase
+	{
+		const TCHAR* Name{TEXT("")};
+		bool bPooled{false};
+		int32 NumFrames{0};
+		int32 NumSpawns{0};
+		int32 NumCreated{0};
+		int32 NumStolen{0};
+		int32 PeakLive{0};
+		int32 NumGarbageCollections{0};
+		double GarbageCollectMs{0.0};
+		int32 ObjectsDelta{0};
+		double SpawnMs{0.0};
+		double MaxSpawnMs{0.0};
+		double GameThreadMs{0.0};
+		double MaxGameThreadMs{0.0};
+	};
+
+	class FBench : public TSharedFromThis<FBench>
+	{
+	public:
+		FBench(UWorld* InWorld, UClass* InClass, int32 InNumShooters, float InRate, float InSeconds, float InLifetime)
+			: World(InWorld)
+			, Class(InClass)
+			, SpawnsPerSecond(InNumShooters * InRate)
+			, Seconds(InSeconds)
+			, Lifetime(InLifetime)
+		{
+			Phases.Add({TEXT("Spawn/Destroy"), false});
+			Phases.Add({TEXT("Pooled"), true});
+		}
+
+		void Start()
+		{
+			bWasEnabled = IConsoleManager::Get().FindConsoleVariable(TEXT("ActorPool.Enabled"))->GetBool();
+			WorldTickTimer.Start(World.Get());
+			PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddSP(this, &FBench::OnPreGarbageCollect);
+			GarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddSP(this, &FBench::OnPostGarbageCollect);
+			StartPhase();
+			TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FBench::Tick));
+		}
+
+	private:
+		void StartPhase()
+		{
+			FPhase& Phase = Phases[PhaseIndex];
+			IConsoleManager::Get().FindConsoleVariable(TEXT("ActorPool.Enabled"))->Set(Phase.bPooled ? 1 : 0, ECVF_SetByConsole);
+			UActorPoolSubsystem* Pool = World->GetSubsystem<UActorPoolSubsystem>();
+			if (Phase.bPooled)
+			{
+				//What a configured pool would have made at begin play, with a cap that never makes it steal
+				const int32 NumLive = FMath::CeilToInt(SpawnsPerSecond * Lifetime);
+				const FActorPool* ClassPool = Pool->FindPool(Class);
+				MaxCountBefore = ClassPool ? ClassPool->MaxCount : INDEX_NONE;
+				Pool->SetMaxCount(Class, FMath::CeilToInt(NumLive * (1.f + LiveTolerance)) + FMath::CeilToInt(SpawnsPerSecond * 0.1f));
+				Pool->Prewarm(Class, NumLive);
+			}
+			const FActorPool* ClassPool = Pool->FindPool(Class);
+			CreatedAtStart = ClassPool ? ClassPool->NumCreated : 0;
+			StolenAtStart = ClassPool ? ClassPool->NumStolen : 0;
+			ObjectsAtStart = GUObjectArray.GetObjectArrayNumMinusAvailable();
+			PhaseTime = 0.0;
+			SpawnDebt = 0.0;
+		}
+
+		void OnPreGarbageCollect()
+		{
+			GarbageCollectStartCycles = FPlatformTime::Cycles64();
+		}
+
+		void OnPostGarbageCollect()
+		{
+			if (PhaseIndex < Phases.Num() && PhaseTime < Seconds)
+			{
+				++Phases[PhaseIndex].NumGarbageCollections;
+				if (GarbageCollectStartCycles != 0)
+				{
+					Phases[PhaseIndex].GarbageCollectMs += FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - GarbageCollectStartCycles);
+				}
+			}
+			GarbageCollectStartCycles = 0;
+		}
+
+		bool Tick(float DeltaTime)
+		{
+			UActorPoolSubsystem* Pool = World.IsValid() ? World->GetSubsystem<UActorPoolSubsystem>() : nullptr;
+			if (Pool == nullptr)
+			{
+				Finish();
+				return false;
+			}
+
+			FPhase& Phase = Phases[PhaseIndex];
+			PhaseTime += DeltaTime;
+			if (PhaseTime < Seconds)
+			{
+				//Last frame's world tick, including whatever destroying the spawns cost; collecting them runs after the
+				//world tick and is timed on its own
+				const double GameThreadMs = WorldTickTimer.GetLastTickMs();
+				Phase.GameThreadMs += GameThreadMs;
+				Phase.MaxGameThreadMs = FMath::Max(Phase.MaxGameThreadMs, GameThreadMs);
+				++Phase.NumFrames;
+
+				SpawnDebt += SpawnsPerSecond * DeltaTime;
+				const int32 NumSpawns = FMath::FloorToInt(SpawnDebt);
+				SpawnDebt -= NumSpawns;
+
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				for (int32 Spawn = 0; Spawn < NumSpawns; ++Spawn)
+				{
+					const FVector Location(FMath::FRandRange(-2000.f, 2000.f), FMath::FRandRange(-2000.f, 2000.f), 100.f);
+					Pool->AcquireActor(Class, FTransform(Location), Lifetime);
+				}
+				const double SpawnMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+				Phase.SpawnMs += SpawnMs;
+				Phase.MaxSpawnMs = FMath::Max(Phase.MaxSpawnMs, SpawnMs);
+				Phase.NumSpawns += NumSpawns;
+				if (const FActorPool* ClassPool = Pool->FindPool(Class))
+				{
+					Phase.PeakLive = FMath::Max(Phase.PeakLive, ClassPool->Active.Num());
+				}
+				return true;
+			}
+
+			//Let the last spawns of the phase expire before measuring the next one
+			if (PhaseTime < Seconds + Lifetime + 0.5f)
+			{
+				return true;
+			}
+
+			const FActorPool* ClassPool = Pool->FindPool(Class);
+			Phase.NumCreated = (ClassPool ? ClassPool->NumCreated : 0) - CreatedAtStart;
+			Phase.NumStolen = (ClassPool ? ClassPool->NumStolen : 0) - StolenAtStart;
+			Phase.ObjectsDelta = GUObjectArray.GetObjectArrayNumMinusAvailable() - ObjectsAtStart;
+			if (++PhaseIndex >= Phases.Num())
+			{
+				Finish();
+				return false;
+			}
+			StartPhase();
+			return true;
+		}
+
+		void Finish();
+
+		TWeakObjectPtr<UWorld> World;
+		UClass* Class{nullptr};
+		float SpawnsPerSecond{0.f};
+		float Seconds{0.f};
+		float Lifetime{0.f};
+		bool bWasEnabled{true};
+		TArray<FPhase> Phases;
+		int32 PhaseIndex{0};
+		double PhaseTime{0.0};
+		double SpawnDebt{0.0};
+		int32 CreatedAtStart{0};
+		int32 StolenAtStart{0};
+		int32 MaxCountBefore{INDEX_NONE};
+		int32 ObjectsAtStart{0};
+		FMultiplayerWorldTickTimer WorldTickTimer;
+		uint64 GarbageCollectStartCycles{0};
+		FDelegateHandle PreGarbageCollectHandle;
+		FDelegateHandle GarbageCollectHandle;
+		FTSTicker::FDelegateHandle TickerHandle;
+	};
+
+	static TSharedPtr<FBench> ActiveBench;
+
+	void FBench::Finish()
+	{
+		WorldTickTimer.Stop();
+		FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+		FCoreUObjectDelegates::GetPostGarbageCollect().Remove(GarbageCollectHandle);
+		IConsoleManager::Get().FindConsoleVariable(TEXT("ActorPool.Enabled"))->Set(bWasEnabled ? 1 : 0, ECVF_SetByConsole);
+		UActorPoolSubsystem* Pool = World.IsValid() ? World->GetSubsystem<UActorPoolSubsystem>() : nullptr;
+		if (Pool && MaxCountBefore != INDEX_NONE)
+		{
+			Pool->SetMaxCount(Class, MaxCountBefore);
+		}
+
+		UE_LOG(LogCombat, Display, TEXT("Actor pool bench: %s, %.0f spawns/s for %.0f s, %.1f s lifetime"), *GetNameSafe(Class), SpawnsPerSecond, Seconds, Lifetime);
+		UE_LOG(LogCombat, Display, TEXT("%14s %8s %8s %8s %8s %10s %10s %10s %10s %4s %10s %10s"),
+			TEXT("Mode"), TEXT("Spawns"), TEXT("Created"), TEXT("Stolen"), TEXT("Live"), TEXT("Spawn ms"), TEXT("Max ms"), TEXT("GT ms"), TEXT("Max GT"), TEXT("GCs"), TEXT("GC ms"), TEXT("Objects"));
+		for (const FPhase& Phase : Phases)
+		{
+			const int32 Frames = FMath::Max(Phase.NumFrames, 1);
+			UE_LOG(LogCombat, Display, TEXT("%14s %8d %8d %8d %8d %10.3f %10.3f %10.2f %10.2f %4d %10.2f %10d"),
+				Phase.Name, Phase.NumSpawns, Phase.NumCreated, Phase.NumStolen, Phase.PeakLive, Phase.SpawnMs / Frames, Phase.MaxSpawnMs,
+				Phase.GameThreadMs / Frames, Phase.MaxGameThreadMs, Phase.NumGarbageCollections, Phase.GarbageCollectMs, Phase.ObjectsDelta);
+		}
+
+		//Only the same workload both ways is a comparison
+		const FPhase& Unpooled = Phases[0];
+		const FPhase& Pooled = Phases[1];
+		const int32 LiveDifference = FMath::Abs(Pooled.PeakLive - Unpooled.PeakLive);
+		if (Pooled.NumStolen > 0 || LiveDifference > FMath::CeilToInt(Unpooled.PeakLive * LiveTolerance))
+		{
+			UE_LOG(LogCombat, Error, TEXT("Actor pool bench INVALID: the pooled run stole %d and kept %d alive against %d, it measured a different workload"),
+				Pooled.NumStolen, Pooled.PeakLive, Unpooled.PeakLive);
+		}
+
+		//Runs from our own ticker, which keeps us alive until it returns
+		ActiveBench.Reset();
+	}
+
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (ActiveBench.IsValid())
+		{
+			Ar.Log(TEXT("An actor pool bench is already running"));
+			return;
+		}
+
+		if (World == nullptr || World->GetSubsystem<UActorPoolSubsystem>() == nullptr)
+		{
+			Ar.Log(TEXT("No actor pool in this world"));
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		FString ClassPath;
+		int32 NumShooters = 100;
+		float Rate = 15.f;
+		float Seconds = 5.f;
+		float Lifetime = 2.f;
+		FParse::Value(*Params, TEXT("Class="), ClassPath);
+		FParse::Value(*Params, TEXT("Shooters="), NumShooters);
+		FParse::Value(*Params, TEXT("Rate="), Rate);
+		FParse::Value(*Params, TEXT("Seconds="), Seconds);
+		FParse::Value(*Params, TEXT("Lifetime="), Lifetime);
+
+		UClass* Class = ClassPath.IsEmpty() ? AStaticMeshActor::StaticClass() : LoadClass<AActor>(nullptr, *ClassPath);
+		if (Class == nullptr)
+		{
+			Ar.Logf(TEXT("No actor class %s"), *ClassPath);
+			return;
+		}
+
+		Ar.Logf(TEXT("Spawning %s at %.0f/s with and without pooling, results are logged when done"), *Class->GetName(), NumShooters * Rate);
+		ActiveBench = MakeShared<FBench>(World, Class, FMath::Max(NumShooters, 1), FMath::Max(Rate, 0.1f), FMath::Max(Seconds, 1.f), FMath::Max(Lifetime, 0.1f));
+		ActiveBench->Start();
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("ActorPool.Bench"),
+		TEXT("Times sustained spawning of a cosmetic actor with and without the pool. Class= Shooters= Rate= Seconds= Lifetime="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
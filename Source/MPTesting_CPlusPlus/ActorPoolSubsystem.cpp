@@ -0,0 +1,376 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ActorPoolSubsystem.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Components/SceneComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundBase.h"
+#include "MPTesting_CPlusPlus.h"
+
+DECLARE_CYCLE_STAT(TEXT("Actor Pool Acquire"), STAT_ActorPoolAcquire, STATGROUP_Combat);
+DECLARE_CYCLE_STAT(TEXT("Actor Pool Tick"), STAT_ActorPoolTick, STATGROUP_Combat);
+
+namespace ActorPool
+{
+	static bool bEnabled = true;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("ActorPool.Enabled"),
+		bEnabled,
+		TEXT("Recycle pooled actors and components. 0 spawns and destroys them every time, to compare against."));
+}
+
+bool UActorPoolSubsystem::IsPoolingEnabled()
+{
+	return ActorPool::bEnabled;
+}
+
+bool UActorPoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UActorPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	for (const FActorPoolSettings& Settings : PoolSettings)
+	{
+		if (UClass* Class = Settings.Class.LoadSynchronous())
+		{
+			Prewarm(Class, Settings.PrewarmCount);
+		}
+		else
+		{
+			UE_LOG(LogCombat, Warning, TEXT("Actor pool class %s not found"), *Settings.Class.ToString());
+		}
+	}
+}
+
+void UActorPoolSubsystem::Deinitialize()
+{
+	//Everything pooled belongs to the world going away with us
+	Pools.Empty();
+	ComponentHost = nullptr;
+
+	Super::Deinitialize();
+}
+
+TStatId UActorPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UActorPoolSubsystem, STATGROUP_Tickables);
+}
+
+FActorPool& UActorPoolSubsystem::GetPool(UClass* Class)
+{
+	if (FActorPool* Pool = Pools.Find(Class))
+	{
+		return *Pool;
+	}
+
+	FActorPool& Pool = Pools.Add(Class);
+	Pool.MaxCount = DefaultMaxCount;
+	Pool.Lifetime = DefaultLifetime;
+	const FSoftObjectPath ClassPath(Class);
+	if (const FActorPoolSettings* Settings = PoolSettings.FindByPredicate([&ClassPath](const FActorPoolSettings& Entry) { return Entry.Class.ToSoftObjectPath() == ClassPath; }))
+	{
+		Pool.MaxCount = Settings->MaxCount;
+		Pool.Lifetime = Settings->Lifetime;
+	}
+
+	if (Class->IsChildOf<AActor>() && Class->GetDefaultObject<AActor>()->GetIsReplicated())
+	{
+		UE_LOG(LogCombat, Warning, TEXT("%s replicates, pooling it on the server will not recycle the client copies"), *Class->GetName());
+	}
+	return Pool;
+}
+
+void UActorPoolSubsystem::Prewarm(UClass* Class, int32 Count)
+{
+	if (Class == nullptr || (!Class->IsChildOf<AActor>() && !Class->IsChildOf<USceneComponent>()))
+	{
+		UE_LOG(LogCombat, Warning, TEXT("Only actors and scene components can be pooled, not %s"), *GetNameSafe(Class));
+		return;
+	}
+
+	FActorPool& Pool = GetPool(Class);
+	const int32 Target = FMath::Min(Count, Pool.MaxCount);
+	while (Pool.Free.Num() + Pool.Active.Num() < Target)
+	{
+		UObject* Object = CreatePooledObject(Class, /*bParked*/ true);
+		if (Object == nullptr)
+		{
+			break;
+		}
+		Pool.Free.Add(Object);
+		++Pool.NumCreated;
+	}
+}
+
+void UActorPoolSubsystem::SetMaxCount(UClass* Class, int32 MaxCount)
+{
+	if (Class)
+	{
+		GetPool(Class).MaxCount = FMath::Max(MaxCount, 1);
+	}
+}
+
+AActor* UActorPoolSubsystem::AcquireActor(TSubclassOf<AActor> Class, const FTransform& Transform, float Lifetime)
+{
+	return Class ? Cast<AActor>(Acquire(Class, Transform, Lifetime)) : nullptr;
+}
+
+USceneComponent* UActorPoolSubsystem::AcquireComponent(TSubclassOf<USceneComponent> Class, const FTransform& Transform, float Lifetime)
+{
+	return Class ? Cast<USceneComponent>(Acquire(Class, Transform, Lifetime)) : nullptr;
+}
+
+UObject* UActorPoolSubsystem::Acquire(UClass* Class, const FTransform& Transform, float Lifetime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ActorPoolAcquire);
+
+	FActorPool& Pool = GetPool(Class);
+	UObject* Object = nullptr;
+	if (IsPoolingEnabled())
+	{
+		while (Object == nullptr && Pool.Free.Num() > 0)
+		{
+			//Something else may have destroyed it while it was parked
+			UObject* Candidate = Pool.Free.Pop(EAllowShrinking::No);
+			Object = IsValid(Candidate) ? Candidate : nullptr;
+		}
+		if (Object)
+		{
+			++Pool.NumReused;
+		}
+		else if (Pool.Active.Num() >= Pool.MaxCount && IsValid(Pool.Active[0].Object))
+		{
+			//At the cap: the one out the longest is the one least likely to be missed
+			Object = Pool.Active[0].Object;
+			Pool.Active.RemoveAt(0);
+			if (Object->Implements<UPooledObject>())
+			{
+				IPooledObject::Execute_OnReturnedToPool(Object);
+			}
+			++Pool.NumStolen;
+		}
+	}
+
+	if (Object == nullptr)
+	{
+		Object = CreatePooledObject(Class, /*bParked*/ false);
+		if (Object == nullptr)
+		{
+			return nullptr;
+		}
+		++Pool.NumCreated;
+	}
+
+	Unpark(Object, Transform);
+
+	const float UsedLifetime = Lifetime >= 0.f ? Lifetime : Pool.Lifetime;
+	FActorPoolEntry& Entry = Pool.Active.AddDefaulted_GetRef();
+	Entry.Object = Object;
+	Entry.ExpireTime = UsedLifetime > 0.f ? GetWorld()->GetTimeSeconds() + UsedLifetime : 0.0;
+	return Object;
+}
+
+void UActorPoolSubsystem::Release(UObject* Object)
+{
+	if (!IsValid(Object))
+	{
+		return;
+	}
+
+	FActorPool* Pool = Pools.Find(Object->GetClass());
+	const int32 Index = Pool ? Pool->Active.IndexOfByPredicate([Object](const FActorPoolEntry& Entry) { return Entry.Object == Object; }) : INDEX_NONE;
+	if (Index == INDEX_NONE)
+	{
+		//Released twice is fine, anything never pooled just goes
+		if (Pool == nullptr || !Pool->Free.Contains(Object))
+		{
+			DestroyPooledObject(Object);
+		}
+		return;
+	}
+
+	Pool->Active.RemoveAt(Index);
+	if (IsPoolingEnabled())
+	{
+		Park(Object);
+		Pool->Free.Add(Object);
+	}
+	else
+	{
+		DestroyPooledObject(Object);
+	}
+}
+
+void UActorPoolSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_ActorPoolTick);
+
+	FrameSoundLocations.Reset();
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (TPair<TObjectPtr<UClass>, FActorPool>& Pair : Pools)
+	{
+		FActorPool& Pool = Pair.Value;
+		for (int32 Index = 0; Index < Pool.Active.Num();)
+		{
+			UObject* Object = Pool.Active[Index].Object;
+			const double ExpireTime = Pool.Active[Index].ExpireTime;
+			if (!IsValid(Object))
+			{
+				Pool.Active.RemoveAt(Index);
+			}
+			else if (ExpireTime > 0.0 && ExpireTime <= Now)
+			{
+				Release(Object);
+			}
+			else
+			{
+				++Index;
+			}
+		}
+	}
+}
+
+UObject* UActorPoolSubsystem::CreatePooledObject(UClass* Class, bool bParked)
+{
+	UWorld* World = GetWorld();
+	UObject* Object = nullptr;
+	if (Class->IsChildOf<AActor>())
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		AActor* Actor = World->SpawnActor<AActor>(Class, FTransform::Identity, SpawnParameters);
+		if (Actor && Actor->GetRootComponent())
+		{
+			//Everything pooled gets moved around, static mesh actors start out Static
+			Actor->GetRootComponent()->SetMobility(EComponentMobility::Movable);
+		}
+		Object = Actor;
+	}
+	else if (Class->IsChildOf<USceneComponent>())
+	{
+		if (ComponentHost == nullptr)
+		{
+			FActorSpawnParameters SpawnParameters;
+			SpawnParameters.ObjectFlags |= RF_Transient;
+			ComponentHost = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+		}
+
+		USceneComponent* Component = NewObject<USceneComponent>(ComponentHost, Class, NAME_None, RF_Transient);
+		Component->SetUsingAbsoluteLocation(true);
+		Component->SetUsingAbsoluteRotation(true);
+		Component->SetUsingAbsoluteScale(true);
+		Component->RegisterComponent();
+		Object = Component;
+	}
+
+	if (Object && bParked)
+	{
+		Park(Object);
+	}
+	return Object;
+}
+
+void UActorPoolSubsystem::Park(UObject* Object)
+{
+	if (Object->Implements<UPooledObject>())
+	{
+		IPooledObject::Execute_OnReturnedToPool(Object);
+	}
+
+	if (AActor* Actor = Cast<AActor>(Object))
+	{
+		Actor->SetActorHiddenInGame(true);
+		Actor->SetActorEnableCollision(false);
+		Actor->SetActorTickEnabled(false);
+	}
+	else if (USceneComponent* Component = Cast<USceneComponent>(Object))
+	{
+		Component->Deactivate();
+		Component->SetVisibility(false);
+		Component->SetComponentTickEnabled(false);
+		if (UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component))
+		{
+			Primitive->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		}
+	}
+}
+
+void UActorPoolSubsystem::Unpark(UObject* Object, const FTransform& Transform)
+{
+	//Back to what the class starts with, whatever the last use left behind
+	if (AActor* Actor = Cast<AActor>(Object))
+	{
+		const AActor* Defaults = Actor->GetClass()->GetDefaultObject<AActor>();
+		Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+		Actor->SetActorHiddenInGame(Defaults->IsHidden());
+		Actor->SetActorEnableCollision(Defaults->GetActorEnableCollision());
+		Actor->SetActorTickEnabled(Defaults->PrimaryActorTick.bStartWithTickEnabled);
+	}
+	else if (USceneComponent* Component = Cast<USceneComponent>(Object))
+	{
+		const USceneComponent* Defaults = Component->GetClass()->GetDefaultObject<USceneComponent>();
+		Component->SetWorldTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+		Component->SetVisibility(Defaults->GetVisibleFlag());
+		Component->SetComponentTickEnabled(Defaults->PrimaryComponentTick.bStartWithTickEnabled);
+		if (UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component))
+		{
+			Primitive->SetCollisionEnabled(CastChecked<UPrimitiveComponent>(Defaults)->GetCollisionEnabled());
+		}
+		Component->Activate(/*bReset*/ true);
+	}
+
+	if (Object->Implements<UPooledObject>())
+	{
+		IPooledObject::Execute_OnAcquiredFromPool(Object);
+	}
+}
+
+void UActorPoolSubsystem::DestroyPooledObject(UObject* Object)
+{
+	if (AActor* Actor = Cast<AActor>(Object))
+	{
+		Actor->Destroy();
+	}
+	else if (UActorComponent* Component = Cast<UActorComponent>(Object))
+	{
+		Component->DestroyComponent();
+	}
+}
+
+bool UActorPoolSubsystem::PlayBudgetedSound(USoundBase* Sound, const FVector& Location, float VolumeMultiplier)
+{
+	if (Sound == nullptr)
+	{
+		return false;
+	}
+
+	//Twenty casings landing in one spot sound like one, and a full server of them should not eat every voice
+	const float DedupeRadiusSquared = FMath::Square(SoundDedupeRadius);
+	const bool bDuplicate = FrameSoundLocations.ContainsByPredicate([&Location, DedupeRadiusSquared](const FVector& Played)
+	{
+		return FVector::DistSquared(Played, Location) < DedupeRadiusSquared;
+	});
+	if (bDuplicate || FrameSoundLocations.Num() >= MaxSoundsPerFrame)
+	{
+		++NumSoundsDropped;
+		return false;
+	}
+
+	FrameSoundLocations.Add(Location);
+	UGameplayStatics::PlaySoundAtLocation(this, Sound, Location, VolumeMultiplier);
+	return true;
+}
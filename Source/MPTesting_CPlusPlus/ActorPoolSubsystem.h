@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/Interface.h"
+#include "ActorPoolSubsystem.generated.h"
+
+class USoundBase;
+
+UINTERFACE(MinimalAPI, Blueprintable)
+class UPooledObject : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Actors and scene components handed out by UActorPoolSubsystem reset themselves here. Transform, visibility,
+ * collision, tick and activation are already taken care of; anything else a previous use changed is not.
+ */
+class MPTESTING_CPLUSPLUS_API IPooledObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Placed and shown again, about to be used */
+	UFUNCTION(BlueprintNativeEvent, Category = "Pool")
+	void OnAcquiredFromPool();
+
+	/** Hidden and parked, stop timers, sounds and anything else still running */
+	UFUNCTION(BlueprintNativeEvent, Category = "Pool")
+	void OnReturnedToPool();
+};
+
+/** Pool of one class, from config */
+USTRUCT()
+struct FActorPoolSettings
+{
+	GENERATED_BODY()
+
+	/** An actor or scene component class */
+	UPROPERTY(Config)
+	TSoftClassPtr<UObject> Class;
+
+	/** Made when the world begins play, so the first shots spawn nothing */
+	UPROPERTY(Config)
+	int32 PrewarmCount{0};
+
+	/** Live objects at most; past it the one acquired longest ago is taken back and reused */
+	UPROPERTY(Config)
+	int32 MaxCount{64};
+
+	/** Seconds until an acquired object goes back on its own, 0 keeps it until released */
+	UPROPERTY(Config)
+	float Lifetime{0.f};
+};
+
+USTRUCT()
+struct FActorPoolEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UObject> Object;
+
+	double ExpireTime{0.0};
+};
+
+USTRUCT()
+struct FActorPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<UObject>> Free;
+
+	/** In the order they were acquired, oldest first */
+	UPROPERTY()
+	TArray<FActorPoolEntry> Active;
+
+	int32 MaxCount{64};
+	float Lifetime{0.f};
+
+	///
+	///Counters for the benchmark: objects made, handed out again from Free, and taken back at the cap
+	///
+	int32 NumCreated{0};
+	int32 NumReused{0};
+	int32 NumStolen{0};
+};
+
+/**
+ * Recycles short lived cosmetic actors and scene components (shell casings, tracers, impact effects) instead of
+ * spawning and destroying one per shot, which churns the GC and hitches under sustained fire. Per class pools are
+ * pre-warmed and capped from config (classes not configured get DefaultMaxCount and DefaultLifetime); released
+ * objects are hidden, stop ticking and colliding, and wait for the next acquire. Objects implementing IPooledObject
+ * reset their own state. Not for replicated actors, the client copies would not follow.
+ * Casing sounds go through PlayBudgetedSound, which keeps one sound per spot per frame and a budget per frame.
+ * ActorPool.Enabled 0 spawns and destroys every time for comparison, "ActorPool.Bench" measures both.
+ */
+UCLASS(config=Game)
+class MPTESTING_CPLUSPLUS_API UActorPoolSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Lifetime below 0 takes the pool's */
+	AActor* AcquireActor(TSubclassOf<AActor> Class, const FTransform& Transform, float Lifetime = -1.f);
+	USceneComponent* AcquireComponent(TSubclassOf<USceneComponent> Class, const FTransform& Transform, float Lifetime = -1.f);
+
+	template<typename T>
+	T* AcquireActor(const FTransform& Transform, float Lifetime = -1.f) { return Cast<T>(AcquireActor(T::StaticClass(), Transform, Lifetime)); }
+
+	/** Back into its pool. Objects that did not come from a pool are destroyed */
+	void Release(UObject* Object);
+
+	void Prewarm(UClass* Class, int32 Count);
+
+	/** Overrides the class's cap from config, for callers that know their worst case */
+	void SetMaxCount(UClass* Class, int32 MaxCount);
+
+	/** PlaySoundAtLocation, unless a sound already played within SoundDedupeRadius this frame or the frame's budget is spent */
+	bool PlayBudgetedSound(USoundBase* Sound, const FVector& Location, float VolumeMultiplier = 1.f);
+
+	const FActorPool* FindPool(UClass* Class) const { return Pools.Find(Class); }
+	int32 GetNumSoundsDropped() const { return NumSoundsDropped; }
+
+	static bool IsPoolingEnabled();
+
+private:
+	FActorPool& GetPool(UClass* Class);
+	UObject* Acquire(UClass* Class, const FTransform& Transform, float Lifetime);
+	UObject* CreatePooledObject(UClass* Class, bool bParked);
+	void Park(UObject* Object);
+	void Unpark(UObject* Object, const FTransform& Transform);
+	void DestroyPooledObject(UObject* Object);
+
+	UPROPERTY(Config)
+	TArray<FActorPoolSettings> PoolSettings;
+
+	UPROPERTY(Config)
+	int32 DefaultMaxCount{64};
+
+	UPROPERTY(Config)
+	float DefaultLifetime{0.f};
+
+	UPROPERTY(Config)
+	int32 MaxSoundsPerFrame{8};
+
+	UPROPERTY(Config)
+	float SoundDedupeRadius{300.f};
+
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FActorPool> Pools;
+
+	/** Owner of the pooled components */
+	UPROPERTY()
+	TObjectPtr<AActor> ComponentHost;
+
+	/** Where the sounds of this frame played */
+	TArray<FVector, TInlineAllocator<16>> FrameSoundLocations;
+	int32 NumSoundsDropped{0};
+};
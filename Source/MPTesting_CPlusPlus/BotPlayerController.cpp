@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BotPlayerController.h"
+#include "GameFramework/Pawn.h"
+#include "InputActionValue.h"
+#include "MPTesting_CPlusPlusCharacter.h"
+
+ABotPlayerController::ABotPlayerController()
+{
+	//A player state like a real player's, so bots show up in PlayerArray and the lobby roster
+	bWantsPlayerState = true;
+	//The look input owns the control rotation, not the pawn's facing
+	bSetControlRotationFromPawnOrientation = false;
+}
+
+void ABotPlayerController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	HomeLocation = InPawn->GetActorLocation();
+	SetControlRotation(InPawn->GetActorRotation());
+	TimeUntilNextInput = 0.f;
+}
+
+void ABotPlayerController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	AMPTesting_CPlusPlusCharacter* BotCharacter = Cast<AMPTesting_CPlusPlusCharacter>(GetPawn());
+	if (BotCharacter == nullptr)
+	{
+		return;
+	}
+
+	TimeUntilNextInput -= DeltaTime;
+	if (TimeUntilNextInput <= 0.f)
+	{
+		ChooseInput();
+	}
+
+	//Walked too far, head home until the next pick
+	const FVector FromHome = BotCharacter->GetActorLocation() - HomeLocation;
+	if (FromHome.SizeSquared2D() > FMath::Square(WanderRadius))
+	{
+		const float HomeYaw = (-FromHome).Rotation().Yaw;
+		SetControlRotation(FRotator(0.f, HomeYaw, 0.f));
+		MoveInput = FVector2D(0.f, 1.f);
+		LookInput = FVector2D::ZeroVector;
+	}
+
+	BotCharacter->Look(FInputActionValue(LookInput * DeltaTime));
+	BotCharacter->Move(FInputActionValue(MoveInput));
+
+	if (bJumping)
+	{
+		BotCharacter->StopJumping();
+		bJumping = false;
+	}
+	else if (Pattern == EBotInputPattern::JumpSpam && BotCharacter->CanJump())
+	{
+		BotCharacter->Jump();
+		bJumping = true;
+	}
+}
+
+void ABotPlayerController::UpdateControlRotation(float DeltaTime, bool bUpdatePawn)
+{
+	//AAIController's would aim at a focus, or level the pitch without one, and the look input's pitch never showed
+	APawn* const BotPawn = GetPawn();
+	if (BotPawn && bUpdatePawn)
+	{
+		BotPawn->FaceRotation(GetControlRotation(), DeltaTime);
+	}
+}
+
+void ABotPlayerController::ChooseInput()
+{
+	switch (Pattern)
+	{
+	case EBotInputPattern::Strafe:
+		MoveInput = FVector2D(MoveInput.X > 0.f ? -1.f : 1.f, FMath::FRandRange(-0.2f, 0.2f));
+		LookInput = FVector2D(FMath::FRandRange(-15.f, 15.f), 0.f);
+		TimeUntilNextInput = FMath::FRandRange(0.5f, 1.5f);
+		break;
+	case EBotInputPattern::RandomWalk:
+	case EBotInputPattern::JumpSpam:
+	default:
+		MoveInput = FVector2D(FMath::FRandRange(-1.f, 1.f), FMath::FRandRange(-1.f, 1.f)).GetSafeNormal();
+		LookInput = FVector2D(FMath::FRandRange(-90.f, 90.f), FMath::FRandRange(-10.f, 10.f));
+		TimeUntilNextInput = FMath::FRandRange(1.f, 3.f);
+		break;
+	}
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "BotPlayerController.generated.h"
+
+class AMPTesting_CPlusPlusCharacter;
+
+UENUM()
+enum class EBotInputPattern : uint8
+{
+	/** Walks a random direction for a few seconds, turning as it goes */
+	RandomWalk,
+	/** Strafes left and right, flipping every second or so */
+	Strafe,
+	/** Random walk, jumping whenever it lands */
+	JumpSpam
+};
+
+/**
+ * Server side stand-in for a connected player, for replication and movement load tests without client processes.
+ * Has a player state like a real player and drives its AMPTesting_CPlusPlusCharacter through the same Move/Look
+ * handlers Enhanced Input calls, with a synthetic pattern instead of a person. Bots wander around where they
+ * spawned and turn back past WanderRadius. Spawned and removed by UBotPlayerSubsystem.
+ */
+UCLASS()
+class MPTESTING_CPLUSPLUS_API ABotPlayerController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	ABotPlayerController();
+
+	virtual void Tick(float DeltaTime) override;
+	/** Only turns the pawn, the control rotation is the look input's */
+	virtual void UpdateControlRotation(float DeltaTime, bool bUpdatePawn = true) override;
+
+	void SetInputPattern(EBotInputPattern InPattern) { Pattern = InPattern; }
+	EBotInputPattern GetInputPattern() const { return Pattern; }
+
+	void SetWanderRadius(float InWanderRadius) { WanderRadius = InWanderRadius; }
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+
+private:
+	/** New move and look input once the current pick runs out */
+	void ChooseInput();
+
+	EBotInputPattern Pattern{EBotInputPattern::RandomWalk};
+	float WanderRadius{3000.f};
+
+	FVector HomeLocation{FVector::ZeroVector};
+	FVector2D MoveInput{FVector2D::ZeroVector};
+	/** Degrees per second of yaw, and pitch swing */
+	FVector2D LookInput{FVector2D::ZeroVector};
+	float TimeUntilNextInput{0.f};
+	bool bJumping{false};
+};
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BotPlayerSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "TimerManager.h"
+#include "LobbyGameMode.h"
+#include "MPTesting_CPlusPlus.h"
+
+bool UBotPlayerSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UBotPlayerSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Bots are server players, a client has no game mode to spawn them with
+	if (InWorld.GetNetMode() == NM_Client)
+	{
+		return;
+	}
+	bActive = true;
+
+	FParse::Value(FCommandLine::Get(), TEXT("Bots="), DefaultBotCount);
+	if (DefaultBotCount > 0)
+	{
+		//After the actors' BeginPlay, the game mode and player starts are ready by then
+		InWorld.GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this]()
+		{
+			SetNumBots(DefaultBotCount);
+		}));
+	}
+}
+
+void UBotPlayerSubsystem::Deinitialize()
+{
+	//Their pawns and controllers go with the world
+	Bots.Empty();
+	bActive = false;
+
+	Super::Deinitialize();
+}
+
+void UBotPlayerSubsystem::SetNumBots(int32 Count, TOptional<EBotInputPattern> Pattern)
+{
+	if (!bActive)
+	{
+		return;
+	}
+
+	Count = FMath::Clamp(Count, 0, MaxBots);
+	while (Bots.Num() > Count)
+	{
+		RemoveBot(Bots.Pop(EAllowShrinking::No));
+	}
+
+	constexpr int32 NumPatterns = static_cast<int32>(EBotInputPattern::JumpSpam) + 1;
+	while (Bots.Num() < Count)
+	{
+		const EBotInputPattern BotPattern = Pattern.Get(static_cast<EBotInputPattern>(NextBotIndex % NumPatterns));
+		if (!AddBot(BotPattern))
+		{
+			UE_LOG(LogCombat, Warning, TEXT("Stopped at %d bots, the last one did not spawn"), Bots.Num());
+			break;
+		}
+	}
+}
+
+bool UBotPlayerSubsystem::AddBot(EBotInputPattern Pattern)
+{
+	UWorld* World = GetWorld();
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	if (GameMode == nullptr)
+	{
+		return false;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	ABotPlayerController* Bot = World->SpawnActor<ABotPlayerController>(SpawnParameters);
+	if (Bot == nullptr)
+	{
+		return false;
+	}
+
+	const int32 BotIndex = NextBotIndex++;
+	Bot->SetInputPattern(Pattern);
+	Bot->SetWanderRadius(WanderRadius);
+	if (APlayerState* PlayerState = Bot->GetPlayerState<APlayerState>())
+	{
+		PlayerState->SetIsABot(true);
+		PlayerState->SetPlayerName(FString::Printf(TEXT("Bot%03d"), BotIndex));
+	}
+
+	//Rows in front of a player start, clear of the start itself
+	const AActor* PlayerStart = GameMode->FindPlayerStart(Bot);
+	const FTransform StartTransform = PlayerStart ? PlayerStart->GetActorTransform() : FTransform::Identity;
+	const int32 Columns = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(MaxBots)));
+	const int32 Slot = Bots.Num();
+	const FVector Offset((Slot / Columns + 1) * SpawnSpacing, (Slot % Columns - Columns / 2) * SpawnSpacing, 0.f);
+	GameMode->RestartPlayerAtTransform(Bot, FTransform(StartTransform.GetRotation(), StartTransform.GetLocation() + StartTransform.TransformVector(Offset)));
+
+	if (Bot->GetPawn() == nullptr)
+	{
+		Bot->Destroy();
+		return false;
+	}
+
+	if (ALobbyGameMode* LobbyGameMode = Cast<ALobbyGameMode>(GameMode))
+	{
+		LobbyGameMode->AddBot(Bot);
+	}
+	Bots.Add(Bot);
+	return true;
+}
+
+void UBotPlayerSubsystem::RemoveBot(ABotPlayerController* Bot)
+{
+	if (Bot == nullptr)
+	{
+		return;
+	}
+
+	if (ALobbyGameMode* LobbyGameMode = GetWorld()->GetAuthGameMode<ALobbyGameMode>())
+	{
+		LobbyGameMode->RemoveBot(Bot);
+	}
+	if (APawn* Pawn = Bot->GetPawn())
+	{
+		Pawn->Destroy();
+	}
+	Bot->Destroy();
+}
+
+///
+///Bots.Count <N> [Pattern=Mixed|RandomWalk|Strafe|JumpSpam], run on the server (or with -ExecCmds on a headless one)
+///
+namespace BotPlayers
+{
+	static void SetCount(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UBotPlayerSubsystem* BotPlayers = World ? World->GetSubsystem<UBotPlayerSubsystem>() : nullptr;
+		if (BotPlayers == nullptr || !BotPlayers->IsActive())
+		{
+			Ar.Log(TEXT("Bots only run on the server"));
+			return;
+		}
+
+		if (Args.Num() == 0)
+		{
+			Ar.Logf(TEXT("%d bots"), BotPlayers->GetNumBots());
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		FString PatternName;
+		TOptional<EBotInputPattern> Pattern;
+		if (FParse::Value(*Params, TEXT("Pattern="), PatternName) && PatternName != TEXT("Mixed"))
+		{
+			const int64 Value = StaticEnum<EBotInputPattern>()->GetValueByNameString(PatternName);
+			if (Value == INDEX_NONE)
+			{
+				Ar.Logf(TEXT("No bot pattern %s"), *PatternName);
+				return;
+			}
+			Pattern = static_cast<EBotInputPattern>(Value);
+		}
+
+		const int32 Count = FCString::Atoi(*Args[0]);
+		if (Count > BotPlayers->GetMaxBots())
+		{
+			Ar.Logf(TEXT("At most %d bots, see MaxBots"), BotPlayers->GetMaxBots());
+		}
+		BotPlayers->SetNumBots(Count, Pattern);
+		Ar.Logf(TEXT("%d bots"), BotPlayers->GetNumBots());
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice CountCommand(
+		TEXT("Bots.Count"),
+		TEXT("Scales the server's bot players to <N>. Pattern=Mixed|RandomWalk|Strafe|JumpSpam, for the bots added"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&SetCount));
+}
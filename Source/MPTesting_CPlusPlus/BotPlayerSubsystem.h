@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BotPlayerController.h"
+#include "BotPlayerSubsystem.generated.h"
+
+/**
+ * In-process bot players, so one headless server can carry a full match's worth of replicated, moving characters.
+ * Each bot is an ABotPlayerController with a player state and a default pawn spawned through the game mode like a
+ * player's; in the lobby they join the roster already ready, they never hold up the real players' ready check.
+ * Bots take no reservation slots and are not carried over by seamless travel, so every map starts DefaultBotCount
+ * of them (or -Bots= on the command line).
+ * Servers only. "Bots.Count <N> [Pattern=Mixed|RandomWalk|Strafe|JumpSpam]" scales them at runtime.
+ */
+UCLASS(config=Game)
+class MPTESTING_CPLUSPLUS_API UBotPlayerSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Adds or removes bots, newest first, until there are Count. Mixed patterns cycle through all of them */
+	void SetNumBots(int32 Count, TOptional<EBotInputPattern> Pattern = {});
+	int32 GetNumBots() const { return Bots.Num(); }
+	int32 GetMaxBots() const { return MaxBots; }
+
+	bool IsActive() const { return bActive; }
+
+private:
+	bool AddBot(EBotInputPattern Pattern);
+	void RemoveBot(ABotPlayerController* Bot);
+
+	/** Bots every map starts with */
+	UPROPERTY(Config)
+	int32 DefaultBotCount{0};
+
+	UPROPERTY(Config)
+	int32 MaxBots{200};
+
+	/** Bots spawn on a grid this far apart around a player start, so they don't spawn into each other */
+	UPROPERTY(Config)
+	float SpawnSpacing{200.f};
+
+	/** How far a bot walks from where it spawned before it turns back */
+	UPROPERTY(Config)
+	float WanderRadius{3000.f};
+
+	UPROPERTY()
+	TArray<TObjectPtr<ABotPlayerController>> Bots;
+
+	bool bActive{false};
+	int32 NextBotIndex{0};
+};
@@ -0,0 +1,250 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterSignificanceSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Parse.h"
+#include "RenderCore.h"
+#include "MPTesting_CPlusPlus.h"
+
+///
+///Client frame time with many animated characters, throttled by significance and without (Significance.Enabled 0):
+///  Significance.Bench [Counts=25,50,100] [Seconds=5] [Spacing=300]
+///Spawns the local player's character class in a grid in front of the view, local only and without controllers,
+///so run it standalone or on a client. Every count is measured off then on, after a second to settle. The summary
+///goes to LogCombat at the end.
+///
+namespace CharacterSignificanceBench
+{
+	static constexpr float SettleSeconds = 1.f;
+
+	struct FPhase
+	{
+		int32 NumCharacters{0};
+		bool bSignificance{false};
+		int32 NumFrames{0};
+		double FrameMs{0.0};
+		double MaxFrameMs{0.0};
+		double GameThreadMs{0.0};
+		double RenderThreadMs{0.0};
+		TArray<int32> TierCounts;
+	};
+
+	class FBench : public TSharedFromThis<FBench>
+	{
+	public:
+		FBench(UWorld* InWorld, UClass* InClass, const TArray<int32>& Counts, float InSeconds, float InSpacing)
+			: World(InWorld)
+			, Class(InClass)
+			, Seconds(InSeconds)
+			, Spacing(InSpacing)
+		{
+			for (const int32 Count : Counts)
+			{
+				Phases.Add({Count, false});
+				Phases.Add({Count, true});
+			}
+		}
+
+		void Start()
+		{
+			bWasEnabled = UCharacterSignificanceSubsystem::IsSignificanceEnabled();
+			StartPhase();
+			TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FBench::Tick));
+		}
+
+	private:
+		void StartPhase()
+		{
+			FPhase& Phase = Phases[PhaseIndex];
+			IConsoleManager::Get().FindConsoleVariable(TEXT("Significance.Enabled"))->Set(Phase.bSignificance ? 1 : 0, ECVF_SetByConsole);
+			SpawnCharacters(Phase.NumCharacters);
+			PhaseTime = 0.0;
+		}
+
+		void SpawnCharacters(int32 Count)
+		{
+			//Same count as the previous phase, only the cvar changes
+			if (Characters.Num() == Count)
+			{
+				return;
+			}
+			DestroyCharacters();
+
+			const APlayerController* PlayerController = World->GetFirstPlayerController();
+			FVector ViewLocation = FVector::ZeroVector;
+			FRotator ViewRotation = FRotator::ZeroRotator;
+			if (PlayerController)
+			{
+				PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			}
+			const FRotator Yaw(0.f, ViewRotation.Yaw, 0.f);
+			const FVector Forward = Yaw.Vector();
+			const FVector Right = FRotationMatrix(Yaw).GetScaledAxis(EAxis::Y);
+
+			//Rows going away from the view, so the grid spans every significance tier
+			const int32 Columns = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count)));
+			FActorSpawnParameters SpawnParameters;
+			SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				const int32 Row = Index / Columns;
+				const int32 Column = Index % Columns;
+				const FVector Location = ViewLocation + Forward * Spacing * (Row + 1) + Right * Spacing * (Column - Columns / 2);
+				if (ACharacter* Character = World->SpawnActor<ACharacter>(Class, Location, Yaw, SpawnParameters))
+				{
+					Characters.Add(Character);
+				}
+			}
+		}
+
+		void DestroyCharacters()
+		{
+			for (const TWeakObjectPtr<ACharacter>& Character : Characters)
+			{
+				if (Character.IsValid())
+				{
+					Character->Destroy();
+				}
+			}
+			Characters.Reset();
+		}
+
+		bool Tick(float DeltaTime)
+		{
+			if (!World.IsValid())
+			{
+				Finish();
+				return false;
+			}
+
+			FPhase& Phase = Phases[PhaseIndex];
+			PhaseTime += DeltaTime;
+			if (PhaseTime < SettleSeconds)
+			{
+				return true;
+			}
+
+			if (PhaseTime < SettleSeconds + Seconds)
+			{
+				const double FrameMs = DeltaTime * 1000.0;
+				Phase.FrameMs += FrameMs;
+				Phase.MaxFrameMs = FMath::Max(Phase.MaxFrameMs, FrameMs);
+				Phase.GameThreadMs += FPlatformTime::ToMilliseconds(GGameThreadTime);
+				Phase.RenderThreadMs += FPlatformTime::ToMilliseconds(GRenderThreadTime);
+				++Phase.NumFrames;
+				return true;
+			}
+
+			if (UCharacterSignificanceSubsystem* Significance = World->GetSubsystem<UCharacterSignificanceSubsystem>())
+			{
+				Phase.TierCounts = Significance->GetTierCounts();
+			}
+			if (++PhaseIndex >= Phases.Num())
+			{
+				Finish();
+				return false;
+			}
+			StartPhase();
+			return true;
+		}
+
+		void Finish();
+
+		TWeakObjectPtr<UWorld> World;
+		UClass* Class{nullptr};
+		float Seconds{0.f};
+		float Spacing{0.f};
+		bool bWasEnabled{true};
+		TArray<FPhase> Phases;
+		int32 PhaseIndex{0};
+		double PhaseTime{0.0};
+		TArray<TWeakObjectPtr<ACharacter>> Characters;
+		FTSTicker::FDelegateHandle TickerHandle;
+	};
+
+	static TSharedPtr<FBench> ActiveBench;
+
+	void FBench::Finish()
+	{
+		DestroyCharacters();
+		IConsoleManager::Get().FindConsoleVariable(TEXT("Significance.Enabled"))->Set(bWasEnabled ? 1 : 0, ECVF_SetByConsole);
+
+		UE_LOG(LogCombat, Display, TEXT("Significance bench: %s, %.0f s per run, %.0f apart"), *GetNameSafe(Class), Seconds, Spacing);
+		UE_LOG(LogCombat, Display, TEXT("%10s %12s %8s %10s %10s %10s %10s  %s"),
+			TEXT("Characters"), TEXT("Significance"), TEXT("Frames"), TEXT("Frame ms"), TEXT("Max ms"), TEXT("GT ms"), TEXT("RT ms"), TEXT("Tiers"));
+		for (const FPhase& Phase : Phases)
+		{
+			const int32 Frames = FMath::Max(Phase.NumFrames, 1);
+			FString Tiers;
+			for (const int32 Count : Phase.TierCounts)
+			{
+				Tiers += FString::Printf(TEXT("%d "), Count);
+			}
+			UE_LOG(LogCombat, Display, TEXT("%10d %12s %8d %10.2f %10.2f %10.2f %10.2f  %s"),
+				Phase.NumCharacters, Phase.bSignificance ? TEXT("On") : TEXT("Off"), Phase.NumFrames, Phase.FrameMs / Frames, Phase.MaxFrameMs,
+				Phase.GameThreadMs / Frames, Phase.RenderThreadMs / Frames, *Tiers);
+		}
+
+		//Runs from our own ticker, which keeps us alive until it returns
+		ActiveBench.Reset();
+	}
+
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (ActiveBench.IsValid())
+		{
+			Ar.Log(TEXT("A significance bench is already running"));
+			return;
+		}
+
+		if (World == nullptr || World->GetSubsystem<UCharacterSignificanceSubsystem>() == nullptr)
+		{
+			Ar.Log(TEXT("No character significance in this world, it is not created on dedicated servers"));
+			return;
+		}
+
+		const APlayerController* PlayerController = World->GetFirstPlayerController();
+		const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		if (Pawn == nullptr || !Pawn->IsA<ACharacter>())
+		{
+			Ar.Log(TEXT("Needs a local player with a character to copy"));
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		FString CountsParam(TEXT("25,50,100"));
+		float Seconds = 5.f;
+		float Spacing = 300.f;
+		FParse::Value(*Params, TEXT("Counts="), CountsParam, false);
+		FParse::Value(*Params, TEXT("Seconds="), Seconds);
+		FParse::Value(*Params, TEXT("Spacing="), Spacing);
+
+		TArray<FString> CountStrings;
+		CountsParam.ParseIntoArray(CountStrings, TEXT(","));
+		TArray<int32> Counts;
+		for (const FString& Count : CountStrings)
+		{
+			Counts.Add(FMath::Max(FCString::Atoi(*Count), 1));
+		}
+		if (Counts.Num() == 0)
+		{
+			Ar.Log(TEXT("Counts= takes a comma separated list of character counts"));
+			return;
+		}
+
+		Ar.Logf(TEXT("Spawning %s by %s with and without significance, results are logged when done"), *Pawn->GetClass()->GetName(), *CountsParam);
+		ActiveBench = MakeShared<FBench>(World, Pawn->GetClass(), Counts, FMath::Max(Seconds, 1.f), FMath::Max(Spacing, 100.f));
+		ActiveBench->Start();
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("Significance.Bench"),
+		TEXT("Client frame time with many characters, with and without significance and the animation budget. Counts= Seconds= Spacing="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
@@ -0,0 +1,291 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CharacterSignificanceSubsystem.h"
+
+#include "AnimationBudgetAllocatorParameters.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "IAnimationBudgetAllocator.h"
+#include "SignificanceManager.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "LagCompensationSubsystem.h"
+#include "MPTesting_CPlusPlus.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Significance"), STAT_CharacterSignificance, STATGROUP_Combat);
+
+namespace CharacterSignificance
+{
+	static const FName CharacterTag(TEXT("Character"));
+
+	/** The local player's own character, above anything the formula can give */
+	static constexpr float LocalSignificance = 10.f;
+
+	static bool bEnabled = true;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("Significance.Enabled"),
+		bEnabled,
+		TEXT("Throttle characters by significance and the animation budget. 0 animates everyone at full rate, to compare against."));
+}
+
+bool UCharacterSignificanceSubsystem::IsSignificanceEnabled()
+{
+	return CharacterSignificance::bEnabled;
+}
+
+bool UCharacterSignificanceSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//Nothing renders on a dedicated server
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UCharacterSignificanceSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	SignificanceManager = USignificanceManager::Get(&InWorld);
+	if (SignificanceManager == nullptr)
+	{
+		UE_LOG(LogCombat, Warning, TEXT("No significance manager in %s, characters animate at full rate"), *InWorld.GetName());
+	}
+
+	if (Tiers.Num() == 0)
+	{
+		Tiers.AddDefaulted();
+	}
+	Tiers.Sort([](const FCharacterSignificanceTier& A, const FCharacterSignificanceTier& B) { return A.MinSignificance > B.MinSignificance; });
+	AimConeCos = FMath::Cos(FMath::DegreesToRadians(AimConeDegrees));
+
+	LagCompensation = InWorld.GetNetMode() == NM_ListenServer ? InWorld.GetSubsystem<ULagCompensationSubsystem>() : nullptr;
+
+	AnimationBudgetAllocator = bUseAnimationBudget ? IAnimationBudgetAllocator::Get(&InWorld) : nullptr;
+	if (AnimationBudgetAllocator)
+	{
+		FAnimationBudgetAllocatorParameters Parameters;
+		Parameters.BudgetInMs = AnimationBudgetMs;
+		AnimationBudgetAllocator->SetParameters(Parameters);
+	}
+	SetEnabled(IsSignificanceEnabled());
+}
+
+void UCharacterSignificanceSubsystem::Deinitialize()
+{
+	CharacterTiers.Empty();
+	SignificanceManager = nullptr;
+	LagCompensation = nullptr;
+	AnimationBudgetAllocator = nullptr;
+
+	Super::Deinitialize();
+}
+
+TStatId UCharacterSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void UCharacterSignificanceSubsystem::RegisterCharacter(ACharacter* Character)
+{
+	if (SignificanceManager == nullptr || Character == nullptr || CharacterTiers.Contains(Character))
+	{
+		return;
+	}
+
+	CharacterTiers.Add(Character, INDEX_NONE);
+	SignificanceManager->RegisterObject(Character, CharacterSignificance::CharacterTag,
+		[this](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+		{
+			//Runs in parallel, reads only
+			return CalculateSignificance(*static_cast<const ACharacter*>(ObjectInfo->GetObject()), Viewpoint);
+		},
+		USignificanceManager::EPostSignificanceType::Sequential,
+		[this](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float Significance, bool bFinal)
+		{
+			OnSignificanceUpdated(*static_cast<ACharacter*>(ObjectInfo->GetObject()), Significance);
+		});
+
+	if (USkeletalMeshComponentBudgeted* Mesh = Cast<USkeletalMeshComponentBudgeted>(Character->GetMesh()); Mesh && AnimationBudgetAllocator)
+	{
+		AnimationBudgetAllocator->RegisterComponent(Mesh);
+	}
+}
+
+void UCharacterSignificanceSubsystem::UnregisterCharacter(ACharacter* Character)
+{
+	if (Character == nullptr || CharacterTiers.Remove(Character) == 0)
+	{
+		return;
+	}
+
+	if (SignificanceManager)
+	{
+		SignificanceManager->UnregisterObject(Character);
+	}
+	if (USkeletalMeshComponentBudgeted* Mesh = Cast<USkeletalMeshComponentBudgeted>(Character->GetMesh()); Mesh && AnimationBudgetAllocator)
+	{
+		AnimationBudgetAllocator->UnregisterComponent(Mesh);
+	}
+}
+
+void UCharacterSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (SignificanceManager == nullptr)
+	{
+		return;
+	}
+
+	if (bEnabled != IsSignificanceEnabled())
+	{
+		SetEnabled(IsSignificanceEnabled());
+	}
+	if (!bEnabled)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CharacterSignificance);
+
+	//Every local player's view, split screen included
+	Viewpoints.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (PlayerController && PlayerController->IsLocalController())
+		{
+			FVector Location;
+			FRotator Rotation;
+			PlayerController->GetPlayerViewPoint(Location, Rotation);
+			Viewpoints.Emplace(Rotation, Location);
+		}
+	}
+	SignificanceManager->Update(Viewpoints);
+}
+
+float UCharacterSignificanceSubsystem::CalculateSignificance(const ACharacter& Character, const FTransform& Viewpoint) const
+{
+	if (Character.IsLocallyControlled())
+	{
+		return CharacterSignificance::LocalSignificance;
+	}
+
+	const FVector ToCharacter = Character.GetActorLocation() - Viewpoint.GetLocation();
+	const float Distance = ToCharacter.Size();
+	float Significance = 1.f - FMath::Clamp((Distance - NearDistance) / FMath::Max(FarDistance - NearDistance, 1.f), 0.f, 1.f);
+
+	const USkeletalMeshComponent* Mesh = Character.GetMesh();
+	if (Mesh && !Mesh->WasRecentlyRendered(0.2f))
+	{
+		Significance *= HiddenScale;
+	}
+
+	if (Distance > UE_KINDA_SMALL_NUMBER && FVector::DotProduct(ToCharacter / Distance, Viewpoint.GetRotation().GetForwardVector()) >= AimConeCos)
+	{
+		Significance += AimBonus;
+	}
+	return Significance;
+}
+
+void UCharacterSignificanceSubsystem::OnSignificanceUpdated(ACharacter& Character, float Significance)
+{
+	//Hit validation reads these bones every frame, they can't lag behind for the host's framerate
+	if (LagCompensation && LagCompensation->IsCharacterRegistered(&Character))
+	{
+		Significance = CharacterSignificance::LocalSignificance;
+	}
+
+	if (USkeletalMeshComponentBudgeted* Mesh = Cast<USkeletalMeshComponentBudgeted>(Character.GetMesh()); Mesh && AnimationBudgetAllocator)
+	{
+		const bool bLocal = Significance >= CharacterSignificance::LocalSignificance;
+		AnimationBudgetAllocator->SetComponentSignificance(Mesh, Significance, /*bNeverSkip*/ bLocal);
+	}
+
+	const int32 TierIndex = GetTierIndex(Significance);
+	int32* CurrentTier = CharacterTiers.Find(&Character);
+	if (CurrentTier && *CurrentTier != TierIndex)
+	{
+		*CurrentTier = TierIndex;
+		ApplyTier(Character, TierIndex);
+	}
+}
+
+int32 UCharacterSignificanceSubsystem::GetTierIndex(float Significance) const
+{
+	for (int32 Index = 0; Index < Tiers.Num(); ++Index)
+	{
+		if (Significance >= Tiers[Index].MinSignificance)
+		{
+			return Index;
+		}
+	}
+	return Tiers.Num() - 1;
+}
+
+void UCharacterSignificanceSubsystem::ApplyTier(ACharacter& Character, int32 TierIndex)
+{
+	const FCharacterSignificanceTier& Tier = Tiers[TierIndex];
+	USkeletalMeshComponent* Mesh = Character.GetMesh();
+	Character.SetActorTickInterval(Tier.TickInterval);
+	if (Mesh == nullptr)
+	{
+		return;
+	}
+
+	//With the budget on, the allocator decides when meshes tick and URO would fight it
+	if (AnimationBudgetAllocator && bEnabled)
+	{
+		Mesh->bEnableUpdateRateOptimizations = false;
+	}
+	else
+	{
+		Mesh->SetComponentTickInterval(Tier.TickInterval);
+		Mesh->bEnableUpdateRateOptimizations = Tier.bUpdateRateOptimizations;
+	}
+
+	Mesh->SetForcedLOD(Tier.ForcedLOD);
+	if (Tier.bClothSimulation)
+	{
+		Mesh->ResumeClothingSimulation();
+	}
+	else
+	{
+		Mesh->SuspendClothingSimulation();
+	}
+	Mesh->KinematicBonesUpdateToPhysics = Tier.bUpdatePhysicsFromAnimation ? EKinematicBonesUpdateToPhysics::SkipSimulatingBones : EKinematicBonesUpdateToPhysics::SkipAllBones;
+}
+
+void UCharacterSignificanceSubsystem::SetEnabled(bool bEnable)
+{
+	bEnabled = bEnable;
+	if (AnimationBudgetAllocator)
+	{
+		AnimationBudgetAllocator->SetEnabled(bEnable);
+	}
+
+	//Off puts everyone at the top tier; on lets the next update place them again
+	for (TPair<TWeakObjectPtr<ACharacter>, int32>& Pair : CharacterTiers)
+	{
+		Pair.Value = INDEX_NONE;
+		if (ACharacter* Character = Pair.Key.Get(); Character && !bEnable)
+		{
+			ApplyTier(*Character, 0);
+		}
+	}
+}
+
+TArray<int32> UCharacterSignificanceSubsystem::GetTierCounts() const
+{
+	TArray<int32> Counts;
+	Counts.SetNumZeroed(Tiers.Num());
+	for (const TPair<TWeakObjectPtr<ACharacter>, int32>& Pair : CharacterTiers)
+	{
+		if (Counts.IsValidIndex(Pair.Value))
+		{
+			++Counts[Pair.Value];
+		}
+	}
+	return Counts;
+}
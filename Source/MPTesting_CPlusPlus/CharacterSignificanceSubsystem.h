@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterSignificanceSubsystem.generated.h"
+
+class ACharacter;
+class ULagCompensationSubsystem;
+class USignificanceManager;
+class IAnimationBudgetAllocator;
+
+/** How much a character at or above MinSignificance costs, from config */
+USTRUCT()
+struct FCharacterSignificanceTier
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	float MinSignificance{0.f};
+
+	/** Actor tick, and the mesh's when the animation budget is off */
+	UPROPERTY(Config)
+	float TickInterval{0.f};
+
+	/** Like SetForcedLOD: 0 lets the engine pick, otherwise LOD index + 1 */
+	UPROPERTY(Config)
+	int32 ForcedLOD{0};
+
+	/** Engine update rate optimizations, only used when the animation budget is off */
+	UPROPERTY(Config)
+	bool bUpdateRateOptimizations{false};
+
+	UPROPERTY(Config)
+	bool bClothSimulation{true};
+
+	/** Physics bodies follow the animation, nothing on a character needs them far away */
+	UPROPERTY(Config)
+	bool bUpdatePhysicsFromAnimation{true};
+};
+
+/**
+ * Keeps the cost of many animated characters flat on anything that renders. Every frame the significance manager
+ * scores each character against the local views: distance, whether it was rendered, and whether a view is aiming
+ * at it; the local player's own character always scores highest. The score goes to the animation budget allocator,
+ * which ticks meshes within AnimationBudgetMs, and picks a tier (tick interval, LOD, URO, cloth, physics) that is
+ * applied when it changes. Replaces the lobby avatars' distance throttle.
+ * Not created on dedicated servers. On a listen server, characters that lag compensation records are pinned to the
+ * top tier and never skipped by the budget: their bones are the hitboxes it rewinds, throttled they would trail.
+ * Significance.Enabled 0 puts everyone back at the top tier, "Significance.Bench" measures with and without.
+ */
+UCLASS(config=Game)
+class MPTESTING_CPLUSPLUS_API UCharacterSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterCharacter(ACharacter* Character);
+	void UnregisterCharacter(ACharacter* Character);
+
+	int32 GetNumTiers() const { return Tiers.Num(); }
+	/** Characters in each tier right now */
+	TArray<int32> GetTierCounts() const;
+
+	static bool IsSignificanceEnabled();
+
+private:
+	float CalculateSignificance(const ACharacter& Character, const FTransform& Viewpoint) const;
+	void OnSignificanceUpdated(ACharacter& Character, float Significance);
+	int32 GetTierIndex(float Significance) const;
+	void ApplyTier(ACharacter& Character, int32 TierIndex);
+	void SetEnabled(bool bEnable);
+
+	UPROPERTY(Config)
+	float NearDistance{1500.f};
+
+	/** Past this, distance alone scores 0 */
+	UPROPERTY(Config)
+	float FarDistance{8000.f};
+
+	/** Score kept by characters that were not rendered last frame */
+	UPROPERTY(Config)
+	float HiddenScale{0.25f};
+
+	UPROPERTY(Config)
+	float AimConeDegrees{10.f};
+
+	/** Added for a view aiming at the character, they are about to be shot or shoot back */
+	UPROPERTY(Config)
+	float AimBonus{0.3f};
+
+	UPROPERTY(Config)
+	bool bUseAnimationBudget{true};
+
+	/** Game thread time the budget allocator may spend on character animation per frame */
+	UPROPERTY(Config)
+	float AnimationBudgetMs{2.f};
+
+	/** Highest MinSignificance first */
+	UPROPERTY(Config)
+	TArray<FCharacterSignificanceTier> Tiers;
+
+	UPROPERTY()
+	TObjectPtr<USignificanceManager> SignificanceManager;
+
+	/** Only set on a listen server, where the host's meshes are also the ones hits are validated against */
+	UPROPERTY()
+	TObjectPtr<ULagCompensationSubsystem> LagCompensation;
+
+	IAnimationBudgetAllocator* AnimationBudgetAllocator{nullptr};
+
+	bool bEnabled{true};
+	float AimConeCos{1.f};
+	TMap<TWeakObjectPtr<ACharacter>, int32> CharacterTiers;
+	TArray<FTransform> Viewpoints;
+};
@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatStateComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+bool FCombatVitals::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 HealthValue = Health;
+	uint32 ShieldValue = Shield;
+	Ar.SerializeInt(HealthValue, Steps + 1);
+	Ar.SerializeInt(ShieldValue, Steps + 1);
+	Health = static_cast<uint16>(HealthValue);
+	Shield = static_cast<uint16>(ShieldValue);
+
+	bOutSuccess = true;
+	return true;
+}
+
+UCombatStateComponent::UCombatStateComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+	SetIsReplicatedByDefault(true);
+}
+
+void UCombatStateComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	Params.Condition = COND_OwnerOnly;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UCombatStateComponent, OwnerVitals, Params);
+	Params.Condition = COND_SkipOwner;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UCombatStateComponent, ProxyVitals, Params);
+}
+
+void UCombatStateComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		ResetVitals();
+	}
+}
+
+float UCombatStateComponent::ApplyDamage(float Damage, APawn* DamageInstigator, const FVector& Location, int32 NumHits)
+{
+	if (GetOwnerRole() != ROLE_Authority || Damage <= 0.f || Health <= 0.f)
+	{
+		return 0.f;
+	}
+
+	const float ShieldDamage = FMath::Min(Damage, Shield);
+	const float HealthDamage = FMath::Min(Damage - ShieldDamage, Health);
+	const bool bShieldBroken = Shield > 0.f && ShieldDamage >= Shield;
+	const bool bKilled = HealthDamage >= Health;
+	SetVitals(Health - HealthDamage, Shield - ShieldDamage, bShieldBroken || bKilled);
+
+	FCombatDamageEvent& Event = PendingEvents.AddDefaulted_GetRef();
+	Event.Instigator = DamageInstigator;
+	Event.Location = Location;
+	Event.DamageTenths = static_cast<uint16>(FMath::Min(FMath::RoundToInt((ShieldDamage + HealthDamage) * 10.f), static_cast<int32>(MAX_uint16)));
+	Event.NumHits = static_cast<uint8>(FMath::Clamp(NumHits, 1, static_cast<int32>(MAX_uint8)));
+	Event.bShieldBroken = bShieldBroken;
+	Event.bKilled = bKilled;
+	SetComponentTickEnabled(true);
+
+	return ShieldDamage + HealthDamage;
+}
+
+bool UCombatStateComponent::Restore(float HealthAmount, float ShieldAmount)
+{
+	if (GetOwnerRole() != ROLE_Authority || Health <= 0.f)
+	{
+		return false;
+	}
+
+	const float NewHealth = FMath::Min(Health + FMath::Max(HealthAmount, 0.f), MaxHealth);
+	const float NewShield = FMath::Min(Shield + FMath::Max(ShieldAmount, 0.f), MaxShield);
+	if (NewHealth == Health && NewShield == Shield)
+	{
+		return false;
+	}
+	SetVitals(NewHealth, NewShield, false);
+	return true;
+}
+
+void UCombatStateComponent::ResetVitals()
+{
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		SetVitals(MaxHealth, FMath::Min(StartingShield, MaxShield), true);
+	}
+}
+
+void UCombatStateComponent::SetVitals(float NewHealth, float NewShield, bool bUrgent)
+{
+	Health = FMath::Clamp(NewHealth, 0.f, MaxHealth);
+	Shield = FMath::Clamp(NewShield, 0.f, MaxShield);
+
+	FCombatVitals Vitals;
+	Vitals.Health = FCombatVitals::Quantize(Health, MaxHealth);
+	Vitals.Shield = FCombatVitals::Quantize(Shield, MaxShield);
+	if (Vitals != OwnerVitals)
+	{
+		OwnerVitals = Vitals;
+		MARK_PROPERTY_DIRTY_FROM_NAME(UCombatStateComponent, OwnerVitals, this);
+	}
+
+	//Everyone else gets the latest value when the interval is up, the steps in between are never sent
+	bProxyVitalsPending = OwnerVitals != ProxyVitals;
+	if (bProxyVitalsPending)
+	{
+		if (bUrgent || GetWorld()->GetTimeSeconds() >= NextProxyUpdateTime)
+		{
+			FlushProxyVitals();
+		}
+		else
+		{
+			SetComponentTickEnabled(true);
+		}
+	}
+
+	OnVitalsChanged.Broadcast(*this);
+}
+
+void UCombatStateComponent::FlushProxyVitals()
+{
+	ProxyVitals = OwnerVitals;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UCombatStateComponent, ProxyVitals, this);
+	bProxyVitalsPending = false;
+	NextProxyUpdateTime = GetWorld()->GetTimeSeconds() + ProxyUpdateInterval;
+}
+
+void UCombatStateComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (PendingEvents.Num() > 0)
+	{
+		const int32 NumToSend = FMath::Min(PendingEvents.Num(), FMath::Max(MaxEventsPerFrame, 1));
+		if (NumToSend == PendingEvents.Num())
+		{
+			MulticastDamageEvents(PendingEvents);
+			PendingEvents.Reset();
+		}
+		else
+		{
+			MulticastDamageEvents(TArray<FCombatDamageEvent>(PendingEvents.GetData(), NumToSend));
+			PendingEvents.RemoveAt(0, NumToSend);
+		}
+	}
+
+	if (bProxyVitalsPending && GetWorld()->GetTimeSeconds() >= NextProxyUpdateTime)
+	{
+		FlushProxyVitals();
+	}
+
+	if (PendingEvents.Num() == 0 && !bProxyVitalsPending)
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+void UCombatStateComponent::MulticastDamageEvents_Implementation(const TArray<FCombatDamageEvent>& Events)
+{
+	OnDamageEvents.Broadcast(*this, Events);
+}
+
+void UCombatStateComponent::OnRep_OwnerVitals()
+{
+	OnVitalsChanged.Broadcast(*this);
+}
+
+void UCombatStateComponent::OnRep_ProxyVitals()
+{
+	OnVitalsChanged.Broadcast(*this);
+}
+
+const FCombatVitals& UCombatStateComponent::GetReplicatedVitals() const
+{
+	return GetOwnerRole() == ROLE_AutonomousProxy ? OwnerVitals : ProxyVitals;
+}
+
+float UCombatStateComponent::GetHealth() const
+{
+	return GetOwnerRole() == ROLE_Authority ? Health : FCombatVitals::Dequantize(GetReplicatedVitals().Health, MaxHealth);
+}
+
+float UCombatStateComponent::GetShield() const
+{
+	return GetOwnerRole() == ROLE_Authority ? Shield : FCombatVitals::Dequantize(GetReplicatedVitals().Shield, MaxShield);
+}
@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "CombatStateComponent.generated.h"
+
+class APawn;
+class UCombatStateComponent;
+
+/**
+ * Health and shield as fractions of the component's maximums in 1/1023 steps, 0.1 points at a maximum of 100.
+ * Serializes to 20 bits; the maximums are class defaults and never sent.
+ */
+USTRUCT()
+struct FCombatVitals
+{
+	GENERATED_BODY()
+
+	static constexpr uint32 Steps = 1023;
+
+	uint16 Health = Steps;
+	uint16 Shield = 0;
+
+	static uint16 Quantize(float Value, float Max) { return Max > 0.f ? static_cast<uint16>(FMath::RoundToInt(FMath::Clamp(Value / Max, 0.f, 1.f) * Steps)) : 0; }
+	static float Dequantize(uint16 Value, float Max) { return Max * Value / Steps; }
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FCombatVitals& Other) const { return Health == Other.Health && Shield == Other.Shield; }
+	bool operator!=(const FCombatVitals& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FCombatVitals> : public TStructOpsTypeTraitsBase2<FCombatVitals>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/** Everything one instigator did to a character in one frame, for hit markers and damage numbers */
+USTRUCT()
+struct FCombatDamageEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<APawn> Instigator;
+
+	/** Of the first hit */
+	UPROPERTY()
+	FVector_NetQuantize Location{FVector::ZeroVector};
+
+	/** Shield and health taken together, in tenths of a point */
+	UPROPERTY()
+	uint16 DamageTenths = 0;
+
+	UPROPERTY()
+	uint8 NumHits = 0;
+
+	UPROPERTY()
+	uint8 bShieldBroken : 1;
+
+	UPROPERTY()
+	uint8 bKilled : 1;
+
+	FCombatDamageEvent() : bShieldBroken(false), bKilled(false) {}
+
+	float GetDamage() const { return DamageTenths * 0.1f; }
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnCombatVitalsChanged, const UCombatStateComponent& /*CombatState*/);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnCombatDamageEvents, const UCombatStateComponent& /*CombatState*/, const TArray<FCombatDamageEvent>& /*Events*/);
+
+/**
+ * Health and shield of a character. The server keeps exact values and replicates them quantized in FCombatVitals,
+ * through two push model copies: OwnerVitals goes to the owning client on every change, for its HUD; ProxyVitals
+ * goes to everyone else at most every ProxyUpdateInterval, for overhead bars, except that breaking the shield or
+ * dying goes out at once. Neither is compared for changes unless it was marked dirty. Characters that aren't relevant
+ * to a connection get nothing, and far ones come after near ones when the connection is saturated, like the rest
+ * of the actor.
+ * Damage taken during a frame is queued and goes out in one reliable multicast per character at the end of it
+ * (the component only ticks while something is queued).
+ */
+UCLASS(config=Game, ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class MPTESTING_CPLUSPLUS_API UCombatStateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCombatStateComponent();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Server only. Shield takes damage first. Returns how much was actually taken */
+	float ApplyDamage(float Damage, APawn* DamageInstigator, const FVector& Location, int32 NumHits = 1);
+
+	/** Server only. Adds up to the maximums, false when there was nothing to add */
+	bool Restore(float HealthAmount, float ShieldAmount);
+
+	/** Server only. Back to full health and the starting shield */
+	void ResetVitals();
+
+	UFUNCTION(BlueprintPure, Category = "Combat")
+	float GetHealth() const;
+
+	UFUNCTION(BlueprintPure, Category = "Combat")
+	float GetShield() const;
+
+	UFUNCTION(BlueprintPure, Category = "Combat")
+	float GetMaxHealth() const { return MaxHealth; }
+
+	UFUNCTION(BlueprintPure, Category = "Combat")
+	float GetMaxShield() const { return MaxShield; }
+
+	UFUNCTION(BlueprintPure, Category = "Combat")
+	bool IsAlive() const { return GetHealth() > 0.f; }
+
+	/** Whenever health or shield change, on the server and on clients as they receive them */
+	FOnCombatVitalsChanged OnVitalsChanged;
+
+	/** Once per frame with that frame's damage, on the server and on every client the character is relevant to */
+	FOnCombatDamageEvents OnDamageEvents;
+
+protected:
+	virtual void BeginPlay() override;
+
+	UFUNCTION()
+	void OnRep_OwnerVitals();
+
+	UFUNCTION()
+	void OnRep_ProxyVitals();
+
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastDamageEvents(const TArray<FCombatDamageEvent>& Events);
+
+private:
+	/** The replicated copy this machine reads from */
+	const FCombatVitals& GetReplicatedVitals() const;
+	void SetVitals(float NewHealth, float NewShield, bool bUrgent);
+	void FlushProxyVitals();
+
+	UPROPERTY(Config)
+	float MaxHealth{100.f};
+
+	UPROPERTY(Config)
+	float MaxShield{100.f};
+
+	UPROPERTY(Config)
+	float StartingShield{100.f};
+
+	/** Simulated proxies see health and shield this often at most */
+	UPROPERTY(Config)
+	float ProxyUpdateInterval{0.25f};
+
+	/** Damage events one multicast carries at most, the rest wait for the next frame */
+	UPROPERTY(Config)
+	int32 MaxEventsPerFrame{16};
+
+	UPROPERTY(ReplicatedUsing = OnRep_OwnerVitals)
+	FCombatVitals OwnerVitals;
+
+	UPROPERTY(ReplicatedUsing = OnRep_ProxyVitals)
+	FCombatVitals ProxyVitals;
+
+	/** Server only, exact */
+	float Health{0.f};
+	float Shield{0.f};
+
+	bool bProxyVitalsPending{false};
+	double NextProxyUpdateTime{0.0};
+	TArray<FCombatDamageEvent> PendingEvents;
+};
@@ -0,0 +1,524 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InputReplaySubsystem.h"
+
+#include "EnhancedInputComponent.h"
+#include "EnhancedInputSubsystems.h"
+#include "InputAction.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "MPTesting_CPlusPlus.h"
+
+namespace InputReplay
+{
+	static int32 GetNumAxes(EInputActionValueType ValueType)
+	{
+		switch (ValueType)
+		{
+		case EInputActionValueType::Axis2D:
+			return 2;
+		case EInputActionValueType::Axis3D:
+			return 3;
+		default:
+			return 1;
+		}
+	}
+}
+
+///
+///FInputRecording
+///
+
+bool FInputRecording::Save(const FString& FileName) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	const_cast<FInputRecording*>(this)->Serialize(Writer);
+	return FFileHelper::SaveArrayToFile(Bytes, *FileName);
+}
+
+bool FInputRecording::Load(const FString& FileName)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FileName))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	Serialize(Reader);
+	return !Reader.IsError();
+}
+
+void FInputRecording::Serialize(FArchive& Ar)
+{
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	Ar << FileMagic << FileVersion;
+	if (FileMagic != Magic || FileVersion != Version)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << StartLocation << StartRotation << StartControlRotation << EndLocation << Duration;
+
+	int32 NumActions = Actions.Num();
+	Ar << NumActions;
+	if (Ar.IsLoading())
+	{
+		if (NumActions < 0 || NumActions > MAX_uint8 + 1)
+		{
+			Ar.SetError();
+			return;
+		}
+		Actions.SetNum(NumActions);
+	}
+	for (FAction& Action : Actions)
+	{
+		uint8 ValueType = static_cast<uint8>(Action.ValueType);
+		uint8 bAccumulate = Action.bAccumulate ? 1 : 0;
+		Ar << Action.Path << ValueType << bAccumulate;
+		Action.ValueType = static_cast<EInputActionValueType>(ValueType);
+		Action.bAccumulate = bAccumulate != 0;
+	}
+
+	int32 NumEvents = Events.Num();
+	Ar << NumEvents;
+	if (Ar.IsLoading())
+	{
+		//Smallest event is 9 bytes, anything claiming more than the file holds is corrupt
+		if (NumEvents < 0 || NumEvents > (Ar.TotalSize() - Ar.Tell()) / 9)
+		{
+			Ar.SetError();
+			return;
+		}
+		Events.SetNum(NumEvents);
+	}
+	for (FEvent& Event : Events)
+	{
+		Ar << Event.Time << Event.Action;
+		if (!Actions.IsValidIndex(Event.Action))
+		{
+			Ar.SetError();
+			return;
+		}
+		for (int32 Axis = 0; Axis < InputReplay::GetNumAxes(Actions[Event.Action].ValueType); ++Axis)
+		{
+			Ar << Event.Value[Axis];
+		}
+	}
+}
+
+///
+///UInputReplaySubsystem
+///
+
+bool UInputReplaySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//Nobody plays on a dedicated server
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UInputReplaySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FString ReplayFile;
+	if (FParse::Value(FCommandLine::Get(), TEXT("InputReplay="), ReplayFile))
+	{
+		float Fps = 60.f;
+		FParse::Value(FCommandLine::Get(), TEXT("InputReplayFps="), Fps);
+		StartReplay(ReplayFile, Fps, FParse::Param(FCommandLine::Get(), TEXT("InputReplayExit")));
+	}
+}
+
+void UInputReplaySubsystem::Deinitialize()
+{
+	if (bRecording)
+	{
+		StopRecording();
+	}
+	if (bReplaying)
+	{
+		FinishReplay(nullptr);
+	}
+	bReplayPending = false;
+
+	Super::Deinitialize();
+}
+
+TStatId UInputReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInputReplaySubsystem, STATGROUP_Tickables);
+}
+
+FString UInputReplaySubsystem::GetDefaultRecordingFile()
+{
+	return FPaths::ProjectSavedDir() / TEXT("InputRecordings") / FDateTime::Now().ToString() + TEXT(".inputrec");
+}
+
+void UInputReplaySubsystem::BindRecorder(UEnhancedInputComponent& InputComponent, const UInputAction* Action, bool bAccumulate)
+{
+	if (Action == nullptr)
+	{
+		return;
+	}
+
+	RecordedActions.Add(Action, bAccumulate);
+	InputComponent.BindAction(Action, ETriggerEvent::Triggered, this, &ThisClass::OnRecordedInput);
+	if (!bAccumulate)
+	{
+		//Released, the held value goes back to zero
+		InputComponent.BindAction(Action, ETriggerEvent::Completed, this, &ThisClass::OnRecordedInput);
+	}
+}
+
+APlayerController* UInputReplaySubsystem::GetLocalPlayerController() const
+{
+	UWorld* World = GetWorld();
+	return World ? World->GetFirstPlayerController() : nullptr;
+}
+
+bool UInputReplaySubsystem::StartRecording(const FString& FileName)
+{
+	const APlayerController* PlayerController = GetLocalPlayerController();
+	const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (bRecording || IsReplaying() || Pawn == nullptr)
+	{
+		return false;
+	}
+
+	Recording = FInputRecording();
+	Recording.StartLocation = Pawn->GetActorLocation();
+	Recording.StartRotation = Pawn->GetActorRotation();
+	Recording.StartControlRotation = PlayerController->GetControlRotation();
+	RecordingFile = FileName;
+	RecordingStartTime = GetWorld()->GetTimeSeconds();
+	LastHeldValues.Reset();
+	bRecording = true;
+	return true;
+}
+
+bool UInputReplaySubsystem::StopRecording()
+{
+	if (!bRecording)
+	{
+		return false;
+	}
+	bRecording = false;
+
+	const APlayerController* PlayerController = GetLocalPlayerController();
+	const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	Recording.EndLocation = Pawn ? Pawn->GetActorLocation() : Recording.StartLocation;
+	Recording.Duration = GetWorld()->GetTimeSeconds() - RecordingStartTime;
+
+	if (!Recording.Save(RecordingFile))
+	{
+		UE_LOG(LogCombat, Warning, TEXT("Could not write the input recording to %s"), *RecordingFile);
+		return false;
+	}
+	UE_LOG(LogCombat, Display, TEXT("Input recording: %.1f s, %d events in %s (%lld bytes)"),
+		Recording.Duration, Recording.Events.Num(), *RecordingFile, IFileManager::Get().FileSize(*RecordingFile));
+	return true;
+}
+
+void UInputReplaySubsystem::OnRecordedInput(const FInputActionInstance& Instance)
+{
+	const UInputAction* Action = Instance.GetSourceAction();
+	const bool* bAccumulate = bRecording ? RecordedActions.Find(Action) : nullptr;
+	if (bAccumulate == nullptr)
+	{
+		return;
+	}
+
+	const FString Path = Action->GetPathName();
+	int32 ActionIndex = Recording.Actions.IndexOfByPredicate([&Path](const FInputRecording::FAction& Recorded) { return Recorded.Path == Path; });
+	if (ActionIndex == INDEX_NONE)
+	{
+		if (Recording.Actions.Num() > MAX_uint8)
+		{
+			return;
+		}
+		ActionIndex = Recording.Actions.Add({Path, Instance.GetValue().GetValueType(), *bAccumulate});
+	}
+
+	const FVector3f Value = Instance.GetTriggerEvent() == ETriggerEvent::Completed ? FVector3f::ZeroVector : FVector3f(Instance.GetValue().Get<FVector>());
+	if (*bAccumulate)
+	{
+		if (Value.IsZero())
+		{
+			return;
+		}
+	}
+	else
+	{
+		//Held values are recorded when they change, Triggered fires every frame while held
+		FVector3f* LastValue = LastHeldValues.Find(ActionIndex);
+		if (LastValue ? LastValue->Equals(Value, UE_KINDA_SMALL_NUMBER) : Value.IsZero())
+		{
+			return;
+		}
+		LastHeldValues.Add(ActionIndex, Value);
+	}
+
+	Recording.Events.Add({static_cast<float>(GetWorld()->GetTimeSeconds() - RecordingStartTime), static_cast<uint8>(ActionIndex), Value});
+}
+
+bool UInputReplaySubsystem::StartReplay(const FString& FileName, float Fps, bool bExitWhenDone)
+{
+	if (bRecording || IsReplaying())
+	{
+		return false;
+	}
+
+	if (!Recording.Load(FileName))
+	{
+		UE_LOG(LogCombat, Warning, TEXT("Could not read an input recording from %s"), *FileName);
+		return false;
+	}
+
+	ReplayActions.Reset();
+	for (const FInputRecording::FAction& Action : Recording.Actions)
+	{
+		UInputAction* InputAction = LoadObject<UInputAction>(nullptr, *Action.Path);
+		if (InputAction == nullptr)
+		{
+			UE_LOG(LogCombat, Warning, TEXT("Input action %s of the recording does not load, its events are skipped"), *Action.Path);
+		}
+		ReplayActions.Add(InputAction);
+	}
+
+	ReplayFps = Fps;
+	bExitWhenReplayDone = bExitWhenDone;
+	bReplayPending = true;
+	return true;
+}
+
+void UInputReplaySubsystem::BeginReplay(APlayerController& PlayerController)
+{
+	bReplayPending = false;
+	bReplaying = true;
+
+	//Same start as the recording, standalone; a server would correct it
+	PlayerController.GetPawn()->TeleportTo(Recording.StartLocation, Recording.StartRotation);
+	PlayerController.SetControlRotation(Recording.StartControlRotation);
+
+	bWasFixedTimeStep = FApp::UseFixedTimeStep();
+	WasFixedDeltaTime = FApp::GetFixedDeltaTime();
+	if (ReplayFps > 0.f)
+	{
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(1.0 / ReplayFps);
+	}
+
+	ReplayValues.Init(FVector3f::ZeroVector, Recording.Actions.Num());
+	ReplayTime = 0.0;
+	NextReplayEvent = 0;
+	ReplayFrames = 0;
+	ReplayTimedFrames = 0;
+	WorldTickTimer.Start(GetWorld());
+	ReplayGameThreadMs = 0.0;
+	ReplayMaxGameThreadMs = 0.0;
+	ReplayStartRealTime = FPlatformTime::Seconds();
+
+	UE_LOG(LogCombat, Display, TEXT("Replaying %.1f s of input, %d events, at %s"),
+		Recording.Duration, Recording.Events.Num(), ReplayFps > 0.f ? *FString::Printf(TEXT("%.0f fps fixed"), ReplayFps) : TEXT("the current timestep"));
+}
+
+void UInputReplaySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bReplayPending && !bReplaying)
+	{
+		return;
+	}
+
+	APlayerController* PlayerController = GetLocalPlayerController();
+	const bool bHasPawn = PlayerController && PlayerController->GetPawn();
+	if (bReplayPending)
+	{
+		if (bHasPawn)
+		{
+			BeginReplay(*PlayerController);
+		}
+	}
+	else if (bHasPawn)
+	{
+		TickReplay(*PlayerController, DeltaTime);
+	}
+	else
+	{
+		FinishReplay(PlayerController);
+	}
+}
+
+void UInputReplaySubsystem::TickReplay(APlayerController& PlayerController, float DeltaTime)
+{
+	if (WorldTickTimer.GetNumTicks() > 0)
+	{
+		const double GameThreadMs = WorldTickTimer.GetLastTickMs();
+		ReplayGameThreadMs += GameThreadMs;
+		ReplayMaxGameThreadMs = FMath::Max(ReplayMaxGameThreadMs, GameThreadMs);
+		++ReplayTimedFrames;
+	}
+	++ReplayFrames;
+
+	ReplayTime += DeltaTime;
+	while (NextReplayEvent < Recording.Events.Num() && Recording.Events[NextReplayEvent].Time <= ReplayTime)
+	{
+		const FInputRecording::FEvent& Event = Recording.Events[NextReplayEvent++];
+		if (Recording.Actions[Event.Action].bAccumulate)
+		{
+			ReplayValues[Event.Action] += Event.Value;
+		}
+		else
+		{
+			ReplayValues[Event.Action] = Event.Value;
+		}
+	}
+
+	//Injected values go through the actions' triggers and the character's bindings on the next input update
+	UEnhancedInputLocalPlayerSubsystem* InputSubsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController.GetLocalPlayer());
+	for (int32 ActionIndex = 0; InputSubsystem && ActionIndex < ReplayActions.Num(); ++ActionIndex)
+	{
+		FVector3f& Value = ReplayValues[ActionIndex];
+		if (ReplayActions[ActionIndex] && !Value.IsZero())
+		{
+			InputSubsystem->InjectInputForAction(ReplayActions[ActionIndex], FInputActionValue(Recording.Actions[ActionIndex].ValueType, FVector(Value)), {}, {});
+		}
+		if (Recording.Actions[ActionIndex].bAccumulate)
+		{
+			Value = FVector3f::ZeroVector;
+		}
+	}
+
+	if (NextReplayEvent >= Recording.Events.Num() && ReplayTime >= Recording.Duration)
+	{
+		FinishReplay(&PlayerController);
+	}
+}
+
+void UInputReplaySubsystem::FinishReplay(APlayerController* PlayerController)
+{
+	bReplaying = false;
+	WorldTickTimer.Stop();
+	FApp::SetUseFixedTimeStep(bWasFixedTimeStep);
+	FApp::SetFixedDeltaTime(WasFixedDeltaTime);
+
+	const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	const int32 TimedFrames = FMath::Max(ReplayTimedFrames, 1);
+	UE_LOG(LogCombat, Display, TEXT("Input replay: %d frames, %.1f s game time in %.1f s, GT %.2f ms avg %.2f ms max, end %.1f cm from the recording's"),
+		ReplayFrames, ReplayTime, FPlatformTime::Seconds() - ReplayStartRealTime, ReplayGameThreadMs / TimedFrames, ReplayMaxGameThreadMs,
+		Pawn ? FVector::Dist(Pawn->GetActorLocation(), Recording.EndLocation) : -1.f);
+	if (const UNetConnection* Connection = PlayerController ? PlayerController->GetNetConnection() : nullptr)
+	{
+		UE_LOG(LogCombat, Display, TEXT("Input replay net: %.1f ms rtt, %d B/s in, %d B/s out"), Connection->AvgLag * 1000.0, Connection->InBytesPerSecond, Connection->OutBytesPerSecond);
+	}
+
+	if (bExitWhenReplayDone)
+	{
+		FPlatformMisc::RequestExit(false, TEXT("InputReplay"));
+	}
+}
+
+///
+///Input.Record [File=], Input.StopRecording, Input.Replay File= [Fps=60] [Exit]
+///
+namespace InputReplay
+{
+	static UInputReplaySubsystem* GetSubsystem(UWorld* World, FOutputDevice& Ar)
+	{
+		UInputReplaySubsystem* InputReplay = World ? World->GetSubsystem<UInputReplaySubsystem>() : nullptr;
+		if (InputReplay == nullptr)
+		{
+			Ar.Log(TEXT("No input replay in this world"));
+		}
+		return InputReplay;
+	}
+
+	static void Record(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UInputReplaySubsystem* InputReplay = GetSubsystem(World, Ar);
+		if (InputReplay == nullptr)
+		{
+			return;
+		}
+
+		FString FileName = UInputReplaySubsystem::GetDefaultRecordingFile();
+		FParse::Value(*FString::Join(Args, TEXT(" ")), TEXT("File="), FileName);
+		if (InputReplay->StartRecording(FileName))
+		{
+			Ar.Logf(TEXT("Recording input to %s, Input.StopRecording to save"), *FileName);
+		}
+		else
+		{
+			Ar.Log(TEXT("Can't record now: already recording or replaying, or no local pawn"));
+		}
+	}
+
+	static void StopRecording(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UInputReplaySubsystem* InputReplay = GetSubsystem(World, Ar);
+		if (InputReplay && !InputReplay->StopRecording())
+		{
+			Ar.Log(TEXT("Not recording"));
+		}
+	}
+
+	static void Replay(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UInputReplaySubsystem* InputReplay = GetSubsystem(World, Ar);
+		if (InputReplay == nullptr)
+		{
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		FString FileName;
+		float Fps = 60.f;
+		if (!FParse::Value(*Params, TEXT("File="), FileName))
+		{
+			Ar.Log(TEXT("Input.Replay File=<recording> [Fps=60] [Exit]"));
+			return;
+		}
+		FParse::Value(*Params, TEXT("Fps="), Fps);
+
+		if (!InputReplay->StartReplay(FileName, Fps, Args.Contains(TEXT("Exit"))))
+		{
+			Ar.Logf(TEXT("Can't replay %s"), *FileName);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice RecordCommand(
+		TEXT("Input.Record"),
+		TEXT("Records the local player's input actions until Input.StopRecording. File="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Record));
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice StopRecordingCommand(
+		TEXT("Input.StopRecording"),
+		TEXT("Saves the input recording"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&StopRecording));
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice ReplayCommand(
+		TEXT("Input.Replay"),
+		TEXT("Plays an input recording back at a fixed timestep and logs frame and movement numbers. File= Fps= Exit"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Replay));
+}
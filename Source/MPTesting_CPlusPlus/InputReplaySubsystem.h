@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InputActionValue.h"
+#include "MultiplayerWorldTickTimer.h"
+#include "InputReplaySubsystem.generated.h"
+
+class APlayerController;
+class UEnhancedInputComponent;
+class UInputAction;
+struct FInputActionInstance;
+
+/**
+ * A recorded play session: the input action values the character's bindings received, timestamped from the start
+ * of the recording, and where the pawn started and ended. Saved as a small binary file, an event is 5 bytes plus
+ * 4 per value axis.
+ */
+struct MPTESTING_CPLUSPLUS_API FInputRecording
+{
+	static constexpr uint32 Magic = 0x5249504D; //"MPIR"
+	static constexpr uint32 Version = 1;
+
+	struct FAction
+	{
+		FString Path;
+		EInputActionValueType ValueType{EInputActionValueType::Boolean};
+		/** Values are per frame deltas (mouse look) and add up, otherwise the latest value holds until the next */
+		bool bAccumulate{false};
+	};
+
+	struct FEvent
+	{
+		float Time{0.f};
+		uint8 Action{0};
+		FVector3f Value{FVector3f::ZeroVector};
+	};
+
+	FVector StartLocation{FVector::ZeroVector};
+	FRotator StartRotation{FRotator::ZeroRotator};
+	FRotator StartControlRotation{FRotator::ZeroRotator};
+	FVector EndLocation{FVector::ZeroVector};
+	float Duration{0.f};
+
+	TArray<FAction> Actions;
+	/** In time order */
+	TArray<FEvent> Events;
+
+	bool Save(const FString& FileName) const;
+	bool Load(const FString& FileName);
+
+	void Serialize(FArchive& Ar);
+};
+
+/**
+ * Records the local player's Enhanced Input actions to a file and plays them back at a fixed timestep, so the same
+ * play session runs on every build and frame, movement and network numbers compare. The character binds the
+ * recorder next to its own Move/Look/Jump bindings; playback injects the values into the same actions, so they go
+ * through the character's real bindings. At the end of a replay the averages and the drift from the recorded end
+ * location go to LogCombat.
+ * "Input.Record [File=]", "Input.StopRecording" and "Input.Replay File= [Fps=60] [Exit]" from the console;
+ * -InputReplay=<file> [-InputReplayFps=60] [-InputReplayExit] plays back at startup, e.g. with -nullrhi.
+ * Not created on dedicated servers.
+ */
+UCLASS()
+class MPTESTING_CPLUSPLUS_API UInputReplaySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Adds the recorder's binding for Action, from SetupPlayerInputComponent */
+	void BindRecorder(UEnhancedInputComponent& InputComponent, const UInputAction* Action, bool bAccumulate);
+
+	bool StartRecording(const FString& FileName);
+	bool StopRecording();
+
+	/** Plays FileName back once the local player has a pawn. Fps above 0 fixes the timestep for the replay */
+	bool StartReplay(const FString& FileName, float Fps, bool bExitWhenDone);
+
+	bool IsRecording() const { return bRecording; }
+	bool IsReplaying() const { return bReplayPending || bReplaying; }
+
+	static FString GetDefaultRecordingFile();
+
+private:
+	void OnRecordedInput(const FInputActionInstance& Instance);
+	APlayerController* GetLocalPlayerController() const;
+	void BeginReplay(APlayerController& PlayerController);
+	void TickReplay(APlayerController& PlayerController, float DeltaTime);
+	void FinishReplay(APlayerController* PlayerController);
+
+	FInputRecording Recording;
+	FString RecordingFile;
+	bool bRecording{false};
+	double RecordingStartTime{0.0};
+	TMap<const UInputAction*, bool> RecordedActions;
+	/** Last recorded value of the held actions, unchanged values are not recorded again */
+	TMap<uint8, FVector3f> LastHeldValues;
+
+	///
+	///Replay state: actions resolved from the recording, the values held and added up this frame
+	///
+	bool bReplayPending{false};
+	bool bReplaying{false};
+	bool bExitWhenReplayDone{false};
+	float ReplayFps{60.f};
+	bool bWasFixedTimeStep{false};
+	double WasFixedDeltaTime{0.0};
+	double ReplayTime{0.0};
+	int32 NextReplayEvent{0};
+	TArray<FVector3f> ReplayValues;
+
+	/** Index for index with the recording's actions, null where an action no longer loads */
+	UPROPERTY()
+	TArray<TObjectPtr<UInputAction>> ReplayActions;
+
+	int32 ReplayFrames{0};
+	/** GT ms are the world's tick, timed from the second replay frame on */
+	FMultiplayerWorldTickTimer WorldTickTimer;
+	int32 ReplayTimedFrames{0};
+	double ReplayGameThreadMs{0.0};
+	double ReplayMaxGameThreadMs{0.0};
+	double ReplayStartRealTime{0.0};
+};
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/Parse.h"
+#include "MPTesting_CPlusPlus.h"
+
+///
+///Measures what lag compensation costs a server, on a FLagCompensationHistory shaped like the world's
+///ULagCompensationSubsystem (or its defaults) filled with synthetic players running in circles:
+///  LagCompensation.Bench [Players=100] [Frames=600] [FireRate=2] [TickRate=60] [Seed=1]
+///Record is the per frame cost of writing every player into the ring, not counting the bone reads of the real
+///capture (see STAT_LagCompensationRecord for those). Rewind and Trace are the cost of one hit validation. Every
+///player fires FireRate validated shots a second, spread over the frames, so the per frame line is what recording
+///and validating together take out of each server tick.
+///
+namespace LagCompensationBench
+{
+	static FLagCompensationPose GetPose(int32 Player, double Time, int32 NumHitboxes)
+	{
+		//Everyone circles the origin at their own radius and speed, fast enough for interpolation to matter
+		const double Radius = 500.0 + 50.0 * Player;
+		const double Angle = Player * 0.7 + Time * (0.5 + 0.01 * Player);
+
+		FLagCompensationPose Pose;
+		Pose.CapsuleCenter = FVector(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), 96.0);
+		Pose.CapsuleHalfHeight = 96.f;
+		for (int32 Hitbox = 0; Hitbox < NumHitboxes; ++Hitbox)
+		{
+			Pose.HitboxCenters[Hitbox] = Pose.CapsuleCenter + FVector(0.0, 0.0, 70.0 - 40.0 * Hitbox);
+		}
+		return Pose;
+	}
+
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const FString Params = FString::Join(Args, TEXT(" "));
+		int32 NumPlayers = 100;
+		int32 NumFrames = 600;
+		float FireRate = 2.f;
+		float TickRate = 60.f;
+		int32 Seed = 1;
+		FParse::Value(*Params, TEXT("Players="), NumPlayers);
+		FParse::Value(*Params, TEXT("Frames="), NumFrames);
+		FParse::Value(*Params, TEXT("FireRate="), FireRate);
+		FParse::Value(*Params, TEXT("TickRate="), TickRate);
+		FParse::Value(*Params, TEXT("Seed="), Seed);
+		NumPlayers = FMath::Max(NumPlayers, 2);
+		NumFrames = FMath::Max(NumFrames, 1);
+		FireRate = FMath::Max(FireRate, 0.f);
+		TickRate = FMath::Max(TickRate, 1.f);
+
+		//Same shape as the live subsystem, so the numbers are the ones a server would see
+		const ULagCompensationSubsystem* Subsystem = World ? World->GetSubsystem<ULagCompensationSubsystem>() : nullptr;
+		const ULagCompensationSubsystem* Settings = Subsystem ? Subsystem : GetDefault<ULagCompensationSubsystem>();
+		TArray<float> HitboxRadii = Settings->GetHitboxRadii();
+		const double MaxRewindSeconds = Settings->GetMaxRewindSeconds();
+
+		FLagCompensationHistory History;
+		History.Init(FMath::Max(Settings->GetMaxCharacters(), NumPlayers), Settings->GetHistoryFrames(), HitboxRadii);
+		const int32 NumHitboxes = History.GetNumHitboxes();
+		for (int32 Player = 0; Player < NumPlayers; ++Player)
+		{
+			History.AddSlot(42.f, GetPose(Player, 0.0, NumHitboxes));
+		}
+
+		TArray<FLagCompensationPose> Poses;
+		Poses.SetNum(NumPlayers);
+		FRandomStream Random(Seed);
+		FLagCompensationFrame RewoundFrame;
+		const double ShotsPerFrame = NumPlayers * FireRate / TickRate;
+		double PendingShots = 0.0;
+		double RecordMs = 0.0;
+		double MaxRecordMs = 0.0;
+		double RewindMs = 0.0;
+		double TraceMs = 0.0;
+		double MaxValidationMs = 0.0;
+		double MaxFrameMs = 0.0;
+		int32 NumQueries = 0;
+		int32 NumHits = 0;
+		double Time = 0.0;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			Time += 1.0 / TickRate;
+			for (int32 Player = 0; Player < NumPlayers; ++Player)
+			{
+				Poses[Player] = GetPose(Player, Time, NumHitboxes);
+			}
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			History.AddFrame(Time);
+			for (int32 Player = 0; Player < NumPlayers; ++Player)
+			{
+				History.WriteSlot(Player, Poses[Player]);
+			}
+			const double FrameRecordMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+			RecordMs += FrameRecordMs;
+			MaxRecordMs = FMath::Max(MaxRecordMs, FrameRecordMs);
+
+			//This frame's shots: a random shooter fires at where a random target was somewhere within the rewind cap
+			double FrameValidationMs = 0.0;
+			PendingShots += ShotsPerFrame;
+			for (; PendingShots >= 1.0; PendingShots -= 1.0)
+			{
+				const int32 Shooter = Random.RandRange(0, NumPlayers - 1);
+				const int32 Target = (Shooter + Random.RandRange(1, NumPlayers - 1)) % NumPlayers;
+				const double QueryTime = FMath::Max(Time - Random.FRandRange(0.f, static_cast<float>(MaxRewindSeconds)), History.GetOldestTime());
+				const FVector Start = GetPose(Shooter, QueryTime, NumHitboxes).CapsuleCenter;
+				const FVector Aim = GetPose(Target, QueryTime, NumHitboxes).CapsuleCenter;
+				const FVector End = Start + (Aim - Start).GetSafeNormal() * 20000.0;
+
+				const uint64 QueryStartCycles = FPlatformTime::Cycles64();
+				History.Rewind(QueryTime, RewoundFrame);
+				const uint64 RewoundCycles = FPlatformTime::Cycles64();
+				FLagCompensationHistory::FHit Hit;
+				NumHits += History.Trace(RewoundFrame, Start, End, Shooter, Hit) ? 1 : 0;
+				const uint64 TracedCycles = FPlatformTime::Cycles64();
+
+				RewindMs += FPlatformTime::ToMilliseconds64(RewoundCycles - QueryStartCycles);
+				TraceMs += FPlatformTime::ToMilliseconds64(TracedCycles - RewoundCycles);
+				FrameValidationMs += FPlatformTime::ToMilliseconds64(TracedCycles - QueryStartCycles);
+				++NumQueries;
+			}
+			MaxValidationMs = FMath::Max(MaxValidationMs, FrameValidationMs);
+			MaxFrameMs = FMath::Max(MaxFrameMs, FrameRecordMs + FrameValidationMs);
+		}
+
+		const int32 BytesPerFrame = NumPlayers * (4 + 3 * NumHitboxes) * sizeof(float);
+		const int32 Queries = FMath::Max(NumQueries, 1);
+		const double FrameMs = (RecordMs + RewindMs + TraceMs) / NumFrames;
+		UE_LOG(LogCombat, Display, TEXT("Lag compensation bench: %d players, %d hitboxes, %d slots x %d frames at %.0f Hz, rewind cap %.0f ms"),
+			NumPlayers, NumHitboxes, History.GetMaxSlots(), Settings->GetHistoryFrames(), TickRate, MaxRewindSeconds * 1000.0);
+		UE_LOG(LogCombat, Display, TEXT("Memory: history %llu KB, rewound frame %llu KB, %d bytes written per frame"),
+			static_cast<uint64>(History.GetAllocatedSize() / 1024), static_cast<uint64>(RewoundFrame.Rows.GetAllocatedSize() / 1024), BytesPerFrame);
+		UE_LOG(LogCombat, Display, TEXT("Record: %.2f us per frame (max %.2f us) over %d frames"),
+			RecordMs * 1000.0 / NumFrames, MaxRecordMs * 1000.0, NumFrames);
+		UE_LOG(LogCombat, Display, TEXT("Validation: rewind %.2f us, trace %.2f us per query over %d queries, %d hit"),
+			RewindMs * 1000.0 / Queries, TraceMs * 1000.0 / Queries, NumQueries, NumHits);
+		UE_LOG(LogCombat, Display, TEXT("Per frame with %.1f shots each: record %.2f us + rewind %.2f us + trace %.2f us = %.2f us (max %.2f us, validation max %.2f us), %.2f%% of the %.2f ms tick"),
+			ShotsPerFrame, RecordMs * 1000.0 / NumFrames, RewindMs * 1000.0 / NumFrames, TraceMs * 1000.0 / NumFrames, FrameMs * 1000.0,
+			MaxFrameMs * 1000.0, MaxValidationMs * 1000.0, FrameMs * TickRate / 10.0, 1000.0 / TickRate);
+		Ar.Log(TEXT("Lag compensation bench done, results are in LogCombat"));
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("LagCompensation.Bench"),
+		TEXT("Times lag compensation recording and hit validation, per query and per server frame. Players= Frames= FireRate= TickRate= Seed="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
@@ -0,0 +1,439 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationSubsystem.h"
+
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "Math/VectorRegister.h"
+#include "MPTesting_CPlusPlus.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_LagCompensationRecord, STATGROUP_Combat);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Trace"), STAT_LagCompensationTrace, STATGROUP_Combat);
+
+namespace LagCompensation
+{
+	/** Where along Start + T * Delta the segment enters the sphere, 0 if it starts inside */
+	static bool SegmentSphereEntry(const FVector& Start, const FVector& Delta, const FVector& Center, double Radius, double& OutT)
+	{
+		const FVector ToStart = Start - Center;
+		const double C = ToStart.SizeSquared() - Radius * Radius;
+		if (C <= 0.0)
+		{
+			OutT = 0.0;
+			return true;
+		}
+
+		const double A = Delta.SizeSquared();
+		const double B = ToStart | Delta;
+		if (B >= 0.0 || A <= UE_SMALL_NUMBER)
+		{
+			return false;
+		}
+
+		const double Discriminant = B * B - A * C;
+		if (Discriminant < 0.0)
+		{
+			return false;
+		}
+
+		OutT = (-B - FMath::Sqrt(Discriminant)) / A;
+		return OutT <= 1.0;
+	}
+}
+
+///
+///FLagCompensationHistory
+///
+
+void FLagCompensationHistory::Init(int32 InMaxSlots, int32 InNumFrames, TConstArrayView<float> InHitboxRadii)
+{
+	MaxSlots = Align(FMath::Max(InMaxSlots, 1), 4);
+	NumFrames = FMath::Max(InNumFrames, 2);
+	NumHitboxes = FMath::Min(InHitboxRadii.Num(), LagCompensation::MaxHitboxes);
+	NumRows = 4 + 3 * NumHitboxes;
+	FrameStride = NumRows * MaxSlots;
+
+	MaxHitboxRadius = 0.f;
+	for (int32 Hitbox = 0; Hitbox < NumHitboxes; ++Hitbox)
+	{
+		HitboxRadii[Hitbox] = InHitboxRadii[Hitbox];
+		MaxHitboxRadius = FMath::Max(MaxHitboxRadius, HitboxRadii[Hitbox]);
+	}
+
+	Samples.SetNumZeroed(NumFrames * FrameStride);
+	FrameTimes.SetNumZeroed(NumFrames);
+	CapsuleRadii.SetNumZeroed(MaxSlots);
+	SlotsInUse.Init(false, MaxSlots);
+	NewestFrame = 0;
+	NumRecordedFrames = 0;
+	NumSlotsInUse = 0;
+	SlotEnd = 0;
+}
+
+int32 FLagCompensationHistory::AddSlot(float CapsuleRadius, const FLagCompensationPose& Pose)
+{
+	//Lowest free slot, keeps the slots in use packed at the front where rewinds look
+	const int32 Slot = SlotsInUse.Find(false);
+	if (Slot == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	SlotsInUse[Slot] = true;
+	++NumSlotsInUse;
+	CapsuleRadii[Slot] = CapsuleRadius;
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		WriteSlotToFrame(GetFrameRows(Frame), Slot, Pose);
+	}
+	UpdateSlotEnd();
+	return Slot;
+}
+
+void FLagCompensationHistory::RemoveSlot(int32 Slot)
+{
+	if (!IsSlotInUse(Slot))
+	{
+		return;
+	}
+
+	SlotsInUse[Slot] = false;
+	--NumSlotsInUse;
+	UpdateSlotEnd();
+}
+
+void FLagCompensationHistory::UpdateSlotEnd()
+{
+	const int32 LastInUse = SlotsInUse.FindLast(true);
+	SlotEnd = Align(LastInUse + 1, 4);
+}
+
+void FLagCompensationHistory::AddFrame(double Time)
+{
+	NewestFrame = (NewestFrame + 1) % NumFrames;
+	NumRecordedFrames = FMath::Min(NumRecordedFrames + 1, NumFrames);
+	FrameTimes[NewestFrame] = Time;
+}
+
+void FLagCompensationHistory::WriteSlot(int32 Slot, const FLagCompensationPose& Pose)
+{
+	WriteSlotToFrame(GetFrameRows(NewestFrame), Slot, Pose);
+}
+
+void FLagCompensationHistory::WriteSlotToFrame(float* FrameRows, int32 Slot, const FLagCompensationPose& Pose)
+{
+	float* Column = FrameRows + Slot;
+	Column[0] = static_cast<float>(Pose.CapsuleCenter.X);
+	Column[MaxSlots] = static_cast<float>(Pose.CapsuleCenter.Y);
+	Column[2 * MaxSlots] = static_cast<float>(Pose.CapsuleCenter.Z);
+	Column[3 * MaxSlots] = Pose.CapsuleHalfHeight;
+	for (int32 Hitbox = 0; Hitbox < NumHitboxes; ++Hitbox)
+	{
+		float* HitboxColumn = Column + (4 + 3 * Hitbox) * MaxSlots;
+		HitboxColumn[0] = static_cast<float>(Pose.HitboxCenters[Hitbox].X);
+		HitboxColumn[MaxSlots] = static_cast<float>(Pose.HitboxCenters[Hitbox].Y);
+		HitboxColumn[2 * MaxSlots] = static_cast<float>(Pose.HitboxCenters[Hitbox].Z);
+	}
+}
+
+bool FLagCompensationHistory::Rewind(double Time, FLagCompensationFrame& OutFrame) const
+{
+	if (NumRecordedFrames == 0)
+	{
+		return false;
+	}
+
+	//Walk back from the newest frame to the first one at or before Time
+	int32 Newer = NewestFrame;
+	int32 Older = NewestFrame;
+	for (int32 Age = 0; Age < NumRecordedFrames; ++Age)
+	{
+		const int32 Frame = (NewestFrame + NumFrames - Age) % NumFrames;
+		Newer = Older;
+		Older = Frame;
+		if (FrameTimes[Frame] <= Time)
+		{
+			break;
+		}
+	}
+
+	const double OlderTime = FrameTimes[Older];
+	const double NewerTime = FrameTimes[Newer];
+	double Alpha = 0.0;
+	if (Newer != Older && NewerTime > OlderTime)
+	{
+		Alpha = FMath::Clamp((Time - OlderTime) / (NewerTime - OlderTime), 0.0, 1.0);
+	}
+	OutFrame.Time = FMath::Lerp(OlderTime, NewerTime, Alpha);
+
+	if (OutFrame.Stride != MaxSlots || OutFrame.Rows.Num() != FrameStride)
+	{
+		OutFrame.Stride = MaxSlots;
+		OutFrame.Rows.SetNumZeroed(FrameStride);
+	}
+
+	//Older + (Newer - Older) * Alpha, four slots at a time, only over the slots in use
+	const VectorRegister4Float VectorAlpha = VectorSetFloat1(static_cast<float>(Alpha));
+	const float* OlderRows = GetFrameRows(Older);
+	const float* NewerRows = GetFrameRows(Newer);
+	float* OutRows = OutFrame.Rows.GetData();
+	for (int32 Row = 0; Row < NumRows; ++Row)
+	{
+		const int32 RowStart = Row * MaxSlots;
+		for (int32 Slot = 0; Slot < SlotEnd; Slot += 4)
+		{
+			const VectorRegister4Float A = VectorLoadAligned(OlderRows + RowStart + Slot);
+			const VectorRegister4Float B = VectorLoadAligned(NewerRows + RowStart + Slot);
+			VectorStoreAligned(VectorMultiplyAdd(VectorSubtract(B, A), VectorAlpha, A), OutRows + RowStart + Slot);
+		}
+	}
+	return true;
+}
+
+bool FLagCompensationHistory::Trace(const FLagCompensationFrame& Frame, const FVector& Start, const FVector& End, int32 IgnoreSlot, FHit& OutHit) const
+{
+	const FVector Delta = End - Start;
+	OutHit = FHit();
+
+	for (int32 Slot = 0; Slot < SlotEnd; ++Slot)
+	{
+		if (!SlotsInUse[Slot] || Slot == IgnoreSlot)
+		{
+			continue;
+		}
+
+		//Capsule first: only characters the trace comes near get their hitboxes tested
+		const FVector CapsuleCenter = Frame.GetCapsuleCenter(Slot);
+		const float CapsuleRadius = CapsuleRadii[Slot];
+		const FVector CapsuleOffset(0.0, 0.0, FMath::Max(Frame.GetCapsuleHalfHeight(Slot) - CapsuleRadius, 0.f));
+		FVector OnTrace;
+		FVector OnCapsule;
+		FMath::SegmentDistToSegmentSafe(Start, End, CapsuleCenter - CapsuleOffset, CapsuleCenter + CapsuleOffset, OnTrace, OnCapsule);
+		if (FVector::DistSquared(OnTrace, OnCapsule) > FMath::Square(CapsuleRadius + MaxHitboxRadius))
+		{
+			continue;
+		}
+
+		double Fraction = 0.0;
+		if (NumHitboxes == 0)
+		{
+			if (LagCompensation::SegmentSphereEntry(Start, Delta, OnCapsule, CapsuleRadius, Fraction) && Fraction < OutHit.Fraction)
+			{
+				OutHit.Slot = Slot;
+				OutHit.Hitbox = INDEX_NONE;
+				OutHit.Fraction = Fraction;
+			}
+			continue;
+		}
+
+		for (int32 Hitbox = 0; Hitbox < NumHitboxes; ++Hitbox)
+		{
+			if (LagCompensation::SegmentSphereEntry(Start, Delta, Frame.GetHitboxCenter(Slot, Hitbox), HitboxRadii[Hitbox], Fraction) && Fraction < OutHit.Fraction)
+			{
+				OutHit.Slot = Slot;
+				OutHit.Hitbox = Hitbox;
+				OutHit.Fraction = Fraction;
+			}
+		}
+	}
+
+	if (OutHit.Slot == INDEX_NONE)
+	{
+		return false;
+	}
+	OutHit.Location = Start + Delta * OutHit.Fraction;
+	return true;
+}
+
+SIZE_T FLagCompensationHistory::GetAllocatedSize() const
+{
+	return Samples.GetAllocatedSize() + FrameTimes.GetAllocatedSize() + CapsuleRadii.GetAllocatedSize() + SlotsInUse.GetAllocatedSize();
+}
+
+///
+///ULagCompensationSubsystem
+///
+
+bool ULagCompensationSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void ULagCompensationSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Clients never validate hits
+	const ENetMode NetMode = InWorld.GetNetMode();
+	if (NetMode != NM_DedicatedServer && NetMode != NM_ListenServer)
+	{
+		return;
+	}
+
+	if (Hitboxes.Num() > LagCompensation::MaxHitboxes)
+	{
+		UE_LOG(LogCombat, Warning, TEXT("%d lag compensation hitboxes configured, only the first %d are used"), Hitboxes.Num(), LagCompensation::MaxHitboxes);
+	}
+
+	History.Init(MaxCharacters, HistoryFrames, GetHitboxRadii());
+	SlotCharacters.SetNum(History.GetMaxSlots());
+	SlotBoneIndices.Init(INDEX_NONE, History.GetMaxSlots() * LagCompensation::MaxHitboxes);
+	bActive = true;
+}
+
+void ULagCompensationSubsystem::Deinitialize()
+{
+	bActive = false;
+	SlotCharacters.Empty();
+	SlotBoneIndices.Empty();
+
+	Super::Deinitialize();
+}
+
+TArray<float> ULagCompensationSubsystem::GetHitboxRadii() const
+{
+	TArray<float> Radii;
+	for (int32 Hitbox = 0; Hitbox < FMath::Min(Hitboxes.Num(), LagCompensation::MaxHitboxes); ++Hitbox)
+	{
+		Radii.Add(Hitboxes[Hitbox].Radius);
+	}
+	return Radii;
+}
+
+void ULagCompensationSubsystem::RegisterCharacter(ACharacter* Character)
+{
+	if (!bActive || Character == nullptr || SlotCharacters.Contains(Character))
+	{
+		return;
+	}
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	int32 BoneIndices[LagCompensation::MaxHitboxes];
+	for (int32 Hitbox = 0; Hitbox < History.GetNumHitboxes(); ++Hitbox)
+	{
+		BoneIndices[Hitbox] = Mesh ? Mesh->GetBoneIndex(Hitboxes[Hitbox].Bone) : INDEX_NONE;
+	}
+
+	//Its history until now is where it is now
+	FLagCompensationPose Pose;
+	CapturePose(*Character, BoneIndices, Pose);
+	const int32 Slot = History.AddSlot(Character->GetCapsuleComponent()->GetScaledCapsuleRadius(), Pose);
+	if (Slot == INDEX_NONE)
+	{
+		UE_LOG(LogCombat, Warning, TEXT("Lag compensation is full (%d characters), %s will not be hit validated"), MaxCharacters, *Character->GetName());
+		return;
+	}
+
+	SlotCharacters[Slot] = Character;
+	FMemory::Memcpy(&SlotBoneIndices[Slot * LagCompensation::MaxHitboxes], BoneIndices, History.GetNumHitboxes() * sizeof(int32));
+
+	//Dedicated servers render nothing, without this the hitbox bones would never move
+	if (Mesh && History.GetNumHitboxes() > 0)
+	{
+		Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+	}
+}
+
+void ULagCompensationSubsystem::UnregisterCharacter(ACharacter* Character)
+{
+	const int32 Slot = SlotCharacters.IndexOfByKey(Character);
+	if (Slot == INDEX_NONE || Character == nullptr)
+	{
+		return;
+	}
+
+	History.RemoveSlot(Slot);
+	SlotCharacters[Slot].Reset();
+}
+
+void ULagCompensationSubsystem::CapturePose(const ACharacter& Character, const int32* BoneIndices, FLagCompensationPose& OutPose) const
+{
+	const UCapsuleComponent* Capsule = Character.GetCapsuleComponent();
+	OutPose.CapsuleCenter = Capsule->GetComponentLocation();
+	OutPose.CapsuleHalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+
+	const USkeletalMeshComponent* Mesh = Character.GetMesh();
+	for (int32 Hitbox = 0; Hitbox < History.GetNumHitboxes(); ++Hitbox)
+	{
+		//A mesh without the bone still gets a hitbox, in the middle of the capsule
+		OutPose.HitboxCenters[Hitbox] = Mesh && BoneIndices[Hitbox] != INDEX_NONE ? Mesh->GetBoneTransform(BoneIndices[Hitbox]).GetLocation() : OutPose.CapsuleCenter;
+	}
+}
+
+void ULagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bActive)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRecord);
+
+	//Tickables run after all tick groups, so this is the pose everyone ends the frame in
+	History.AddFrame(GetWorld()->GetTimeSeconds());
+	FLagCompensationPose Pose;
+	for (int32 Slot = 0; Slot < SlotCharacters.Num(); ++Slot)
+	{
+		if (!History.IsSlotInUse(Slot))
+		{
+			continue;
+		}
+
+		const ACharacter* Character = SlotCharacters[Slot].Get();
+		if (Character == nullptr)
+		{
+			History.RemoveSlot(Slot);
+			continue;
+		}
+
+		CapturePose(*Character, &SlotBoneIndices[Slot * LagCompensation::MaxHitboxes], Pose);
+		History.WriteSlot(Slot, Pose);
+	}
+}
+
+TStatId ULagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+bool ULagCompensationSubsystem::TraceRewound(const FVector& Start, const FVector& End, double ServerTime, const ACharacter* Shooter, FLagCompensatedHit& OutHit)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationTrace);
+
+	OutHit = FLagCompensatedHit();
+	if (!bActive)
+	{
+		return false;
+	}
+
+	const double OldestAllowed = GetWorld()->GetTimeSeconds() - GetMaxRewindSeconds();
+	if (ServerTime < OldestAllowed)
+	{
+		ServerTime = OldestAllowed;
+		++NumClampedRewinds;
+	}
+
+	if (!History.Rewind(ServerTime, RewoundFrame))
+	{
+		return false;
+	}
+
+	const int32 ShooterSlot = Shooter ? SlotCharacters.IndexOfByKey(Shooter) : INDEX_NONE;
+	FLagCompensationHistory::FHit Hit;
+	if (!History.Trace(RewoundFrame, Start, End, ShooterSlot, Hit))
+	{
+		return false;
+	}
+
+	OutHit.Character = SlotCharacters[Hit.Slot].Get();
+	OutHit.Bone = Hit.Hitbox != INDEX_NONE ? Hitboxes[Hit.Hitbox].Bone : NAME_None;
+	OutHit.Location = Hit.Location;
+	OutHit.RewoundTime = RewoundFrame.Time;
+	return OutHit.Character != nullptr;
+}
@@ -0,0 +1,208 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Containers/BitArray.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class ACharacter;
+
+namespace LagCompensation
+{
+	static constexpr int32 MaxHitboxes = 8;
+}
+
+/** Where one character was on one server frame */
+struct FLagCompensationPose
+{
+	FVector CapsuleCenter{FVector::ZeroVector};
+	float CapsuleHalfHeight{0.f};
+	FVector HitboxCenters[LagCompensation::MaxHitboxes];
+};
+
+/** Every character's pose at one moment, same layout as a frame of FLagCompensationHistory */
+struct FLagCompensationFrame
+{
+	double Time{0.0};
+	/** Floats per row */
+	int32 Stride{0};
+	TArray<float, TAlignedHeapAllocator<16>> Rows;
+
+	FVector GetCapsuleCenter(int32 Slot) const { return FVector(Rows[Slot], Rows[Stride + Slot], Rows[2 * Stride + Slot]); }
+	float GetCapsuleHalfHeight(int32 Slot) const { return Rows[3 * Stride + Slot]; }
+	FVector GetHitboxCenter(int32 Slot, int32 Hitbox) const
+	{
+		const int32 Row = 4 + 3 * Hitbox;
+		return FVector(Rows[Row * Stride + Slot], Rows[(Row + 1) * Stride + Slot], Rows[(Row + 2) * Stride + Slot]);
+	}
+};
+
+/**
+ * Fixed-size ring of the last NumFrames server frames of up to MaxSlots characters, laid out struct-of-arrays:
+ * per frame, one row of floats per component (capsule X, Y, Z, half height, then X, Y, Z of every hitbox) holding
+ * that component for every slot. Rewinding all characters to a time is then a handful of 4-wide lerps per row.
+ * Positions are stored as floats, plenty for the few km a map spans.
+ * Memory is NumFrames * (4 + 3 * hitboxes) * MaxSlots * 4 bytes, allocated once in Init: with the defaults
+ * (64 frames, 3 hitboxes, 128 slots) that is 416 KB, and one frame of 100 players writes about 5 KB of it.
+ * Hitboxes are spheres on bones, so their center is all there is to their transform. Knows nothing of actors,
+ * see ULagCompensationSubsystem for that.
+ */
+class MPTESTING_CPLUSPLUS_API FLagCompensationHistory
+{
+public:
+	struct FHit
+	{
+		int32 Slot{INDEX_NONE};
+		/** INDEX_NONE when the capsule itself was hit, which only happens without hitboxes */
+		int32 Hitbox{INDEX_NONE};
+		/** How far along the trace, 0 to 1 */
+		double Fraction{1.0};
+		FVector Location{FVector::ZeroVector};
+	};
+
+	void Init(int32 InMaxSlots, int32 InNumFrames, TConstArrayView<float> InHitboxRadii);
+	bool IsInitialized() const { return NumFrames > 0; }
+
+	/** Takes a free slot and fills its whole history with Pose, so rewinding past its spawn finds it where it spawned. INDEX_NONE when full */
+	int32 AddSlot(float CapsuleRadius, const FLagCompensationPose& Pose);
+	void RemoveSlot(int32 Slot);
+	bool IsSlotInUse(int32 Slot) const { return SlotsInUse.IsValidIndex(Slot) && SlotsInUse[Slot]; }
+	int32 GetNumSlotsInUse() const { return NumSlotsInUse; }
+
+	/** Starts a new frame at Time, over the oldest one once the ring is full. Every slot in use gets written into it */
+	void AddFrame(double Time);
+	void WriteSlot(int32 Slot, const FLagCompensationPose& Pose);
+
+	/** Interpolates every slot to Time, clamped to the recorded frames. False before the first frame */
+	bool Rewind(double Time, FLagCompensationFrame& OutFrame) const;
+
+	/** Nearest hitbox (or capsule) of a slot in use that Start-End passes through in Frame */
+	bool Trace(const FLagCompensationFrame& Frame, const FVector& Start, const FVector& End, int32 IgnoreSlot, FHit& OutHit) const;
+
+	double GetNewestTime() const { return NumRecordedFrames > 0 ? FrameTimes[NewestFrame] : 0.0; }
+	double GetOldestTime() const { return NumRecordedFrames > 0 ? FrameTimes[(NewestFrame + NumFrames - NumRecordedFrames + 1) % NumFrames] : 0.0; }
+	int32 GetMaxSlots() const { return MaxSlots; }
+	int32 GetNumHitboxes() const { return NumHitboxes; }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	float* GetFrameRows(int32 Frame) { return Samples.GetData() + Frame * FrameStride; }
+	const float* GetFrameRows(int32 Frame) const { return Samples.GetData() + Frame * FrameStride; }
+	void WriteSlotToFrame(float* FrameRows, int32 Slot, const FLagCompensationPose& Pose);
+	void UpdateSlotEnd();
+
+	/** Padded to a multiple of 4 so rows stay 16 byte aligned */
+	int32 MaxSlots{0};
+	int32 NumHitboxes{0};
+	int32 NumRows{0};
+	int32 NumFrames{0};
+	int32 FrameStride{0};
+
+	int32 NewestFrame{0};
+	int32 NumRecordedFrames{0};
+
+	/** One past the highest slot in use, rounded up to 4: rewinds stop here */
+	int32 SlotEnd{0};
+	int32 NumSlotsInUse{0};
+
+	TArray<float, TAlignedHeapAllocator<16>> Samples;
+	TArray<double> FrameTimes;
+	TArray<float> CapsuleRadii;
+	TBitArray<> SlotsInUse;
+	float HitboxRadii[LagCompensation::MaxHitboxes]{};
+	float MaxHitboxRadius{0.f};
+};
+
+USTRUCT()
+struct FLagCompensationHitbox
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	FName Bone;
+
+	UPROPERTY(Config)
+	float Radius{10.f};
+};
+
+/** Result of ULagCompensationSubsystem::TraceRewound */
+struct FLagCompensatedHit
+{
+	ACharacter* Character{nullptr};
+	/** Bone of the hitbox, NAME_None for the capsule */
+	FName Bone;
+	FVector Location{FVector::ZeroVector};
+	/** Server time the characters were rewound to, after clamping */
+	double RewoundTime{0.0};
+};
+
+/**
+ * Server side lag compensation. Every server frame the capsule and hitboxes of each registered character go into a
+ * FLagCompensationHistory; a hit validation rewinds them all to the time the shooter saw and traces against that.
+ * Rewinds are capped at MaxRewindMs, so a laggy or lying client can not shoot at where someone was a second ago.
+ * Only answers which character a shot hit; whether world geometry was in the way is up to the caller.
+ * Servers only, inactive on clients and standalone. "LagCompensation.Bench" measures the per frame cost.
+ */
+UCLASS(config=Game)
+class MPTESTING_CPLUSPLUS_API ULagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterCharacter(ACharacter* Character);
+	void UnregisterCharacter(ACharacter* Character);
+	/** Its bones are recorded every frame, whoever throttles its mesh stales its hitboxes */
+	bool IsCharacterRegistered(const ACharacter* Character) const { return Character && SlotCharacters.Contains(Character); }
+
+	/**
+	 * Traces Start-End against every registered character but Shooter as they were at ServerTime (world time seconds).
+	 * ServerTime is clamped to MaxRewindMs before now.
+	 */
+	bool TraceRewound(const FVector& Start, const FVector& End, double ServerTime, const ACharacter* Shooter, FLagCompensatedHit& OutHit);
+
+	const FLagCompensationHistory& GetHistory() const { return History; }
+	float GetMaxRewindSeconds() const { return MaxRewindMs / 1000.f; }
+	int32 GetNumClampedRewinds() const { return NumClampedRewinds; }
+
+	/** Hitbox radii from config, for the benchmark to build the same history */
+	TArray<float> GetHitboxRadii() const;
+	int32 GetMaxCharacters() const { return MaxCharacters; }
+	int32 GetHistoryFrames() const { return HistoryFrames; }
+
+private:
+	void CapturePose(const ACharacter& Character, const int32* BoneIndices, FLagCompensationPose& OutPose) const;
+
+	UPROPERTY(Config)
+	int32 MaxCharacters{128};
+
+	/** Frames kept, at least MaxRewindMs worth at the server tick rate */
+	UPROPERTY(Config)
+	int32 HistoryFrames{64};
+
+	UPROPERTY(Config)
+	float MaxRewindMs{250.f};
+
+	/** Bone spheres tested for hits, at most LagCompensation::MaxHitboxes. None leaves only the capsule */
+	UPROPERTY(Config)
+	TArray<FLagCompensationHitbox> Hitboxes;
+
+	bool bActive{false};
+	int32 NumClampedRewinds{0};
+
+	FLagCompensationHistory History;
+	FLagCompensationFrame RewoundFrame;
+
+	///
+	///Per slot: the character and the bone index of each hitbox on its mesh
+	///
+	TArray<TWeakObjectPtr<ACharacter>> SlotCharacters;
+	TArray<int32> SlotBoneIndices;
+};
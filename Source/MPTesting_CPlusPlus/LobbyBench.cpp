@@ -0,0 +1,348 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BotPlayerSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Parse.h"
+#include "MultiplayerWorldTickTimer.h"
+#include "RenderCore.h"
+#include "LobbyGameMode.h"
+#include "MPTesting_CPlusPlusCharacter.h"
+#include "MPTesting_CPlusPlus.h"
+
+///
+///Frame cost of a full lobby, cheap avatars against full characters:
+///  Lobby.Bench [Players=100] [Seconds=10]
+///On the lobby's server it fills the lobby to Players with bots, spawned as avatars, then respawns them with
+///Lobby.AvatarMode 0 as full characters, and measures each for Seconds once they had a few seconds to spawn and
+///replicate. Players already there keep the pawn they have. On a client it runs for Seconds * 6 and measures
+///whenever it sees Players - 1 remote characters that are all avatars, or none of them, so start it on the clients
+///first and then on the server. Each summary goes to LogCombat at the end.
+///
+namespace LobbyBench
+{
+	static constexpr float SettleSeconds = 3.f;
+	/** How often the client looks at what the server has spawned */
+	static constexpr float ClassifyInterval = 0.5f;
+
+	struct FPhase
+	{
+		const TCHAR* Name{TEXT("")};
+		bool bAvatars{false};
+		int32 NumFrames{0};
+		double FrameMs{0.0};
+		TArray<float> WorldTickMs;
+		double RenderThreadMs{0.0};
+		int32 NumCharacters{0};
+		int32 NumAvatars{0};
+	};
+
+	static void LogPhases(const TCHAR* Role, int32 Players, TArray<FPhase>& Phases)
+	{
+		UE_LOG(LogCombat, Display, TEXT("Lobby bench on the %s: %d players"), Role, Players);
+		UE_LOG(LogCombat, Display, TEXT("%8s %8s %10s %10s %10s %10s %10s %10s"),
+			TEXT("Pawns"), TEXT("Frames"), TEXT("Frame ms"), TEXT("GT ms"), TEXT("GT p99"), TEXT("RT ms"), TEXT("Characters"), TEXT("Avatars"));
+		for (FPhase& Phase : Phases)
+		{
+			Phase.WorldTickMs.Sort();
+			double TickSum = 0.0;
+			for (const float Ms : Phase.WorldTickMs)
+			{
+				TickSum += Ms;
+			}
+			const int32 Frames = FMath::Max(Phase.NumFrames, 1);
+			const int32 Ticks = Phase.WorldTickMs.Num();
+			const float P99 = Ticks > 0 ? Phase.WorldTickMs[FMath::Clamp(FMath::CeilToInt(0.99 * Ticks) - 1, 0, Ticks - 1)] : 0.f;
+			UE_LOG(LogCombat, Display, TEXT("%8s %8d %10.2f %10.2f %10.2f %10.2f %10d %10d"),
+				Phase.Name, Phase.NumFrames, Phase.FrameMs / Frames, Ticks > 0 ? TickSum / Ticks : 0.0, P99,
+				Phase.RenderThreadMs / Frames, Phase.NumCharacters, Phase.NumAvatars);
+		}
+	}
+
+	static void CountCharacters(UWorld* World, bool bRemoteOnly, int32& OutCharacters, int32& OutAvatars)
+	{
+		OutCharacters = 0;
+		OutAvatars = 0;
+		for (TActorIterator<AMPTesting_CPlusPlusCharacter> It(World); It; ++It)
+		{
+			if (!bRemoteOnly || !It->IsLocallyControlled())
+			{
+				++OutCharacters;
+				OutAvatars += It->IsLobbyAvatar() ? 1 : 0;
+			}
+		}
+	}
+
+	/** Common to both ends: a ticker, the world tick timer and the frames it times */
+	class FBenchBase : public TSharedFromThis<FBenchBase>
+	{
+	public:
+		FBenchBase(UWorld* InWorld, int32 InPlayers, float InSeconds)
+			: World(InWorld)
+			, Players(InPlayers)
+			, Seconds(InSeconds)
+		{
+			Phases.Add({TEXT("Avatars"), true});
+			Phases.Add({TEXT("Full"), false});
+		}
+
+		virtual ~FBenchBase() = default;
+
+		void Start()
+		{
+			WorldTickTimer.Start(World.Get());
+			OnStart();
+			TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FBenchBase::Tick));
+		}
+
+	protected:
+		virtual void OnStart() {}
+		/** False once done */
+		virtual bool Update(float DeltaTime) = 0;
+		virtual void OnFinish() = 0;
+
+		void Sample(FPhase& Phase, float DeltaTime)
+		{
+			Phase.FrameMs += DeltaTime * 1000.0;
+			Phase.RenderThreadMs += FPlatformTime::ToMilliseconds(GRenderThreadTime);
+			++Phase.NumFrames;
+			//A server frame can go by without a world tick while it waits for the next one
+			if (WorldTickTimer.GetNumTicks() != LastNumTicks)
+			{
+				LastNumTicks = WorldTickTimer.GetNumTicks();
+				Phase.WorldTickMs.Add(static_cast<float>(WorldTickTimer.GetLastTickMs()));
+			}
+		}
+
+		TWeakObjectPtr<UWorld> World;
+		int32 Players{0};
+		float Seconds{0.f};
+		TArray<FPhase> Phases;
+		uint64 LastNumTicks{0};
+
+	private:
+		bool Tick(float DeltaTime)
+		{
+			if (World.IsValid() && Update(DeltaTime))
+			{
+				return true;
+			}
+			Finish();
+			return false;
+		}
+
+		void Finish();
+
+		FMultiplayerWorldTickTimer WorldTickTimer;
+		FTSTicker::FDelegateHandle TickerHandle;
+	};
+
+	static TSharedPtr<FBenchBase> ActiveBench;
+
+	void FBenchBase::Finish()
+	{
+		WorldTickTimer.Stop();
+		OnFinish();
+
+		//Runs from our own ticker, which keeps us alive until it returns
+		ActiveBench.Reset();
+	}
+
+	/** Fills the lobby with bots and switches them from avatars to full characters */
+	class FServerBench : public FBenchBase
+	{
+	public:
+		using FBenchBase::FBenchBase;
+
+	private:
+		virtual void OnStart() override
+		{
+			UBotPlayerSubsystem* Bots = World->GetSubsystem<UBotPlayerSubsystem>();
+			BotsBefore = Bots->GetNumBots();
+			bAvatarModeBefore = IConsoleManager::Get().FindConsoleVariable(TEXT("Lobby.AvatarMode"))->GetBool();
+
+			//Everyone who isn't one of our bots stays, the bots make up the rest
+			Bots->SetNumBots(0);
+			int32 NumHumans = 0;
+			for (const APlayerState* PlayerState : World->GetGameState()->PlayerArray)
+			{
+				NumHumans += PlayerState && !PlayerState->IsABot() ? 1 : 0;
+			}
+			NumBots = FMath::Max(Players - NumHumans, 0);
+			StartPhase();
+		}
+
+		void StartPhase()
+		{
+			PhaseTime = 0.0;
+			IConsoleManager::Get().FindConsoleVariable(TEXT("Lobby.AvatarMode"))->Set(Phases[PhaseIndex].bAvatars ? 1 : 0, ECVF_SetByConsole);
+			UBotPlayerSubsystem* Bots = World->GetSubsystem<UBotPlayerSubsystem>();
+			Bots->SetNumBots(0);
+			Bots->SetNumBots(NumBots);
+		}
+
+		virtual bool Update(float DeltaTime) override
+		{
+			FPhase& Phase = Phases[PhaseIndex];
+			PhaseTime += DeltaTime;
+			if (PhaseTime < SettleSeconds)
+			{
+				return true;
+			}
+			if (PhaseTime < SettleSeconds + Seconds)
+			{
+				Sample(Phase, DeltaTime);
+				return true;
+			}
+
+			CountCharacters(World.Get(), false, Phase.NumCharacters, Phase.NumAvatars);
+			if (++PhaseIndex >= Phases.Num())
+			{
+				return false;
+			}
+			StartPhase();
+			return true;
+		}
+
+		virtual void OnFinish() override
+		{
+			IConsoleManager::Get().FindConsoleVariable(TEXT("Lobby.AvatarMode"))->Set(bAvatarModeBefore ? 1 : 0, ECVF_SetByConsole);
+			if (World.IsValid())
+			{
+				if (UBotPlayerSubsystem* Bots = World->GetSubsystem<UBotPlayerSubsystem>())
+				{
+					Bots->SetNumBots(0);
+					Bots->SetNumBots(BotsBefore);
+				}
+			}
+
+			const UNetDriver* NetDriver = World.IsValid() ? World->GetNetDriver() : nullptr;
+			UE_LOG(LogCombat, Display, TEXT("%d bots, %d connections, %.0f s per run"),
+				NumBots, NetDriver ? NetDriver->ClientConnections.Num() : 0, Seconds);
+			LogPhases(TEXT("server"), Players, Phases);
+		}
+
+		int32 NumBots{0};
+		int32 BotsBefore{0};
+		bool bAvatarModeBefore{true};
+		int32 PhaseIndex{0};
+		double PhaseTime{0.0};
+	};
+
+	/** Follows whatever the server has spawned, the remote characters say which phase it is in */
+	class FClientBench : public FBenchBase
+	{
+	public:
+		using FBenchBase::FBenchBase;
+
+	private:
+		virtual bool Update(float DeltaTime) override
+		{
+			ElapsedTime += DeltaTime;
+			if (ElapsedTime >= Seconds * 6.f)
+			{
+				return false;
+			}
+
+			ClassifyTime += DeltaTime;
+			if (ClassifyTime >= ClassifyInterval)
+			{
+				ClassifyTime = 0.f;
+				int32 NumCharacters = 0;
+				int32 NumAvatars = 0;
+				CountCharacters(World.Get(), true, NumCharacters, NumAvatars);
+
+				int32 NewPhase = INDEX_NONE;
+				if (NumCharacters >= Players - 1)
+				{
+					NewPhase = NumAvatars == NumCharacters ? 0 : NumAvatars == 0 ? 1 : INDEX_NONE;
+				}
+				if (NewPhase != PhaseIndex)
+				{
+					PhaseIndex = NewPhase;
+					StableTime = 0.0;
+				}
+				if (PhaseIndex != INDEX_NONE)
+				{
+					Phases[PhaseIndex].NumCharacters = NumCharacters;
+					Phases[PhaseIndex].NumAvatars = NumAvatars;
+				}
+			}
+
+			StableTime += DeltaTime;
+			if (PhaseIndex != INDEX_NONE && StableTime >= SettleSeconds)
+			{
+				Sample(Phases[PhaseIndex], DeltaTime);
+			}
+			return true;
+		}
+
+		virtual void OnFinish() override
+		{
+			LogPhases(TEXT("client"), Players, Phases);
+		}
+
+		int32 PhaseIndex{INDEX_NONE};
+		double ElapsedTime{0.0};
+		double StableTime{0.0};
+		float ClassifyTime{0.f};
+	};
+
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (ActiveBench.IsValid())
+		{
+			Ar.Log(TEXT("A lobby bench is already running"));
+			return;
+		}
+		if (World == nullptr || World->GetNetMode() == NM_Standalone)
+		{
+			Ar.Log(TEXT("Needs a lobby server or a client connected to one"));
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		int32 Players = 100;
+		float Seconds = 10.f;
+		FParse::Value(*Params, TEXT("Players="), Players);
+		FParse::Value(*Params, TEXT("Seconds="), Seconds);
+		Players = FMath::Max(Players, 2);
+		Seconds = FMath::Max(Seconds, 1.f);
+
+		if (World->GetNetMode() == NM_Client)
+		{
+			Ar.Logf(TEXT("Measuring while %d players are in the lobby, for %.0f s, results are logged when done"), Players, Seconds * 6.f);
+			ActiveBench = MakeShared<FClientBench>(World, Players, Seconds);
+			ActiveBench->Start();
+			return;
+		}
+
+		const UBotPlayerSubsystem* Bots = World->GetSubsystem<UBotPlayerSubsystem>();
+		if (World->GetAuthGameMode<ALobbyGameMode>() == nullptr || Bots == nullptr || !Bots->IsActive())
+		{
+			Ar.Log(TEXT("Run it in the lobby, the other maps spawn full characters either way"));
+			return;
+		}
+		if (Players > Bots->GetMaxBots())
+		{
+			Ar.Logf(TEXT("At most %d bots, see MaxBots"), Bots->GetMaxBots());
+			return;
+		}
+
+		Ar.Logf(TEXT("Filling the lobby to %d players, as avatars and then full characters, results are logged when done"), Players);
+		ActiveBench = MakeShared<FServerBench>(World, Players, Seconds);
+		ActiveBench->Start();
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("Lobby.Bench"),
+		TEXT("Server and client frame cost with a full lobby, avatars against full characters. Players= Seconds="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
@@ -5,60 +5,319 @@
 
 #include "GameFramework/GameStateBase.h"
 #include "GameFramework/PlayerState.h"
+#include "GameFramework/GameSession.h"
+#include "OnlineSessionSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "OnlineBeaconHost.h"
+#include "MultiplayerReservationBeaconHost.h"
+#include "MultiplayerOnlineServices.h"
+#include "MultiplayerSessionSubsystem.h"
+#include "MultiplayerTelemetry.h"
+#include "MultiplayerJoinFunnel.h"
+#include "LobbyGameState.h"
+#include "LobbyPlayerController.h"
+#include "NetClockSyncComponent.h"
+#include "TimerManager.h"
+#include "MPTesting_CPlusPlusCharacter.h"
+#include "MPTesting_CPlusPlus.h"
+#include "MultiplayerSessionsTrace.h"
 
-void ALobbyGameMode::PostLogin(APlayerController* NewPlayer)
+TRACE_DECLARE_INT_COUNTER(Lobby_Players, TEXT("Lobby/Players"));
+TRACE_DECLARE_INT_COUNTER(Lobby_Ready, TEXT("Lobby/Ready"));
+
+namespace LobbyGameMode
 {
-	Super::PostLogin(NewPlayer);
+	static bool bAvatarMode = true;
+	static FAutoConsoleVariableRef CVarAvatarMode(
+		TEXT("Lobby.AvatarMode"),
+		bAvatarMode,
+		TEXT("Spawn lobby players as cheap avatars. 0 spawns full characters from then on, to compare against."));
+}
+
+ALobbyGameMode::ALobbyGameMode()
+{
+	GameStateClass = ALobbyGameState::StaticClass();
+	PlayerControllerClass = ALobbyPlayerController::StaticClass();
+	bUseSeamlessTravel = true;
+}
+
+void ALobbyGameMode::BeginPlay()
+{
+	Super::BeginPlay();
 
-	if (GameState)
+	if (GetNetMode() == NM_ListenServer || GetNetMode() == NM_DedicatedServer)
 	{
-		int32 NumberOfPlayers = GameState.Get()->PlayerArray.Num();
+		InitReservationBeacon();
+	}
+}
+
+void ALobbyGameMode::GenericPlayerInitialization(AController* C)
+{
+	Super::GenericPlayerInitialization(C);
+
+	//The countdown is read off the synchronized clock
+	UNetClockSyncComponent::AddTo(Cast<APlayerController>(C));
+}
+
+void ALobbyGameMode::SetPlayerDefaults(APawn* PlayerPawn)
+{
+	Super::SetPlayerDefaults(PlayerPawn);
 
-		if (GEngine)
+	//Full characters are for the match, in the lobby everyone is a cheap avatar
+	AMPTesting_CPlusPlusCharacter* Character = Cast<AMPTesting_CPlusPlusCharacter>(PlayerPawn);
+	if (Character && LobbyGameMode::bAvatarMode)
+	{
+		Character->SetLobbyAvatarMode(true);
+	}
+}
+
+void ALobbyGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(CountdownTimerHandle);
+
+	if (BeaconHost)
+	{
+		BeaconHost->DestroyBeacon();
+		BeaconHost = nullptr;
+	}
+	if (ReservationHost)
+	{
+		ReservationHost->Destroy();
+		ReservationHost = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ALobbyGameMode::InitReservationBeacon()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ALobbyGameMode::InitReservationBeacon, LobbyChannel);
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	BeaconHost = World->SpawnActor<AOnlineBeaconHost>(AOnlineBeaconHost::StaticClass());
+	if (BeaconHost == nullptr || !BeaconHost->InitHost())
+	{
+		MULTIPLAYER_TELEMETRY(ReservationBeaconFailed);
+		if (BeaconHost)
+		{
+			BeaconHost->DestroyBeacon();
+			BeaconHost = nullptr;
+		}
+		return;
+	}
+
+	ReservationHost = World->SpawnActor<AMultiplayerReservationBeaconHost>(AMultiplayerReservationBeaconHost::StaticClass());
+	if (ReservationHost == nullptr)
+	{
+		return;
+	}
+	//As many as the session advertises, or the beacon promises slots the session says it doesn't have
+	const IOnlineSessionPtr SessionInterface = FMultiplayerOnlineServices::Get().GetSessionInterface();
+	const FNamedOnlineSession* Session = SessionInterface.IsValid() ? SessionInterface->GetNamedSession(NAME_GameSession) : nullptr;
+	ReservationHost->SetMaxSlots(Session ? Session->SessionSettings.NumPublicConnections : GameSession ? GameSession->MaxPlayers : 4);
+
+	//Players already here (the listen server host) hold a slot as well
+	for (APlayerState* PlayerState : GameState->PlayerArray)
+	{
+		if (PlayerState && PlayerState->GetUniqueId().IsValid())
 		{
-			GEngine->AddOnScreenDebugMessage(
-				1,
-				60.f,
-				FColor::Yellow,
-				FString::Printf(TEXT("Players in game :%d"), NumberOfPlayers)
-			);
-
-			APlayerState* PlayerState = NewPlayer->GetPlayerState<APlayerState>();
-			if (PlayerState)
-			{
-				FString PlayerName = PlayerState->GetPlayerName();
-				GEngine->AddOnScreenDebugMessage(
-				1,
-				60.f,
-				FColor::Cyan,
-				FString::Printf(TEXT("%s has joined the Session"), *PlayerName)
-			);
-			}
+			ReservationHost->JoinSlot(PlayerState->GetUniqueId());
 		}
 	}
+
+	BeaconHost->RegisterHost(ReservationHost);
+	BeaconHost->PauseBeaconRequests(false);
+
+	if (UMultiplayerSessionSubsystem* MultiplayerSessionSubsystem = GetGameInstance()->GetSubsystem<UMultiplayerSessionSubsystem>())
+	{
+		MultiplayerSessionSubsystem->AdvertiseBeaconPort(BeaconHost->GetListenPort());
+	}
+}
+
+void ALobbyGameMode::PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ALobbyGameMode::PreLogin, LobbyChannel);
+	Super::PreLogin(Options, Address, UniqueId, ErrorMessage);
+	FMultiplayerJoinFunnel::LogPhase(FMultiplayerJoinFunnel::ParseFromOptions(Options), EMultiplayerJoinPhase::ServerPreLogin);
+
+	if (!ErrorMessage.IsEmpty() || ReservationHost == nullptr)
+	{
+		return;
+	}
+
+	//Reserved players walk in, everyone else only gets a slot that isn't promised to someone
+	if (!ReservationHost->ClaimSlot(UniqueId))
+	{
+		ErrorMessage = TEXT("Server full.");
+	}
+}
+
+FString ALobbyGameMode::InitNewPlayer(APlayerController* NewPlayerController, const FUniqueNetIdRepl& UniqueId, const FString& Options, const FString& Portal)
+{
+	//PostLogin no longer sees the options, so the join funnel id is kept on the controller
+	if (ALobbyPlayerController* LobbyPlayerController = Cast<ALobbyPlayerController>(NewPlayerController))
+	{
+		LobbyPlayerController->SetJoinCorrelationId(FMultiplayerJoinFunnel::ParseFromOptions(Options));
+	}
+	return Super::InitNewPlayer(NewPlayerController, UniqueId, Options, Portal);
+}
+
+void ALobbyGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ALobbyGameMode::PostLogin, LobbyChannel);
+	Super::PostLogin(NewPlayer);
+
+	if (ReservationHost && NewPlayer->PlayerState)
+	{
+		ReservationHost->JoinSlot(NewPlayer->PlayerState->GetUniqueId());
+	}
+	if (ALobbyGameState* LobbyGameState = GetGameState<ALobbyGameState>())
+	{
+		LobbyGameState->AddRosterEntry(NewPlayer->PlayerState);
+	}
+	UpdateReadyCheck();
+
+	if (const ALobbyPlayerController* LobbyPlayerController = Cast<ALobbyPlayerController>(NewPlayer))
+	{
+		FMultiplayerJoinFunnel::LogPhase(LobbyPlayerController->GetJoinCorrelationId(), EMultiplayerJoinPhase::ServerPostLogin);
+	}
+
+	if (GameState && NewPlayer->PlayerState)
+	{
+		MULTIPLAYER_TELEMETRY(PlayerJoined, NAME_None, NewPlayer->PlayerState->GetPlayerId(), GameState->PlayerArray.Num());
+	}
 }
 
 void ALobbyGameMode::Logout(AController* Exiting)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ALobbyGameMode::Logout, LobbyChannel);
 	Super::Logout(Exiting);
 	APlayerState* PlayerState = Exiting->GetPlayerState<APlayerState>();
-	if (PlayerState)
-	{
-		int32 NumberOfPlayers = GameState.Get()->PlayerArray.Num();
-		GEngine->AddOnScreenDebugMessage(
-		1,
-		60.f,
-		FColor::Yellow,
-		FString::Printf(TEXT("Players in game :%d"), NumberOfPlayers - 1)
-		);
-
-		
-		FString PlayerName = PlayerState->GetPlayerName();
-		GEngine->AddOnScreenDebugMessage(
-		1,
-		60.f,
-		FColor::Cyan,
-		FString::Printf(TEXT("%s has exiting the Session"), *PlayerName)
-	);
+	if (PlayerState && ReservationHost)
+	{
+		ReservationHost->ReleaseSlot(PlayerState->GetUniqueId());
+	}
+	if (ALobbyGameState* LobbyGameState = GetGameState<ALobbyGameState>())
+	{
+		LobbyGameState->RemoveRosterEntry(PlayerState);
+	}
+	UpdateReadyCheck();
+
+	if (GameState && PlayerState)
+	{
+		//The leaving player is still in PlayerArray at this point
+		MULTIPLAYER_TELEMETRY(PlayerLeft, NAME_None, PlayerState->GetPlayerId(), GameState->PlayerArray.Num() - 1);
+	}
+}
+
+void ALobbyGameMode::SetPlayerReady(APlayerController* Player, bool bReady)
+{
+	ALobbyGameState* LobbyGameState = GetGameState<ALobbyGameState>();
+	if (LobbyGameState == nullptr || Player == nullptr)
+	{
+		return;
+	}
+
+	LobbyGameState->SetPlayerReady(Player->PlayerState, bReady);
+	UpdateReadyCheck();
+}
+
+void ALobbyGameMode::AddBot(AController* Bot)
+{
+	ALobbyGameState* LobbyGameState = GetGameState<ALobbyGameState>();
+	if (LobbyGameState == nullptr || Bot == nullptr || Bot->PlayerState == nullptr)
+	{
+		return;
+	}
+
+	LobbyGameState->AddRosterEntry(Bot->PlayerState);
+	LobbyGameState->SetPlayerReady(Bot->PlayerState, true);
+	UpdateReadyCheck();
+}
+
+void ALobbyGameMode::RemoveBot(AController* Bot)
+{
+	ALobbyGameState* LobbyGameState = GetGameState<ALobbyGameState>();
+	if (LobbyGameState == nullptr || Bot == nullptr)
+	{
+		return;
+	}
+
+	LobbyGameState->RemoveRosterEntry(Bot->PlayerState);
+	UpdateReadyCheck();
+}
+
+ALobbyGameMode::FReadyCount ALobbyGameMode::CountReady(TConstArrayView<FLobbyRosterEntry> Entries, int32 MinPlayersToStart, float ReadyQuorum)
+{
+	FReadyCount Count;
+	for (const FLobbyRosterEntry& Entry : Entries)
+	{
+		if (Entry.PlayerState && Entry.PlayerState->IsABot())
+		{
+			continue;
+		}
+		++Count.NumPlayers;
+		Count.NumReady += Entry.IsReady() ? 1 : 0;
+	}
+	Count.NumRequired = FMath::Max(MinPlayersToStart, FMath::CeilToInt(Count.NumPlayers * ReadyQuorum));
+	Count.bQuorum = Count.NumPlayers >= MinPlayersToStart && Count.NumReady >= Count.NumRequired;
+	return Count;
+}
+
+void ALobbyGameMode::UpdateReadyCheck()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ALobbyGameMode::UpdateReadyCheck, LobbyChannel);
+	ALobbyGameState* LobbyGameState = GetGameState<ALobbyGameState>();
+	if (LobbyGameState == nullptr || LobbyGameState->GetReadyCheck().Phase == ELobbyReadyPhase::Travelling)
+	{
+		return;
+	}
+
+	const FReadyCount Count = CountReady(LobbyGameState->GetRosterEntries(), MinPlayersToStart, ReadyQuorum);
+	TRACE_COUNTER_SET(Lobby_Players, Count.NumPlayers);
+	TRACE_COUNTER_SET(Lobby_Ready, Count.NumReady);
+
+	FLobbyReadyCheck ReadyCheck = LobbyGameState->GetReadyCheck();
+	ReadyCheck.NumReady = static_cast<uint8>(FMath::Min(Count.NumReady, 255));
+	ReadyCheck.NumRequired = static_cast<uint8>(FMath::Min(Count.NumRequired, 255));
+
+	if (Count.bQuorum && ReadyCheck.Phase == ELobbyReadyPhase::Waiting)
+	{
+		//Clients count down on their own against this stamp, nothing is sent per second
+		ReadyCheck.Phase = ELobbyReadyPhase::Countdown;
+		ReadyCheck.CountdownEndTime = LobbyGameState->GetServerWorldTimeSeconds() + CountdownSeconds;
+		GetWorldTimerManager().SetTimer(CountdownTimerHandle, this, &ThisClass::TravelToMatch, CountdownSeconds, false);
+	}
+	else if (!Count.bQuorum && ReadyCheck.Phase == ELobbyReadyPhase::Countdown)
+	{
+		ReadyCheck.Phase = ELobbyReadyPhase::Waiting;
+		ReadyCheck.CountdownEndTime = 0.0;
+		GetWorldTimerManager().ClearTimer(CountdownTimerHandle);
+	}
+
+	LobbyGameState->SetReadyCheck(ReadyCheck);
+}
+
+void ALobbyGameMode::TravelToMatch()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ALobbyGameMode::TravelToMatch, LobbyChannel);
+	ALobbyGameState* LobbyGameState = GetGameState<ALobbyGameState>();
+	if (LobbyGameState == nullptr)
+	{
+		return;
+	}
+
+	FLobbyReadyCheck ReadyCheck = LobbyGameState->GetReadyCheck();
+	ReadyCheck.Phase = ELobbyReadyPhase::Travelling;
+	LobbyGameState->SetReadyCheck(ReadyCheck);
+
+	if (UWorld* World = GetWorld())
+	{
+		TRACE_BOOKMARK(TEXT("ServerTravel %s"), *MatchMapURL);
+		World->ServerTravel(MatchMapURL);
 	}
 }
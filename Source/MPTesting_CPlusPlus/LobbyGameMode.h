@@ -6,15 +6,81 @@
 #include "GameFramework/GameModeBase.h"
 #include "LobbyGameMode.generated.h"
 
+class AOnlineBeaconHost;
+class AMultiplayerReservationBeaconHost;
+struct FLobbyRosterEntry;
+
 /**
  * 
  */
-UCLASS()
+UCLASS(config=Game)
 class MPTESTING_CPLUSPLUS_API ALobbyGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 
 public:
+	ALobbyGameMode();
+
+	virtual void PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage) override;
+	virtual FString InitNewPlayer(APlayerController* NewPlayerController, const FUniqueNetIdRepl& UniqueId, const FString& Options, const FString& Portal = TEXT("")) override;
 	virtual void PostLogin(APlayerController* NewPlayer) override;
 	virtual void Logout(AController* Exiting) override;
+
+	/** Called from the lobby player controller's server RPC */
+	void SetPlayerReady(APlayerController* Player, bool bReady);
+
+	///
+	///Bot players from UBotPlayerSubsystem: in the roster and ready, but no reservation slot,
+	///and the ready check counts only the humans
+	///
+	void AddBot(AController* Bot);
+	void RemoveBot(AController* Bot);
+
+	/** What the ready check goes by. Bots are always ready, so only humans are counted */
+	struct FReadyCount
+	{
+		int32 NumPlayers{0};
+		int32 NumReady{0};
+		int32 NumRequired{0};
+		bool bQuorum{false};
+	};
+	static FReadyCount CountReady(TConstArrayView<FLobbyRosterEntry> Entries, int32 MinPlayersToStart, float ReadyQuorum);
+
+protected:
+	virtual void GenericPlayerInitialization(AController* C) override;
+	virtual void SetPlayerDefaults(APawn* PlayerPawn) override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	///
+	///Ready check: once enough players are ready a countdown starts, and the match map is loaded when it ends.
+	///Dropping below quorum cancels it.
+	///
+	void UpdateReadyCheck();
+	void TravelToMatch();
+
+	/** Fraction of the lobby that has to be ready */
+	UPROPERTY(Config)
+	float ReadyQuorum{1.f};
+
+	UPROPERTY(Config)
+	int32 MinPlayersToStart{2};
+
+	UPROPERTY(Config)
+	float CountdownSeconds{10.f};
+
+	UPROPERTY(Config)
+	FString MatchMapURL{TEXT("/Game/ThirdPerson/Maps/ThirdPersonMap?listen")};
+
+	FTimerHandle CountdownTimerHandle;
+
+	/** Starts listening for slot reservations and advertises the beacon port on the session */
+	void InitReservationBeacon();
+
+	UPROPERTY()
+	AOnlineBeaconHost* BeaconHost;
+
+	UPROPERTY()
+	AMultiplayerReservationBeaconHost* ReservationHost;
 };
@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LobbyGameState.h"
+
+#include "GameFramework/PlayerState.h"
+#include "NetClockSyncComponent.h"
+#include "Net/UnrealNetwork.h"
+#include "TimerManager.h"
+
+void FLobbyRosterEntry::PreReplicatedRemove(const FLobbyRoster& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnRosterEntryRemoved.Broadcast(*this);
+	}
+}
+
+void FLobbyRosterEntry::PostReplicatedAdd(const FLobbyRoster& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnRosterEntryAdded.Broadcast(*this);
+	}
+}
+
+void FLobbyRosterEntry::PostReplicatedChange(const FLobbyRoster& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnRosterEntryChanged.Broadcast(*this);
+	}
+}
+
+bool FLobbyReadyCheck::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 PhaseBits = static_cast<uint8>(Phase);
+	Ar.SerializeBits(&PhaseBits, 2);
+	Phase = static_cast<ELobbyReadyPhase>(PhaseBits);
+
+	Ar << NumReady;
+	Ar << NumRequired;
+
+	//The end stamp is only sent while it means something
+	if (Phase == ELobbyReadyPhase::Countdown)
+	{
+		Ar << CountdownEndTime;
+	}
+	else if (Ar.IsLoading())
+	{
+		CountdownEndTime = 0.0;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+ALobbyGameState::ALobbyGameState()
+{
+	Roster.Owner = this;
+}
+
+void ALobbyGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ALobbyGameState, Roster);
+	DOREPLIFETIME(ALobbyGameState, ReadyCheck);
+}
+
+void ALobbyGameState::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Roster.Owner = this;
+	if (HasAuthority())
+	{
+		GetWorldTimerManager().SetTimer(PingTierTimerHandle, this, &ThisClass::UpdatePingTiers, 2.f, true);
+	}
+}
+
+void ALobbyGameState::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(PingTierTimerHandle);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ALobbyGameState::AddRosterEntry(APlayerState* PlayerState)
+{
+	if (!HasAuthority() || PlayerState == nullptr || FindMutableEntry(PlayerState))
+	{
+		return;
+	}
+
+	FLobbyRosterEntry& Entry = Roster.Entries.AddDefaulted_GetRef();
+	Entry.PlayerState = PlayerState;
+	Entry.PlayerId = PlayerState->GetPlayerId();
+	Roster.MarkItemDirty(Entry);
+
+	OnRosterEntryAdded.Broadcast(Entry);
+}
+
+void ALobbyGameState::RemoveRosterEntry(APlayerState* PlayerState)
+{
+	if (!HasAuthority() || PlayerState == nullptr)
+	{
+		return;
+	}
+
+	const int32 Index = Roster.Entries.IndexOfByPredicate([PlayerState](const FLobbyRosterEntry& Entry)
+	{
+		return Entry.PlayerState == PlayerState;
+	});
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FLobbyRosterEntry Removed = Roster.Entries[Index];
+	Roster.Entries.RemoveAtSwap(Index);
+	Roster.MarkArrayDirty();
+
+	OnRosterEntryRemoved.Broadcast(Removed);
+}
+
+void ALobbyGameState::SetPlayerReady(APlayerState* PlayerState, bool bReady)
+{
+	FLobbyRosterEntry* Entry = FindMutableEntry(PlayerState);
+	if (Entry && Entry->IsReady() != bReady)
+	{
+		Entry->SetReady(bReady);
+		MarkEntryChanged(*Entry);
+	}
+}
+
+void ALobbyGameState::SetPlayerTeam(APlayerState* PlayerState, uint8 Team)
+{
+	FLobbyRosterEntry* Entry = FindMutableEntry(PlayerState);
+	if (Entry && Entry->GetTeam() != Team)
+	{
+		Entry->SetTeam(Team);
+		MarkEntryChanged(*Entry);
+	}
+}
+
+void ALobbyGameState::SetPlayerLoadout(APlayerState* PlayerState, uint8 LoadoutId)
+{
+	FLobbyRosterEntry* Entry = FindMutableEntry(PlayerState);
+	if (Entry && Entry->LoadoutId != LoadoutId)
+	{
+		Entry->LoadoutId = LoadoutId;
+		MarkEntryChanged(*Entry);
+	}
+}
+
+void ALobbyGameState::SetReadyCheck(const FLobbyReadyCheck& NewReadyCheck)
+{
+	if (!HasAuthority() || ReadyCheck == NewReadyCheck)
+	{
+		return;
+	}
+
+	ReadyCheck = NewReadyCheck;
+	OnReadyCheckChanged.Broadcast(ReadyCheck);
+}
+
+void ALobbyGameState::OnRep_ReadyCheck()
+{
+	OnReadyCheckChanged.Broadcast(ReadyCheck);
+}
+
+int32 ALobbyGameState::GetNumReadyPlayers() const
+{
+	int32 NumReady = 0;
+	for (const FLobbyRosterEntry& Entry : Roster.Entries)
+	{
+		NumReady += Entry.IsReady() ? 1 : 0;
+	}
+	return NumReady;
+}
+
+float ALobbyGameState::GetCountdownRemaining() const
+{
+	if (ReadyCheck.Phase != ELobbyReadyPhase::Countdown)
+	{
+		return 0.f;
+	}
+	return FMath::Max(0.f, static_cast<float>(ReadyCheck.CountdownEndTime - UNetClockSyncComponent::GetWorldServerTime(GetWorld())));
+}
+
+const FLobbyRosterEntry* ALobbyGameState::FindRosterEntry(const APlayerState* PlayerState) const
+{
+	return Roster.Entries.FindByPredicate([PlayerState](const FLobbyRosterEntry& Entry)
+	{
+		return Entry.PlayerState == PlayerState;
+	});
+}
+
+FLobbyRosterEntry* ALobbyGameState::FindMutableEntry(const APlayerState* PlayerState)
+{
+	if (!HasAuthority() || PlayerState == nullptr)
+	{
+		return nullptr;
+	}
+	return Roster.Entries.FindByPredicate([PlayerState](const FLobbyRosterEntry& Entry)
+	{
+		return Entry.PlayerState == PlayerState;
+	});
+}
+
+void ALobbyGameState::MarkEntryChanged(FLobbyRosterEntry& Entry)
+{
+	Roster.MarkItemDirty(Entry);
+	OnRosterEntryChanged.Broadcast(Entry);
+}
+
+void ALobbyGameState::UpdatePingTiers()
+{
+	for (FLobbyRosterEntry& Entry : Roster.Entries)
+	{
+		if (Entry.PlayerState == nullptr)
+		{
+			continue;
+		}
+
+		//Tiers: <50ms, <100ms, <200ms, worse
+		const float PingMs = Entry.PlayerState->GetPingInMilliseconds();
+		const uint8 PingTier = PingMs < 50.f ? 0 : PingMs < 100.f ? 1 : PingMs < 200.f ? 2 : 3;
+		if (Entry.GetPingTier() != PingTier)
+		{
+			Entry.SetPingTier(PingTier);
+			MarkEntryChanged(Entry);
+		}
+	}
+}
@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameStateBase.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "LobbyGameState.generated.h"
+
+class ALobbyGameState;
+struct FLobbyRoster;
+
+/**
+ * One row of the lobby roster. Ready/team/ping tier share a single byte so a row change
+ * costs a couple of bytes on the wire.
+ */
+USTRUCT(BlueprintType)
+struct FLobbyRosterEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	static constexpr uint8 ReadyMask = 0x01;
+	static constexpr uint8 TeamShift = 1;
+	static constexpr uint8 TeamMask = 0x0E;
+	static constexpr uint8 PingTierShift = 4;
+	static constexpr uint8 PingTierMask = 0x30;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lobby")
+	APlayerState* PlayerState = nullptr;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lobby")
+	int32 PlayerId = INDEX_NONE;
+
+	/** Ready (bit 0), team (bits 1-3), ping tier (bits 4-5) */
+	UPROPERTY()
+	uint8 Flags = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lobby")
+	uint8 LoadoutId = 0;
+
+	bool IsReady() const { return (Flags & ReadyMask) != 0; }
+	uint8 GetTeam() const { return (Flags & TeamMask) >> TeamShift; }
+	uint8 GetPingTier() const { return (Flags & PingTierMask) >> PingTierShift; }
+
+	void SetReady(bool bReady) { Flags = bReady ? (Flags | ReadyMask) : (Flags & ~ReadyMask); }
+	void SetTeam(uint8 Team) { Flags = (Flags & ~TeamMask) | ((Team << TeamShift) & TeamMask); }
+	void SetPingTier(uint8 PingTier) { Flags = (Flags & ~PingTierMask) | ((PingTier << PingTierShift) & PingTierMask); }
+
+	void PreReplicatedRemove(const FLobbyRoster& InArraySerializer);
+	void PostReplicatedAdd(const FLobbyRoster& InArraySerializer);
+	void PostReplicatedChange(const FLobbyRoster& InArraySerializer);
+};
+
+USTRUCT()
+struct FLobbyRoster : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FLobbyRosterEntry> Entries;
+
+	UPROPERTY(NotReplicated)
+	ALobbyGameState* Owner = nullptr;
+
+	FLobbyRosterEntry* FindEntry(int32 PlayerId)
+	{
+		return Entries.FindByPredicate([PlayerId](const FLobbyRosterEntry& Entry) { return Entry.PlayerId == PlayerId; });
+	}
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FLobbyRosterEntry, FLobbyRoster>(Entries, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FLobbyRoster> : public TStructOpsTypeTraitsBase2<FLobbyRoster>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+UENUM(BlueprintType)
+enum class ELobbyReadyPhase : uint8
+{
+	Waiting,
+	Countdown,
+	Travelling
+};
+
+/**
+ * Lobby-wide ready-check state. Per-player ready flags live in the roster rows, this only carries
+ * the totals and the countdown end stamp, so an update is a fixed handful of bytes for any lobby size.
+ * Clients count down locally against server time instead of receiving ticks.
+ */
+USTRUCT(BlueprintType)
+struct FLobbyReadyCheck
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lobby")
+	ELobbyReadyPhase Phase = ELobbyReadyPhase::Waiting;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lobby")
+	uint8 NumReady = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Lobby")
+	uint8 NumRequired = 0;
+
+	/** Server world time at which the countdown ends, only meaningful during Countdown */
+	UPROPERTY(BlueprintReadOnly, Category = "Lobby")
+	double CountdownEndTime = 0.0;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FLobbyReadyCheck& Other) const
+	{
+		return Phase == Other.Phase && NumReady == Other.NumReady && NumRequired == Other.NumRequired && CountdownEndTime == Other.CountdownEndTime;
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FLobbyReadyCheck> : public TStructOpsTypeTraitsBase2<FLobbyReadyCheck>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnLobbyRosterEntryChanged, const FLobbyRosterEntry&);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnLobbyReadyCheckChanged, const FLobbyReadyCheck&);
+
+/**
+ * Game state of the lobby map. Replicates the lobby roster as a fast array, so only the rows
+ * that changed are sent, and raises add/change/remove events the UI binds to.
+ */
+UCLASS()
+class MPTESTING_CPLUSPLUS_API ALobbyGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	ALobbyGameState();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	///
+	///Server only. Every change marks just the touched row dirty
+	///
+	void AddRosterEntry(APlayerState* PlayerState);
+	void RemoveRosterEntry(APlayerState* PlayerState);
+	void SetPlayerReady(APlayerState* PlayerState, bool bReady);
+	void SetPlayerTeam(APlayerState* PlayerState, uint8 Team);
+	void SetPlayerLoadout(APlayerState* PlayerState, uint8 LoadoutId);
+
+	/** Server only. Publishes new ready totals / countdown */
+	void SetReadyCheck(const FLobbyReadyCheck& NewReadyCheck);
+
+	const TArray<FLobbyRosterEntry>& GetRosterEntries() const { return Roster.Entries; }
+	int32 GetNumReadyPlayers() const;
+
+	const FLobbyReadyCheck& GetReadyCheck() const { return ReadyCheck; }
+
+	/** Seconds left on the countdown, evaluated locally every frame from the replicated end stamp and the synchronized server clock */
+	UFUNCTION(BlueprintPure, Category = "Lobby")
+	float GetCountdownRemaining() const;
+
+	const FLobbyRosterEntry* FindRosterEntry(const APlayerState* PlayerState) const;
+
+	///
+	///Fired on clients from replication, and on the server when it edits the roster
+	///
+	FOnLobbyRosterEntryChanged OnRosterEntryAdded;
+	FOnLobbyRosterEntryChanged OnRosterEntryChanged;
+	FOnLobbyRosterEntryChanged OnRosterEntryRemoved;
+	FOnLobbyReadyCheckChanged OnReadyCheckChanged;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	FLobbyRosterEntry* FindMutableEntry(const APlayerState* PlayerState);
+	void MarkEntryChanged(FLobbyRosterEntry& Entry);
+
+	/** Buckets every player's ping, rows only replicate when their tier moves */
+	void UpdatePingTiers();
+
+	UFUNCTION()
+	void OnRep_ReadyCheck();
+
+	UPROPERTY(Replicated)
+	FLobbyRoster Roster;
+
+	UPROPERTY(ReplicatedUsing = OnRep_ReadyCheck)
+	FLobbyReadyCheck ReadyCheck;
+
+	FTimerHandle PingTierTimerHandle;
+};
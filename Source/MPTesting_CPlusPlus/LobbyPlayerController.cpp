@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LobbyPlayerController.h"
+
+#include "LobbyGameMode.h"
+#include "LobbyGameState.h"
+#include "GameFramework/PlayerState.h"
+
+void ALobbyPlayerController::SetReady(bool bReady)
+{
+	ServerSetReady(bReady);
+}
+
+void ALobbyPlayerController::ToggleReady()
+{
+	const ALobbyGameState* LobbyGameState = GetWorld()->GetGameState<ALobbyGameState>();
+	const FLobbyRosterEntry* Entry = LobbyGameState ? LobbyGameState->FindRosterEntry(PlayerState) : nullptr;
+	SetReady(Entry == nullptr || !Entry->IsReady());
+}
+
+void ALobbyPlayerController::ServerSetReady_Implementation(bool bReady)
+{
+	if (ALobbyGameMode* LobbyGameMode = GetWorld()->GetAuthGameMode<ALobbyGameMode>())
+	{
+		LobbyGameMode->SetPlayerReady(this, bReady);
+	}
+}
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "LobbyPlayerController.generated.h"
+
+/**
+ * Player controller used in the lobby map. Carries the ready-check input to the server.
+ */
+UCLASS()
+class MPTESTING_CPLUSPLUS_API ALobbyPlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, Category = "Lobby")
+	void SetReady(bool bReady);
+
+	/** Console: flips the local player's ready state */
+	UFUNCTION(Exec)
+	void ToggleReady();
+
+	/** Server only. Join funnel id the player logged in with, empty if it came without one */
+	const FString& GetJoinCorrelationId() const { return JoinCorrelationId; }
+	void SetJoinCorrelationId(const FString& InJoinCorrelationId) { JoinCorrelationId = InJoinCorrelationId; }
+
+protected:
+	UFUNCTION(Server, Reliable)
+	void ServerSetReady(bool bReady);
+
+private:
+	FString JoinCorrelationId;
+};
@@ -8,6 +8,8 @@ public class MPTesting_CPlusPlus : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput","OnlineSubsystemSteam","OnlineSubsystem","OnlineSubsystemUtils" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput","NetCore","OnlineSubsystemSteam","OnlineSubsystem","OnlineSubsystemUtils","MultiplayerSessions" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "HTTPServer", "SignificanceManager", "AnimationBudgetAllocator", "AIModule" });
 	}
 }
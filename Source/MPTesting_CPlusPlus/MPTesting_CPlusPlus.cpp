@@ -3,5 +3,9 @@
 #include "MPTesting_CPlusPlus.h"
 #include "Modules/ModuleManager.h"
 
+UE_TRACE_CHANNEL_DEFINE(LobbyChannel);
+
+DEFINE_LOG_CATEGORY(LogCombat);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MPTesting_CPlusPlus, "MPTesting_CPlusPlus" );
  
\ No newline at end of file
@@ -3,3 +3,14 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+
+DECLARE_STATS_GROUP(TEXT("Lobby"), STATGROUP_Lobby, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("Combat"), STATGROUP_Combat, STATCAT_Advanced);
+
+/** Server side hit validation, lag compensation and the weapons built on it */
+MPTESTING_CPLUSPLUS_API DECLARE_LOG_CATEGORY_EXTERN(LogCombat, Log, All);
+
+/** Insights channel of the lobby, enable with -trace=default,Lobby */
+UE_TRACE_CHANNEL_EXTERN(LobbyChannel, MPTESTING_CPLUSPLUS_API);
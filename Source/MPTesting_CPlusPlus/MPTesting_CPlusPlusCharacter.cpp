@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MPTesting_CPlusPlusCharacter.h"
+#include "Engine/Engine.h"
 #include "Engine/LocalPlayer.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
@@ -14,19 +15,44 @@
 #include "Interfaces/OnlineSessionInterface.h"
 #include "OnlineSessionSettings.h"
 #include "Online/OnlineSessionNames.h"
-#include "Interfaces/OnlineIdentityInterface.h"
+#include "MultiplayerIdentitySubsystem.h"
+#include "MultiplayerOnlineServices.h"
+#include "MultiplayerTelemetry.h"
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerSessionSchema.h"
+#include "Engine/GameInstance.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "TimerManager.h"
+#include "MPTesting_CPlusPlus.h"
+#include "LagCompensationSubsystem.h"
+#include "WeaponTraceSubsystem.h"
+#include "NetClockSyncComponent.h"
+#include "CharacterSignificanceSubsystem.h"
+#include "InputReplaySubsystem.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "CombatStateComponent.h"
 
 
 DEFINE_LOG_CATEGORY(LogTemplateCharacter);
 
+//What every spawn pays, the lobby's 100 avatars and each respawn in a match
+DECLARE_CYCLE_STAT(TEXT("Character Construct"), STAT_CharacterConstruct, STATGROUP_Combat);
+DECLARE_CYCLE_STAT(TEXT("Character BeginPlay"), STAT_CharacterBeginPlay, STATGROUP_Combat);
+
 //////////////////////////////////////////////////////////////////////////
 // AMPTesting_CPlusPlusCharacter
 
-AMPTesting_CPlusPlusCharacter::AMPTesting_CPlusPlusCharacter():
+AMPTesting_CPlusPlusCharacter::AMPTesting_CPlusPlusCharacter(const FObjectInitializer& ObjectInitializer):
+	Super(ObjectInitializer.SetDefaultSubobjectClass<USkeletalMeshComponentBudgeted>(ACharacter::MeshComponentName)),
 	CreateSessionCompleteDelegate(FOnCreateSessionCompleteDelegate::CreateUObject(this,&ThisClass::OnCreateSessionComplete)),
 	FindSessionsCompleteDelegate(FOnFindSessionsCompleteDelegate::CreateUObject(this,&ThisClass::OnFindSessionComplete)),
 	JoinSessionCompleteDelegate(FOnJoinSessionCompleteDelegate::CreateUObject(this,&ThisClass::OnJoinSessionComplete))
 {
+	SCOPE_CYCLE_COUNTER(STAT_CharacterConstruct);
+
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
 		
@@ -59,74 +85,199 @@ AMPTesting_CPlusPlusCharacter::AMPTesting_CPlusPlusCharacter():
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attach the camera to the end of the boom and let the boom adjust to match the controller orientation
 	FollowCamera->bUsePawnControlRotation = false; // Camera does not rotate relative to arm
 
+	// Health and shield, replicated on its own terms (see UCombatStateComponent)
+	CombatState = CreateDefaultSubobject<UCombatStateComponent>(TEXT("CombatState"));
+
+	// The mesh ticks under the animation budget once UCharacterSignificanceSubsystem registers it, not before
+	CastChecked<USkeletalMeshComponentBudgeted>(GetMesh())->SetAutoRegisterWithBudgetAllocator(false);
+
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
 
-	IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
-	if (OnlineSubsystem)
+	// The online session interface is looked up when a session call needs it, not here:
+	// this constructor also builds the CDO while the module loads
+}
+
+void AMPTesting_CPlusPlusCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(AMPTesting_CPlusPlusCharacter, bLobbyAvatarMode, Params);
+}
+
+void AMPTesting_CPlusPlusCharacter::BeginPlay()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterBeginPlay);
+
+	Super::BeginPlay();
+
+	if (bLobbyAvatarMode)
+	{
+		ApplyLobbyAvatarMode();
+	}
+	else if (HasAuthority())
 	{
-		OnlineSessionInterface = OnlineSubsystem->GetSessionInterface();
-		if (OnlineSessionInterface.IsValid())
+		if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Online session interface is valid"));
+			LagCompensation->RegisterCharacter(this);
 		}
-		else
+	}
+
+	if (UCharacterSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
+	{
+		Significance->RegisterCharacter(this);
+	}
+
+	// No online lookups per spawn, the session calls resolve the interface from FMultiplayerOnlineServices on demand
+}
+
+void AMPTesting_CPlusPlusCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterCharacter(this);
+	}
+	if (UCharacterSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
+	{
+		Significance->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMPTesting_CPlusPlusCharacter::SetLobbyAvatarMode(bool bEnable)
+{
+	if (!HasAuthority() || bLobbyAvatarMode == bEnable)
+	{
+		return;
+	}
+
+	bLobbyAvatarMode = bEnable;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AMPTesting_CPlusPlusCharacter, bLobbyAvatarMode, this);
+	ApplyLobbyAvatarMode();
+
+	//Nobody gets shot in the lobby
+	if (ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>())
+	{
+		if (bEnable)
 		{
-			UE_LOG(LogTemp, Error, TEXT("Online session interface is null"));
+			LagCompensation->UnregisterCharacter(this);
 		}
-		if (GEngine)
+		else
 		{
-			GEngine->AddOnScreenDebugMessage(
-				-1,
-				15.f,
-				FColor::Blue,
-				FString::Printf(TEXT("Found subsystem %s"),*OnlineSubsystem->GetSubsystemName().ToString())
-				);
+			LagCompensation->RegisterCharacter(this);
 		}
 	}
 }
 
-void AMPTesting_CPlusPlusCharacter::BeginPlay()
+void AMPTesting_CPlusPlusCharacter::FireHitscan(const FVector& Start, const FVector& Direction, float Range)
 {
-	Super::BeginPlay();
+	//The synchronized clock when there is one, what lag compensation rewinds to
+	const double ClientTime = UNetClockSyncComponent::GetWorldServerTime(GetWorld());
+	ServerFireHitscan(Start, Direction.GetSafeNormal(), Range, ClientTime, ++NextShotId);
+}
 
-	// 确保使用正确的在线子系统
-	IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
-	if (OnlineSubsystem)
+void AMPTesting_CPlusPlusCharacter::ServerFireHitscan_Implementation(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, float Range, double ClientTime, uint32 ShotId)
+{
+	UWeaponTraceSubsystem* WeaponTrace = GetWorld()->GetSubsystem<UWeaponTraceSubsystem>();
+	if (WeaponTrace == nullptr)
 	{
-		FString SubsystemName = OnlineSubsystem->GetSubsystemName().ToString();
-		UE_LOG(LogTemp, Warning, TEXT("Using OnlineSubsystem: %s"), *SubsystemName);
+		return;
+	}
 
-		OnlineSessionInterface = OnlineSubsystem->GetSessionInterface();
-		
-		if (OnlineSessionInterface.IsValid())
+	FWeaponFireRequest Request;
+	Request.Shooter = this;
+	Request.Start = Start;
+	Request.End = Start + Direction * Range;
+	Request.ClientTime = ClientTime;
+	Request.ShotId = ShotId;
+	WeaponTrace->RequestFire(Request);
+}
+
+void AMPTesting_CPlusPlusCharacter::OnRep_LobbyAvatarMode()
+{
+	ApplyLobbyAvatarMode();
+}
+
+void AMPTesting_CPlusPlusCharacter::ApplyLobbyAvatarMode()
+{
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	if (!bLobbyAvatarMode)
+	{
+		if (!FullCharacterSettings.IsSet())
 		{
-			UE_LOG(LogTemp, Warning, TEXT("Online session interface is valid"));
+			return;
 		}
-		else
+
+		const FFullCharacterSettings& Full = FullCharacterSettings.GetValue();
+		if (HasAuthority())
 		{
-			UE_LOG(LogTemp, Error, TEXT("Online session interface is invalid"));
+			NetUpdateFrequency = Full.NetUpdateFrequency;
+			MinNetUpdateFrequency = Full.MinNetUpdateFrequency;
 		}
+		CameraBoom->SetComponentTickEnabled(Full.bCameraBoomTicks);
+		FollowCamera->SetActive(Full.bFollowCameraActive);
+		GetMesh()->VisibilityBasedAnimTickOption = Full.AnimTickOption;
+		Movement->NetworkSmoothingMode = Full.NetworkSmoothingMode;
+		Movement->SetComponentTickEnabled(Full.bMovementTicks);
+		FullCharacterSettings.Reset();
+		return;
 	}
-	else
+
+	//Once, a second call would save the avatar's settings as the full ones
+	if (FullCharacterSettings.IsSet())
 	{
-		UE_LOG(LogTemp, Error, TEXT("OnlineSubsystem is null"));
+		return;
+	}
+	FFullCharacterSettings& Full = FullCharacterSettings.Emplace();
+	Full.NetUpdateFrequency = NetUpdateFrequency;
+	Full.MinNetUpdateFrequency = MinNetUpdateFrequency;
+	Full.bCameraBoomTicks = CameraBoom->IsComponentTickEnabled();
+	Full.bFollowCameraActive = FollowCamera->IsActive();
+	Full.AnimTickOption = GetMesh()->VisibilityBasedAnimTickOption;
+	Full.NetworkSmoothingMode = Movement->NetworkSmoothingMode;
+	Full.bMovementTicks = Movement->IsComponentTickEnabled();
+
+	if (HasAuthority())
+	{
+		NetUpdateFrequency = LobbyNetUpdateFrequency;
+		MinNetUpdateFrequency = FMath::Min(MinNetUpdateFrequency, LobbyNetUpdateFrequency);
 	}
 
-	// 调试登录状态
-	DebugLoginStatus();
+	if (IsLocallyControlled())
+	{
+		return;
+	}
+
+	//Nobody looks through a remote player's camera
+	CameraBoom->SetComponentTickEnabled(false);
+	FollowCamera->Deactivate();
+
+	//Distance and tick throttling is UCharacterSignificanceSubsystem's, as for any other character
+	GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+
+	if (GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		//Simulated proxies just take the replicated transform, no movement simulation or smoothing
+		Movement->NetworkSmoothingMode = ENetworkSmoothingMode::Disabled;
+		Movement->SetComponentTickEnabled(false);
+	}
 }
 
 void AMPTesting_CPlusPlusCharacter::CreateGameSession()
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(AMPTesting_CPlusPlusCharacter::CreateGameSession);
+    OnlineSessionInterface = FMultiplayerOnlineServices::Get().GetSessionInterface();
     if (!OnlineSessionInterface.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("OnlineSessionInterface is not valid"));
+        MULTIPLAYER_TELEMETRY(SessionInterfaceMissing);
         return;
     }
 
     // 检查登录状态
-    DebugLoginStatus();
+    RecordLoginStatus();
 
     // 销毁现有会话
     auto ExistingSession = OnlineSessionInterface->GetNamedSession(NAME_GameSession);
@@ -145,45 +296,41 @@ void AMPTesting_CPlusPlusCharacter::CreateGameSession()
     SessionSettings->bShouldAdvertise = true;
     SessionSettings->bUsesPresence = true;
     SessionSettings->bUseLobbiesIfAvailable = true;
-    SessionSettings->Set(FName("MatchType"), FString("FreeForAll"), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+    FMultiplayerSessionMode Mode;
+    Mode.MatchType = EMultiplayerMatchType::FreeForAll;
+    Mode.Flags = EMultiplayerSessionFlags::JoinInProgress;
+    Mode.Write(*SessionSettings);
 
     // 使用统一的网络ID获取方法
     FUniqueNetIdRepl NetId = GetPlayerNetId();
     if (!NetId.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("Cannot create session: Invalid NetId"));
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, TEXT("Cannot create session: Player not logged in"));
-        }
+        MULTIPLAYER_TELEMETRY(NotLoggedIn, TEXT("CreateGameSession"));
         return;
     }
 
-	if (const FUniqueNetId* RawNetId = NetId.GetUniqueNetId().Get())
-	{
-		FString NetIdStr = RawNetId->ToString();
-		UE_LOG(LogTemp, Warning, TEXT("NetId: %s"), *NetIdStr);
-	}
+    MULTIPLAYER_TELEMETRY(SessionCreateRequested, NAME_GameSession, SessionSettings->NumPublicConnections);
     OnlineSessionInterface->CreateSession(*NetId, NAME_GameSession, *SessionSettings);
 }
 
 void AMPTesting_CPlusPlusCharacter::JoinGameSession()
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(AMPTesting_CPlusPlusCharacter::JoinGameSession);
+    OnlineSessionInterface = FMultiplayerOnlineServices::Get().GetSessionInterface();
     if (!OnlineSessionInterface.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("OnlineSessionInterface is not valid"));
+        MULTIPLAYER_TELEMETRY(SessionInterfaceMissing);
         return;
     }
 
     // 检查登录状态
-    DebugLoginStatus();
+    RecordLoginStatus();
 
     OnlineSessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
 
     SessionSearch = MakeShareable(new FOnlineSessionSearch());
     if (!SessionSearch.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("Failed to create SessionSearch"));
         return;
     }
 
@@ -195,19 +342,11 @@ void AMPTesting_CPlusPlusCharacter::JoinGameSession()
     FUniqueNetIdRepl NetId = GetPlayerNetId();
     if (!NetId.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("Cannot join session: Invalid NetId"));
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, TEXT("Cannot join session: Player not logged in"));
-        }
+        MULTIPLAYER_TELEMETRY(NotLoggedIn, TEXT("JoinGameSession"));
         return;
     }
 
-	if (const FUniqueNetId* RawNetId = NetId.GetUniqueNetId().Get())
-	{
-		FString NetIdStr = RawNetId->ToString();
-		UE_LOG(LogTemp, Warning, TEXT("NetId: %s"), *NetIdStr);
-	}
+    MULTIPLAYER_TELEMETRY(SessionSearchStarted, NAME_None, SessionSearch->MaxSearchResults);
     OnlineSessionInterface->FindSessions(*NetId, SessionSearch.ToSharedRef());
 }
 
@@ -217,98 +356,63 @@ void AMPTesting_CPlusPlusCharacter::QuitGameSession()
 	UWorld* World = GetWorld();
 	if (World)
 	{
+		TRACE_BOOKMARK(TEXT("ServerTravel /Game/ThirdPerson/Maps/ThirdPersonMap"));
 		World->ServerTravel(FString("/Game/ThirdPerson/Maps/ThirdPersonMap"));
 	}
 }
 
 void AMPTesting_CPlusPlusCharacter::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(AMPTesting_CPlusPlusCharacter::OnCreateSessionComplete);
     if (bWasSuccessful)
     {
         // 会话创建成功
-        UE_LOG(LogTemp, Warning, TEXT("Session created successfully: %s"), *SessionName.ToString());
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(
-                -1,
-                15.f,
-                FColor::Blue,
-                FString::Printf(TEXT("Created session: %s"), *SessionName.ToString())
-            );
-        }
+        MULTIPLAYER_TELEMETRY(SessionCreated, SessionName);
 
         UWorld* World = GetWorld();
         if (World)
         {
+            TRACE_BOOKMARK(TEXT("ServerTravel /Game/ThirdPerson/Maps/Lobby?listen"));
             World->ServerTravel(FString("/Game/ThirdPerson/Maps/Lobby?listen"));
         }
     }
     else
     {
         // 会话创建失败
-        UE_LOG(LogTemp, Error, TEXT("Failed to create session"));
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(
-                -1,
-                15.f,
-                FColor::Red,
-                TEXT("Failed to create session")
-            );
-        }
+        MULTIPLAYER_TELEMETRY(SessionCreateFailed, SessionName);
     }
 }
 
 void AMPTesting_CPlusPlusCharacter::OnFindSessionComplete(bool bWasSuccessful)
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(AMPTesting_CPlusPlusCharacter::OnFindSessionComplete);
     if (!OnlineSessionInterface.IsValid() || !SessionSearch.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("Invalid interfaces in OnFindSessionComplete"));
         return;
     }
 
-    UE_LOG(LogTemp, Warning, TEXT("Find sessions completed. Successful: %d, Results: %d"), 
-        bWasSuccessful, SessionSearch->SearchResults.Num());
-
+    MULTIPLAYER_TELEMETRY(SessionSearchCompleted, NAME_None, bWasSuccessful, SessionSearch->SearchResults.Num());
     if (!bWasSuccessful || SessionSearch->SearchResults.Num() == 0)
     {
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Red, 
-                FString::Printf(TEXT("No sessions found or search failed. Results: %d"), 
-                SessionSearch->SearchResults.Num()));
-        }
         return;
     }
 
-    for (auto Result : SessionSearch->SearchResults)
+    for (int32 ResultIndex = 0; ResultIndex < SessionSearch->SearchResults.Num(); ++ResultIndex)
     {
-        FString Id = Result.GetSessionIdStr();
-        FString User = Result.Session.OwningUserName;
-        FString MatchType;
-        Result.Session.SessionSettings.Get(FName("MatchType"), MatchType);
-        
-        UE_LOG(LogTemp, Warning, TEXT("Found session - ID: %s, User: %s, MatchType: %s"), 
-            *Id, *User, *MatchType);
-
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(-1, 15.f, FColor::Cyan,
-                FString::Printf(TEXT("Session: %s, User: %s, MatchType: %s"), 
-                *Id, *User, *MatchType));
-        }
+        const FOnlineSessionSearchResult& Result = SessionSearch->SearchResults[ResultIndex];
+        const bool bMatches = FMultiplayerSessionMode::Read(Result.Session.SessionSettings).MatchType == EMultiplayerMatchType::FreeForAll;
+        MULTIPLAYER_TELEMETRY(SessionFound, NAME_None, ResultIndex, bMatches);
 
-        if (MatchType.Equals(TEXT("FreeForAll")))
+        if (bMatches)
         {
-            UE_LOG(LogTemp, Warning, TEXT("Attempting to join matching session"));
-            
             FUniqueNetIdRepl NetId = GetPlayerNetId();
             if (!NetId.IsValid())
             {
-                UE_LOG(LogTemp, Error, TEXT("Cannot join: Invalid NetId"));
+                MULTIPLAYER_TELEMETRY(NotLoggedIn, TEXT("JoinGameSession"));
                 continue;
             }
 
+            MULTIPLAYER_TELEMETRY(SessionJoinRequested, NAME_GameSession);
             OnlineSessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
             OnlineSessionInterface->JoinSession(*NetId, NAME_GameSession, Result);
             break;
@@ -318,178 +422,108 @@ void AMPTesting_CPlusPlusCharacter::OnFindSessionComplete(bool bWasSuccessful)
 
 void AMPTesting_CPlusPlusCharacter::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
 {
+    MULTIPLAYER_SESSIONS_TRACE_SCOPE(AMPTesting_CPlusPlusCharacter::OnJoinSessionComplete);
     if (!OnlineSessionInterface.IsValid())
     {
-        UE_LOG(LogTemp, Error, TEXT("OnlineSessionInterface is not valid"));
+        MULTIPLAYER_TELEMETRY(SessionInterfaceMissing);
         return;
     }
 
     FString Address;
     if (OnlineSessionInterface->GetResolvedConnectString(NAME_GameSession, Address))
     {
-        UE_LOG(LogTemp, Warning, TEXT("Resolved connect string: %s"), *Address);
-        
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(
-                -1,
-                15.f,
-                FColor::Yellow,
-                FString::Printf(TEXT("Connect String: %s"), *Address)
-            );
-        }
+        MULTIPLAYER_TELEMETRY(ConnectStringResolved, SessionName);
 
         APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
         if (PlayerController)
         {
+            TRACE_BOOKMARK(TEXT("ClientTravel GameSession"));
             PlayerController->ClientTravel(Address, TRAVEL_Absolute);
         }
     }
     else
     {
-        UE_LOG(LogTemp, Error, TEXT("Failed to get resolved connect string"));
-        if (GEngine)
-        {
-            GEngine->AddOnScreenDebugMessage(
-                -1,
-                15.f,
-                FColor::Red,
-                TEXT("Failed to get connect string")
-            );
-        }
+        MULTIPLAYER_TELEMETRY(ConnectStringFailed, SessionName);
     }
 }
 
 FString AMPTesting_CPlusPlusCharacter::NetIdToString(const FUniqueNetIdRepl& NetId) const
 {
-	if (!NetId.IsValid())
-	{
-		return TEXT("Invalid_NetId");
-	}
-    
-	// 使用 GetUniqueNetId() 方法获取原始指针
-	if (const FUniqueNetId* RawNetId = NetId.GetUniqueNetId().Get())
-	{
-		return RawNetId->ToString();
-	}
-    
-	return TEXT("Invalid_RawNetId");
+	return UMultiplayerIdentitySubsystem::NetIdToString(NetId);
 }
 
 
 void AMPTesting_CPlusPlusCharacter::DebugLoginStatus()
 {
-    IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
-    if (!OnlineSubsystem)
+    //Typed at the console, so it prints whether or not telemetry is compiled in
+    UMultiplayerIdentitySubsystem* IdentitySubsystem = GetIdentitySubsystem();
+    const ULocalPlayer* LocalPlayer = GetOwningLocalPlayer();
+    FString Message;
+    if (!IdentitySubsystem || !LocalPlayer)
     {
-        UE_LOG(LogTemp, Warning, TEXT("No OnlineSubsystem found"));
-        return;
+        Message = !IdentitySubsystem ? TEXT("No identity subsystem found") : TEXT("No local player found");
     }
-
-    UE_LOG(LogTemp, Warning, TEXT("OnlineSubsystem: %s"), *OnlineSubsystem->GetSubsystemName().ToString());
-
-    IOnlineIdentityPtr IdentityInterface = OnlineSubsystem->GetIdentityInterface();
-    if (!IdentityInterface.IsValid())
-    {
-        UE_LOG(LogTemp, Warning, TEXT("Identity interface not valid"));
-        return;
-    }
-
-    const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-    if (!LocalPlayer)
+    else
     {
-        UE_LOG(LogTemp, Warning, TEXT("No local player found"));
-        return;
+        const int32 ControllerId = LocalPlayer->GetControllerId();
+        const FUniqueNetIdRepl UserId = IdentitySubsystem->GetNetId(ControllerId);
+        Message = FString::Printf(TEXT("Login Status: %s\nUser ID: %s"),
+            ELoginStatus::ToString(IdentitySubsystem->GetLoginStatus(ControllerId)),
+            UserId.IsValid() ? *NetIdToString(UserId) : TEXT("Invalid"));
     }
 
-    int32 ControllerId = LocalPlayer->GetControllerId();
-    ELoginStatus::Type LoginStatus = IdentityInterface->GetLoginStatus(ControllerId);
-    
-    FString StatusStr;
-    switch (LoginStatus)
+    UE_LOG(LogTemplateCharacter, Display, TEXT("%s"), *Message);
+    if (GEngine)
     {
-        case ELoginStatus::NotLoggedIn: StatusStr = TEXT("Not Logged In"); break;
-        case ELoginStatus::UsingLocalProfile: StatusStr = TEXT("Using Local Profile"); break;
-        case ELoginStatus::LoggedIn: StatusStr = TEXT("Logged In"); break;
-        default: StatusStr = TEXT("Unknown Status"); break;
+        GEngine->AddOnScreenDebugMessage(-1, 10.f, FColor::Yellow, Message);
     }
+}
 
-    UE_LOG(LogTemp, Warning, TEXT("Login Status: %s"), *StatusStr);
-
-    // 获取并显示用户ID
-    TSharedPtr<const FUniqueNetId> UserId = IdentityInterface->GetUniquePlayerId(ControllerId);
-    if (UserId.IsValid())
-    {
-        UE_LOG(LogTemp, Warning, TEXT("User ID: %s"), *UserId->ToString());
-    }
-    else
+void AMPTesting_CPlusPlusCharacter::RecordLoginStatus()
+{
+#if MULTIPLAYER_TELEMETRY_ENABLED
+    UMultiplayerIdentitySubsystem* IdentitySubsystem = GetIdentitySubsystem();
+    const ULocalPlayer* LocalPlayer = GetOwningLocalPlayer();
+    if (!IdentitySubsystem || !LocalPlayer)
     {
-        UE_LOG(LogTemp, Warning, TEXT("No valid User ID"));
+        return;
     }
 
-    // 显示在屏幕上
-    if (GEngine)
-    {
-        FString Message = FString::Printf(TEXT("Login Status: %s\nUser ID: %s"), 
-            *StatusStr, 
-            UserId.IsValid() ? *UserId->ToString() : TEXT("Invalid"));
-        
-        GEngine->AddOnScreenDebugMessage(-1, 10.f, FColor::Yellow, Message);
-    }
+    // 记录登录状态, 用户ID由身份子系统在解析时记录
+    const int32 ControllerId = LocalPlayer->GetControllerId();
+    MULTIPLAYER_TELEMETRY(LoginStatus, NAME_None, ControllerId, IdentitySubsystem->GetLoginStatus(ControllerId));
+#endif
 }
 
 
 FUniqueNetIdRepl AMPTesting_CPlusPlusCharacter::GetPlayerNetId() const
 {
-	IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
-	if (!OnlineSubsystem)
-	{
-		UE_LOG(LogTemp, Warning, TEXT("No OnlineSubsystem found"));
-		return FUniqueNetIdRepl();
-	}
-
-	IOnlineIdentityPtr IdentityInterface = OnlineSubsystem->GetIdentityInterface();
-	if (!IdentityInterface.IsValid())
-	{
-		UE_LOG(LogTemp, Warning, TEXT("Identity interface not valid"));
-		return FUniqueNetIdRepl();
-	}
-
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	if (!LocalPlayer)
+	UMultiplayerIdentitySubsystem* IdentitySubsystem = GetIdentitySubsystem();
+	if (!IdentitySubsystem)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("No local player found"));
 		return FUniqueNetIdRepl();
 	}
 
-	int32 ControllerId = LocalPlayer->GetControllerId();
-    
-	// 首先尝试从身份接口获取
-	TSharedPtr<const FUniqueNetId> NetIdPtr = IdentityInterface->GetUniquePlayerId(ControllerId);
-	if (NetIdPtr.IsValid())
-	{
-		FUniqueNetIdRepl NetIdRepl(NetIdPtr);
-		UE_LOG(LogTemp, Warning, TEXT("Using NetId from Identity interface: %s"), *NetIdToString(NetIdRepl));
-		return NetIdRepl;
-	}
+	return IdentitySubsystem->GetNetIdForLocalPlayer(GetOwningLocalPlayer());
+}
 
-	// 如果身份接口没有，尝试其他方法
-	FUniqueNetIdRepl PreferredNetId = LocalPlayer->GetPreferredUniqueNetId();
-	if (PreferredNetId.IsValid())
-	{
-		UE_LOG(LogTemp, Warning, TEXT("Using PreferredUniqueNetId: %s"), *NetIdToString(PreferredNetId));
-		return PreferredNetId;
-	}
+UMultiplayerIdentitySubsystem* AMPTesting_CPlusPlusCharacter::GetIdentitySubsystem() const
+{
+	const UGameInstance* GameInstance = GetGameInstance();
+	return GameInstance ? GameInstance->GetSubsystem<UMultiplayerIdentitySubsystem>() : nullptr;
+}
 
-	FUniqueNetIdRepl CachedNetId = LocalPlayer->GetCachedUniqueNetId();
-	if (CachedNetId.IsValid())
+const ULocalPlayer* AMPTesting_CPlusPlusCharacter::GetOwningLocalPlayer() const
+{
+	//Our own controller's player first, so split-screen players don't all act as the first one
+	if (const APlayerController* PlayerController = Cast<APlayerController>(Controller))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Using CachedUniqueNetId: %s"), *NetIdToString(CachedNetId));
-		return CachedNetId;
+		if (const ULocalPlayer* LocalPlayer = PlayerController->GetLocalPlayer())
+		{
+			return LocalPlayer;
+		}
 	}
-
-	UE_LOG(LogTemp, Warning, TEXT("Could not get valid NetId from any source"));
-	return FUniqueNetIdRepl();
+	return GetWorld()->GetFirstLocalPlayerFromController();
 }
 
 
@@ -519,6 +553,14 @@ void AMPTesting_CPlusPlusCharacter::SetupPlayerInputComponent(UInputComponent* P
 
 		// Looking
 		EnhancedInputComponent->BindAction(LookAction, ETriggerEvent::Triggered, this, &AMPTesting_CPlusPlusCharacter::Look);
+
+		// Input.Record taps the same actions, Input.Replay injects into them
+		if (UInputReplaySubsystem* InputReplay = GetWorld()->GetSubsystem<UInputReplaySubsystem>())
+		{
+			InputReplay->BindRecorder(*EnhancedInputComponent, JumpAction, /*bAccumulate*/ false);
+			InputReplay->BindRecorder(*EnhancedInputComponent, MoveAction, /*bAccumulate*/ false);
+			InputReplay->BindRecorder(*EnhancedInputComponent, LookAction, /*bAccumulate*/ true);
+		}
 	}
 	else
 	{
@@ -559,6 +601,15 @@ void AMPTesting_CPlusPlusCharacter::Look(const FInputActionValue& Value)
 		// add yaw and pitch input to controller
 		AddControllerYawInput(LookAxisVector.X);
 		AddControllerPitchInput(LookAxisVector.Y);
+
+		//Controller input only reaches player controllers, bots turn their control rotation themselves
+		if (!Controller->IsPlayerController())
+		{
+			FRotator ControlRotation = Controller->GetControlRotation();
+			ControlRotation.Yaw += LookAxisVector.X;
+			ControlRotation.Pitch = FMath::ClampAngle(ControlRotation.Pitch + LookAxisVector.Y, -60.f, 60.f);
+			Controller->SetControlRotation(ControlRotation);
+		}
 	}
 }
 
@@ -5,9 +5,11 @@
 #include "CoreMinimal.h"
 #include "OnlineSubsystem.h"
 #include "GameFramework/Character.h"
+#include "Components/SkinnedMeshComponent.h"
 #include "Interfaces/OnlineSessionDelegates.h"
 #include "Logging/LogMacros.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "Engine/NetSerialization.h"
 #include "MPTesting_CPlusPlusCharacter.generated.h"
 
 
@@ -16,6 +18,9 @@ class UCameraComponent;
 class UInputMappingContext;
 class UInputAction;
 struct FInputActionValue;
+class UMultiplayerIdentitySubsystem;
+class ULocalPlayer;
+class UCombatStateComponent;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogTemplateCharacter, Log, All);
 
@@ -31,6 +36,10 @@ class AMPTesting_CPlusPlusCharacter : public ACharacter
 	/** Follow camera */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	UCameraComponent* FollowCamera;
+
+	/** Health and shield */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	UCombatStateComponent* CombatState;
 	
 	/** MappingContext */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
@@ -49,15 +58,22 @@ class AMPTesting_CPlusPlusCharacter : public ACharacter
 	UInputAction* LookAction;
 
 public:
-	AMPTesting_CPlusPlusCharacter();
-	
+	AMPTesting_CPlusPlusCharacter(const FObjectInitializer& ObjectInitializer);
 
-protected:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
-	/** Called for movement input */
+	/** Server only. Lobby maps turn players into cheap avatars, the match map keeps full characters */
+	void SetLobbyAvatarMode(bool bEnable);
+	bool IsLobbyAvatar() const { return bLobbyAvatarMode; }
+
+	/** Fires one hitscan shot, on the owning client or the listen server's own player. The server decides what it hit */
+	UFUNCTION(BlueprintCallable, Category = "Combat")
+	void FireHitscan(const FVector& Start, const FVector& Direction, float Range = 10000.f);
+
+	/** Called for movement input, from Enhanced Input or a bot's synthetic input */
 	void Move(const FInputActionValue& Value);
 
-	/** Called for looking input */
+	/** Called for looking input, from Enhanced Input or a bot's synthetic input */
 	void Look(const FInputActionValue& Value);
 			
 
@@ -67,12 +83,15 @@ protected:
 	
 	// To add mapping context
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+	/** Returns CombatState subobject **/
+	FORCEINLINE UCombatStateComponent* GetCombatState() const { return CombatState; }
 
 public:
 	//Pointer to the online session interface
@@ -80,7 +99,10 @@ public:
 	FUniqueNetIdRepl GetPlayerNetId() const;
 	FUniqueNetIdRepl CreateOfflineNetId() const;
 	FString NetIdToString(const FUniqueNetIdRepl& NetId) const;
+	UMultiplayerIdentitySubsystem* GetIdentitySubsystem() const;
+	const ULocalPlayer* GetOwningLocalPlayer() const;
 
+	/** Prints the local player's login status and net id to the log and the screen */
 	UFUNCTION(Exec)
 	void DebugLoginStatus();
 
@@ -106,6 +128,44 @@ private:
 	TSharedPtr<FOnlineSessionSearch> SessionSearch;
 	FDelegateHandle FindSessionsCompleteDelegateHandle;
 	FOnJoinSessionCompleteDelegate JoinSessionCompleteDelegate;
+
+	/** The login status as telemetry when a session call starts, compiled out with it */
+	void RecordLoginStatus();
+
+	///
+	///Lobby avatar mode: low net update rate and no movement simulation on simulated proxies,
+	///animation is throttled by UCharacterSignificanceSubsystem like everywhere else
+	///
+	UFUNCTION()
+	void OnRep_LobbyAvatarMode();
+	void ApplyLobbyAvatarMode();
+
+	UPROPERTY(ReplicatedUsing = OnRep_LobbyAvatarMode)
+	bool bLobbyAvatarMode{false};
+
+	/** Net update rate of avatars in the lobby, nobody needs 100Hz in a waiting room */
+	UPROPERTY(EditDefaultsOnly, Category = "Lobby")
+	float LobbyNetUpdateFrequency{10.f};
+
+	/** What avatar mode changed, put back when it is turned off */
+	struct FFullCharacterSettings
+	{
+		float NetUpdateFrequency{0.f};
+		float MinNetUpdateFrequency{0.f};
+		bool bCameraBoomTicks{true};
+		bool bFollowCameraActive{true};
+		EVisibilityBasedAnimTickOption AnimTickOption{EVisibilityBasedAnimTickOption::AlwaysTickPose};
+		ENetworkSmoothingMode NetworkSmoothingMode{ENetworkSmoothingMode::Exponential};
+		bool bMovementTicks{true};
+	};
+	/** Set while avatar mode is applied */
+	TOptional<FFullCharacterSettings> FullCharacterSettings;
+
+	/** Queues the shot in UWeaponTraceSubsystem, with the server time the client saw when firing */
+	UFUNCTION(Server, Unreliable)
+	void ServerFireHitscan(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, float Range, double ClientTime, uint32 ShotId);
+
+	uint32 NextShotId{0};
 	
 };
 
@@ -2,6 +2,10 @@
 
 #include "MPTesting_CPlusPlusGameMode.h"
 #include "MPTesting_CPlusPlusCharacter.h"
+#include "NetClockSyncComponent.h"
+#include "CombatStateComponent.h"
+#include "WeaponTraceSubsystem.h"
+#include "GameFramework/PlayerController.h"
 #include "UObject/ConstructorHelpers.h"
 
 AMPTesting_CPlusPlusGameMode::AMPTesting_CPlusPlusGameMode()
@@ -13,3 +17,34 @@ AMPTesting_CPlusPlusGameMode::AMPTesting_CPlusPlusGameMode()
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
 }
+
+void AMPTesting_CPlusPlusGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// the weapon traces decide who got hit, the game mode what that costs them
+	if (UWeaponTraceSubsystem* WeaponTrace = GetWorld()->GetSubsystem<UWeaponTraceSubsystem>())
+	{
+		WeaponTrace->OnWeaponHits.AddUObject(this, &ThisClass::ApplyWeaponHits);
+	}
+}
+
+void AMPTesting_CPlusPlusGameMode::GenericPlayerInitialization(AController* C)
+{
+	Super::GenericPlayerInitialization(C);
+
+	// remote players get a clock synchronized with the server
+	UNetClockSyncComponent::AddTo(Cast<APlayerController>(C));
+}
+
+void AMPTesting_CPlusPlusGameMode::ApplyWeaponHits(const TArray<FWeaponHitEvent>& HitEvents)
+{
+	for (const FWeaponHitEvent& Event : HitEvents)
+	{
+		const AMPTesting_CPlusPlusCharacter* Target = Cast<AMPTesting_CPlusPlusCharacter>(Event.Target.Get());
+		if (UCombatStateComponent* CombatState = Target ? Target->GetCombatState() : nullptr)
+		{
+			CombatState->ApplyDamage(HitscanDamage * Event.NumHits, Event.Shooter.Get(), Event.Location, Event.NumHits);
+		}
+	}
+}
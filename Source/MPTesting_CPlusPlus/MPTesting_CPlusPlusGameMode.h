@@ -6,6 +6,8 @@
 #include "GameFramework/GameModeBase.h"
 #include "MPTesting_CPlusPlusGameMode.generated.h"
 
+struct FWeaponHitEvent;
+
 UCLASS(minimalapi)
 class AMPTesting_CPlusPlusGameMode : public AGameModeBase
 {
@@ -13,6 +15,17 @@ class AMPTesting_CPlusPlusGameMode : public AGameModeBase
 
 public:
 	AMPTesting_CPlusPlusGameMode();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void GenericPlayerInitialization(AController* C) override;
+
+	/** Damage of every hitscan hit */
+	UPROPERTY(EditDefaultsOnly, Category = "Combat")
+	float HitscanDamage{20.f};
+
+private:
+	void ApplyWeaponHits(const TArray<FWeaponHitEvent>& HitEvents);
 };
 
 
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchReplaySubsystem.h"
+#include "Engine/DemoNetDriver.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Parse.h"
+#include "MPTesting_CPlusPlus.h"
+
+bool UMatchReplaySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UMatchReplaySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Clients only play replays back
+	const ENetMode NetMode = InWorld.GetNetMode();
+	if (NetMode != NM_DedicatedServer && NetMode != NM_ListenServer)
+	{
+		return;
+	}
+	bActive = true;
+
+	if (bRecordMatches || FParse::Param(FCommandLine::Get(), TEXT("RecordReplay")))
+	{
+		StartRecording();
+	}
+}
+
+void UMatchReplaySubsystem::Deinitialize()
+{
+	//The replay ends with its map, the next map starts its own
+	StopRecording();
+	bActive = false;
+
+	Super::Deinitialize();
+}
+
+TArray<FString> UMatchReplaySubsystem::GetStreamerOptions()
+{
+	return {TEXT("ReplayStreamerOverride=MultiplayerReplayStreaming")};
+}
+
+bool UMatchReplaySubsystem::StartRecording(const FString& ReplayName)
+{
+	UWorld* World = GetWorld();
+	UGameInstance* GameInstance = World->GetGameInstance();
+	if (!bActive || GameInstance == nullptr || IsRecording())
+	{
+		return false;
+	}
+
+	const FString MapName = World->GetMapName();
+	const FString Name = ReplayName.IsEmpty() ? FString::Printf(TEXT("%s_%s_%s"), *ReplayNamePrefix, *MapName, *FDateTime::Now().ToString()) : ReplayName;
+	GameInstance->StartRecordingReplay(Name, MapName, GetStreamerOptions());
+	UE_LOG(LogCombat, Display, TEXT("Recording replay %s"), *Name);
+	return IsRecording();
+}
+
+void UMatchReplaySubsystem::StopRecording()
+{
+	if (IsRecording())
+	{
+		GetWorld()->DestroyDemoNetDriver();
+	}
+}
+
+bool UMatchReplaySubsystem::IsRecording() const
+{
+	const UDemoNetDriver* DemoNetDriver = GetWorld()->GetDemoNetDriver();
+	return DemoNetDriver && DemoNetDriver->IsRecording();
+}
+
+///
+///Replay.Record [Name=], Replay.StopRecording
+///
+namespace MatchReplay
+{
+	static void Record(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UMatchReplaySubsystem* MatchReplay = World ? World->GetSubsystem<UMatchReplaySubsystem>() : nullptr;
+		if (MatchReplay == nullptr)
+		{
+			Ar.Log(TEXT("No match replay in this world"));
+			return;
+		}
+
+		FString Name;
+		FParse::Value(*FString::Join(Args, TEXT(" ")), TEXT("Name="), Name);
+		if (!MatchReplay->StartRecording(Name))
+		{
+			Ar.Log(TEXT("Can't record: only servers record, and only one replay at a time"));
+		}
+	}
+
+	static void StopRecording(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UMatchReplaySubsystem* MatchReplay = World ? World->GetSubsystem<UMatchReplaySubsystem>() : nullptr;
+		if (MatchReplay == nullptr || !MatchReplay->IsRecording())
+		{
+			Ar.Log(TEXT("Not recording"));
+			return;
+		}
+		MatchReplay->StopRecording();
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice RecordCommand(
+		TEXT("Replay.Record"),
+		TEXT("Starts a compressed server side replay of this map. Name="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Record));
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice StopRecordingCommand(
+		TEXT("Replay.StopRecording"),
+		TEXT("Finishes the server side replay"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&StopRecording));
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MatchReplaySubsystem.generated.h"
+
+/**
+ * Records a server side replay of every map the server runs, through the demo net driver and the compressed local
+ * file streamer of the MultiplayerReplayStreaming plugin, for UReplayBenchmarkSubsystem to play back offline.
+ * The demo driver serializes on the game thread at demo.RecordHz, the streamer holds one chunk in memory and
+ * compresses and writes chunks in its background file requests.
+ * Off unless bRecordMatches is set or the server runs with -RecordReplay. "Replay.Record [Name=]" and
+ * "Replay.StopRecording" on the server.
+ */
+UCLASS(config=Game)
+class MPTESTING_CPLUSPLUS_API UMatchReplaySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Empty names the replay after the map and the time */
+	bool StartRecording(const FString& ReplayName = FString());
+	void StopRecording();
+	bool IsRecording() const;
+
+	/** Replay options that select the compressed streamer, for recording and playback alike */
+	static TArray<FString> GetStreamerOptions();
+
+private:
+	UPROPERTY(Config)
+	bool bRecordMatches{false};
+
+	UPROPERTY(Config)
+	FString ReplayNamePrefix{TEXT("Match")};
+
+	bool bActive{false};
+};
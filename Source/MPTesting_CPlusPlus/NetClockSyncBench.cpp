@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetClockSyncComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Parse.h"
+#include "MPTesting_CPlusPlus.h"
+
+///
+///Checks FNetClockEstimator against a simulated link, with the settings and exchange schedule of UNetClockSyncComponent:
+///  NetClock.Bench [Seconds=120] [Rtt=80] [Jitter=20] [Asymmetry=0] [Loss=5] [Drift=50] [ServerHz=30] [ClientHz=60] [ServerWork=3] [Tolerance=5] [Seed=1]
+///Each leg takes half of Rtt ms, Asymmetry ms more one way than the other, plus 0 to Jitter ms like the PktLagVariance
+///of net emulation, and Loss percent of either leg never arrive. Requests wait for the server's next frame and their
+///replies leave ServerWork ms into it, replies wait for the client's next frame. The server clock runs Drift ppm fast.
+///The error is the estimate minus the true server time on every client frame after the join burst; PASS when its p99
+///is within Tolerance ms. Asymmetry can't be seen from round trips, half of it is always left in the error.
+///The MPTesting.NetClock.Estimator automation test runs the same simulation and fails past its tolerance.
+///
+namespace NetClockSyncBench
+{
+	struct FLink
+	{
+		float Seconds{120.f};
+		float RoundTripMs{80.f};
+		float JitterMs{20.f};
+		float AsymmetryMs{0.f};
+		float LossPercent{5.f};
+		float DriftPpm{50.f};
+		float ServerHz{30.f};
+		float ClientHz{60.f};
+		float ServerWorkMs{3.f};
+		int32 Seed{1};
+	};
+
+	struct FResult
+	{
+		int32 NumRequests{0};
+		int32 NumLost{0};
+		int32 NumAccepted{0};
+		int32 NumSamples{0};
+		int32 NumWithinBound{0};
+		int32 NumBackwards{0};
+		double SumBoundMs{0.0};
+		double DriftPpm{0.0};
+		/** On every client frame after the join burst, sorted */
+		TArray<float> ErrorsMs;
+
+		float GetQuantile(double Q) const
+		{
+			return ErrorsMs.Num() > 0 ? ErrorsMs[FMath::Clamp(FMath::CeilToInt(Q * ErrorsMs.Num()) - 1, 0, ErrorsMs.Num() - 1)] : 0.f;
+		}
+	};
+
+	struct FPendingReply
+	{
+		double ReceiveTime{0.0};
+		double SendTime{0.0};
+		double ServerTime{0.0};
+	};
+
+	static FResult Simulate(const FLink& Link)
+	{
+		const float ServerHz = FMath::Max(Link.ServerHz, 1.f);
+		const float ClientHz = FMath::Max(Link.ClientHz, 1.f);
+		const UNetClockSyncComponent* Settings = GetDefault<UNetClockSyncComponent>();
+		FNetClockEstimator Estimator;
+		Estimator.Init(Settings->GetEstimatorSettings());
+		FRandomStream Random(Link.Seed);
+
+		//Clocks far apart that run at slightly different speeds, times below are real seconds since the start
+		const double LocalStart = 5000.0;
+		const double ServerStart = 1000.0;
+		const double ServerRate = 1.0 + Link.DriftPpm * 1e-6;
+		const auto ServerClock = [&](double Time) { return ServerStart + Time * ServerRate; };
+		const auto NextFrame = [](double Time, double Hz) { return FMath::CeilToDouble(Time * Hz - UE_KINDA_SMALL_NUMBER) / Hz; };
+		const auto Leg = [&](double SkewMs) { return FMath::Max(0.0, (Link.RoundTripMs + SkewMs) * 0.5e-3 + Random.FRand() * Link.JitterMs * 1e-3); };
+		const auto Lost = [&]() { return Random.FRand() * 100.f < Link.LossPercent; };
+
+		const double MeasureFrom = Settings->GetBurstExchanges() * Settings->GetBurstInterval() + Link.RoundTripMs * 1e-3;
+		const int32 NumFrames = FMath::CeilToInt(FMath::Max(Link.Seconds, 1.f) * ClientHz);
+		TArray<FPendingReply> Pending;
+		FResult Result;
+		Result.ErrorsMs.Reserve(NumFrames);
+		double NextRequestTime = 0.0;
+		double LastEstimate = -MAX_dbl;
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			const double Time = Frame / ClientHz;
+
+			//Replies handled this frame, in the order they arrived
+			while (Pending.Num() > 0 && Pending[0].ReceiveTime <= Time + UE_KINDA_SMALL_NUMBER)
+			{
+				Result.NumAccepted += Estimator.AddSample(LocalStart + Pending[0].SendTime, Pending[0].ServerTime, LocalStart + Time) ? 1 : 0;
+				Pending.RemoveAt(0);
+			}
+
+			if (Time >= NextRequestTime)
+			{
+				++Result.NumRequests;
+				NextRequestTime = Time + (Result.NumRequests < Settings->GetBurstExchanges() ? Settings->GetBurstInterval() : Settings->GetSyncInterval());
+				if (Lost())
+				{
+					++Result.NumLost;
+				}
+				else
+				{
+					const double HandledTime = NextFrame(Time + Leg(Link.AsymmetryMs), ServerHz);
+					if (Lost())
+					{
+						++Result.NumLost;
+					}
+					else
+					{
+						Pending.Add({NextFrame(HandledTime + Link.ServerWorkMs * 1e-3 + Leg(-Link.AsymmetryMs), ClientHz), Time, ServerClock(HandledTime)});
+						Pending.Sort([](const FPendingReply& A, const FPendingReply& B) { return A.ReceiveTime < B.ReceiveTime; });
+					}
+				}
+			}
+
+			Estimator.Advance(LocalStart + Time);
+			if (!Estimator.IsSynchronized())
+			{
+				continue;
+			}
+			const double Estimate = Estimator.GetServerTime(LocalStart + Time);
+			Result.NumBackwards += Estimate < LastEstimate ? 1 : 0;
+			LastEstimate = Estimate;
+			if (Time < MeasureFrom)
+			{
+				continue;
+			}
+
+			const double Error = FMath::Abs(Estimate - ServerClock(Time));
+			const double Bound = Estimator.GetErrorBound(LocalStart + Time);
+			Result.ErrorsMs.Add(static_cast<float>(Error * 1000.0));
+			Result.NumWithinBound += Error <= Bound ? 1 : 0;
+			Result.SumBoundMs += Bound * 1000.0;
+		}
+
+		Result.ErrorsMs.Sort();
+		Result.NumSamples = Estimator.GetNumSamples();
+		Result.DriftPpm = Estimator.GetDriftPpm();
+		return Result;
+	}
+
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const FString Params = FString::Join(Args, TEXT(" "));
+		FLink Link;
+		float ToleranceMs = 5.f;
+		FParse::Value(*Params, TEXT("Seconds="), Link.Seconds);
+		FParse::Value(*Params, TEXT("Rtt="), Link.RoundTripMs);
+		FParse::Value(*Params, TEXT("Jitter="), Link.JitterMs);
+		FParse::Value(*Params, TEXT("Asymmetry="), Link.AsymmetryMs);
+		FParse::Value(*Params, TEXT("Loss="), Link.LossPercent);
+		FParse::Value(*Params, TEXT("Drift="), Link.DriftPpm);
+		FParse::Value(*Params, TEXT("ServerHz="), Link.ServerHz);
+		FParse::Value(*Params, TEXT("ClientHz="), Link.ClientHz);
+		FParse::Value(*Params, TEXT("ServerWork="), Link.ServerWorkMs);
+		FParse::Value(*Params, TEXT("Tolerance="), ToleranceMs);
+		FParse::Value(*Params, TEXT("Seed="), Link.Seed);
+
+		const FResult Result = Simulate(Link);
+		const UNetClockSyncComponent* Settings = GetDefault<UNetClockSyncComponent>();
+		const int32 NumMeasured = FMath::Max(Result.ErrorsMs.Num(), 1);
+		const bool bPassed = Result.ErrorsMs.Num() > 0 && Result.GetQuantile(0.99) <= ToleranceMs;
+
+		UE_LOG(LogCombat, Display, TEXT("Net clock bench: %.0f s, round trip %.0f ms + 0-%.0f ms jitter per leg, asymmetry %.0f ms, %.0f%% loss, drift %.0f ppm, server %.0f Hz (%.0f ms to reply), client %.0f Hz"),
+			Link.Seconds, Link.RoundTripMs, Link.JitterMs, Link.AsymmetryMs, Link.LossPercent, Link.DriftPpm, Link.ServerHz, Link.ServerWorkMs, Link.ClientHz);
+		UE_LOG(LogCombat, Display, TEXT("Exchanges: %d sent, %d lost, %d used, %d in the window; then one per %.1f s, %.1f bytes/s of payload up and %.1f down"),
+			Result.NumRequests, Result.NumLost, Result.NumAccepted, Result.NumSamples, Settings->GetSyncInterval(),
+			sizeof(double) / Settings->GetSyncInterval(), 2 * sizeof(double) / Settings->GetSyncInterval());
+		UE_LOG(LogCombat, Display, TEXT("Error: p50 %.2f p99 %.2f max %.2f ms over %d frames, %.1f%% within the error bound (%.1f ms on average), ran backwards %d times, drift measured %.1f ppm"),
+			Result.GetQuantile(0.5), Result.GetQuantile(0.99), Result.ErrorsMs.Num() > 0 ? Result.ErrorsMs.Last() : 0.f, Result.ErrorsMs.Num(),
+			100.0 * Result.NumWithinBound / NumMeasured, Result.SumBoundMs / NumMeasured, Result.NumBackwards, Result.DriftPpm);
+		if (bPassed)
+		{
+			UE_LOG(LogCombat, Display, TEXT("PASS: p99 error within %.1f ms"), ToleranceMs);
+		}
+		else
+		{
+			UE_LOG(LogCombat, Warning, TEXT("FAIL: p99 error over %.1f ms"), ToleranceMs);
+		}
+		Ar.Logf(TEXT("Net clock bench %s, results are in LogCombat"), bPassed ? TEXT("passed") : TEXT("failed"));
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("NetClock.Bench"),
+		TEXT("Checks the server clock estimate against a simulated jittery link. Seconds= Rtt= Jitter= Asymmetry= Loss= Drift= ServerHz= ClientHz= ServerWork= Tolerance= Seed="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FNetClockEstimatorTest, "MPTesting.NetClock.Estimator",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FNetClockEstimatorTest::RunTest(const FString& Parameters)
+{
+	using namespace NetClockSyncBench;
+
+	//The link NetClock.Bench defaults to, and a bad one, each over a few seeds
+	struct FCase
+	{
+		const TCHAR* Name;
+		FLink Link;
+		float ToleranceMs;
+	};
+	FLink Bad;
+	Bad.RoundTripMs = 200.f;
+	Bad.JitterMs = 50.f;
+	Bad.LossPercent = 10.f;
+	Bad.DriftPpm = 100.f;
+	const FCase Cases[] = {{TEXT("Default link"), FLink(), 5.f}, {TEXT("Bad link"), Bad, 15.f}};
+
+	for (const FCase& Case : Cases)
+	{
+		for (int32 Seed = 1; Seed <= 3; ++Seed)
+		{
+			FLink Link = Case.Link;
+			Link.Seed = Seed;
+			const FResult Result = Simulate(Link);
+			const FString What = FString::Printf(TEXT("%s, seed %d"), Case.Name, Seed);
+			if (!TestTrue(*FString::Printf(TEXT("%s synchronizes"), *What), Result.ErrorsMs.Num() > 0))
+			{
+				continue;
+			}
+			TestTrue(*FString::Printf(TEXT("%s: p99 error %.2f ms within %.1f ms"), *What, Result.GetQuantile(0.99), Case.ToleranceMs),
+				Result.GetQuantile(0.99) <= Case.ToleranceMs);
+			TestEqual(*FString::Printf(TEXT("%s: estimate never runs backwards"), *What), Result.NumBackwards, 0);
+		}
+	}
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,305 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "NetClockSyncComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+
+void FNetClockEstimator::Init(const FSettings& InSettings)
+{
+	Settings = InSettings;
+	Settings.WindowSize = FMath::Max(Settings.WindowSize, 1);
+	Reset();
+}
+
+void FNetClockEstimator::Reset()
+{
+	Samples.Reset(Settings.WindowSize);
+	NewestSample = INDEX_NONE;
+	MinRoundTrip = 0.0;
+	FitTime = 0.0;
+	FitOffset = 0.0;
+	FitHalfWidth = 0.0;
+	DriftStartTime = 0.0;
+	DriftStartOffset = 0.0;
+	Drift = 0.0;
+	Offset = 0.0;
+	LastAdvanceTime = 0.0;
+	bSynchronized = false;
+}
+
+bool FNetClockEstimator::AddSample(double LocalSendTime, double ServerTime, double LocalReceiveTime)
+{
+	const double RoundTrip = LocalReceiveTime - LocalSendTime;
+	if (RoundTrip < 0.0 || RoundTrip > Settings.MaxRoundTrip)
+	{
+		return false;
+	}
+
+	FNetClockSample Sample;
+	Sample.LocalTime = LocalSendTime + RoundTrip * 0.5;
+	Sample.Offset = ServerTime - Sample.LocalTime;
+	Sample.RoundTrip = RoundTrip;
+
+	//Unreliable replies can overtake each other, a late one has nothing to add
+	if (NewestSample != INDEX_NONE && Sample.LocalTime <= Samples[NewestSample].LocalTime)
+	{
+		return false;
+	}
+
+	if (Samples.Num() < Settings.WindowSize)
+	{
+		NewestSample = Samples.Add(Sample);
+	}
+	else
+	{
+		NewestSample = (NewestSample + 1) % Settings.WindowSize;
+		Samples[NewestSample] = Sample;
+	}
+	UpdateFit();
+	return true;
+}
+
+void FNetClockEstimator::UpdateFit()
+{
+	const FNetClockSample Newest = Samples[NewestSample];
+	const double MaxDrift = Settings.MaxDriftPpm * 1e-6;
+
+	//The overlap of every bound, as of the newest exchange
+	MinRoundTrip = MAX_dbl;
+	double Low = -MAX_dbl;
+	double High = MAX_dbl;
+	for (const FNetClockSample& Sample : Samples)
+	{
+		const double HalfWidth = Sample.RoundTrip * 0.5 + MaxDrift * (Newest.LocalTime - Sample.LocalTime);
+		Low = FMath::Max(Low, Sample.Offset - HalfWidth);
+		High = FMath::Min(High, Sample.Offset + HalfWidth);
+		MinRoundTrip = FMath::Min(MinRoundTrip, Sample.RoundTrip);
+	}
+
+	//No overlap, the server clock jumped: only the newest exchange still describes it
+	const bool bStepped = Low > High;
+	if (bStepped)
+	{
+		Samples.Reset();
+		NewestSample = Samples.Add(Newest);
+		MinRoundTrip = Newest.RoundTrip;
+		Low = Newest.Offset - Newest.RoundTrip * 0.5;
+		High = Newest.Offset + Newest.RoundTrip * 0.5;
+	}
+
+	FitTime = Newest.LocalTime;
+	FitOffset = (Low + High) * 0.5;
+	FitHalfWidth = (High - Low) * 0.5;
+
+	//The estimate wanders by a few ms as the fastest exchanges come and go, only a long span says anything about drift
+	if (bStepped || Samples.Num() == 1)
+	{
+		DriftStartTime = FitTime;
+		DriftStartOffset = FitOffset;
+		Drift = 0.0;
+	}
+	else if (FitTime - DriftStartTime >= Settings.MinDriftSpan)
+	{
+		Drift = FMath::Clamp((FitOffset - DriftStartOffset) / (FitTime - DriftStartTime), -MaxDrift, MaxDrift);
+	}
+}
+
+void FNetClockEstimator::Advance(double LocalTime)
+{
+	if (NewestSample == INDEX_NONE)
+	{
+		return;
+	}
+
+	const double Target = GetTargetOffset(LocalTime);
+	const double Gap = Target - Offset;
+	if (!bSynchronized || FMath::Abs(Gap) > Settings.StepThreshold)
+	{
+		Offset = Target;
+		bSynchronized = true;
+	}
+	else
+	{
+		const double MaxCorrection = Settings.MaxSlewRate * FMath::Max(LocalTime - LastAdvanceTime, 0.0);
+		Offset += FMath::Clamp(Gap, -MaxCorrection, MaxCorrection);
+	}
+	LastAdvanceTime = LocalTime;
+}
+
+double FNetClockEstimator::GetErrorBound(double LocalTime) const
+{
+	if (!bSynchronized)
+	{
+		return MAX_dbl;
+	}
+	const double Age = FMath::Max(LocalTime - FitTime, 0.0);
+	return FitHalfWidth + Settings.MaxDriftPpm * 1e-6 * Age + FMath::Abs(Offset - GetTargetOffset(LocalTime));
+}
+
+UNetClockSyncComponent::UNetClockSyncComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	SetIsReplicatedByDefault(true);
+}
+
+UNetClockSyncComponent* UNetClockSyncComponent::AddTo(APlayerController* PlayerController)
+{
+	if (PlayerController == nullptr || !PlayerController->HasAuthority())
+	{
+		return nullptr;
+	}
+	//Controllers kept through seamless travel bring theirs along
+	if (UNetClockSyncComponent* Existing = PlayerController->FindComponentByClass<UNetClockSyncComponent>())
+	{
+		return Existing;
+	}
+	//A listen server's own player is on the server clock already
+	if (PlayerController->IsLocalController())
+	{
+		return nullptr;
+	}
+
+	UNetClockSyncComponent* Clock = NewObject<UNetClockSyncComponent>(PlayerController, TEXT("NetClockSync"));
+	Clock->RegisterComponent();
+	return Clock;
+}
+
+double UNetClockSyncComponent::GetWorldServerTime(const UWorld* World)
+{
+	if (World->GetNetMode() != NM_Client)
+	{
+		return World->GetTimeSeconds();
+	}
+
+	const APlayerController* PlayerController = World->GetFirstPlayerController();
+	const UNetClockSyncComponent* Clock = PlayerController ? PlayerController->FindComponentByClass<UNetClockSyncComponent>() : nullptr;
+	if (Clock && Clock->IsSynchronized())
+	{
+		return Clock->GetServerTime();
+	}
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+double UNetClockSyncComponent::GetServerClock(const UWorld* World)
+{
+	//World time still belongs to the start of the last frame, FApp's last time
+	return World->GetTimeSeconds() + FMath::Max(FPlatformTime::Seconds() - FApp::GetLastTime(), 0.0);
+}
+
+double UNetClockSyncComponent::GetServerTime() const
+{
+	return Estimator.GetServerTime(FPlatformTime::Seconds());
+}
+
+double UNetClockSyncComponent::GetErrorBound() const
+{
+	return Estimator.GetErrorBound(FPlatformTime::Seconds());
+}
+
+FNetClockEstimator::FSettings UNetClockSyncComponent::GetEstimatorSettings() const
+{
+	FNetClockEstimator::FSettings Settings;
+	Settings.WindowSize = WindowSize;
+	Settings.MaxRoundTrip = MaxRoundTrip;
+	Settings.MaxDriftPpm = MaxDriftPpm;
+	Settings.MinDriftSpan = MinDriftSpan;
+	Settings.MaxSlewRate = MaxSlewRate;
+	Settings.StepThreshold = StepThreshold;
+	return Settings;
+}
+
+void UNetClockSyncComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Estimator.Init(GetEstimatorSettings());
+
+	//Player controllers only replicate to their owner, so on a client this is always the local player's
+	if (GetNetMode() == NM_Client)
+	{
+		NextRequestTime = 0.0;
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UNetClockSyncComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now >= NextRequestTime)
+	{
+		ServerRequestTime(Now);
+		++NumRequests;
+		NextRequestTime = Now + (NumRequests < BurstExchanges ? BurstInterval : SyncInterval);
+	}
+	Estimator.Advance(Now);
+}
+
+void UNetClockSyncComponent::ServerRequestTime_Implementation(double ClientSendTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastReplyTime < MinServerInterval)
+	{
+		return;
+	}
+	LastReplyTime = Now;
+	ClientReportTime(ClientSendTime, GetServerClock(GetWorld()));
+}
+
+void UNetClockSyncComponent::ClientReportTime_Implementation(double ClientSendTime, double ServerTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	if (Estimator.AddSample(ClientSendTime, ServerTime, Now))
+	{
+		++NumReplies;
+		Estimator.Advance(Now);
+	}
+}
+
+///
+///NetClock.Status
+///
+namespace NetClockSync
+{
+	static void Status(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		const UNetClockSyncComponent* Clock = PlayerController ? PlayerController->FindComponentByClass<UNetClockSyncComponent>() : nullptr;
+		if (Clock == nullptr)
+		{
+			Ar.Log(TEXT("No net clock: only clients connected to a server have one"));
+			return;
+		}
+
+		const FNetClockEstimator& Estimator = Clock->GetEstimator();
+		if (!Estimator.IsSynchronized())
+		{
+			Ar.Logf(TEXT("Net clock not synchronized yet, %d of %d exchanges answered"), Clock->GetNumReplies(), Clock->GetNumRequests());
+			return;
+		}
+
+		const double Now = FPlatformTime::Seconds();
+		const double ServerTime = Estimator.GetServerTime(Now);
+		const AGameStateBase* GameState = World->GetGameState();
+		Ar.Logf(TEXT("Net clock: server time %.3f s, error bound %.2f ms, round trip %.1f ms, drift %.1f ppm, %d exchanges in the window, %d of %d answered"),
+			ServerTime, Estimator.GetErrorBound(Now) * 1000.0, Estimator.GetRoundTripTime() * 1000.0, Estimator.GetDriftPpm(),
+			Estimator.GetNumSamples(), Clock->GetNumReplies(), Clock->GetNumRequests());
+		if (GameState)
+		{
+			Ar.Logf(TEXT("Replicated server world time is %.1f ms behind it"), (ServerTime - GameState->GetServerWorldTimeSeconds()) * 1000.0);
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice StatusCommand(
+		TEXT("NetClock.Status"),
+		TEXT("Prints the local player's estimate of the server clock"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Status));
+}
@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "NetClockSyncComponent.generated.h"
+
+class APlayerController;
+
+/** One time exchange: where it happened on the local clock, and the offset to the server clock it measured */
+struct FNetClockSample
+{
+	/** Local time halfway between sending the request and receiving the reply */
+	double LocalTime{0.0};
+	/** Server time minus local time, assuming both legs took as long */
+	double Offset{0.0};
+	double RoundTrip{0.0};
+};
+
+/**
+ * NTP style estimate of a server clock from request/reply exchanges, no networking in it (see UNetClockSyncComponent).
+ * Each exchange bounds the true offset to [Offset - RoundTrip / 2, Offset + RoundTrip / 2] however the round trip
+ * split between the two legs. The estimate is the middle of where the last WindowSize of those bounds overlap, each
+ * widened by MaxDriftPpm for its age. Jitter only ever widens a bound, so the overlap keeps the fastest leg each way
+ * and the estimate stays close however noisy the link; what is left is the asymmetry of the fastest legs. Bounds that
+ * don't overlap mean the server clock stepped (a hitch clamping its world time), and the window starts over from the
+ * newest exchange. Drift is how fast the estimate moved since the clock last stepped, once that is MinDriftSpan ago,
+ * and carries the estimate forward between exchanges.
+ * The published offset slews towards the estimate at MaxSlewRate so server time never runs backwards, and steps
+ * only when it is off by more than StepThreshold.
+ */
+class MPTESTING_CPLUSPLUS_API FNetClockEstimator
+{
+public:
+	struct FSettings
+	{
+		int32 WindowSize{32};
+		/** Exchanges slower than this are thrown away, their bound is too wide to help */
+		double MaxRoundTrip{1.0};
+		/** Cap on the measured drift, and how fast an exchange's bound widens as it ages */
+		double MaxDriftPpm{100.0};
+		/** Shortest time drift is measured over, below it none is assumed */
+		double MinDriftSpan{60.0};
+		/** Seconds of correction per second */
+		double MaxSlewRate{0.05};
+		double StepThreshold{0.1};
+	};
+
+	void Init(const FSettings& InSettings);
+	void Reset();
+
+	/** Times on the local clock, ServerTime on the server's. False when the exchange was thrown away */
+	bool AddSample(double LocalSendTime, double ServerTime, double LocalReceiveTime);
+	/** Moves the published offset towards the estimate, call every frame */
+	void Advance(double LocalTime);
+
+	bool IsSynchronized() const { return bSynchronized; }
+	double GetServerTime(double LocalTime) const { return LocalTime + Offset; }
+	double GetOffset() const { return Offset; }
+	/** Largest the error of GetServerTime can be, if the link and the drift stayed within what was measured */
+	double GetErrorBound(double LocalTime) const;
+	/** Shortest round trip in the window */
+	double GetRoundTripTime() const { return MinRoundTrip; }
+	double GetDriftPpm() const { return Drift * 1e6; }
+	int32 GetNumSamples() const { return Samples.Num(); }
+
+private:
+	double GetTargetOffset(double LocalTime) const { return FitOffset + Drift * (LocalTime - FitTime); }
+	void UpdateFit();
+
+	FSettings Settings;
+	/** Ring of the last WindowSize exchanges, NewestSample is the last one written */
+	TArray<FNetClockSample> Samples;
+	int32 NewestSample{INDEX_NONE};
+
+	double MinRoundTrip{0.0};
+	/** Middle and half width of the overlap of the bounds, at the newest exchange */
+	double FitTime{0.0};
+	double FitOffset{0.0};
+	double FitHalfWidth{0.0};
+
+	/** First estimate since the clock last stepped, drift is measured from it */
+	double DriftStartTime{0.0};
+	double DriftStartOffset{0.0};
+	double Drift{0.0};
+
+	double Offset{0.0};
+	double LastAdvanceTime{0.0};
+	bool bSynchronized{false};
+};
+
+/**
+ * Shared clock between a client and the server, on the player controller. The owning client asks the server for its
+ * time in a burst of BurstExchanges when it joins and then every SyncInterval, and feeds the replies to an
+ * FNetClockEstimator. GetServerTime is the server's world time as of now, continuous within a frame, with an error
+ * bound, where AGameStateBase::GetServerWorldTimeSeconds is a replicated value behind by a one way trip that only
+ * updates every ServerWorldTimeSecondsUpdateFrequency.
+ * Every exchange is two unreliable RPCs of 8 and 16 bytes of payload, so after the burst it costs a client a few
+ * bytes per second each way. The server answers a controller at most once per MinServerInterval whatever it is
+ * sent, which caps what a client can make it send.
+ * "NetClock.Status" on a client prints the estimate, "NetClock.Bench" checks it against a simulated jittery link.
+ */
+UCLASS(config=Game, ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class MPTESTING_CPLUSPLUS_API UNetClockSyncComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UNetClockSyncComponent();
+
+	/** Server only. Gives the controller a clock unless it already has one */
+	static UNetClockSyncComponent* AddTo(APlayerController* PlayerController);
+
+	/** Best server time the world knows: its own on the server, the local player's clock once synchronized on a client, the replicated one until then */
+	static double GetWorldServerTime(const UWorld* World);
+
+	/** Server world time right now. RPCs run in the net driver's TickDispatch, before the world adds this frame's delta */
+	static double GetServerClock(const UWorld* World);
+
+	UFUNCTION(BlueprintCallable, Category = "Net Clock")
+	double GetServerTime() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Net Clock")
+	double GetErrorBound() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Net Clock")
+	bool IsSynchronized() const { return Estimator.IsSynchronized(); }
+
+	const FNetClockEstimator& GetEstimator() const { return Estimator; }
+	FNetClockEstimator::FSettings GetEstimatorSettings() const;
+	int32 GetNumRequests() const { return NumRequests; }
+	int32 GetNumReplies() const { return NumReplies; }
+
+	///
+	///Exchange schedule, shared with NetClock.Bench
+	///
+	int32 GetBurstExchanges() const { return BurstExchanges; }
+	float GetBurstInterval() const { return BurstInterval; }
+	float GetSyncInterval() const { return SyncInterval; }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+	UFUNCTION(Server, Unreliable)
+	void ServerRequestTime(double ClientSendTime);
+
+	UFUNCTION(Client, Unreliable)
+	void ClientReportTime(double ClientSendTime, double ServerTime);
+
+private:
+	UPROPERTY(Config)
+	int32 BurstExchanges{10};
+
+	UPROPERTY(Config)
+	float BurstInterval{0.1f};
+
+	UPROPERTY(Config)
+	float SyncInterval{2.f};
+
+	UPROPERTY(Config)
+	float MinServerInterval{0.05f};
+
+	UPROPERTY(Config)
+	int32 WindowSize{32};
+
+	UPROPERTY(Config)
+	float MaxRoundTrip{1.f};
+
+	UPROPERTY(Config)
+	float MaxDriftPpm{100.f};
+
+	UPROPERTY(Config)
+	float MinDriftSpan{60.f};
+
+	UPROPERTY(Config)
+	float MaxSlewRate{0.05f};
+
+	UPROPERTY(Config)
+	float StepThreshold{0.1f};
+
+	FNetClockEstimator Estimator;
+	int32 NumRequests{0};
+	int32 NumReplies{0};
+	double NextRequestTime{0.0};
+	double LastReplyTime{0.0};
+};
@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PickupActor.h"
+#include "Components/SceneComponent.h"
+#include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "TimerManager.h"
+#include "CombatStateComponent.h"
+#include "MPTesting_CPlusPlusCharacter.h"
+#include "PickupSpawnerSubsystem.h"
+
+APickupActor::APickupActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	bReplicates = true;
+	//Pooled pickups are placed somewhere else
+	SetReplicatingMovement(true);
+	NetDormancy = DORM_DormantAll;
+	//Only matters while dormancy is flushed, how long a change waits to go out
+	NetUpdateFrequency = 10.f;
+
+	Trigger = CreateDefaultSubobject<USphereComponent>(TEXT("Trigger"));
+	Trigger->InitSphereRadius(80.f);
+	Trigger->SetCollisionProfileName(UCollisionProfile::CustomCollisionProfileName);
+	Trigger->SetCollisionObjectType(ECC_WorldDynamic);
+	Trigger->SetCollisionResponseToAllChannels(ECR_Ignore);
+	Trigger->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+	Trigger->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Trigger->SetGenerateOverlapEvents(true);
+	Trigger->SetCanEverAffectNavigation(false);
+	RootComponent = Trigger;
+
+	Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh"));
+	Mesh->SetupAttachment(Trigger);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Mesh->SetGenerateOverlapEvents(false);
+	Mesh->SetCanEverAffectNavigation(false);
+	Mesh->SetHiddenInGame(true);
+}
+
+void APickupActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(APickupActor, TypeIndex, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(APickupActor, State, Params);
+}
+
+void APickupActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UpdateMesh();
+	UpdateVisibility();
+	if (HasAuthority())
+	{
+		Trigger->OnComponentBeginOverlap.AddDynamic(this, &APickupActor::OnTriggerBeginOverlap);
+	}
+}
+
+void APickupActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(RespawnTimerHandle);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void APickupActor::Place(int32 InTypeIndex, const FTransform& Transform)
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	GetWorldTimerManager().ClearTimer(RespawnTimerHandle);
+	//Before anything changes, or the dormant channel might not see it
+	FlushNetDormancy();
+	if (TypeIndex != InTypeIndex)
+	{
+		TypeIndex = static_cast<uint8>(InTypeIndex);
+		MARK_PROPERTY_DIRTY_FROM_NAME(APickupActor, TypeIndex, this);
+		UpdateMesh();
+	}
+	SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+	SetState(EPickupState::Available);
+}
+
+void APickupActor::Park()
+{
+	if (HasAuthority())
+	{
+		GetWorldTimerManager().ClearTimer(RespawnTimerHandle);
+		SetState(EPickupState::Pooled);
+	}
+}
+
+void APickupActor::OnTriggerBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	TryGiveTo(OtherActor);
+}
+
+bool APickupActor::TryGiveTo(AActor* Actor)
+{
+	if (State != EPickupState::Available)
+	{
+		return false;
+	}
+
+	const AMPTesting_CPlusPlusCharacter* Character = Cast<AMPTesting_CPlusPlusCharacter>(Actor);
+	UCombatStateComponent* CombatState = Character ? Character->GetCombatState() : nullptr;
+	const UPickupSpawnerSubsystem* Spawner = GetWorld()->GetSubsystem<UPickupSpawnerSubsystem>();
+	const FPickupTypeSettings* Type = Spawner ? Spawner->GetType(TypeIndex) : nullptr;
+	if (CombatState == nullptr || !CombatState->IsAlive() || Type == nullptr)
+	{
+		return false;
+	}
+	if ((Type->Health > 0.f || Type->Shield > 0.f) && !CombatState->Restore(Type->Health, Type->Shield))
+	{
+		return false;
+	}
+
+	SetState(EPickupState::Taken);
+	if (Type->RespawnSeconds > 0.f)
+	{
+		GetWorldTimerManager().SetTimer(RespawnTimerHandle, this, &APickupActor::Respawn, Type->RespawnSeconds);
+	}
+	return true;
+}
+
+void APickupActor::Respawn()
+{
+	SetState(EPickupState::Available);
+}
+
+void APickupActor::SetState(EPickupState NewState)
+{
+	if (State == NewState)
+	{
+		return;
+	}
+
+	FlushNetDormancy();
+	State = NewState;
+	MARK_PROPERTY_DIRTY_FROM_NAME(APickupActor, State, this);
+	UpdateVisibility();
+}
+
+void APickupActor::UpdateMesh()
+{
+	//Nothing is drawn there
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	UPickupSpawnerSubsystem* Spawner = GetWorld()->GetSubsystem<UPickupSpawnerSubsystem>();
+	const FPickupTypeSettings* Type = Spawner ? Spawner->GetType(TypeIndex) : nullptr;
+	Mesh->SetStaticMesh(Type ? Spawner->GetTypeMesh(TypeIndex) : nullptr);
+	Mesh->SetRelativeScale3D(FVector(Type ? Type->MeshScale : 1.f));
+}
+
+void APickupActor::UpdateVisibility()
+{
+	const bool bAvailable = State == EPickupState::Available;
+	Mesh->SetHiddenInGame(!bAvailable);
+
+	//Last, enabling it reports whoever already stands there right away, and they may take it at once
+	if (HasAuthority())
+	{
+		Trigger->SetCollisionEnabled(bAvailable ? ECollisionEnabled::QueryOnly : ECollisionEnabled::NoCollision);
+	}
+}
+
+void APickupActor::OnRep_TypeIndex()
+{
+	UpdateMesh();
+}
+
+void APickupActor::OnRep_State()
+{
+	UpdateVisibility();
+}
+
+APickupSpawnPoint::APickupSpawnPoint()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
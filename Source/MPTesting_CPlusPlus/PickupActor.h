@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "PickupActor.generated.h"
+
+class UPrimitiveComponent;
+class USphereComponent;
+class UStaticMeshComponent;
+
+UENUM()
+enum class EPickupState : uint8
+{
+	/** Hidden in UPickupSpawnerSubsystem's pool */
+	Pooled,
+	Available,
+	/** Waiting to respawn in place */
+	Taken,
+};
+
+/**
+ * A map pickup of one of UPickupSpawnerSubsystem's types. Spawned and reused by the subsystem, never destroyed during
+ * a match: taking it hides it until it respawns in place, releasing it parks it in the pool until it is placed again.
+ * Net dormant for every connection: each one gets it once and then nothing until the state changes, which flushes
+ * dormancy for that one update. Idle pickups cost the server no relevancy or property checks.
+ * Overlaps are only generated on the server; clients just show the mesh of the type and hide it when not available.
+ */
+UCLASS(NotBlueprintable)
+class MPTESTING_CPLUSPLUS_API APickupActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	APickupActor();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Server only. Moves it to Transform as an available pickup of TypeIndex */
+	void Place(int32 InTypeIndex, const FTransform& Transform);
+
+	/** Server only. Hidden until placed again */
+	void Park();
+
+	EPickupState GetState() const { return State; }
+	int32 GetTypeIndex() const { return TypeIndex; }
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UFUNCTION()
+	void OnRep_TypeIndex();
+
+	UFUNCTION()
+	void OnRep_State();
+
+private:
+	UFUNCTION()
+	void OnTriggerBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	/** Gives the type's health and shield; false leaves the pickup where it is */
+	bool TryGiveTo(AActor* Actor);
+	void Respawn();
+	void SetState(EPickupState NewState);
+	void UpdateMesh();
+	void UpdateVisibility();
+
+	UPROPERTY(VisibleAnywhere, Category = "Pickup")
+	TObjectPtr<USphereComponent> Trigger;
+
+	UPROPERTY(VisibleAnywhere, Category = "Pickup")
+	TObjectPtr<UStaticMeshComponent> Mesh;
+
+	UPROPERTY(ReplicatedUsing = OnRep_TypeIndex)
+	uint8 TypeIndex{0};
+
+	UPROPERTY(ReplicatedUsing = OnRep_State)
+	EPickupState State{EPickupState::Pooled};
+
+	FTimerHandle RespawnTimerHandle;
+};
+
+/** Where UPickupSpawnerSubsystem places a pickup of PickupType when the match starts */
+UCLASS()
+class MPTESTING_CPLUSPLUS_API APickupSpawnPoint : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	APickupSpawnPoint();
+
+	/** Name of one of UPickupSpawnerSubsystem's PickupTypes */
+	UPROPERTY(EditAnywhere, Category = "Pickup")
+	FName PickupType;
+};
@@ -0,0 +1,274 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PickupSpawnerSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetworkObjectList.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Parse.h"
+#include "MultiplayerWorldTickTimer.h"
+#include "PickupActor.h"
+#include "MPTesting_CPlusPlus.h"
+
+///
+///Server net tick cost of idle pickups, with none, then Count of them dormant, then the same ones awake:
+///  Pickups.Bench [Count=500] [Seconds=10] [Spacing=300] [Type=<first of PickupTypes>]
+///Run on a listen or dedicated server with at least one client connected, nothing replicates otherwise. The pickups
+///go in a grid over the first player, high enough that nobody takes them, and are spawned in one batch through
+///UPickupSpawnerSubsystem; a second run reuses them from its pool. Each phase settles for a second, so the initial
+///replication is done, then measures from the end of the actor ticks to the end of the net flush (the net driver's
+///relevancy checks, property comparisons and sends) for Seconds. The summary goes to LogCombat at the end.
+///
+namespace PickupBench
+{
+	static constexpr float SettleSeconds = 1.f;
+
+	struct FPhase
+	{
+		const TCHAR* Name{TEXT("")};
+		int32 NumFrames{0};
+		TArray<float> NetMs;
+		double GameThreadMs{0.0};
+		int64 ActiveObjects{0};
+		int64 DormantObjects{0};
+
+		double GetAverageNetMs() const
+		{
+			double Sum = 0.0;
+			for (const float Ms : NetMs)
+			{
+				Sum += Ms;
+			}
+			return NetMs.Num() > 0 ? Sum / NetMs.Num() : 0.0;
+		}
+	};
+
+	class FBench : public TSharedFromThis<FBench>
+	{
+	public:
+		FBench(UWorld* InWorld, int32 InTypeIndex, int32 InCount, float InSeconds, float InSpacing)
+			: World(InWorld)
+			, TypeIndex(InTypeIndex)
+			, Count(InCount)
+			, Seconds(InSeconds)
+			, Spacing(InSpacing)
+		{
+			Phases.Add({TEXT("No pickups")});
+			Phases.Add({TEXT("Dormant")});
+			Phases.Add({TEXT("Awake")});
+		}
+
+		void Start()
+		{
+			PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddSP(this, &FBench::OnPostActorTick);
+			PostTickFlushHandle = World->OnPostTickFlush().AddSP(this, &FBench::OnPostTickFlush);
+			WorldTickTimer.Start(World.Get());
+			StartPhase();
+			TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FBench::Tick));
+		}
+
+	private:
+		void StartPhase()
+		{
+			PhaseTime = 0.0;
+			if (PhaseIndex == 1)
+			{
+				SpawnPickups();
+			}
+			else if (PhaseIndex == 2)
+			{
+				for (const TWeakObjectPtr<APickupActor>& Pickup : Pickups)
+				{
+					if (Pickup.IsValid())
+					{
+						Pickup->SetNetDormancy(DORM_Awake);
+					}
+				}
+			}
+		}
+
+		void SpawnPickups()
+		{
+			UPickupSpawnerSubsystem* Spawner = World->GetSubsystem<UPickupSpawnerSubsystem>();
+			const APlayerController* PlayerController = World->GetFirstPlayerController();
+			const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+			const FVector Center = (Pawn ? Pawn->GetActorLocation() : FVector::ZeroVector) + FVector(0.f, 0.f, 1000.f);
+			const int32 Side = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count)));
+
+			const int32 CreatedBefore = Spawner->GetNumCreated();
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				const FVector Offset((Index % Side - Side / 2) * Spacing, (Index / Side - Side / 2) * Spacing, 0.f);
+				if (APickupActor* Pickup = Spawner->AcquirePickup(TypeIndex, FTransform(Center + Offset)))
+				{
+					Pickups.Add(Pickup);
+				}
+			}
+			SpawnMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+			NumCreated = Spawner->GetNumCreated() - CreatedBefore;
+		}
+
+		void OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+		{
+			if (InWorld == World.Get())
+			{
+				WindowStartCycles = FPlatformTime::Cycles64();
+			}
+		}
+
+		void OnPostTickFlush()
+		{
+			if (WindowStartCycles == 0 || PhaseIndex >= Phases.Num() || PhaseTime < SettleSeconds)
+			{
+				return;
+			}
+
+			FPhase& Phase = Phases[PhaseIndex];
+			Phase.NetMs.Add(static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - WindowStartCycles)));
+			WindowStartCycles = 0;
+
+			//Last frame's world tick
+			Phase.GameThreadMs += WorldTickTimer.GetLastTickMs();
+			++Phase.NumFrames;
+			if (UNetDriver* NetDriver = World->GetNetDriver())
+			{
+				Phase.ActiveObjects += NetDriver->GetNetworkObjectList().GetActiveObjects().Num();
+				Phase.DormantObjects += NetDriver->GetNetworkObjectList().GetDormantObjectsOnAllConnections().Num();
+			}
+		}
+
+		bool Tick(float DeltaTime)
+		{
+			if (!World.IsValid() || World->GetSubsystem<UPickupSpawnerSubsystem>() == nullptr)
+			{
+				Finish();
+				return false;
+			}
+
+			PhaseTime += DeltaTime;
+			if (PhaseTime < SettleSeconds + Seconds)
+			{
+				return true;
+			}
+			if (++PhaseIndex >= Phases.Num())
+			{
+				Finish();
+				return false;
+			}
+			StartPhase();
+			return true;
+		}
+
+		void Finish();
+
+		TWeakObjectPtr<UWorld> World;
+		int32 TypeIndex{0};
+		int32 Count{0};
+		float Seconds{0.f};
+		float Spacing{0.f};
+		TArray<FPhase> Phases;
+		int32 PhaseIndex{0};
+		double PhaseTime{0.0};
+		uint64 WindowStartCycles{0};
+		TArray<TWeakObjectPtr<APickupActor>> Pickups;
+		double SpawnMs{0.0};
+		int32 NumCreated{0};
+		FDelegateHandle PostActorTickHandle;
+		FDelegateHandle PostTickFlushHandle;
+		FMultiplayerWorldTickTimer WorldTickTimer;
+		FTSTicker::FDelegateHandle TickerHandle;
+	};
+
+	static TSharedPtr<FBench> ActiveBench;
+
+	void FBench::Finish()
+	{
+		FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+		WorldTickTimer.Stop();
+		if (World.IsValid())
+		{
+			World->OnPostTickFlush().Remove(PostTickFlushHandle);
+			if (UPickupSpawnerSubsystem* Spawner = World->GetSubsystem<UPickupSpawnerSubsystem>())
+			{
+				for (const TWeakObjectPtr<APickupActor>& Pickup : Pickups)
+				{
+					if (Pickup.IsValid())
+					{
+						Pickup->SetNetDormancy(DORM_DormantAll);
+						Spawner->ReleasePickup(Pickup.Get());
+					}
+				}
+			}
+		}
+
+		const UNetDriver* NetDriver = World.IsValid() ? World->GetNetDriver() : nullptr;
+		UE_LOG(LogCombat, Display, TEXT("Pickup bench: %d pickups, %.0f s per phase, %d connections"),
+			Pickups.Num(), Seconds, NetDriver ? NetDriver->ClientConnections.Num() : 0);
+		UE_LOG(LogCombat, Display, TEXT("Spawned in one batch in %.2f ms, %d new and %d from the pool"), SpawnMs, NumCreated, Pickups.Num() - NumCreated);
+		UE_LOG(LogCombat, Display, TEXT("%12s %8s %10s %10s %10s %10s %10s %10s"),
+			TEXT("Mode"), TEXT("Frames"), TEXT("Net ms"), TEXT("p99 ms"), TEXT("Max ms"), TEXT("GT ms"), TEXT("Active"), TEXT("Dormant"));
+		for (FPhase& Phase : Phases)
+		{
+			Phase.NetMs.Sort();
+			const int32 Frames = FMath::Max(Phase.NumFrames, 1);
+			const float P99 = Phase.NetMs.Num() > 0 ? Phase.NetMs[FMath::Clamp(FMath::CeilToInt(0.99 * Phase.NetMs.Num()) - 1, 0, Phase.NetMs.Num() - 1)] : 0.f;
+			UE_LOG(LogCombat, Display, TEXT("%12s %8d %10.3f %10.3f %10.3f %10.2f %10lld %10lld"),
+				Phase.Name, Phase.NumFrames, Phase.GetAverageNetMs(), P99, Phase.NetMs.Num() > 0 ? Phase.NetMs.Last() : 0.f,
+				Phase.GameThreadMs / Frames, Phase.ActiveObjects / Frames, Phase.DormantObjects / Frames);
+		}
+		UE_LOG(LogCombat, Display, TEXT("Net tick cost of the pickups: %+.3f ms dormant, %+.3f ms awake"),
+			Phases[1].GetAverageNetMs() - Phases[0].GetAverageNetMs(), Phases[2].GetAverageNetMs() - Phases[0].GetAverageNetMs());
+
+		//Runs from our own ticker, which keeps us alive until it returns
+		ActiveBench.Reset();
+	}
+
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (ActiveBench.IsValid())
+		{
+			Ar.Log(TEXT("A pickup bench is already running"));
+			return;
+		}
+
+		UPickupSpawnerSubsystem* Spawner = World ? World->GetSubsystem<UPickupSpawnerSubsystem>() : nullptr;
+		const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		if (Spawner == nullptr || World->GetNetMode() == NM_Client || NetDriver == nullptr || NetDriver->ClientConnections.Num() == 0)
+		{
+			Ar.Log(TEXT("Needs a server with at least one client connected"));
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		int32 Count = 500;
+		float Seconds = 10.f;
+		float Spacing = 300.f;
+		FString TypeName;
+		FParse::Value(*Params, TEXT("Count="), Count);
+		FParse::Value(*Params, TEXT("Seconds="), Seconds);
+		FParse::Value(*Params, TEXT("Spacing="), Spacing);
+		FParse::Value(*Params, TEXT("Type="), TypeName);
+
+		const int32 TypeIndex = TypeName.IsEmpty() ? 0 : Spawner->FindTypeIndex(FName(*TypeName));
+		if (Spawner->GetType(TypeIndex) == nullptr)
+		{
+			Ar.Logf(TEXT("No pickup type %s"), TypeName.IsEmpty() ? TEXT("configured") : *TypeName);
+			return;
+		}
+
+		Ar.Logf(TEXT("Measuring the net tick with %d idle pickups, results are logged when done"), FMath::Max(Count, 1));
+		ActiveBench = MakeShared<FBench>(World, TypeIndex, FMath::Max(Count, 1), FMath::Max(Seconds, 1.f), FMath::Max(Spacing, 50.f));
+		ActiveBench->Start();
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("Pickups.Bench"),
+		TEXT("Measures the server net tick cost of idle pickups, dormant and awake. Count= Seconds= Spacing= Type="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
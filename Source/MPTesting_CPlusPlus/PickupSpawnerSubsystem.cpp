@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PickupSpawnerSubsystem.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "PickupActor.h"
+#include "MPTesting_CPlusPlus.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Spawn Batch"), STAT_PickupSpawnBatch, STATGROUP_Combat);
+
+bool UPickupSpawnerSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UPickupSpawnerSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (PickupTypes.Num() > MAX_uint8 + 1)
+	{
+		UE_LOG(LogCombat, Warning, TEXT("%d pickup types, only the first %d can be replicated"), PickupTypes.Num(), MAX_uint8 + 1);
+		PickupTypes.SetNum(MAX_uint8 + 1);
+	}
+	TypeMeshes.SetNum(PickupTypes.Num());
+
+	//Clients get the pickups from the server
+	if (InWorld.GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	for (TActorIterator<APickupSpawnPoint> It(&InWorld); It; ++It)
+	{
+		const int32 TypeIndex = FindTypeIndex(It->PickupType);
+		if (TypeIndex == INDEX_NONE)
+		{
+			UE_LOG(LogCombat, Warning, TEXT("%s: no pickup type %s"), *It->GetName(), *It->PickupType.ToString());
+			continue;
+		}
+		QueueSpawn(TypeIndex, It->GetActorTransform());
+	}
+	if (PendingSpawns.Num() > 0)
+	{
+		UE_LOG(LogCombat, Log, TEXT("Spawning %d pickups, %d per frame"), PendingSpawns.Num(), SpawnsPerFrame);
+	}
+}
+
+TStatId UPickupSpawnerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPickupSpawnerSubsystem, STATGROUP_Tickables);
+}
+
+void UPickupSpawnerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (PendingSpawns.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_PickupSpawnBatch);
+
+	const int32 NumToSpawn = SpawnsPerFrame > 0 ? FMath::Min(SpawnsPerFrame, PendingSpawns.Num()) : PendingSpawns.Num();
+	for (int32 Index = 0; Index < NumToSpawn; ++Index)
+	{
+		AcquirePickup(PendingSpawns[Index].TypeIndex, PendingSpawns[Index].Transform);
+	}
+	PendingSpawns.RemoveAt(0, NumToSpawn, EAllowShrinking::No);
+}
+
+void UPickupSpawnerSubsystem::QueueSpawn(int32 TypeIndex, const FTransform& Transform)
+{
+	if (PickupTypes.IsValidIndex(TypeIndex))
+	{
+		PendingSpawns.Add({TypeIndex, Transform});
+	}
+}
+
+APickupActor* UPickupSpawnerSubsystem::AcquirePickup(int32 TypeIndex, const FTransform& Transform)
+{
+	UWorld* World = GetWorld();
+	if (!PickupTypes.IsValidIndex(TypeIndex) || World->GetNetMode() == NM_Client)
+	{
+		return nullptr;
+	}
+
+	APickupActor* Pickup = nullptr;
+	while (Pickup == nullptr && Free.Num() > 0)
+	{
+		Pickup = Free.Pop(EAllowShrinking::No);
+		if (!IsValid(Pickup))
+		{
+			Pickup = nullptr;
+		}
+	}
+	if (Pickup == nullptr)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Pickup = World->SpawnActor<APickupActor>(APickupActor::StaticClass(), Transform, SpawnParameters);
+		if (Pickup == nullptr)
+		{
+			return nullptr;
+		}
+		++NumCreated;
+	}
+
+	Pickup->Place(TypeIndex, Transform);
+	Active.Add(Pickup);
+	return Pickup;
+}
+
+void UPickupSpawnerSubsystem::ReleasePickup(APickupActor* Pickup)
+{
+	if (IsValid(Pickup) && Active.RemoveSingleSwap(Pickup) > 0)
+	{
+		Pickup->Park();
+		Free.Add(Pickup);
+	}
+}
+
+void UPickupSpawnerSubsystem::ReleaseAll()
+{
+	PendingSpawns.Reset();
+	for (APickupActor* Pickup : Active)
+	{
+		if (IsValid(Pickup))
+		{
+			Pickup->Park();
+			Free.Add(Pickup);
+		}
+	}
+	Active.Reset();
+}
+
+int32 UPickupSpawnerSubsystem::FindTypeIndex(FName Name) const
+{
+	return PickupTypes.IndexOfByPredicate([Name](const FPickupTypeSettings& Type) { return Type.Name == Name; });
+}
+
+UStaticMesh* UPickupSpawnerSubsystem::GetTypeMesh(int32 TypeIndex)
+{
+	if (!PickupTypes.IsValidIndex(TypeIndex))
+	{
+		return nullptr;
+	}
+	if (TypeMeshes.Num() != PickupTypes.Num())
+	{
+		TypeMeshes.SetNum(PickupTypes.Num());
+	}
+	if (TypeMeshes[TypeIndex] == nullptr && !PickupTypes[TypeIndex].Mesh.IsNull())
+	{
+		TypeMeshes[TypeIndex] = PickupTypes[TypeIndex].Mesh.LoadSynchronous();
+		if (TypeMeshes[TypeIndex] == nullptr)
+		{
+			UE_LOG(LogCombat, Warning, TEXT("Pickup mesh %s not found"), *PickupTypes[TypeIndex].Mesh.ToString());
+		}
+	}
+	return TypeMeshes[TypeIndex];
+}
+
+///
+///Pickups.Status
+///
+namespace PickupSpawner
+{
+	static void Status(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		const UPickupSpawnerSubsystem* Spawner = World ? World->GetSubsystem<UPickupSpawnerSubsystem>() : nullptr;
+		if (Spawner == nullptr)
+		{
+			Ar.Log(TEXT("No pickup spawner in this world"));
+			return;
+		}
+
+		int32 NumAvailable = 0;
+		int32 NumTaken = 0;
+		for (const APickupActor* Pickup : Spawner->GetActivePickups())
+		{
+			NumAvailable += Pickup && Pickup->GetState() == EPickupState::Available ? 1 : 0;
+			NumTaken += Pickup && Pickup->GetState() == EPickupState::Taken ? 1 : 0;
+		}
+		Ar.Logf(TEXT("Pickups: %d placed (%d available, %d taken), %d waiting to spawn, %d pooled, %d spawned in total"),
+			Spawner->GetActivePickups().Num(), NumAvailable, NumTaken, Spawner->GetNumPending(), Spawner->GetNumPooled(), Spawner->GetNumCreated());
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice StatusCommand(
+		TEXT("Pickups.Status"),
+		TEXT("Prints how many pickups are placed, taken and pooled"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Status));
+}
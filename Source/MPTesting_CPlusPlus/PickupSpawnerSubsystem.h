@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PickupSpawnerSubsystem.generated.h"
+
+class APickupActor;
+class UStaticMesh;
+
+/** One kind of pickup, from config. Replicated as its index in PickupTypes, so clients need the same list */
+USTRUCT()
+struct FPickupTypeSettings
+{
+	GENERATED_BODY()
+
+	/** What APickupSpawnPoint::PickupType refers to */
+	UPROPERTY(Config)
+	FName Name;
+
+	UPROPERTY(Config)
+	TSoftObjectPtr<UStaticMesh> Mesh;
+
+	UPROPERTY(Config)
+	float MeshScale{1.f};
+
+	/** Seconds until it is back after being taken, 0 or less never */
+	UPROPERTY(Config)
+	float RespawnSeconds{30.f};
+
+	/** Given to the character that takes it; a pickup that gives something can't be taken at full health and shield */
+	UPROPERTY(Config)
+	float Health{0.f};
+
+	UPROPERTY(Config)
+	float Shield{0.f};
+};
+
+/**
+ * Places the map's pickups and keeps them for the whole match. On the server, begin play queues one for every
+ * APickupSpawnPoint and they are spawned SpawnsPerFrame at a time over the next frames, so hundreds of them don't
+ * land in one frame, and none are spawned after. Released pickups are parked in a pool, dormant and hidden on
+ * clients too, and placed again by the next acquire instead of a new spawn.
+ * On clients it only resolves the meshes of the types. "Pickups.Bench" measures the server net tick cost of idle
+ * pickups, dormant and awake.
+ */
+UCLASS(config=Game)
+class MPTESTING_CPLUSPLUS_API UPickupSpawnerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Spawned with the next batch */
+	void QueueSpawn(int32 TypeIndex, const FTransform& Transform);
+
+	/** Server only. Places a pooled pickup, or spawns one when the pool is empty */
+	APickupActor* AcquirePickup(int32 TypeIndex, const FTransform& Transform);
+
+	/** Server only. Parks it in the pool */
+	void ReleasePickup(APickupActor* Pickup);
+	void ReleaseAll();
+
+	int32 FindTypeIndex(FName Name) const;
+	const FPickupTypeSettings* GetType(int32 TypeIndex) const { return PickupTypes.IsValidIndex(TypeIndex) ? &PickupTypes[TypeIndex] : nullptr; }
+
+	/** Loaded on first use */
+	UStaticMesh* GetTypeMesh(int32 TypeIndex);
+
+	const TArray<TObjectPtr<APickupActor>>& GetActivePickups() const { return Active; }
+	int32 GetNumPooled() const { return Free.Num(); }
+	int32 GetNumPending() const { return PendingSpawns.Num(); }
+	int32 GetNumCreated() const { return NumCreated; }
+
+private:
+	struct FPendingSpawn
+	{
+		int32 TypeIndex{0};
+		FTransform Transform;
+	};
+
+	UPROPERTY(Config)
+	TArray<FPickupTypeSettings> PickupTypes;
+
+	/** Queued spawns placed per frame, 0 places them all in the first frame */
+	UPROPERTY(Config)
+	int32 SpawnsPerFrame{64};
+
+	UPROPERTY()
+	TArray<TObjectPtr<UStaticMesh>> TypeMeshes;
+
+	UPROPERTY()
+	TArray<TObjectPtr<APickupActor>> Active;
+
+	UPROPERTY()
+	TArray<TObjectPtr<APickupActor>> Free;
+
+	TArray<FPendingSpawn> PendingSpawns;
+	int32 NumCreated{0};
+};
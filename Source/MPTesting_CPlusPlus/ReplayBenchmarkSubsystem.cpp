@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ReplayBenchmarkSubsystem.h"
+#include "Engine/DemoNetDriver.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+#include "MatchReplaySubsystem.h"
+#include "MPTesting_CPlusPlus.h"
+
+namespace ReplayBenchmark
+{
+	/** Time the replay gets to load before the benchmark gives up on it */
+	static constexpr double StartTimeoutSeconds = 60.0;
+
+	static void WriteLine(FArchive& Writer, const FString& Line)
+	{
+		const FTCHARToUTF8 Utf8(*(Line + TEXT("\n")));
+		Writer.Serialize(const_cast<ANSICHAR*>(Utf8.Get()), Utf8.Length());
+	}
+}
+
+void UReplayBenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	FString CommandLineReplay;
+	if (FParse::Value(FCommandLine::Get(), TEXT("BenchReplay="), CommandLineReplay))
+	{
+		float CommandLineFps = 30.f;
+		FString CommandLineCsv;
+		FParse::Value(FCommandLine::Get(), TEXT("BenchReplayFps="), CommandLineFps);
+		FParse::Value(FCommandLine::Get(), TEXT("BenchReplayCsv="), CommandLineCsv);
+		StartBenchmark(CommandLineReplay, CommandLineFps, CommandLineCsv, FParse::Param(FCommandLine::Get(), TEXT("BenchReplayExit")));
+	}
+}
+
+void UReplayBenchmarkSubsystem::Deinitialize()
+{
+	if (bRunning)
+	{
+		Finish(TEXT("game instance shut down"));
+	}
+
+	Super::Deinitialize();
+}
+
+bool UReplayBenchmarkSubsystem::StartBenchmark(const FString& InReplayName, float InFps, const FString& CsvFile, bool bInExitWhenDone)
+{
+	if (bRunning)
+	{
+		return false;
+	}
+
+	ReplayName = InReplayName;
+	Fps = FMath::Max(InFps, 0.f);
+	bExitWhenDone = bInExitWhenDone;
+	CsvFileName = CsvFile.IsEmpty() ? FPaths::ProfilingDir() / FString::Printf(TEXT("ReplayBench_%s_%s.csv"), *ReplayName, *FDateTime::Now().ToString()) : CsvFile;
+	CsvWriter.Reset(IFileManager::Get().CreateFileWriter(*CsvFileName));
+	if (!CsvWriter.IsValid())
+	{
+		UE_LOG(LogCombat, Warning, TEXT("Could not open %s for the replay benchmark"), *CsvFileName);
+		return false;
+	}
+	ReplayBenchmark::WriteLine(*CsvWriter, TEXT("Frame,DemoTime,FrameMs,GameThreadMs,RenderThreadMs,Actors"));
+
+	GameThreadMs.Reset();
+	LastDemoTime = 0.f;
+	bPlaybackStarted = false;
+	bRunning = true;
+	StartRealTime = FPlatformTime::Seconds();
+	PlaybackCompleteHandle = FNetworkReplayDelegates::OnReplayPlaybackComplete.AddUObject(this, &ThisClass::OnPlaybackComplete);
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::Tick));
+	return true;
+}
+
+bool UReplayBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	UGameInstance* GameInstance = GetGameInstance();
+	UWorld* World = GameInstance->GetWorld();
+	const double Now = FPlatformTime::Seconds();
+
+	//Replays load from a running world, wait for the startup map
+	if (!bPlaybackStarted)
+	{
+		if (World && World->HasBegunPlay())
+		{
+			bPlaybackStarted = true;
+			bWasBenchmarking = FApp::IsBenchmarking();
+			bWasFixedTimeStep = FApp::UseFixedTimeStep();
+			WasFixedDeltaTime = FApp::GetFixedDeltaTime();
+			if (Fps > 0.f)
+			{
+				//Fixed steps and no waiting in between: as fast as it goes, the same frames every run
+				FApp::SetBenchmarking(true);
+				FApp::SetUseFixedTimeStep(true);
+				FApp::SetFixedDeltaTime(1.0 / Fps);
+			}
+			if (!GameInstance->PlayReplay(ReplayName, nullptr, UMatchReplaySubsystem::GetStreamerOptions()))
+			{
+				Finish(TEXT("could not start playback"));
+				return false;
+			}
+			StartRealTime = Now;
+			LastFrameRealTime = Now;
+		}
+		return true;
+	}
+
+	const UDemoNetDriver* DemoNetDriver = World ? World->GetDemoNetDriver() : nullptr;
+	if (DemoNetDriver == nullptr || !DemoNetDriver->IsPlaying())
+	{
+		if (GameThreadMs.Num() > 0)
+		{
+			Finish(TEXT("playback stopped"));
+			return false;
+		}
+		if (Now - StartRealTime > ReplayBenchmark::StartTimeoutSeconds)
+		{
+			Finish(TEXT("replay did not load"));
+			return false;
+		}
+		return true;
+	}
+
+	//The replay plays in a world of its own
+	if (WorldTickTimer.GetWorld() != World)
+	{
+		WorldTickTimer.Start(World);
+	}
+	if (WorldTickTimer.GetNumTicks() == 0)
+	{
+		LastFrameRealTime = Now;
+		return true;
+	}
+
+	const double FrameMs = (Now - LastFrameRealTime) * 1000.0;
+	LastFrameRealTime = Now;
+	const float FrameGameThreadMs = static_cast<float>(WorldTickTimer.GetLastTickMs());
+	LastDemoTime = DemoNetDriver->GetDemoCurrentTime();
+	GameThreadMs.Add(FrameGameThreadMs);
+	ReplayBenchmark::WriteLine(*CsvWriter, FString::Printf(TEXT("%d,%.3f,%.3f,%.3f,%.3f,%d"),
+		GameThreadMs.Num(), LastDemoTime, FrameMs, FrameGameThreadMs, FPlatformTime::ToMilliseconds(GRenderThreadTime), World->GetActorCount()));
+	return true;
+}
+
+void UReplayBenchmarkSubsystem::OnPlaybackComplete(UWorld* World)
+{
+	if (bRunning && World == GetGameInstance()->GetWorld())
+	{
+		Finish(TEXT("end of replay"));
+	}
+}
+
+void UReplayBenchmarkSubsystem::Finish(const TCHAR* Reason)
+{
+	bRunning = false;
+	WorldTickTimer.Stop();
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	FNetworkReplayDelegates::OnReplayPlaybackComplete.Remove(PlaybackCompleteHandle);
+	if (bPlaybackStarted)
+	{
+		FApp::SetBenchmarking(bWasBenchmarking);
+		FApp::SetUseFixedTimeStep(bWasFixedTimeStep);
+		FApp::SetFixedDeltaTime(WasFixedDeltaTime);
+	}
+	CsvWriter.Reset();
+
+	const double RealSeconds = FPlatformTime::Seconds() - StartRealTime;
+	TArray<float> Sorted = GameThreadMs;
+	Sorted.Sort();
+	double Sum = 0.0;
+	for (const float Sample : Sorted)
+	{
+		Sum += Sample;
+	}
+	const auto Quantile = [&Sorted](double Q) { return Sorted.Num() > 0 ? Sorted[FMath::Clamp(FMath::CeilToInt(Q * Sorted.Num()) - 1, 0, Sorted.Num() - 1)] : 0.f; };
+
+	UE_LOG(LogCombat, Display, TEXT("Replay bench %s (%s): %d frames, %.1f s of replay in %.1f s (x%.1f), GT avg %.2f p50 %.2f p99 %.2f max %.2f ms, per frame stats in %s"),
+		*ReplayName, Reason, Sorted.Num(), LastDemoTime, RealSeconds, RealSeconds > 0.0 ? LastDemoTime / RealSeconds : 0.0,
+		Sorted.Num() > 0 ? Sum / Sorted.Num() : 0.0, Quantile(0.5), Quantile(0.99), Sorted.Num() > 0 ? Sorted.Last() : 0.f, *CsvFileName);
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false, TEXT("ReplayBenchmark"));
+	}
+}
+
+///
+///Replay.Bench Name= [Fps=30] [Csv=] [Exit]
+///
+namespace ReplayBenchmark
+{
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		UReplayBenchmarkSubsystem* Benchmark = GameInstance ? GameInstance->GetSubsystem<UReplayBenchmarkSubsystem>() : nullptr;
+		if (Benchmark == nullptr)
+		{
+			Ar.Log(TEXT("No game instance to play a replay in"));
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		FString Name;
+		FString Csv;
+		float Fps = 30.f;
+		if (!FParse::Value(*Params, TEXT("Name="), Name))
+		{
+			Ar.Log(TEXT("Replay.Bench Name=<replay> [Fps=30] [Csv=<file>] [Exit]"));
+			return;
+		}
+		FParse::Value(*Params, TEXT("Fps="), Fps);
+		FParse::Value(*Params, TEXT("Csv="), Csv);
+
+		if (!Benchmark->StartBenchmark(Name, Fps, Csv, Args.Contains(TEXT("Exit"))))
+		{
+			Ar.Log(TEXT("A replay benchmark is already running, or its CSV could not be opened"));
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("Replay.Bench"),
+		TEXT("Plays a recorded match back at a fixed timestep as fast as possible and writes per frame stats. Name= Fps= Csv= Exit"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
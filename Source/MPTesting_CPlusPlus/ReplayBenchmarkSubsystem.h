@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "MultiplayerWorldTickTimer.h"
+#include "ReplayBenchmarkSubsystem.generated.h"
+
+/**
+ * Plays a replay recorded by UMatchReplaySubsystem back as a benchmark: a fixed timestep without waiting between
+ * frames, so it runs as fast as the machine allows and every run simulates the same frames. One CSV row per frame
+ * (demo time, frame, game thread and render thread ms, actors) goes to Saved/Profiling, the summary to LogCombat.
+ * The game thread ms are the replay world's tick, timed here since nothing draws headless to set GGameThreadTime.
+ * Run headless with -nullrhi -BenchReplay=<name> [-BenchReplayFps=30] [-BenchReplayCsv=<file>] [-BenchReplayExit],
+ * or "Replay.Bench Name= [Fps=30] [Csv=] [Exit]" from the console.
+ */
+UCLASS()
+class MPTESTING_CPLUSPLUS_API UReplayBenchmarkSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Fps 0 keeps the normal timestep, real time speed */
+	bool StartBenchmark(const FString& ReplayName, float Fps, const FString& CsvFile, bool bExitWhenDone);
+	bool IsRunning() const { return bRunning; }
+
+private:
+	bool Tick(float DeltaTime);
+	void OnPlaybackComplete(UWorld* World);
+	void Finish(const TCHAR* Reason);
+
+	FString ReplayName;
+	FString CsvFileName;
+	float Fps{30.f};
+	bool bExitWhenDone{false};
+
+	bool bRunning{false};
+	bool bPlaybackStarted{false};
+	bool bWasBenchmarking{false};
+	bool bWasFixedTimeStep{false};
+	double WasFixedDeltaTime{0.0};
+	double StartRealTime{0.0};
+	double LastFrameRealTime{0.0};
+
+	TUniquePtr<FArchive> CsvWriter;
+	TArray<float> GameThreadMs;
+	float LastDemoTime{0.f};
+	FMultiplayerWorldTickTimer WorldTickTimer;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+	FDelegateHandle PlaybackCompleteHandle;
+};
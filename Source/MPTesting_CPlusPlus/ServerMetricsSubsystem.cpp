@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerMetricsSubsystem.h"
+
+#include "HttpServerModule.h"
+#include "IHttpRouter.h"
+#include "HttpServerRequest.h"
+#include "HttpServerResponse.h"
+#include "Engine/GameInstance.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "LobbyGameState.h"
+#include "MultiplayerSessionSubsystem.h"
+
+namespace ServerMetrics
+{
+	static void AddGauge(FString& Out, const TCHAR* Name, const TCHAR* Help, double Value)
+	{
+		Out += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s gauge\n%s %.6g\n"), Name, Help, Name, Name, Value);
+	}
+
+	static void AddCounter(FString& Out, const TCHAR* Name, const TCHAR* Help, double Value)
+	{
+		Out += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s counter\n%s %.6g\n"), Name, Help, Name, Name, Value);
+	}
+
+	static void AddQuantiles(FString& Out, const TCHAR* Name, const TCHAR* Help, const float* Samples, int32 NumSamples)
+	{
+		TArray<float> Sorted(Samples, NumSamples);
+		Sorted.Sort();
+
+		Out += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s summary\n"), Name, Help, Name);
+		double Sum = 0.0;
+		for (const float Sample : Sorted)
+		{
+			Sum += Sample;
+		}
+		for (const double Quantile : {0.5, 0.9, 0.99})
+		{
+			const float Value = Sorted.Num() > 0 ? Sorted[FMath::Clamp(FMath::CeilToInt(Quantile * Sorted.Num()) - 1, 0, Sorted.Num() - 1)] : 0.f;
+			Out += FString::Printf(TEXT("%s{quantile=\"%g\"} %.3f\n"), Name, Quantile, Value);
+		}
+		Out += FString::Printf(TEXT("%s_sum %.3f\n%s_count %d\n"), Name, Sum, Name, Sorted.Num());
+	}
+}
+
+bool UServerMetricsSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UServerMetricsSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Clients have nothing an orchestrator would place
+	const ENetMode NetMode = InWorld.GetNetMode();
+	if (NetMode != NM_DedicatedServer && NetMode != NM_ListenServer)
+	{
+		return;
+	}
+
+	FParse::Value(FCommandLine::Get(), TEXT("MetricsPort="), MetricsPort);
+	FParse::Value(FCommandLine::Get(), TEXT("MetricsFile="), MetricsFile);
+
+	if (MetricsPort > 0)
+	{
+		HttpRouter = FHttpServerModule::Get().GetHttpRouter(MetricsPort, /*bFailOnBindFailure*/ true);
+		if (HttpRouter.IsValid())
+		{
+			MetricsRouteHandle = HttpRouter->BindRoute(FHttpPath(TEXT("/metrics")), EHttpServerRequestVerbs::VERB_GET,
+				FHttpRequestHandler::CreateUObject(this, &ThisClass::HandleMetricsRequest));
+			FHttpServerModule::Get().StartAllListeners();
+		}
+	}
+
+	TimeUntilFileWrite = MetricsFileInterval;
+	bActive = MetricsRouteHandle.IsValid() || !MetricsFile.IsEmpty();
+	if (bActive)
+	{
+		WorldTickTimer.Start(&InWorld);
+	}
+}
+
+void UServerMetricsSubsystem::Deinitialize()
+{
+	if (HttpRouter.IsValid() && MetricsRouteHandle.IsValid())
+	{
+		HttpRouter->UnbindRoute(MetricsRouteHandle);
+	}
+	MetricsRouteHandle.Reset();
+	HttpRouter.Reset();
+	WorldTickTimer.Stop();
+	bActive = false;
+
+	Super::Deinitialize();
+}
+
+void UServerMetricsSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bActive)
+	{
+		return;
+	}
+
+	FrameTimesMs[NextFrameTime] = DeltaTime * 1000.f;
+	GameThreadTimesMs[NextFrameTime] = static_cast<float>(WorldTickTimer.GetLastTickMs());
+	NextFrameTime = (NextFrameTime + 1) % NumFrameSamples;
+	NumFrameTimes = FMath::Min(NumFrameTimes + 1, NumFrameSamples);
+
+	if (!MetricsFile.IsEmpty())
+	{
+		TimeUntilFileWrite -= DeltaTime;
+		if (TimeUntilFileWrite <= 0.f)
+		{
+			TimeUntilFileWrite = MetricsFileInterval;
+			WriteMetricsFile();
+		}
+	}
+}
+
+TStatId UServerMetricsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UServerMetricsSubsystem, STATGROUP_Tickables);
+}
+
+FString UServerMetricsSubsystem::BuildMetricsText() const
+{
+	using namespace ServerMetrics;
+
+	FString Out;
+	Out.Reserve(4096);
+
+	AddQuantiles(Out, TEXT("mp_server_frame_ms"), TEXT("Server frame time over the last frames"), FrameTimesMs, NumFrameTimes);
+	AddQuantiles(Out, TEXT("mp_server_game_thread_ms"), TEXT("Game thread work of the world tick, net flush included, over the last frames"), GameThreadTimesMs, NumFrameTimes);
+
+	const UWorld* World = GetWorld();
+	const AGameModeBase* GameMode = World ? World->GetAuthGameMode() : nullptr;
+	AddGauge(Out, TEXT("mp_server_players"), TEXT("Players logged in"), GameMode ? GameMode->GetNumPlayers() : 0);
+	if (const ALobbyGameState* LobbyGameState = World ? World->GetGameState<ALobbyGameState>() : nullptr)
+	{
+		AddGauge(Out, TEXT("mp_lobby_players_ready"), TEXT("Lobby players marked ready"), LobbyGameState->GetNumReadyPlayers());
+	}
+
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	if (const UMultiplayerSessionSubsystem* SessionSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionSubsystem>() : nullptr)
+	{
+		const EOnlineSessionState::Type SessionState = SessionSubsystem->GetSessionState();
+		Out += TEXT("# HELP mp_session_state Online session state, 1 for the current one\n# TYPE mp_session_state gauge\n");
+		Out += FString::Printf(TEXT("mp_session_state{state=\"%s\"} 1\n"), EOnlineSessionState::ToString(SessionState));
+		AddGauge(Out, TEXT("mp_session_open_public_connections"), TEXT("Free public slots advertised on the session"), SessionSubsystem->GetNumOpenPublicConnections());
+
+		AddGauge(Out, TEXT("mp_backend_circuit_open"), TEXT("1 while online backend calls fail fast"), SessionSubsystem->GetBackendCircuit().GetState() == FMultiplayerCircuitBreaker::EState::Open ? 1 : 0);
+		AddCounter(Out, TEXT("mp_backend_circuit_opens_total"), TEXT("Times the online backend circuit opened"), SessionSubsystem->GetBackendCircuit().GetNumOpens());
+		struct FBackendCounter
+		{
+			const TCHAR* Name;
+			const TCHAR* Help;
+			uint32 FMultiplayerBackendOpStats::* Member;
+		};
+		static const FBackendCounter BackendCounters[] =
+		{
+			{TEXT("mp_backend_attempts_total"), TEXT("Online backend calls sent"), &FMultiplayerBackendOpStats::Attempts},
+			{TEXT("mp_backend_failures_total"), TEXT("Online backend calls that failed, timeouts included"), &FMultiplayerBackendOpStats::Failures},
+			{TEXT("mp_backend_timeouts_total"), TEXT("Online backend calls that never called back"), &FMultiplayerBackendOpStats::Timeouts},
+			{TEXT("mp_backend_retries_total"), TEXT("Online backend calls retried after a failure"), &FMultiplayerBackendOpStats::Retries},
+			{TEXT("mp_backend_rejected_total"), TEXT("Online backend calls failed fast by the open circuit"), &FMultiplayerBackendOpStats::Rejected},
+		};
+		for (const FBackendCounter& Counter : BackendCounters)
+		{
+			Out += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s counter\n"), Counter.Name, Counter.Help, Counter.Name);
+			for (int32 Op = 0; Op < static_cast<int32>(EMultiplayerBackendOp::Count); ++Op)
+			{
+				const FMultiplayerBackendOpStats& Stats = SessionSubsystem->GetBackendStats(static_cast<EMultiplayerBackendOp>(Op));
+				Out += FString::Printf(TEXT("%s{op=\"%s\"} %u\n"), Counter.Name, LexToString(static_cast<EMultiplayerBackendOp>(Op)), Stats.*Counter.Member);
+			}
+		}
+	}
+
+	//Read straight off the connections, the net driver keeps these up to date anyway
+	if (const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr)
+	{
+		Out += TEXT("# HELP mp_connection_rtt_ms Average round trip time per client connection\n# TYPE mp_connection_rtt_ms gauge\n");
+		FString InBytes = TEXT("# HELP mp_connection_in_bytes_per_second Bytes received per second per client connection\n# TYPE mp_connection_in_bytes_per_second gauge\n");
+		FString OutBytes = TEXT("# HELP mp_connection_out_bytes_per_second Bytes sent per second per client connection\n# TYPE mp_connection_out_bytes_per_second gauge\n");
+		for (const UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection == nullptr)
+			{
+				continue;
+			}
+			const APlayerState* PlayerState = Connection->PlayerController ? Connection->PlayerController->PlayerState : nullptr;
+			const int32 PlayerId = PlayerState ? PlayerState->GetPlayerId() : INDEX_NONE;
+			Out += FString::Printf(TEXT("mp_connection_rtt_ms{player=\"%d\"} %.1f\n"), PlayerId, Connection->AvgLag * 1000.0);
+			InBytes += FString::Printf(TEXT("mp_connection_in_bytes_per_second{player=\"%d\"} %d\n"), PlayerId, Connection->InBytesPerSecond);
+			OutBytes += FString::Printf(TEXT("mp_connection_out_bytes_per_second{player=\"%d\"} %d\n"), PlayerId, Connection->OutBytesPerSecond);
+		}
+		Out += InBytes;
+		Out += OutBytes;
+	}
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	AddGauge(Out, TEXT("mp_memory_used_physical_bytes"), TEXT("Physical memory used by the process"), MemoryStats.UsedPhysical);
+	AddGauge(Out, TEXT("mp_memory_peak_used_physical_bytes"), TEXT("Peak physical memory used by the process"), MemoryStats.PeakUsedPhysical);
+	AddGauge(Out, TEXT("mp_memory_available_physical_bytes"), TEXT("Physical memory still available on the machine"), MemoryStats.AvailablePhysical);
+
+	return Out;
+}
+
+bool UServerMetricsSubsystem::HandleMetricsRequest(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+{
+	OnComplete(FHttpServerResponse::Create(BuildMetricsText(), TEXT("text/plain; version=0.0.4")));
+	return true;
+}
+
+void UServerMetricsSubsystem::WriteMetricsFile()
+{
+	//Written aside and moved over, so a reader never sees half a file
+	const FString TempFile = MetricsFile + TEXT(".tmp");
+	if (FFileHelper::SaveStringToFile(BuildMetricsText(), *TempFile))
+	{
+		IFileManager::Get().Move(*MetricsFile, *TempFile, /*bReplace*/ true);
+	}
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "HttpRouteHandle.h"
+#include "HttpResultCallback.h"
+#include "MultiplayerWorldTickTimer.h"
+#include "ServerMetricsSubsystem.generated.h"
+
+class IHttpRouter;
+struct FHttpServerRequest;
+
+/**
+ * Health of a listen/dedicated server in Prometheus text format, for orchestrators to autoscale and bin-pack on.
+ * Served at http://127.0.0.1:<MetricsPort>/metrics (the HTTP listeners are bound to loopback in DefaultEngine.ini)
+ * and/or written to MetricsFile every MetricsFileInterval seconds. Both are off unless configured or given on the
+ * command line (-MetricsPort=, -MetricsFile=).
+ * Per frame this only stores the frame time; everything else is read when a scrape or dump asks for it.
+ */
+UCLASS(config=Game)
+class MPTESTING_CPLUSPLUS_API UServerMetricsSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Current metrics in Prometheus text exposition format */
+	FString BuildMetricsText() const;
+
+private:
+	bool HandleMetricsRequest(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete);
+	void WriteMetricsFile();
+
+	/** Port of the local metrics endpoint, 0 turns it off */
+	UPROPERTY(Config)
+	int32 MetricsPort{0};
+
+	/** File rewritten with the metrics every MetricsFileInterval seconds, empty turns it off */
+	UPROPERTY(Config)
+	FString MetricsFile;
+
+	UPROPERTY(Config)
+	float MetricsFileInterval{10.f};
+
+	static constexpr int32 NumFrameSamples = 1024;
+
+	///
+	///Rings of the last frame times and game thread work times, in milliseconds. The work is the world's own tick
+	///
+	float FrameTimesMs[NumFrameSamples]{};
+	float GameThreadTimesMs[NumFrameSamples]{};
+	int32 NumFrameTimes{0};
+	int32 NextFrameTime{0};
+	FMultiplayerWorldTickTimer WorldTickTimer;
+
+	bool bActive{false};
+	float TimeUntilFileWrite{0.f};
+
+	TSharedPtr<IHttpRouter> HttpRouter;
+	FHttpRouteHandle MetricsRouteHandle;
+};
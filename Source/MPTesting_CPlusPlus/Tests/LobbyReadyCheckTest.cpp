@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerState.h"
+#include "LobbyGameMode.h"
+#include "LobbyGameState.h"
+
+///
+///The lobby ready check against rosters with bots in them. Bots are always ready, so they must neither make up
+///a quorum for humans who aren't nor stand in for the MinPlayersToStart humans a match needs.
+///
+namespace LobbyReadyCheckTest
+{
+	static constexpr int32 NumBots = 20;
+	static constexpr int32 MinPlayersToStart = 2;
+	static constexpr float ReadyQuorum = 1.f;
+
+	struct FRoster
+	{
+		UWorld* World{nullptr};
+		TArray<FLobbyRosterEntry> Entries;
+
+		FRoster()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("LobbyReadyCheck"));
+			GEngine->CreateNewWorldContext(EWorldType::Game).SetCurrentWorld(World);
+		}
+
+		~FRoster()
+		{
+			World->DestroyWorld(false);
+			GEngine->DestroyWorldContext(World);
+		}
+
+		void Add(bool bBot, bool bReady)
+		{
+			APlayerState* PlayerState = World->SpawnActor<APlayerState>(APlayerState::StaticClass());
+			PlayerState->SetIsABot(bBot);
+			FLobbyRosterEntry& Entry = Entries.AddDefaulted_GetRef();
+			Entry.PlayerState = PlayerState;
+			Entry.PlayerId = Entries.Num();
+			Entry.SetReady(bReady);
+		}
+
+		void AddBots()
+		{
+			for (int32 Index = 0; Index < NumBots; ++Index)
+			{
+				Add(true, true);
+			}
+		}
+
+		ALobbyGameMode::FReadyCount Count() const
+		{
+			return ALobbyGameMode::CountReady(Entries, MinPlayersToStart, ReadyQuorum);
+		}
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLobbyReadyCheckTest, "MPTesting.Lobby.ReadyCheck",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FLobbyReadyCheckTest::RunTest(const FString& Parameters)
+{
+	using namespace LobbyReadyCheckTest;
+
+	{
+		FRoster Roster;
+		Roster.Add(false, false);
+		Roster.AddBots();
+		const ALobbyGameMode::FReadyCount Count = Roster.Count();
+		TestFalse(TEXT("One unready human and ready bots stay in Waiting"), Count.bQuorum);
+		TestEqual(TEXT("Bots are not counted as players"), Count.NumPlayers, 1);
+		TestEqual(TEXT("Bots are not counted as ready"), Count.NumReady, 0);
+	}
+	{
+		FRoster Roster;
+		Roster.Add(false, true);
+		Roster.AddBots();
+		TestFalse(TEXT("Bots don't make up MinPlayersToStart"), Roster.Count().bQuorum);
+	}
+	{
+		FRoster Roster;
+		Roster.Add(false, true);
+		Roster.Add(false, false);
+		Roster.AddBots();
+		TestFalse(TEXT("A human who isn't ready holds up the countdown"), Roster.Count().bQuorum);
+	}
+	{
+		FRoster Roster;
+		Roster.Add(false, true);
+		Roster.Add(false, true);
+		Roster.AddBots();
+		const ALobbyGameMode::FReadyCount Count = Roster.Count();
+		TestTrue(TEXT("Enough ready humans start the countdown, bots or not"), Count.bQuorum);
+		TestEqual(TEXT("Required players"), Count.NumRequired, 2);
+	}
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
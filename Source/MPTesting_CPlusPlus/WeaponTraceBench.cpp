@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeaponTraceSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/Parse.h"
+#include "MultiplayerWorldTickTimer.h"
+#include "MPTesting_CPlusPlus.h"
+
+///
+///Game thread cost of hitscan at increasing trace counts, batched async through UWeaponTraceSubsystem against the
+///same traces done synchronously one by one:
+///  WeaponTrace.Bench [Traces=10,100,500,1000,2000] [Frames=60] [Length=5000] [Seed=1]
+///Run on a listen or dedicated server, in the map to measure. Traces start around the first player (or the origin)
+///and go in random directions. The summary goes to LogCombat once every count has run for Frames frames.
+///
+namespace WeaponTraceBench
+{
+	/** First frames of a count still carry the previous count's batch */
+	static constexpr int32 NumWarmupFrames = 2;
+
+	struct FLevel
+	{
+		int32 NumTraces{0};
+		int32 NumFrames{0};
+		double AsyncMs{0.0};
+		double SyncMs{0.0};
+		double GameThreadMs{0.0};
+	};
+
+	class FBench : public TSharedFromThis<FBench>
+	{
+	public:
+		FBench(UWorld* InWorld, const TArray<int32>& TraceCounts, int32 InNumFrames, float InLength, int32 Seed)
+			: World(InWorld)
+			, NumFrames(InNumFrames)
+			, Length(InLength)
+			, Random(Seed)
+		{
+			for (const int32 NumTraces : TraceCounts)
+			{
+				Levels.AddDefaulted_GetRef().NumTraces = NumTraces;
+			}
+
+			const APlayerController* PlayerController = InWorld->GetFirstPlayerController();
+			const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+			Origin = Pawn ? Pawn->GetActorLocation() : FVector::ZeroVector;
+		}
+
+		void Start()
+		{
+			WorldTickTimer.Start(World.Get());
+			TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FBench::Tick));
+		}
+
+	private:
+		bool Tick(float DeltaTime)
+		{
+			UWorld* CurrentWorld = World.Get();
+			UWeaponTraceSubsystem* WeaponTrace = CurrentWorld ? CurrentWorld->GetSubsystem<UWeaponTraceSubsystem>() : nullptr;
+			if (WeaponTrace == nullptr || LevelIndex >= Levels.Num())
+			{
+				Finish();
+				return false;
+			}
+
+			//What the subsystem spent on last frame's batch, settled once the warmup frames are through
+			FLevel& Level = Levels[LevelIndex];
+			if (FrameIndex >= NumWarmupFrames)
+			{
+				const FWeaponTraceFrameStats& Stats = WeaponTrace->GetLastFrameStats();
+				Level.AsyncMs += Stats.SubmitMs + Stats.ConsumeMs;
+				Level.GameThreadMs += WorldTickTimer.GetLastTickMs();
+				++Level.NumFrames;
+			}
+
+			if (FrameIndex >= NumFrames + NumWarmupFrames)
+			{
+				FrameIndex = 0;
+				++LevelIndex;
+				return true;
+			}
+
+			FWeaponFireRequest Request;
+			for (int32 Trace = 0; Trace < Level.NumTraces; ++Trace)
+			{
+				Request.Start = Origin + Random.VRand() * Random.FRandRange(0.f, 1000.f);
+				Request.End = Request.Start + Random.VRand() * Length;
+				WeaponTrace->RequestFire(Request);
+			}
+
+			//The same amount the old way, one blocking trace after the other
+			if (FrameIndex >= NumWarmupFrames)
+			{
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				FHitResult Hit;
+				for (int32 Trace = 0; Trace < Level.NumTraces; ++Trace)
+				{
+					const FVector Start = Origin + Random.VRand() * Random.FRandRange(0.f, 1000.f);
+					CurrentWorld->LineTraceSingleByChannel(Hit, Start, Start + Random.VRand() * Length, ECC_Visibility, FCollisionQueryParams(SCENE_QUERY_STAT(WeaponTraceBench)));
+				}
+				Level.SyncMs += FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+			}
+
+			++FrameIndex;
+			return true;
+		}
+
+		void Finish();
+
+		TWeakObjectPtr<UWorld> World;
+		int32 NumFrames{0};
+		float Length{0.f};
+		FRandomStream Random;
+		FVector Origin{FVector::ZeroVector};
+		TArray<FLevel> Levels;
+		int32 LevelIndex{0};
+		int32 FrameIndex{0};
+		/** Frame GT ms, the world's tick from its start to its net flush */
+		FMultiplayerWorldTickTimer WorldTickTimer;
+		FTSTicker::FDelegateHandle TickerHandle;
+	};
+
+	static TSharedPtr<FBench> ActiveBench;
+
+	void FBench::Finish()
+	{
+		WorldTickTimer.Stop();
+		UE_LOG(LogCombat, Display, TEXT("Weapon trace bench: %d frames per count, %.0f cm traces, game thread ms per frame"), NumFrames, Length);
+		UE_LOG(LogCombat, Display, TEXT("%8s %10s %10s %12s"), TEXT("Traces"), TEXT("Async ms"), TEXT("Sync ms"), TEXT("Frame GT ms"));
+		for (const FLevel& Level : Levels)
+		{
+			const int32 Frames = FMath::Max(Level.NumFrames, 1);
+			UE_LOG(LogCombat, Display, TEXT("%8d %10.3f %10.3f %12.2f"), Level.NumTraces, Level.AsyncMs / Frames, Level.SyncMs / Frames, Level.GameThreadMs / Frames);
+		}
+
+		//Runs from our own ticker, which keeps us alive until it returns
+		ActiveBench.Reset();
+	}
+
+	static void Bench(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (ActiveBench.IsValid())
+		{
+			Ar.Log(TEXT("A weapon trace bench is already running"));
+			return;
+		}
+
+		const UWeaponTraceSubsystem* WeaponTrace = World ? World->GetSubsystem<UWeaponTraceSubsystem>() : nullptr;
+		if (WeaponTrace == nullptr || !WeaponTrace->IsActive())
+		{
+			Ar.Log(TEXT("Weapon traces only run on a listen or dedicated server"));
+			return;
+		}
+
+		const FString Params = FString::Join(Args, TEXT(" "));
+		FString Counts = TEXT("10,100,500,1000,2000");
+		int32 NumFrames = 60;
+		float Length = 5000.f;
+		int32 Seed = 1;
+		FParse::Value(*Params, TEXT("Traces="), Counts, false);
+		FParse::Value(*Params, TEXT("Frames="), NumFrames);
+		FParse::Value(*Params, TEXT("Length="), Length);
+		FParse::Value(*Params, TEXT("Seed="), Seed);
+
+		TArray<FString> CountStrings;
+		Counts.ParseIntoArray(CountStrings, TEXT(","));
+		TArray<int32> TraceCounts;
+		for (const FString& Count : CountStrings)
+		{
+			TraceCounts.Add(FMath::Max(FCString::Atoi(*Count), 0));
+		}
+
+		Ar.Logf(TEXT("Running %d trace counts for %d frames each, results are logged when done"), TraceCounts.Num(), NumFrames);
+		ActiveBench = MakeShared<FBench>(World, TraceCounts, FMath::Max(NumFrames, 1), Length, Seed);
+		ActiveBench->Start();
+	}
+
+	static FAutoConsoleCommandWithWorldArgsAndOutputDevice BenchCommand(
+		TEXT("WeaponTrace.Bench"),
+		TEXT("Times batched async hitscan against synchronous traces. Traces=10,100,... Frames= Length= Seed="),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&Bench));
+}
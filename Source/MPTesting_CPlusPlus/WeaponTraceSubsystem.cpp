@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeaponTraceSubsystem.h"
+
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "LagCompensationSubsystem.h"
+#include "MPTesting_CPlusPlus.h"
+
+DECLARE_CYCLE_STAT(TEXT("Weapon Trace Submit"), STAT_WeaponTraceSubmit, STATGROUP_Combat);
+DECLARE_CYCLE_STAT(TEXT("Weapon Trace Consume"), STAT_WeaponTraceConsume, STATGROUP_Combat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weapon Traces"), STAT_WeaponTraces, STATGROUP_Combat);
+
+namespace WeaponTrace
+{
+	static uint64 MakePairKey(const UObject* A, uint32 B)
+	{
+		return (static_cast<uint64>(A->GetUniqueID()) << 32) | B;
+	}
+
+	/** Frames between sweeps of the shooters that are gone */
+	static constexpr uint64 ShooterPruneFrames = 600;
+}
+
+bool UWeaponTraceSubsystem::FShooterShots::AcceptShotId(uint32 ShotId)
+{
+	if (ShotId > HighestShotId)
+	{
+		const uint32 Shift = ShotId - HighestShotId;
+		//The old highest becomes bit Shift - 1
+		SeenBelowHighest = Shift > 64 ? 0 : ((SeenBelowHighest << 1) | 1) << (Shift - 1);
+		HighestShotId = ShotId;
+		return true;
+	}
+
+	const uint32 Age = HighestShotId - ShotId;
+	if (Age == 0 || Age > 64)
+	{
+		return false;
+	}
+	const uint64 Bit = uint64(1) << (Age - 1);
+	if (SeenBelowHighest & Bit)
+	{
+		return false;
+	}
+	SeenBelowHighest |= Bit;
+	return true;
+}
+
+bool UWeaponTraceSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UWeaponTraceSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Shots are only ever decided on the server
+	const ENetMode NetMode = InWorld.GetNetMode();
+	bActive = NetMode == NM_DedicatedServer || NetMode == NM_ListenServer;
+}
+
+void UWeaponTraceSubsystem::Deinitialize()
+{
+	bActive = false;
+	PendingRequests.Empty();
+	Shooters.Empty();
+	InFlightTraces.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UWeaponTraceSubsystem::RequestFire(const FWeaponFireRequest& Request)
+{
+	if (!bActive || FVector::DistSquared(Request.Start, Request.End) > FMath::Square(MaxRange))
+	{
+		return false;
+	}
+
+	if (const ACharacter* Shooter = Request.Shooter.Get())
+	{
+		//A client can aim anywhere, but it can only shoot from where it stands
+		const UCapsuleComponent* Capsule = Shooter->GetCapsuleComponent();
+		const float MaxDistance = Capsule->GetScaledCapsuleHalfHeight() + MaxMuzzleDistance;
+		if (FVector::DistSquared(Request.Start, Capsule->GetComponentLocation()) > FMath::Square(MaxDistance))
+		{
+			UE_LOG(LogCombat, Verbose, TEXT("%s fired from %.0f cm away, refused"), *Shooter->GetName(), FVector::Dist(Request.Start, Capsule->GetComponentLocation()));
+			return false;
+		}
+
+		FShooterShots& Shots = Shooters.FindOrAdd(Shooter);
+		if (Shots.Frame != GFrameCounter)
+		{
+			Shots.Frame = GFrameCounter;
+			Shots.NumThisFrame = 0;
+		}
+		if (Shots.NumThisFrame >= MaxShotsPerShooterPerFrame)
+		{
+			UE_LOG(LogCombat, Verbose, TEXT("%s is over %d shots this frame, refused"), *Shooter->GetName(), MaxShotsPerShooterPerFrame);
+			return false;
+		}
+		//A replayed shot stays refused however long after the first one it comes
+		if (!Shots.AcceptShotId(Request.ShotId))
+		{
+			return false;
+		}
+		++Shots.NumThisFrame;
+	}
+
+	PendingRequests.Add(Request);
+	return true;
+}
+
+void UWeaponTraceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bActive)
+	{
+		return;
+	}
+
+	//Last frame's traces first: their handles are only good for this frame
+	ConsumeResults();
+	SubmitRequests();
+
+	if (GFrameCounter % WeaponTrace::ShooterPruneFrames == 0)
+	{
+		for (auto It = Shooters.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+}
+
+TStatId UWeaponTraceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeaponTraceSubsystem, STATGROUP_Tickables);
+}
+
+void UWeaponTraceSubsystem::SubmitRequests()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponTraceSubmit);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	UWorld* World = GetWorld();
+	const int32 NumToSubmit = FMath::Min(PendingRequests.Num(), MaxTracesPerFrame);
+	InFlightTraces.Reset(NumToSubmit);
+	for (int32 Index = 0; Index < NumToSubmit; ++Index)
+	{
+		const FWeaponFireRequest& Request = PendingRequests[Index];
+		FCollisionQueryParams Params(SCENE_QUERY_STAT(WeaponTrace), /*bTraceComplex*/ false, Request.Shooter.Get());
+		FInFlightTrace& Trace = InFlightTraces.AddDefaulted_GetRef();
+		Trace.Request = Request;
+		Trace.Handle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Request.Start, Request.End, TraceChannel, Params);
+	}
+	PendingRequests.RemoveAt(0, NumToSubmit, EAllowShrinking::No);
+
+	INC_DWORD_STAT_BY(STAT_WeaponTraces, NumToSubmit);
+	LastFrameStats.NumSubmitted = NumToSubmit;
+	LastFrameStats.SubmitMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+}
+
+void UWeaponTraceSubsystem::ConsumeResults()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponTraceConsume);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	UWorld* World = GetWorld();
+	ULagCompensationSubsystem* LagCompensation = World->GetSubsystem<ULagCompensationSubsystem>();
+
+	//Index of each shooter/target pair's event, so a burst into one target replicates as one event
+	TMap<uint64, int32> EventIndices;
+	HitEvents.Reset();
+	int32 NumConsumed = 0;
+	int32 NumLost = 0;
+	for (const FInFlightTrace& Trace : InFlightTraces)
+	{
+		FTraceDatum Datum;
+		if (!World->QueryTraceData(Trace.Handle, Datum))
+		{
+			++NumLost;
+			continue;
+		}
+		++NumConsumed;
+
+		//Stop where the world blocked the shot, then see who stood in the way back when the client fired
+		const FHitResult* BlockingHit = Datum.OutHits.FindByPredicate([](const FHitResult& Hit) { return Hit.bBlockingHit; });
+		const FVector End = BlockingHit ? BlockingHit->Location : Trace.Request.End;
+		FLagCompensatedHit Hit;
+		if (LagCompensation == nullptr || !LagCompensation->TraceRewound(Trace.Request.Start, End, Trace.Request.ClientTime, Trace.Request.Shooter.Get(), Hit))
+		{
+			continue;
+		}
+
+		const ACharacter* Shooter = Trace.Request.Shooter.Get();
+		const uint64 Key = Shooter ? WeaponTrace::MakePairKey(Shooter, Hit.Character->GetUniqueID()) : Hit.Character->GetUniqueID();
+		if (const int32* EventIndex = EventIndices.Find(Key))
+		{
+			++HitEvents[*EventIndex].NumHits;
+			continue;
+		}
+
+		EventIndices.Add(Key, HitEvents.Num());
+		FWeaponHitEvent& Event = HitEvents.AddDefaulted_GetRef();
+		Event.Shooter = Trace.Request.Shooter;
+		Event.Target = Hit.Character;
+		Event.NumHits = 1;
+		Event.ShotId = Trace.Request.ShotId;
+		Event.Bone = Hit.Bone;
+		Event.Location = Hit.Location;
+	}
+	InFlightTraces.Reset();
+
+	if (NumLost > 0)
+	{
+		NumLostResults += NumLost;
+		UE_LOG(LogCombat, Warning, TEXT("%d weapon trace results missing this frame, %d lost so far"), NumLost, NumLostResults);
+	}
+
+	LastFrameStats.NumConsumed = NumConsumed;
+	LastFrameStats.NumHitEvents = HitEvents.Num();
+	LastFrameStats.ConsumeMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+
+	if (HitEvents.Num() > 0)
+	{
+		OnWeaponHits.Broadcast(HitEvents);
+	}
+}
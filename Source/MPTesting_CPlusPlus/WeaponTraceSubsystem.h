@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "WeaponTraceSubsystem.generated.h"
+
+class ACharacter;
+
+/** One hitscan shot as the shooter's client saw it */
+struct FWeaponFireRequest
+{
+	TWeakObjectPtr<ACharacter> Shooter;
+	FVector Start{FVector::ZeroVector};
+	FVector End{FVector::ZeroVector};
+	/** Server time the client fired at, what lag compensation rewinds to */
+	double ClientTime{0.0};
+	/** Counts up per shooter, a shot id that was already seen is refused */
+	uint32 ShotId{0};
+};
+
+/** Every hit one shooter landed on one target in a frame, what gets replicated instead of each trace */
+struct FWeaponHitEvent
+{
+	TWeakObjectPtr<ACharacter> Shooter;
+	TWeakObjectPtr<ACharacter> Target;
+	int32 NumHits{0};
+	/** Of the first hit */
+	uint32 ShotId{0};
+	FName Bone;
+	FVector Location{FVector::ZeroVector};
+};
+
+/** Cost of the last frame's batch, for the benchmark and stat Combat */
+struct FWeaponTraceFrameStats
+{
+	int32 NumSubmitted{0};
+	int32 NumConsumed{0};
+	int32 NumHitEvents{0};
+	double SubmitMs{0.0};
+	double ConsumeMs{0.0};
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnWeaponHits, const TArray<FWeaponHitEvent>& /*HitEvents*/);
+
+/**
+ * Server side hitscan. Fire requests are collected during the frame and go out together at the end of it as async
+ * line traces against the world; the frame after, their results are read in one batch, the characters each shot
+ * reached are found by rewinding them with ULagCompensationSubsystem, and hits are merged per shooter and target
+ * into OnWeaponHits. Nothing waits on the physics scene on the game thread.
+ * TraceChannel should be one characters ignore (Visibility in the default profiles): the world decides where a shot
+ * stops, lag compensation decides who it hit on the way. Servers only. "WeaponTrace.Bench" measures the cost.
+ */
+UCLASS(config=Game)
+class MPTESTING_CPLUSPLUS_API UWeaponTraceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Queues a shot for this frame's batch. False if it was refused: a shot id seen before or too old to tell,
+	 * over the shooter's shots for this frame, too long, or fired from too far off the shooter
+	 */
+	bool RequestFire(const FWeaponFireRequest& Request);
+
+	bool IsActive() const { return bActive; }
+	int32 GetNumPendingRequests() const { return PendingRequests.Num(); }
+	const FWeaponTraceFrameStats& GetLastFrameStats() const { return LastFrameStats; }
+
+	/** Once a frame, with every hit of the batch that came back */
+	FOnWeaponHits OnWeaponHits;
+
+private:
+	void ConsumeResults();
+	void SubmitRequests();
+
+	UPROPERTY(Config)
+	TEnumAsByte<ECollisionChannel> TraceChannel{ECC_Visibility};
+
+	UPROPERTY(Config)
+	float MaxRange{20000.f};
+
+	/** How far from the shooter's capsule a shot may start, muzzles stick out a bit */
+	UPROPERTY(Config)
+	float MaxMuzzleDistance{250.f};
+
+	/** Traces submitted per frame at most, the rest wait for the next frame */
+	UPROPERTY(Config)
+	int32 MaxTracesPerFrame{2048};
+
+	/** Shots one character may ask for in a server frame, a client flooding the RPC can't grow the queue past it */
+	UPROPERTY(Config)
+	int32 MaxShotsPerShooterPerFrame{8};
+
+	struct FInFlightTrace
+	{
+		FWeaponFireRequest Request;
+		FTraceHandle Handle;
+	};
+
+	/** Shots a character asked for. The RPC is unreliable, so ids may arrive out of order within the window */
+	struct FShooterShots
+	{
+		uint32 HighestShotId{0};
+		/** Bit N set: HighestShotId - 1 - N was seen. Ids further back are refused */
+		uint64 SeenBelowHighest{0};
+		uint64 Frame{0};
+		int32 NumThisFrame{0};
+
+		/** False for an id that was seen before or is too old to tell, otherwise records it */
+		bool AcceptShotId(uint32 ShotId);
+	};
+
+	bool bActive{false};
+	TArray<FWeaponFireRequest> PendingRequests;
+	TMap<TWeakObjectPtr<const ACharacter>, FShooterShots> Shooters;
+	TArray<FInFlightTrace> InFlightTraces;
+	TArray<FWeaponHitEvent> HitEvents;
+	int32 NumLostResults{0};
+	FWeaponTraceFrameStats LastFrameStats;
+};